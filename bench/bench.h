@@ -0,0 +1,58 @@
+#ifndef FN_BENCH_H
+#define FN_BENCH_H
+
+/*
+ * Helpers shared by host benchmarks
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+// Run fn() repeatedly for at least min_seconds, return the average duration of one run in seconds
+template <typename Fn>
+double bench_run(Fn &&fn, double min_seconds = 0.5)
+{
+    using clock = std::chrono::steady_clock;
+    fn(); // warm up
+
+    long runs = 0;
+    auto start = clock::now();
+    double elapsed = 0;
+    do
+    {
+        fn();
+        runs++;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    } while (elapsed < min_seconds);
+
+    return elapsed / runs;
+}
+
+// Print one result line, bytes processed by one run and its duration
+inline void bench_report(const char *name, size_t bytes, double seconds)
+{
+    printf("%-40s %10.1f MB/s %12.3f us/run\n", name, bytes / seconds / 1e6, seconds * 1e6);
+}
+
+// Deterministic pseudo-random test data
+inline std::vector<uint8_t> bench_random_data(size_t len, uint32_t seed = 1)
+{
+    std::mt19937 gen(seed);
+    std::vector<uint8_t> data(len);
+    for (auto &b : data)
+        b = gen() & 0xFF;
+    return data;
+}
+
+// Keep the optimizer from discarding results
+template <typename T>
+inline void bench_keep(const T &value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+#endif // FN_BENCH_H
@@ -0,0 +1,101 @@
+/*
+ * Base64 and hash throughput (FUJI BASE64 / HASH commands)
+ * Data arrives in 512 byte pieces, as from a network receive buffer or the client. One-shot
+ * conversion of everything is compared with the incremental encoder / decoder and hash contexts,
+ * which need memory only for the output instead of the whole input.
+ * Hashes are only measured if MbedTLS was found.
+ */
+
+#include <string.h>
+
+#include <string>
+
+#include "bench.h"
+#include "base64.h"
+#ifdef FN_BENCH_HASH
+#include "hash.h"
+#endif
+
+#define DATA_SIZE (1024 * 1024)
+#define CHUNK 512
+
+int main()
+{
+    std::vector<uint8_t> data = bench_random_data(DATA_SIZE);
+    bool ok = true;
+
+    printf("Encoding: %d bytes in %d byte pieces\n", DATA_SIZE, CHUNK);
+
+    size_t enc_len = 0;
+    double t = bench_run([&]() {
+        auto p = Base64::encode(data.data(), data.size(), &enc_len);
+        bench_keep(p);
+    });
+    bench_report("base64 encode (one-shot)", DATA_SIZE, t);
+    auto encoded_p = Base64::encode(data.data(), data.size(), &enc_len);
+    std::string encoded(encoded_p.get(), enc_len);
+
+    std::string out;
+    t = bench_run([&]() {
+        Base64::Encoder encoder;
+        out.clear();
+        for (size_t pos = 0; pos < data.size(); pos += CHUNK)
+            encoder.update(data.data() + pos, std::min((size_t)CHUNK, data.size() - pos), out);
+        encoder.finalize(out);
+    });
+    bench_report("base64 Encoder", DATA_SIZE, t);
+    ok = ok && out == encoded;
+
+    size_t dec_len = 0;
+    t = bench_run([&]() {
+        auto p = Base64::decode(encoded.data(), encoded.size(), &dec_len);
+        bench_keep(p);
+    });
+    bench_report("base64 decode (one-shot)", DATA_SIZE, t);
+
+    t = bench_run([&]() {
+        Base64::Decoder decoder;
+        out.clear();
+        for (size_t pos = 0; pos < encoded.size(); pos += CHUNK)
+            decoder.update(encoded.data() + pos, std::min((size_t)CHUNK, encoded.size() - pos), out);
+        ok = decoder.finalize(out) && ok;
+    });
+    bench_report("base64 Decoder", DATA_SIZE, t);
+    ok = ok && out.size() == data.size() && memcmp(out.data(), data.data(), data.size()) == 0;
+
+    printf("%-40s %zu bytes one-shot, %zu bytes incremental\n", "  encode memory",
+           data.size() + enc_len, enc_len);
+
+#ifdef FN_BENCH_HASH
+    static const char *names[] = {"MD5", "SHA1", "SHA256", "SHA512"};
+    for (int a = 0; a < 4; a++)
+    {
+        uint8_t digest[64];
+        t = bench_run([&]() {
+            Hash::Context ctx;
+            ctx.start(static_cast<Hash::Algorithm>(a));
+            for (size_t pos = 0; pos < data.size(); pos += CHUNK)
+                ctx.update(data.data() + pos, std::min((size_t)CHUNK, data.size() - pos));
+            ctx.finalize(digest);
+        });
+        bench_report((std::string("hash ") + names[a]).c_str(), DATA_SIZE, t);
+    }
+
+    // FUJI HASH INPUT: algorithm is not known until HASH COMPUTE, so all of them are updated
+    std::vector<uint8_t> chunk(CHUNK);
+    t = bench_run([&]() {
+        hasher.clear();
+        for (size_t pos = 0; pos < data.size(); pos += CHUNK)
+        {
+            memcpy(chunk.data(), data.data() + pos, CHUNK);
+            hasher.add_data(chunk);
+        }
+        hasher.compute(Hash::Algorithm::SHA256, true);
+    });
+    bench_report("Hash (FUJI HASH INPUT)", DATA_SIZE, t);
+    printf("%-40s %s\n", "  SHA256", hasher.output_hex().c_str());
+#endif
+
+    printf("round trip: %s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
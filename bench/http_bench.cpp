@@ -0,0 +1,229 @@
+/*
+ * Web configurator static files
+ * Requests per second for web UI files served by mongoose, read from the file for every
+ * request (previous send_file) and from the asset cache: full response, gzip variant and
+ * "304 Not Modified" revalidation. Client runs in a thread over loopback with keep-alive.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "bench.h"
+#include "httpServiceAssets.h"
+
+#define LISTEN_URL "http://127.0.0.1:8734"
+#define LISTEN_PORT 8734
+#define SEND_BUFF_SIZE 4096
+
+static const char *files[] = {"css/core.css", "js/settings.js", "js/select.js", "favicon.ico"};
+
+static fnHttpServiceAssets assets;
+static bool use_cache = false;
+
+static std::string read_file(const std::string &path)
+{
+    std::string content;
+    FILE *f = fopen(path.c_str(), "rb");
+    if (f == nullptr)
+        return content;
+    fseek(f, 0, SEEK_END);
+    content.resize(ftell(f));
+    fseek(f, 0, SEEK_SET);
+    content.resize(fread(&content[0], 1, content.size(), f));
+    fclose(f);
+    return content;
+}
+
+static std::string webui_path(const char *file)
+{
+    // templates are used as they are, the content does not matter here
+    std::string path = std::string(FN_WEBUI_DIR) + "/" + file;
+    if (access(path.c_str(), R_OK) != 0)
+    {
+        size_t dot = path.rfind('.');
+        path.insert(dot, ".tmpl");
+    }
+    return path;
+}
+
+// previous send_file(): open, malloc, read and send in chunks for each request
+static void send_file_uncached(mg_connection *c, const char *file)
+{
+    FILE *f = fopen(webui_path(file).c_str(), "rb");
+    if (f == nullptr)
+    {
+        mg_http_reply(c, 400, "", "Error opening file\n");
+        return;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    mg_printf(c, "HTTP/1.1 200 OK\r\nContent-Type: text/css\r\nContent-Length: %lu\r\n\r\n", (unsigned long)size);
+    char *buf = (char *)malloc(SEND_BUFF_SIZE);
+    size_t count;
+    while ((count = fread(buf, 1, SEND_BUFF_SIZE, f)) > 0)
+        mg_send(c, buf, count);
+    free(buf);
+    fclose(f);
+}
+
+static void cb(mg_connection *c, int ev, void *ev_data)
+{
+    if (ev != MG_EV_HTTP_MSG)
+        return;
+    mg_http_message *hm = (mg_http_message *)ev_data;
+    std::string file(hm->query.ptr, hm->query.len);
+    if (use_cache)
+    {
+        const fnHttpAsset *asset = assets.find(file);
+        if (asset != nullptr)
+            fnHttpServiceAssets::send(c, asset, "text/css", hm);
+        else
+            mg_http_reply(c, 404, "", "Not found\n");
+    }
+    else
+    {
+        send_file_uncached(c, file.c_str());
+    }
+    c->is_resp = 0;
+}
+
+// Blocking keep-alive client, returns number of body bytes received
+static size_t client_run(int requests, const char *extra_headers, std::atomic<bool> &failed)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(LISTEN_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        failed = true;
+        return 0;
+    }
+
+    size_t body_bytes = 0;
+    std::string buf;
+    char chunk[16384];
+    for (int i = 0; i < requests && !failed; i++)
+    {
+        const char *file = files[i % (sizeof(files) / sizeof(files[0]))];
+        std::string etag_header;
+        if (extra_headers != nullptr && strcmp(extra_headers, "etag") == 0)
+        {
+            const fnHttpAsset *asset = assets.find(file);
+            etag_header = "If-None-Match: " + asset->etag + "\r\n";
+        }
+        else if (extra_headers != nullptr)
+        {
+            etag_header = extra_headers;
+        }
+        std::string req = std::string("GET /file?") + file + " HTTP/1.1\r\nHost: fujinet\r\n" + etag_header + "\r\n";
+        send(fd, req.data(), req.size(), 0);
+
+        // read header, then Content-Length bytes of body
+        size_t header_end;
+        while ((header_end = buf.find("\r\n\r\n")) == std::string::npos)
+        {
+            ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0)
+            {
+                failed = true;
+                break;
+            }
+            buf.append(chunk, n);
+        }
+        if (failed)
+            break;
+        size_t length = 0;
+        size_t cl = buf.find("Content-Length: ");
+        if (cl != std::string::npos && cl < header_end)
+            length = strtoul(buf.c_str() + cl + 16, nullptr, 10);
+        while (buf.size() < header_end + 4 + length)
+        {
+            ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0)
+            {
+                failed = true;
+                break;
+            }
+            buf.append(chunk, n);
+        }
+        body_bytes += length;
+        buf.erase(0, header_end + 4 + length);
+    }
+    close(fd);
+    return body_bytes;
+}
+
+static void run(mg_mgr *mgr, const char *name, bool cache, int requests, const char *extra_headers)
+{
+    use_cache = cache;
+    std::atomic<bool> done(false);
+    std::atomic<bool> failed(false);
+    size_t bytes = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread client([&]() {
+        bytes = client_run(requests, extra_headers, failed);
+        done = true;
+    });
+    while (!done)
+        mg_mgr_poll(mgr, 1);
+    client.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (failed)
+        printf("%-28s FAILED\n", name);
+    else
+        printf("%-28s %10.0f req/s %10.1f KB/request\n", name, requests / seconds, bytes / 1024.0 / requests);
+}
+
+int main(int argc, char **argv)
+{
+    int requests = argc > 1 ? atoi(argv[1]) : 20000;
+
+    // web UI as FujiNet-PC build would prepare it, with gzip variants
+    for (const char *file : files)
+    {
+        std::string content = read_file(webui_path(file));
+        std::string gz_path = "/tmp/fn_http_bench.gz";
+        FILE *f = fopen("/tmp/fn_http_bench", "wb");
+        fwrite(content.data(), 1, content.size(), f);
+        fclose(f);
+        std::string gzip;
+        if (system("gzip -9 -n -c /tmp/fn_http_bench > /tmp/fn_http_bench.gz") == 0)
+            gzip = read_file(gz_path);
+        // as build_webui.py, only if it saves at least 10%
+        if (!gzip.empty() && gzip.size() < content.size() * 9 / 10)
+            assets.add(std::string(file) + ".gz", std::move(gzip));
+        assets.add(file, std::move(content));
+    }
+    printf("Web UI files: %zu, %zu bytes cached, %d requests per run\n", assets.count(), assets.bytes(), requests);
+
+    mg_mgr mgr;
+    mg_mgr_init(&mgr);
+    if (mg_http_listen(&mgr, LISTEN_URL, cb, nullptr) == nullptr)
+    {
+        printf("Cannot listen on %s\n", LISTEN_URL);
+        return 1;
+    }
+
+    run(&mgr, "file per request", false, requests, nullptr);
+    run(&mgr, "cached", true, requests, nullptr);
+    run(&mgr, "cached, gzip", true, requests, "Accept-Encoding: gzip, deflate\r\n");
+    run(&mgr, "cached, 304 revalidation", true, requests, "etag");
+
+    mg_mgr_free(&mgr);
+    return 0;
+}
@@ -0,0 +1,291 @@
+/*
+ * Printer emulator throughput
+ * Print jobs are fed through each printer_emu subclass in 40 byte records, as the Atari SIO
+ * printer device does, with printer output written to a temporary directory. Reports input throughput and heap
+ * allocations per job. Fonts for the PDF printers are read from data/webui/common/f.
+ *
+ * Optional argument is a directory where output of each job is written, to compare versions.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "bench.h"
+#include "fsFlash.h"
+
+#include "file_printer.h"
+#include "html_printer.h"
+#include "atari_820.h"
+#include "atari_822.h"
+#include "atari_825.h"
+#include "atari_1020.h"
+#include "atari_1025.h"
+#include "atari_1027.h"
+#include "atari_1029.h"
+#include "atari_xdm121.h"
+#include "atari_xmm801.h"
+#include "epson_80.h"
+#include "okimate_10.h"
+#include "png_printer.h"
+
+#define SIO_RECORD_LEN 40
+
+// Heap allocation counter, calls are passed on to glibc allocator
+static size_t allocs = 0;
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t n, size_t size);
+extern "C" void *__libc_realloc(void *p, size_t size);
+
+extern "C" void *malloc(size_t size)
+{
+    allocs++;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t n, size_t size)
+{
+    allocs++;
+    return __libc_calloc(n, size);
+}
+
+extern "C" void *realloc(void *p, size_t size)
+{
+    allocs++;
+    return __libc_realloc(p, size);
+}
+
+// File system keeping printer output in current (temporary) directory
+class BenchFileSystem : public FileSystem
+{
+public:
+    fsType type() override { return FSTYPE_COUNT; }
+    const char *typestring() override { return "bench"; }
+
+    FILE *file_open(const char *path, const char *mode) override
+    {
+        return fopen(path + 1, mode);
+    }
+
+    std::string contents(const char *path)
+    {
+        std::string data;
+        FILE *f = file_open(path, "rb");
+        if (f != nullptr)
+        {
+            char buf[4096];
+            size_t n;
+            while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+                data.append(buf, n);
+            fclose(f);
+        }
+        return data;
+    }
+
+    bool exists(const char *path) override { return access(path + 1, F_OK) == 0; }
+    bool remove(const char *path) override { return false; }
+    bool rename(const char *pathFrom, const char *pathTo) override { return false; }
+    bool is_dir(const char *path) override { return false; }
+    bool mkdir(const char *path) override { return false; }
+    bool rmdir(const char *path) override { return false; }
+    bool dir_exists(const char *path) override { return false; }
+    bool dir_open(const char *path, const char *pattern, uint16_t diroptions) override { return false; }
+    fsdir_entry_t *dir_read() override { return nullptr; }
+    void dir_close() override {}
+    uint16_t dir_tell() override { return FNFS_INVALID_DIRPOS; }
+    bool dir_seek(uint16_t position) override { return false; }
+};
+
+typedef std::vector<std::vector<uint8_t>> job_t;
+
+// Split line into SIO records, last one ends with EOL
+static void add_line(job_t &job, const std::string &line)
+{
+    size_t pos = 0;
+    while (line.size() - pos >= SIO_RECORD_LEN)
+    {
+        job.emplace_back(line.begin() + pos, line.begin() + pos + SIO_RECORD_LEN);
+        pos += SIO_RECORD_LEN;
+    }
+    std::vector<uint8_t> rec(line.begin() + pos, line.end());
+    rec.push_back(ATASCII_EOL);
+    job.push_back(rec);
+}
+
+static size_t job_bytes(const job_t &job)
+{
+    size_t n = 0;
+    for (const auto &rec : job)
+        n += rec.size();
+    return n;
+}
+
+// BASIC program listing
+static job_t listing_job(int lines)
+{
+    static const char *words[] = {"PRINT", "GOTO", "FOR", "NEXT", "IF", "THEN", "POKE", "PEEK(", "X", "Y(I)", "\"HELLO, WORLD\"",
+                                  "=", "+", "*", ";", "(A-B)/2", "CHR$(", "USR(1536)", "REM", "DIM", "A$(40)"};
+    std::mt19937 gen(1);
+    job_t job;
+    for (int i = 0; i < lines; i++)
+    {
+        std::string line = std::to_string((i + 1) * 10) + " ";
+        int n = 2 + gen() % 14;
+        for (int w = 0; w < n; w++)
+        {
+            line += words[gen() % (sizeof(words) / sizeof(words[0]))];
+            line += ' ';
+        }
+        add_line(job, line);
+    }
+    return job;
+}
+
+// Listing with Epson style modes: bold, italic, expanded, underline
+static job_t epson_job(int lines)
+{
+    job_t listing = listing_job(lines);
+    job_t job;
+    int i = 0;
+    for (auto &rec : listing)
+    {
+        static const char *modes[][2] = {{"\x1b" "E", "\x1b" "F"}, {"\x1b" "4", "\x1b" "5"}, {"\x0e", "\x14"}, {"\x1b-\x01", "\x1b-\x00"}};
+        auto &m = modes[i++ % 8 % 4];
+        if (i % 8 < 4)
+        {
+            // mode on for part of the line
+            std::vector<uint8_t> r(m[0], m[0] + strlen(m[0]) + (m[0][1] == '-' ? 1 : 0));
+            r.insert(r.end(), rec.begin(), rec.begin() + rec.size() / 2);
+            r.insert(r.end(), m[1], m[1] + strlen(m[1]) + (m[1][1] == '-' ? 1 : 0));
+            r.insert(r.end(), rec.begin() + rec.size() / 2, rec.end());
+            job.push_back(r);
+        }
+        else
+            job.push_back(rec);
+    }
+    return job;
+}
+
+// Atari 1020 graphics: text, then plotting commands
+static job_t plotter_job(int lines)
+{
+    std::mt19937 gen(2);
+    job_t job = listing_job(lines / 4);
+    job.push_back({27, 7, ATASCII_EOL}); // graphics mode
+    for (int i = 0; i < lines; i++)
+    {
+        std::string cmd = "C" + std::to_string(i % 4) + "*M" + std::to_string(gen() % 400) + ",-" + std::to_string(gen() % 400) +
+                          "*D" + std::to_string(gen() % 400) + ",-" + std::to_string(gen() % 400) +
+                          "*J" + std::to_string(gen() % 20) + "," + std::to_string(gen() % 20) + ":-10,5";
+        add_line(job, cmd);
+    }
+    job.push_back({'A', ATASCII_EOL});
+    return job;
+}
+
+// GRANTIC screen dump: line repeat count and 320 pixels per line
+static job_t png_job()
+{
+    std::vector<uint8_t> stream;
+    for (int y = 0; y < 192; y++)
+    {
+        stream.push_back(1);
+        for (int x = 0; x < 320; x++)
+            stream.push_back(((x / 16) + (y / 12)) & 1 ? 0x0F : (x * y) % 7 == 0 ? 0x44 : 0);
+    }
+    job_t job;
+    for (size_t pos = 0; pos < stream.size(); pos += SIO_RECORD_LEN)
+        job.emplace_back(stream.begin() + pos, stream.begin() + std::min(stream.size(), pos + SIO_RECORD_LEN));
+    return job;
+}
+
+static BenchFileSystem benchfs;
+
+static void print_job(printer_emu *p, const job_t &job)
+{
+    p->initPrinter(&benchfs);
+    for (const auto &rec : job)
+    {
+        memcpy(p->provideBuffer(), rec.data(), rec.size());
+        p->process(rec.size(), 'N', 0);
+    }
+    p->closeOutput();
+}
+
+static void bench_printer(const char *name, std::function<printer_emu *()> make, const job_t &job, const char *outdir)
+{
+    double t = bench_run([&]() {
+        std::unique_ptr<printer_emu> p(make());
+        print_job(p.get(), job);
+    });
+    bench_report(name, job_bytes(job), t);
+
+    size_t before = allocs;
+    {
+        std::unique_ptr<printer_emu> p(make());
+        print_job(p.get(), job);
+    }
+    std::string output = benchfs.contents("/paper");
+    printf("%-40s %zu allocations, %zu bytes output\n", "", allocs - before, output.size());
+
+    if (outdir != nullptr)
+    {
+        std::string fn = std::string(outdir) + "/" + name;
+        FILE *f = fopen(fn.c_str(), "wb");
+        if (f != nullptr)
+        {
+            fwrite(output.data(), 1, output.size(), f);
+            fclose(f);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *outdir = argc > 1 ? argv[1] : nullptr;
+    if (outdir != nullptr)
+        outdir = realpath(outdir, nullptr);
+
+    // fsFlash reads fonts from data/f relative to current directory
+    char tmpdir[] = "/tmp/fnbenchXXXXXX";
+    if (mkdtemp(tmpdir) == nullptr || chdir(tmpdir) != 0 || ::mkdir("data", 0755) != 0 ||
+        symlink(FN_FONT_DIR, "data/f") != 0)
+    {
+        perror("font directory");
+        return 1;
+    }
+    fsFlash.start();
+
+    job_t listing = listing_job(2000);
+    job_t epson = epson_job(2000);
+    job_t plotter = plotter_job(400);
+    job_t screen = png_job();
+
+    printf("Printer emulators: listing %zu bytes, epson %zu bytes, plotter %zu bytes, screen %zu bytes\n",
+           job_bytes(listing), job_bytes(epson), job_bytes(plotter), job_bytes(screen));
+
+    bench_printer("file RAW", []() { return new filePrinter(RAW); }, listing, outdir);
+    bench_printer("file TRIM", []() { return new filePrinter(TRIM); }, listing, outdir);
+    bench_printer("file ASCII", []() { return new filePrinter(ASCII); }, listing, outdir);
+    bench_printer("HTML", []() { return new htmlPrinter(HTML); }, listing, outdir);
+    bench_printer("Atari 820", []() { return new atari820; }, listing, outdir);
+    bench_printer("Atari 822", []() { return new atari822; }, listing, outdir);
+    bench_printer("Atari 825", []() { return new atari825; }, listing, outdir);
+    bench_printer("Atari 1025", []() { return new atari1025; }, listing, outdir);
+    bench_printer("Atari 1027", []() { return new atari1027; }, listing, outdir);
+    bench_printer("Atari 1029", []() { return new atari1029; }, listing, outdir);
+    bench_printer("Atari XDM121", []() { return new xdm121; }, listing, outdir);
+    bench_printer("Okimate 10", []() { return new okimate10; }, listing, outdir);
+    bench_printer("Epson 80", []() { return new epson80; }, epson, outdir);
+    bench_printer("Atari XMM801", []() { return new xmm801; }, epson, outdir);
+    bench_printer("Atari 1020", []() { return new atari1020; }, plotter, outdir);
+    bench_printer("PNG", []() { return new pngPrinter; }, screen, outdir);
+
+    return 0;
+}
@@ -0,0 +1,303 @@
+/*
+ * SmartPort block cache
+ * Replays ProDOS block request traces against PO and DO images, with the cached MediaTypePO /
+ * MediaTypeDO and with the previous per block access (seek + read of the block, two sectors for DO).
+ * Reads, writes and seeks on the image are counted, on the device each read or write is a request
+ * to the storage (a TNFS/SMB round trip for network mounted images).
+ *
+ * A trace file can be given as argument, one request per line: "R <block>" or "W <block>".
+ * Default is a synthetic ProDOS boot followed by CAT of the volume directory and loading a file.
+ */
+
+#include <dlfcn.h>
+#include <string.h>
+
+#include "bench.h"
+#include "mediaTypePO.h"
+#include "mediaTypeDO.h"
+
+#define IMAGE_BLOCKS 280
+
+// Only used for high score blocks of 2MG images, not exercised here
+fnFile *fujiHost::fnfile_open(const char * /*path*/, char * /*fullpath*/, int /*fullpathlen*/, const char * /*mode*/)
+{
+    return nullptr;
+}
+
+// stdio calls on the image file are counted by interposing them
+struct io_counts_t
+{
+    size_t reads;
+    size_t writes;
+    size_t seeks;
+};
+
+static FILE *counted_file = nullptr;
+static io_counts_t counts;
+
+template <typename Fn>
+static Fn real_fn(const char *name)
+{
+    return (Fn)dlsym(RTLD_NEXT, name);
+}
+
+extern "C" size_t fread(void *ptr, size_t size, size_t n, FILE *f)
+{
+    static auto real = real_fn<size_t (*)(void *, size_t, size_t, FILE *)>("fread");
+    if (f == counted_file)
+        counts.reads++;
+    return real(ptr, size, n, f);
+}
+
+extern "C" size_t fwrite(const void *ptr, size_t size, size_t n, FILE *f)
+{
+    static auto real = real_fn<size_t (*)(const void *, size_t, size_t, FILE *)>("fwrite");
+    if (f == counted_file)
+        counts.writes++;
+    return real(ptr, size, n, f);
+}
+
+extern "C" int fseek(FILE *f, long off, int whence)
+{
+    static auto real = real_fn<int (*)(FILE *, long, int)>("fseek");
+    if (f == counted_file)
+        counts.seeks++;
+    return real(f, off, whence);
+}
+
+static FILE *open_image(const std::vector<uint8_t> &image)
+{
+    FILE *f = tmpfile();
+    ::fwrite(image.data(), 1, image.size(), f);
+    ::rewind(f);
+    counted_file = f;
+    counts = {0, 0, 0};
+    return f;
+}
+
+struct request_t
+{
+    bool write;
+    uint32_t block;
+};
+
+static std::vector<request_t> default_trace()
+{
+    std::vector<request_t> t;
+    auto read = [&](uint32_t first, uint32_t count) {
+        for (uint32_t b = first; b < first + count; b++)
+            t.push_back({false, b});
+    };
+    // boot: boot blocks, volume directory, bitmap, PRODOS system file, BASIC.SYSTEM
+    read(0, 2);
+    read(2, 4);
+    read(6, 1);
+    read(7, 1);
+    read(8, 34);
+    read(2, 1);
+    read(42, 21);
+    // CAT: volume directory blocks
+    read(2, 4);
+    // BLOAD of a 20 block file: directory, index block, data
+    read(2, 1);
+    read(63, 1);
+    read(64, 20);
+    // BSAVE of 4 blocks: directory, bitmap, data blocks, updated directory and bitmap
+    read(2, 1);
+    read(6, 1);
+    for (uint32_t b = 84; b < 88; b++)
+        t.push_back({true, b});
+    t.push_back({true, 2});
+    t.push_back({true, 6});
+    return t;
+}
+
+static std::vector<request_t> load_trace(const char *path)
+{
+    std::vector<request_t> t;
+    FILE *f = fopen(path, "r");
+    if (f == nullptr)
+        return t;
+    char op;
+    unsigned block;
+    while (fscanf(f, " %c %u", &op, &block) == 2)
+        t.push_back({op == 'W' || op == 'w', block});
+    fclose(f);
+    return t;
+}
+
+// The previous PO access: seek unless the block follows the last one, read or write 512 bytes
+static void replay_reference_po(FILE *f, const std::vector<request_t> &trace)
+{
+    uint8_t block[512];
+    uint32_t last = 0xFFFFFFFF;
+    for (const request_t &r : trace)
+    {
+        if (r.block == 0 || r.block != last + 1)
+            fseek(f, r.block * 512, SEEK_SET);
+        last = r.block;
+        if (r.write)
+            fwrite(block, 1, 512, f);
+        else
+            fread(block, 1, 512, f);
+    }
+}
+
+// The previous DO access: seek and read or write each of the two sectors
+static void replay_reference_do(FILE *f, const std::vector<request_t> &trace)
+{
+    static const int prodos2dos[8][2] = {{0, 14}, {13, 12}, {11, 10}, {9, 8}, {7, 6}, {5, 4}, {3, 2}, {1, 15}};
+    uint8_t sector[256];
+    for (const request_t &r : trace)
+    {
+        for (int h = 0; h < 2; h++)
+        {
+            fseek(f, (r.block / 8) * 4096 + prodos2dos[r.block % 8][h] * 256, SEEK_SET);
+            if (r.write)
+                fwrite(sector, 1, 256, f);
+            else
+                fread(sector, 1, 256, f);
+        }
+    }
+}
+
+static void replay_media(MediaType *media, const std::vector<request_t> &trace)
+{
+    uint8_t block[512] = {};
+    for (const request_t &r : trace)
+    {
+        uint16_t count = 512;
+        if (r.write)
+            media->write(r.block, &count, block);
+        else
+            media->read(r.block, &count, block);
+    }
+    media->flush();
+}
+
+static void report(const char *name, double seconds)
+{
+    printf("  %-16s %6zu reads %6zu writes %6zu seeks %10.1f us\n", name, counts.reads, counts.writes, counts.seeks, seconds * 1e6);
+}
+
+static bool verify_block(const std::vector<uint8_t> &image, uint32_t b, const uint8_t *block, bool dos_order)
+{
+    static const int prodos2dos[8][2] = {{0, 14}, {13, 12}, {11, 10}, {9, 8}, {7, 6}, {5, 4}, {3, 2}, {1, 15}};
+    for (int h = 0; h < 2; h++)
+    {
+        size_t pos = dos_order ? (b / 8) * 4096 + prodos2dos[b % 8][h] * 256 : b * 512 + h * 256;
+        if (memcmp(&block[h * 256], &image[pos], 256) != 0)
+            return false;
+    }
+    return true;
+}
+
+static bool verify(MediaType *media, const std::vector<uint8_t> &image, bool dos_order)
+{
+    uint8_t block[512];
+    for (uint32_t b = 0; b < IMAGE_BLOCKS; b++)
+    {
+        uint16_t count = 512;
+        if (media->read(b, &count, block) || !verify_block(image, b, block, dos_order))
+            return false;
+    }
+    return true;
+}
+
+// Random reads and writes against a model of the volume, then check the image after remount
+static bool verify_random(bool dos_order, const std::vector<uint8_t> &image)
+{
+    std::vector<uint8_t> model(image.size());
+    MediaType *media = dos_order ? (MediaType *)new MediaTypeDO() : (MediaType *)new MediaTypePO();
+    media->mount(open_image(image), image.size());
+    uint8_t block[512];
+    for (uint32_t b = 0; b < IMAGE_BLOCKS; b++)
+    {
+        uint16_t count = 512;
+        media->read(b, &count, block);
+        memcpy(&model[b * 512], block, 512);
+    }
+
+    std::mt19937 gen(7);
+    bool ok = true;
+    for (int i = 0; i < 5000 && ok; i++)
+    {
+        // mostly short sequential runs, like file reads
+        uint32_t b = gen() % IMAGE_BLOCKS;
+        uint32_t run = 1 + gen() % 6;
+        bool write = gen() % 3 == 0;
+        for (; run > 0 && b < IMAGE_BLOCKS; run--, b++)
+        {
+            uint16_t count = 512;
+            if (write)
+            {
+                for (auto &x : block)
+                    x = gen() & 0xFF;
+                memcpy(&model[b * 512], block, 512);
+                ok = ok && !media->write(b, &count, block);
+            }
+            else
+            {
+                ok = ok && !media->read(b, &count, block) && memcmp(block, &model[b * 512], 512) == 0;
+            }
+        }
+    }
+    FILE *f = counted_file;
+    media->flush();
+
+    // check what reached the file
+    std::vector<uint8_t> file(image.size());
+    ::fseek(f, 0, SEEK_SET);
+    ::fread(file.data(), 1, file.size(), f);
+    for (uint32_t b = 0; b < IMAGE_BLOCKS && ok; b++)
+        ok = verify_block(file, b, &model[b * 512], dos_order);
+
+    media->unmount();
+    delete media;
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<request_t> trace = argc > 1 ? load_trace(argv[1]) : default_trace();
+    printf("ProDOS trace: %zu block requests\n", trace.size());
+
+    const std::vector<uint8_t> image = bench_random_data(IMAGE_BLOCKS * 512);
+    bool ok = true;
+
+    for (int dos_order = 0; dos_order <= 1; dos_order++)
+    {
+        printf("%s image\n", dos_order ? "DO" : "PO");
+        double t = bench_run([&]() {
+            FILE *f = open_image(image);
+            if (dos_order)
+                replay_reference_do(f, trace);
+            else
+                replay_reference_po(f, trace);
+            fclose(f);
+        }, 0.2);
+        report("per block", t);
+
+        t = bench_run([&]() {
+            MediaType *media = dos_order ? (MediaType *)new MediaTypeDO() : (MediaType *)new MediaTypePO();
+            media->mount(open_image(image), image.size());
+            replay_media(media, trace);
+            media->unmount();
+            delete media;
+        }, 0.2);
+        report("block cache", t);
+
+        // all blocks read back through the cache match the image
+        MediaType *media = dos_order ? (MediaType *)new MediaTypeDO() : (MediaType *)new MediaTypePO();
+        media->mount(open_image(image), image.size());
+        bool match = verify(media, image, dos_order);
+        media->unmount();
+        delete media;
+        printf("  read back: %s\n", match ? "OK" : "MISMATCH");
+        bool random_ok = verify_random(dos_order, image);
+        printf("  random read/write: %s\n", random_ok ? "OK" : "MISMATCH");
+        ok = ok && match && random_ok;
+    }
+
+    return ok ? 0 : 1;
+}
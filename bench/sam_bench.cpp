@@ -0,0 +1,88 @@
+/*
+ * SAM speech synthesis (voice device, util_sam_say)
+ * Rendering the whole utterance into the buffer before playing is compared with the
+ * streaming mode, which hands out fixed size chunks while it renders. Reports samples/s,
+ * the time until the first chunk could be played and the memory used for the output.
+ */
+
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "bench.h"
+#include "reciter.h"
+#include "sam.h"
+
+#define CHUNK 512
+#define SAMPLE_RATE 22050
+
+int debug = 0; // defined by samlib.cpp in the firmware
+
+static const char *phrase = "HELLO, MY NAME IS SAM. I AM THE VOICE OF YOUR FUJI NET. "
+                            "WOULD YOU LIKE TO PLAY A GAME OF CHESS?";
+
+struct Stream
+{
+    std::vector<uint8_t> samples;
+    std::chrono::steady_clock::time_point first;
+};
+
+static void on_chunk(const unsigned char *samples, int length, void *user)
+{
+    Stream *s = (Stream *)user;
+    if (s->samples.empty())
+        s->first = std::chrono::steady_clock::now();
+    s->samples.insert(s->samples.end(), samples, samples + length);
+}
+
+static void report(const char *name, size_t samples, double seconds)
+{
+    printf("%-40s %10.2f Msamples/s %9.3f ms/run\n", name, samples / seconds / 1e6, seconds * 1e3);
+}
+
+int main()
+{
+    char phonemes[256];
+    snprintf(phonemes, sizeof(phonemes), "%s[", phrase);
+    if (!TextToPhonemes((unsigned char *)phonemes))
+    {
+        printf("TextToPhonemes failed\n");
+        return 1;
+    }
+
+    // Whole utterance into the buffer
+    std::vector<uint8_t> whole;
+    double t = bench_run([&]() {
+        SetInput(phonemes);
+        SAMMain();
+        whole.assign(GetBuffer(), GetBuffer() + GetBufferLength() / 50);
+        FreeBuffer();
+    });
+    printf("SAM: %zu samples, %.2f s of speech\n", whole.size(), (double)whole.size() / SAMPLE_RATE);
+    report("render to buffer", whole.size(), t);
+
+    // Streaming in chunks
+    Stream stream;
+    double first = 0;
+    int runs = 0;
+    SetOutputCallback(on_chunk, &stream, CHUNK);
+    t = bench_run([&]() {
+        stream.samples.clear();
+        auto start = std::chrono::steady_clock::now();
+        SetInput(phonemes);
+        SAMMain();
+        first += std::chrono::duration<double>(stream.first - start).count();
+        runs++;
+    });
+    SetOutputCallback(NULL, NULL, 0);
+    report("render streaming", stream.samples.size(), t);
+    printf("%-40s %9.3f ms to first chunk, %.3f ms of speech per chunk\n", "  streaming latency",
+           first / runs * 1e3, CHUNK * 1e3 / SAMPLE_RATE);
+    printf("%-40s %d bytes buffer, %zu bytes streaming\n", "  output memory", SAMPLE_RATE * 10,
+           (size_t)CHUNK + 16);
+
+    bool ok = stream.samples == whole;
+    printf("streaming output: %s\n", ok ? "OK" : "DIFFERENT");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+/*
+ * SLIP codec throughput
+ * SmartPort block transfers (512 byte blocks plus request header) encoded and decoded
+ * with the vector based SLIP API and with the buffer based encoder / streaming decoder.
+ */
+
+#include <string.h>
+
+#include "bench.h"
+#include "SLIP.h"
+
+#define BLOCK_FRAME_SIZE (512 + 8)
+#define FRAMES 256
+#define READ_CHUNK 1024
+
+int main()
+{
+    // random data has about 1 in 128 bytes to escape, similar to disk images
+    std::vector<std::vector<uint8_t>> frames;
+    for (int i = 0; i < FRAMES; i++)
+        frames.push_back(bench_random_data(BLOCK_FRAME_SIZE, i + 1));
+
+    // encoded stream, as received from the transport
+    std::vector<uint8_t> stream;
+    for (const auto &f : frames)
+    {
+        auto e = SLIP::encode(f);
+        stream.insert(stream.end(), e.begin(), e.end());
+    }
+    const size_t payload_bytes = FRAMES * BLOCK_FRAME_SIZE;
+
+    printf("SLIP: %d frames of %d bytes, encoded stream %zu bytes\n", FRAMES, BLOCK_FRAME_SIZE, stream.size());
+
+    double t = bench_run([&]() {
+        for (const auto &f : frames)
+        {
+            auto e = SLIP::encode(f);
+            bench_keep(e);
+        }
+    });
+    bench_report("encode (vector)", payload_bytes, t);
+
+    std::vector<uint8_t> out(SLIP::max_encoded_size(BLOCK_FRAME_SIZE));
+    t = bench_run([&]() {
+        for (const auto &f : frames)
+        {
+            size_t n = SLIP::encode(f.data(), f.size(), out.data(), out.size());
+            bench_keep(n);
+        }
+    });
+    bench_report("encode (buffer)", payload_bytes, t);
+
+    // old receive path: each read split into packets independently
+    size_t decoded = 0;
+    t = bench_run([&]() {
+        decoded = 0;
+        for (size_t pos = 0; pos < stream.size(); pos += READ_CHUNK)
+        {
+            size_t n = std::min((size_t)READ_CHUNK, stream.size() - pos);
+            auto packets = SLIP::split_into_packets(stream.data() + pos, n);
+            for (const auto &p : packets)
+                decoded += p.size();
+        }
+    });
+    bench_report("split_into_packets (1K reads)", payload_bytes, t);
+    printf("%-40s %zu of %zu bytes (frames split across reads are lost)\n", "  decoded", decoded, payload_bytes);
+
+    std::vector<uint8_t> frame(SLIP_MAX_FRAME_SIZE);
+    SLIPDecoder decoder(frame.data(), frame.size());
+    t = bench_run([&]() {
+        decoded = 0;
+        for (size_t pos = 0; pos < stream.size(); pos += READ_CHUNK)
+        {
+            size_t n = std::min((size_t)READ_CHUNK, stream.size() - pos);
+            decoder.feed(stream.data() + pos, n, [&](const uint8_t * /*data*/, size_t len) { decoded += len; });
+        }
+    });
+    bench_report("SLIPDecoder (1K reads)", payload_bytes, t);
+    printf("%-40s %zu of %zu bytes\n", "  decoded", decoded, payload_bytes);
+
+    // verify round trip
+    size_t index = 0;
+    bool ok = true;
+    decoder.reset();
+    decoder.feed(stream.data(), stream.size(), [&](const uint8_t *data, size_t len) {
+        ok = ok && index < frames.size() && len == frames[index].size() && memcmp(data, frames[index].data(), len) == 0;
+        index++;
+    });
+    ok = ok && index == frames.size();
+    printf("round trip: %s\n", ok ? "OK" : "FAILED");
+
+    return ok ? 0 : 1;
+}
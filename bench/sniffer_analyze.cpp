@@ -0,0 +1,218 @@
+/*
+ * Offline analyzer for modem sniffer captures (AT+SNIFF=PCAP, /modem-sniffer.pcapng)
+ * Splits the capture into sessions at CONNECT and NO CARRIER and reports per session
+ * the throughput in each direction, gaps in the data to the computer and the round trip
+ * latency from data sent by the computer to the next data received from the network.
+ *
+ *   sniffer_analyze capture.pcapng [gap_ms]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "modem-capture.h"
+
+struct session
+{
+    int number = 0;
+    unsigned baud = 0;
+    int64_t start = -1;
+    int64_t end = 0;
+    uint64_t bytes[2] = {0, 0}; // CAPTURE_TO_COMPUTER, CAPTURE_TO_NETWORK
+    uint64_t packets[2] = {0, 0};
+    int64_t lastRx = -1;
+    int64_t pendingTx = -1;
+    std::vector<int64_t> gaps;
+    std::vector<int64_t> rtts;
+    unsigned events[CAPTURE_EVENT_DROPPED + 1] = {};
+    uint64_t dropped = 0;
+};
+
+static int64_t gap_us = 500000;
+
+static double percentile(std::vector<int64_t> &v, double p)
+{
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, (size_t)(p * v.size()))] / 1000.0;
+}
+
+static void report(session &s)
+{
+    if (s.start < 0)
+        return;
+
+    double seconds = (s.end - s.start) / 1e6;
+    printf("Session %d", s.number);
+    if (s.baud)
+        printf(" at %u baud", s.baud);
+    printf(", %.3f s\n", seconds);
+
+    static const char *names[] = {"to computer", "to network"};
+    for (int d = 0; d < 2; d++)
+    {
+        double rate = seconds > 0 ? s.bytes[d] / seconds : 0;
+        printf("  %-12s %10llu bytes %8llu packets %10.1f bytes/s", names[d], (unsigned long long)s.bytes[d],
+               (unsigned long long)s.packets[d], rate);
+        if (s.baud)
+            printf(" (%.0f%% of line)", rate * 10 * 100 / s.baud);
+        printf("\n");
+    }
+
+    if (!s.gaps.empty())
+    {
+        int64_t total = 0;
+        for (int64_t g : s.gaps)
+            total += g;
+        printf("  gaps > %lld ms  %zu, %.1f ms total, longest %.1f ms\n", (long long)(gap_us / 1000), s.gaps.size(),
+               total / 1000.0, *std::max_element(s.gaps.begin(), s.gaps.end()) / 1000.0);
+    }
+    else
+        printf("  gaps > %lld ms  none\n", (long long)(gap_us / 1000));
+
+    if (!s.rtts.empty())
+        printf("  round trip     %zu, min %.1f ms, median %.1f ms, 95%% %.1f ms, max %.1f ms\n", s.rtts.size(),
+               percentile(s.rtts, 0), percentile(s.rtts, 0.5), percentile(s.rtts, 0.95), percentile(s.rtts, 1));
+
+    if (s.events[CAPTURE_EVENT_DTR] || s.events[CAPTURE_EVENT_RTS] || s.events[CAPTURE_EVENT_XMT] ||
+        s.events[CAPTURE_EVENT_COMMAND_MODE])
+        printf("  events         DTR %u, RTS %u, XMT %u, +++ %u\n", s.events[CAPTURE_EVENT_DTR],
+               s.events[CAPTURE_EVENT_RTS], s.events[CAPTURE_EVENT_XMT], s.events[CAPTURE_EVENT_COMMAND_MODE]);
+    if (s.dropped)
+        printf("  not captured   %llu bytes, the sniffer could not keep up\n", (unsigned long long)s.dropped);
+}
+
+static void add_record(session &s, int64_t t, const uint8_t *data, uint32_t len)
+{
+    uint8_t type = data[0];
+    uint8_t event = data[1];
+    uint16_t value = data[2] | (data[3] << 8);
+    uint32_t bytes = len - CAPTURE_HEADER_SIZE;
+
+    if (s.start < 0)
+        s.start = t;
+    s.end = t;
+
+    if (type == CAPTURE_EVENT)
+    {
+        if (event <= CAPTURE_EVENT_DROPPED)
+            s.events[event]++;
+        if (event == CAPTURE_EVENT_DROPPED)
+            s.dropped += value;
+        return;
+    }
+    if (type > CAPTURE_TO_NETWORK)
+        return;
+
+    s.bytes[type] += bytes;
+    s.packets[type]++;
+
+    if (type == CAPTURE_TO_COMPUTER)
+    {
+        if (s.lastRx >= 0 && t - s.lastRx > gap_us)
+            s.gaps.push_back(t - s.lastRx);
+        s.lastRx = t;
+        if (s.pendingTx >= 0)
+        {
+            s.rtts.push_back(t - s.pendingTx);
+            s.pendingTx = -1;
+        }
+    }
+    else if (s.pendingTx < 0)
+    {
+        s.pendingTx = t;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s capture.pcapng [gap_ms]\n", argv[0]);
+        return 2;
+    }
+    if (argc > 2)
+        gap_us = atoll(argv[2]) * 1000;
+
+    FILE *f = fopen(argv[1], "rb");
+    if (f == nullptr)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    std::vector<uint8_t> block;
+    session s;
+    int sessions = 0;
+    uint64_t records = 0;
+    uint32_t hdr[2];
+    bool ok = true;
+
+    while (fread(hdr, sizeof(uint32_t), 2, f) == 2)
+    {
+        if (hdr[1] < 12 || hdr[1] % 4 != 0)
+        {
+            ok = false;
+            break;
+        }
+        block.resize(hdr[1] - 8);
+        if (fread(block.data(), 1, block.size(), f) != block.size())
+        {
+            ok = false;
+            break;
+        }
+        const uint32_t *w = (const uint32_t *)block.data();
+
+        if (hdr[0] == PCAPNG_SHB && w[0] != PCAPNG_BYTE_ORDER_MAGIC)
+        {
+            fprintf(stderr, "%s: not a little endian pcapng file\n", argv[1]);
+            return 1;
+        }
+        if (hdr[0] == PCAPNG_IDB && (w[0] & 0xFFFF) != CAPTURE_LINKTYPE)
+        {
+            fprintf(stderr, "%s: not a modem sniffer capture (link type %u)\n", argv[1], w[0] & 0xFFFF);
+            return 1;
+        }
+        if (hdr[0] != PCAPNG_EPB || block.size() < 24)
+            continue;
+
+        int64_t t = ((int64_t)w[1] << 32) | w[2];
+        uint32_t len = w[3];
+        const uint8_t *data = block.data() + 20;
+        if (len < CAPTURE_HEADER_SIZE || 20 + len > block.size())
+        {
+            ok = false;
+            break;
+        }
+        records++;
+
+        if (data[0] == CAPTURE_EVENT && data[1] == CAPTURE_EVENT_CONNECT)
+        {
+            report(s);
+            s = session();
+            s.number = ++sessions;
+            s.baud = data[2] | (data[3] << 8);
+        }
+        if (s.number == 0)
+            s.number = ++sessions;
+
+        add_record(s, t, data, len);
+
+        if (data[0] == CAPTURE_EVENT && data[1] == CAPTURE_EVENT_NO_CARRIER)
+        {
+            report(s);
+            s = session();
+        }
+    }
+    report(s);
+    fclose(f);
+
+    printf("%llu records\n", (unsigned long long)records);
+    if (!ok)
+        fprintf(stderr, "%s: truncated or damaged block\n", argv[1]);
+    return ok ? 0 : 1;
+}
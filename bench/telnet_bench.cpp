@@ -0,0 +1,164 @@
+/*
+ * Telnet receive and send (modem with ATNET1, N: TELNET)
+ * An ANSI art BBS screen stream, escape sequences and CP437 block graphics with an
+ * occasional escaped 0xFF, and a binary file transfer are fed through libtelnet in the
+ * chunk sizes the modem and the N: device read. Built as bench_telnet_bytewise the data
+ * is scanned byte by byte by the state machine, as before the memchr fast path.
+ */
+
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+
+#include "bench.h"
+#include "libtelnet.h"
+
+#define SCREENS 64
+
+static const telnet_telopt_t telopts[] = {
+    {TELNET_TELOPT_ECHO, TELNET_WONT, TELNET_DO},
+    {TELNET_TELOPT_TTYPE, TELNET_WILL, TELNET_DONT},
+    {TELNET_TELOPT_COMPRESS2, TELNET_WONT, TELNET_DO},
+    {TELNET_TELOPT_MSSP, TELNET_WONT, TELNET_DO},
+    {-1, 0, 0}};
+
+struct Sink
+{
+    std::string data;
+    size_t sent = 0;
+};
+
+static void event_handler(telnet_t *telnet, telnet_event_t *ev, void *user_data)
+{
+    Sink *sink = (Sink *)user_data;
+
+    switch (ev->type)
+    {
+    case TELNET_EV_DATA:
+        sink->data.append(ev->data.buffer, ev->data.size);
+        break;
+    case TELNET_EV_SEND:
+        sink->sent += ev->data.size;
+        break;
+    case TELNET_EV_TTYPE:
+        if (ev->ttype.cmd == TELNET_TTYPE_SEND)
+            telnet_ttype_is(telnet, "ANSI");
+        break;
+    default:
+        break;
+    }
+}
+
+// What a BBS sends on connect, before the first screen
+static void negotiate(std::string &stream)
+{
+    static const unsigned char start[] = {
+        TELNET_IAC, TELNET_WILL, TELNET_TELOPT_ECHO, TELNET_IAC, TELNET_WILL, TELNET_TELOPT_SGA,
+        TELNET_IAC, TELNET_DO, TELNET_TELOPT_TTYPE, TELNET_IAC, TELNET_SB, TELNET_TELOPT_TTYPE,
+        TELNET_TTYPE_SEND, TELNET_IAC, TELNET_SE};
+    stream.append((const char *)start, sizeof(start));
+}
+
+// 80x24 ANSI art screens, payload is the data the computer should get
+static void ansi_screens(std::string &stream, std::string &payload)
+{
+    static const unsigned char blocks[] = {0xDB, 0xDC, 0xDF, 0xB0, 0xB1, 0xB2, 0xDD, 0xDE, 0x20, 0xFF};
+    uint32_t seed = 1;
+
+    for (int s = 0; s < SCREENS; s++)
+    {
+        payload += "\x1b[2J\x1b[H";
+        for (int row = 0; row < 24; row++)
+        {
+            for (int col = 0; col < 80;)
+            {
+                seed = seed * 1103515245 + 12345;
+                int run = 1 + (seed >> 16) % 12;
+                char sgr[24];
+                snprintf(sgr, sizeof(sgr), "\x1b[%d;%d;%dm", (seed >> 8) & 1, 30 + (seed >> 9) % 8,
+                         40 + (seed >> 12) % 8);
+                payload += sgr;
+                for (int i = 0; i < run && col < 80; i++, col++)
+                    payload += (char)blocks[(seed >> (i % 16)) % sizeof(blocks)];
+            }
+            payload += "\r\n";
+        }
+    }
+
+    for (char c : payload)
+    {
+        stream += c;
+        if ((unsigned char)c == TELNET_IAC)
+            stream += c;
+    }
+}
+
+static void binary_file(std::string &stream, std::string &payload)
+{
+    std::vector<uint8_t> data = bench_random_data(SCREENS * 4096, 7);
+    payload.assign(data.begin(), data.end());
+    for (char c : payload)
+    {
+        stream += c;
+        if ((unsigned char)c == TELNET_IAC)
+            stream += c;
+    }
+}
+
+static bool run(const char *name, const std::string &stream, const std::string &payload, size_t chunk)
+{
+    Sink sink;
+    double t = bench_run([&]() {
+        sink.data.clear();
+        telnet_t *telnet = telnet_init(telopts, event_handler, 0, &sink);
+        for (size_t pos = 0; pos < stream.size(); pos += chunk)
+            telnet_recv(telnet, stream.data() + pos, std::min(chunk, stream.size() - pos));
+        telnet_free(telnet);
+    });
+
+    char label[64];
+    snprintf(label, sizeof(label), "recv %s, %zu byte reads", name, chunk);
+    bench_report(label, stream.size(), t);
+
+    if (sink.data != payload)
+    {
+        printf("  %s: received data is DIFFERENT\n", name);
+        return false;
+    }
+    return true;
+}
+
+int main()
+{
+    std::string ansi, ansi_payload, binary, binary_payload;
+    negotiate(ansi);
+    ansi_screens(ansi, ansi_payload);
+    binary_file(binary, binary_payload);
+
+    printf("Telnet: %d ANSI screens %zu bytes, binary file %zu bytes\n", SCREENS, ansi.size(), binary.size());
+
+    bool ok = true;
+    ok &= run("ANSI art", ansi, ansi_payload, 1024); // modem RX_BUF_SIZE
+    ok &= run("ANSI art", ansi, ansi_payload, 48);   // modem slice at 9600 baud
+    ok &= run("binary", binary, binary_payload, 1024);
+    ok &= run("binary", binary, binary_payload, 512); // N: read of a full buffer
+
+    Sink sink;
+    double t = bench_run([&]() {
+        sink.sent = 0;
+        telnet_t *telnet = telnet_init(telopts, event_handler, 0, &sink);
+        for (size_t pos = 0; pos < binary_payload.size(); pos += 256)
+            telnet_send(telnet, binary_payload.data() + pos, std::min((size_t)256, binary_payload.size() - pos));
+        telnet_free(telnet);
+    });
+    bench_report("send binary, 256 byte writes", binary_payload.size(), t);
+    if (sink.sent != binary.size())
+    {
+        printf("  send: %zu bytes escaped, expected %zu\n", sink.sent, binary.size());
+        ok = false;
+    }
+
+    printf("telnet data: %s\n", ok ? "OK" : "DIFFERENT");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,245 @@
+/*
+ * WOZ mount time and heap use
+ * Mounts WOZ 1 and WOZ 2 images with MediaTypeWOZ (tracks read into one arena) and with
+ * a reference loader doing what the loader did before: one allocation and read per track.
+ * Images given on the command line are used as corpus, otherwise synthetic 35 track
+ * WOZ 1 and WOZ 2 images are generated.
+ */
+
+#include <malloc.h>
+#include <string.h>
+
+#include <string>
+
+#include "bench.h"
+#include "mediaTypeWOZ.h"
+
+// heap accounting, glibc specific
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t n, size_t size);
+extern "C" void *__libc_realloc(void *p, size_t size);
+extern "C" void __libc_free(void *p);
+
+static size_t heap_now = 0;
+static size_t heap_peak = 0;
+
+static void *heap_add(void *p)
+{
+    if (p)
+    {
+        heap_now += malloc_usable_size(p);
+        if (heap_now > heap_peak)
+            heap_peak = heap_now;
+    }
+    return p;
+}
+
+static void heap_sub(void *p)
+{
+    if (p)
+        heap_now -= malloc_usable_size(p);
+}
+
+extern "C" void *malloc(size_t size) { return heap_add(__libc_malloc(size)); }
+extern "C" void *calloc(size_t n, size_t size) { return heap_add(__libc_calloc(n, size)); }
+extern "C" void free(void *p) { heap_sub(p); __libc_free(p); }
+extern "C" void *realloc(void *p, size_t size)
+{
+    heap_sub(p);
+    return heap_add(__libc_realloc(p, size));
+}
+
+#define SYNTH_TRACKS 35
+#define SYNTH_TRACK_BYTES 6400
+
+static void put16(std::vector<uint8_t> &v, size_t pos, uint16_t x)
+{
+    v[pos] = x & 0xFF;
+    v[pos + 1] = x >> 8;
+}
+
+static void put32(std::vector<uint8_t> &v, size_t pos, uint32_t x)
+{
+    put16(v, pos, x & 0xFFFF);
+    put16(v, pos + 2, x >> 16);
+}
+
+static std::vector<uint8_t> make_woz(int version)
+{
+    std::vector<uint8_t> woz(WOZ_TRKS_DATA_OFFSET, 0);
+    memcpy(&woz[0], version == 1 ? "WOZ1" : "WOZ2", 4);
+    woz[4] = 0xFF; woz[5] = 0x0A; woz[6] = 0x0D; woz[7] = 0x0A;
+    memcpy(&woz[WOZ_INFO_OFFSET], "INFO", 4);
+    put32(woz, WOZ_INFO_OFFSET + 4, 60);
+    woz[WOZ_INFO_OFFSET + 8] = version;
+    woz[WOZ_INFO_OFFSET + 8 + 39] = 32;
+    put16(woz, WOZ_INFO_OFFSET + 8 + 44, 13);
+    memcpy(&woz[WOZ_TMAP_OFFSET], "TMAP", 4);
+    put32(woz, WOZ_TMAP_OFFSET + 4, 160);
+    memset(&woz[WOZ_TMAP_OFFSET + 8], 0xFF, MAX_TRACKS);
+    for (int t = 0; t < SYNTH_TRACKS; t++)
+    {
+        int pos = t * 4;
+        if (pos > 0)
+            woz[WOZ_TMAP_OFFSET + 8 + pos - 1] = t;
+        woz[WOZ_TMAP_OFFSET + 8 + pos] = woz[WOZ_TMAP_OFFSET + 8 + pos + 1] = t;
+    }
+    memcpy(&woz[WOZ_TRKS_OFFSET], "TRKS", 4);
+
+    std::vector<uint8_t> bits = bench_random_data(SYNTH_TRACK_BYTES, version);
+    if (version == 1)
+    {
+        put32(woz, WOZ_TRKS_OFFSET + 4, SYNTH_TRACKS * WOZ1_TRK_RECORD_LEN);
+        for (int t = 0; t < SYNTH_TRACKS; t++)
+        {
+            size_t rec = woz.size();
+            woz.resize(rec + WOZ1_TRK_RECORD_LEN, 0);
+            memcpy(&woz[rec], bits.data(), bits.size());
+            put16(woz, rec + WOZ1_TRACK_LEN, SYNTH_TRACK_BYTES);
+            put16(woz, rec + WOZ1_TRACK_LEN + 2, SYNTH_TRACK_BYTES * 8);
+        }
+    }
+    else
+    {
+        const int blocks = (SYNTH_TRACK_BYTES + 511) / 512;
+        woz.resize(3 * 512, 0);
+        put32(woz, WOZ_TRKS_OFFSET + 4, 1280 + SYNTH_TRACKS * blocks * 512);
+        for (int t = 0; t < SYNTH_TRACKS; t++)
+        {
+            size_t trk = WOZ_TRKS_DATA_OFFSET + t * 8;
+            put16(woz, trk, 3 + t * blocks);
+            put16(woz, trk + 2, blocks);
+            put32(woz, trk + 4, SYNTH_TRACK_BYTES * 8);
+            size_t pos = woz.size();
+            woz.resize(pos + blocks * 512, 0);
+            memcpy(&woz[pos], bits.data(), bits.size());
+        }
+    }
+    return woz;
+}
+
+// The previous loader: a malloc and a read for every track
+static bool reference_mount(FILE *f, std::vector<uint8_t *> &tracks)
+{
+    char hdr[12];
+    uint32_t chunk_id, chunk_size;
+    uint8_t tmap[MAX_TRACKS];
+    TRK_t trks[MAX_TRACKS];
+
+    fread(hdr, 1, 12, f);
+    fseek(f, 12, SEEK_SET);
+    fread(&chunk_id, sizeof(chunk_id), 1, f);
+    fread(&chunk_size, sizeof(chunk_size), 1, f);
+    fseek(f, 80, SEEK_SET);
+    fread(&chunk_id, sizeof(chunk_id), 1, f);
+    fread(&chunk_size, sizeof(chunk_size), 1, f);
+    fread(tmap, 1, MAX_TRACKS, f);
+    fseek(f, WOZ_TRKS_DATA_OFFSET, SEEK_SET);
+
+    if (hdr[3] == '1')
+    {
+        uint8_t *temp = (uint8_t *)malloc(WOZ1_TRK_RECORD_LEN);
+        for (int i = 0; i < MAX_TRACKS; i++)
+        {
+            uint16_t bytes_used = 0, bit_count = 0;
+            memset(temp, 0, WOZ1_TRK_RECORD_LEN);
+            fread(temp, 1, WOZ1_TRACK_LEN, f);
+            fread(&bytes_used, sizeof(bytes_used), 1, f);
+            fread(&bit_count, sizeof(bit_count), 1, f);
+            if (bit_count > 0)
+            {
+                size_t s = (bytes_used + 511) / 512 * 512;
+                uint8_t *p = (uint8_t *)malloc(s);
+                memset(p, 0, s);
+                memcpy(p, temp, bytes_used);
+                tracks.push_back(p);
+            }
+            fread(temp, 1, 6, f);
+        }
+        free(temp);
+        return true;
+    }
+
+    fread(trks, sizeof(TRK_t), MAX_TRACKS, f);
+    for (int i = 0; i < MAX_TRACKS; i++)
+    {
+        size_t s = trks[i].block_count * 512;
+        if (s == 0)
+            continue;
+        uint8_t *p = (uint8_t *)malloc(s);
+        fseek(f, trks[i].start_block * 512, SEEK_SET);
+        fread(p, 1, s, f);
+        tracks.push_back(p);
+    }
+    return true;
+}
+
+struct result_t
+{
+    double seconds;
+    size_t peak;
+};
+
+template <typename Mount>
+static result_t measure(Mount &&mount)
+{
+    result_t r;
+    size_t base = heap_now;
+    heap_peak = heap_now;
+    mount();
+    r.peak = heap_peak - base;
+    r.seconds = bench_run(mount, 0.3);
+    return r;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> corpus;
+    for (int i = 1; i < argc; i++)
+        corpus.push_back(argv[i]);
+
+    if (corpus.empty())
+    {
+        for (int version = 1; version <= 2; version++)
+        {
+            std::string path = "/tmp/bench_woz" + std::to_string(version) + ".woz";
+            std::vector<uint8_t> woz = make_woz(version);
+            FILE *f = fopen(path.c_str(), "wb");
+            if (f == nullptr)
+                return 1;
+            fwrite(woz.data(), 1, woz.size(), f);
+            fclose(f);
+            corpus.push_back(path);
+        }
+    }
+
+    bool ok = true;
+    for (const std::string &path : corpus)
+    {
+        printf("%s\n", path.c_str());
+
+        result_t ref = measure([&]() {
+            std::vector<uint8_t *> tracks;
+            FILE *f = fopen(path.c_str(), "rb");
+            reference_mount(f, tracks);
+            for (uint8_t *p : tracks)
+                free(p);
+            fclose(f);
+        });
+
+        bool mounted = true;
+        result_t arena = measure([&]() {
+            MediaTypeWOZ *woz = new MediaTypeWOZ();
+            mounted = woz->mount(fopen(path.c_str(), "rb"), 0) == MEDIATYPE_WOZ;
+            woz->unmount();
+            delete woz;
+        });
+        ok = ok && mounted;
+
+        printf("  %-30s %10.1f us %10zu bytes peak heap\n", "per track malloc", ref.seconds * 1e6, ref.peak);
+        printf("  %-30s %10.1f us %10zu bytes peak heap%s\n", "arena", arena.seconds * 1e6, arena.peak,
+               mounted ? "" : " (MOUNT FAILED)");
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,507 @@
+/*
+ * RunCPM Z80 core speed and correctness
+ * Runs the core on a minimal CP/M page zero (BDOS console output only) and reports millions
+ * of emulated instructions per second:
+ *  - CRC-16 of 8 KB, bit by bit (shifts, jumps, DJNZ)
+ *  - Sieve of Eratosthenes, 8190 flags (BYTE benchmark: LDIR, 16 bit arithmetic, IX)
+ *  - a CP/M program given on the command line, e.g. zexdoc.com or zexall.com
+ * The exerciser runs every non branching instruction (base, CB, ED, DD, FD, DDCB, FDCB) on
+ * random register and memory states and compares a CRC of the results with the CRC of the
+ * switch dispatched core, like zexdoc does with real hardware.
+ *
+ * bench_z80 is built with the default dispatch, bench_z80_switch with CPU_SWITCH to compare.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#include "bench.h"
+#include "globals.h"
+
+static bool bdosQuiet = false;
+static std::string bdosOutput;
+
+void _Bios(void);
+void _Bdos(void);
+void _HardwareOut(const uint32 /*Port*/, const uint32 /*Value*/) {}
+uint32 _HardwareIn(const uint32 /*Port*/) { return 0; }
+
+#define CPU_STATS
+#include "cpu.h"
+
+#define BDOS_ADDR 0xFE00
+#define CODE_ADDR 0x0100
+
+// BIOS 0 (boot) ends the program
+void _Bios(void)
+{
+    Status = 1;
+}
+
+// Console output for program messages, string output returns its length in HL
+void _Bdos(void)
+{
+    if (bdosQuiet)
+        return;
+    size_t start = bdosOutput.size();
+    switch (LOW_REGISTER(BC))
+    {
+    case 2:
+        bdosOutput += (char)LOW_REGISTER(DE);
+        break;
+    case 9:
+        for (uint16 a = DE; RAM[a] != '$'; a++)
+            bdosOutput += (char)RAM[a];
+        HL = bdosOutput.size() - start;
+        break;
+    }
+    fwrite(bdosOutput.data() + start, 1, bdosOutput.size() - start, stdout);
+    fflush(stdout);
+}
+
+// Page zero: JP 0 goes to the BIOS, CALL 5 to the BDOS
+static void page_zero()
+{
+    static const uint8 boot[] = {0xD3, 0xFF, 0x76};             // OUT (0FFh),A - HALT
+    static const uint8 bdos[] = {0xDB, 0xFF, 0xC9};             // IN A,(0FFh) - RET
+    static const uint8 jump[] = {0xC3, BDOS_ADDR & 0xFF, BDOS_ADDR >> 8}; // JP BDOS
+    memcpy(&RAM[0], boot, sizeof(boot));
+    memcpy(&RAM[5], jump, sizeof(jump));
+    memcpy(&RAM[BDOS_ADDR], bdos, sizeof(bdos));
+}
+
+// Runs a program from addr until it returns or jumps to 0, returns seconds
+static double run_program(uint16 addr)
+{
+    Z80reset();
+    PC = addr;
+    SP = BDOS_ADDR;
+    PUSH(0);
+    auto start = std::chrono::steady_clock::now();
+    Z80run();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char *name, unsigned long long instructions, double seconds)
+{
+    printf("%-40s %10.1f MIPS %10.3f s\n", name, instructions / seconds / 1e6, seconds);
+}
+
+/* CRC-16/CCITT of 8 KB at 4000h, IY times, result at 8000h
+0100 FD 21 nn nn    LD IY,reps
+0104 21 00 40 outer:LD HL,4000h
+0107 01 00 20       LD BC,2000h
+010A 11 FF FF       LD DE,0FFFFh
+010D 7E       loop: LD A,(HL)
+010E AA             XOR D
+010F 57             LD D,A
+0110 C5             PUSH BC
+0111 06 08          LD B,8
+0113 CB 23    bit:  SLA E
+0115 CB 12          RL D
+0117 30 08          JR NC,skip
+0119 7A             LD A,D
+011A EE 10          XOR 10h
+011C 57             LD D,A
+011D 7B             LD A,E
+011E EE 21          XOR 21h
+0120 5F             LD E,A
+0121 10 F0    skip: DJNZ bit
+0123 C1             POP BC
+0124 23             INC HL
+0125 0B             DEC BC
+0126 78             LD A,B
+0127 B1             OR C
+0128 20 E3          JR NZ,loop
+012A FD 2B          DEC IY
+012C FD E5          PUSH IY
+012E C1             POP BC
+012F 78             LD A,B
+0130 B1             OR C
+0131 20 D1          JR NZ,outer
+0133 ED 53 00 80    LD (8000h),DE
+0137 C9             RET
+*/
+static const uint8 crcProgram[] = {
+    0xFD, 0x21, 0x00, 0x00, 0x21, 0x00, 0x40, 0x01, 0x00, 0x20, 0x11, 0xFF, 0xFF, 0x7E, 0xAA, 0x57,
+    0xC5, 0x06, 0x08, 0xCB, 0x23, 0xCB, 0x12, 0x30, 0x08, 0x7A, 0xEE, 0x10, 0x57, 0x7B, 0xEE, 0x21,
+    0x5F, 0x10, 0xF0, 0xC1, 0x23, 0x0B, 0x78, 0xB1, 0x20, 0xE3, 0xFD, 0x2B, 0xFD, 0xE5, 0xC1, 0x78,
+    0xB1, 0x20, 0xD1, 0xED, 0x53, 0x00, 0x80, 0xC9};
+
+/* Sieve of 8190 flags at 6000h, IY times, number of primes at 8002h
+0100 FD 21 nn nn    LD IY,reps
+0104 21 00 60 outer:LD HL,6000h
+0107 11 01 60       LD DE,6001h
+010A 01 FD 1F       LD BC,8189
+010D 36 01          LD (HL),1
+010F ED B0          LDIR
+0111 DD 21 00 00    LD IX,0
+0115 21 00 60       LD HL,6000h
+0118 01 00 00       LD BC,0
+011B 7E      iloop: LD A,(HL)
+011C B7             OR A
+011D 28 1F          JR Z,next
+011F E5             PUSH HL
+0120 60             LD H,B
+0121 69             LD L,C
+0122 29             ADD HL,HL
+0123 23             INC HL
+0124 23             INC HL
+0125 23             INC HL
+0126 EB             EX DE,HL
+0127 E1             POP HL
+0128 E5             PUSH HL
+0129 19             ADD HL,DE
+012A 7C      kloop: LD A,H
+012B FE 7F          CP 7Fh
+012D 38 07          JR C,mark
+012F 20 0A          JR NZ,kdone
+0131 7D             LD A,L
+0132 FE FE          CP 0FEh
+0134 30 05          JR NC,kdone
+0136 36 00   mark:  LD (HL),0
+0138 19             ADD HL,DE
+0139 18 EF          JR kloop
+013B E1      kdone: POP HL
+013C DD 23          INC IX
+013E 23      next:  INC HL
+013F 03             INC BC
+0140 78             LD A,B
+0141 FE 1F          CP 1Fh
+0143 38 D6          JR C,iloop
+0145 79             LD A,C
+0146 FE FE          CP 0FEh
+0148 38 D1          JR C,iloop
+014A FD 2B          DEC IY
+014C FD E5          PUSH IY
+014E C1             POP BC
+014F 78             LD A,B
+0150 B1             OR C
+0151 20 B1          JR NZ,outer
+0153 DD 22 02 80    LD (8002h),IX
+0157 C9             RET
+*/
+static const uint8 sieveProgram[] = {
+    0xFD, 0x21, 0x00, 0x00, 0x21, 0x00, 0x60, 0x11, 0x01, 0x60, 0x01, 0xFD, 0x1F, 0x36, 0x01, 0xED,
+    0xB0, 0xDD, 0x21, 0x00, 0x00, 0x21, 0x00, 0x60, 0x01, 0x00, 0x00, 0x7E, 0xB7, 0x28, 0x1F, 0xE5,
+    0x60, 0x69, 0x29, 0x23, 0x23, 0x23, 0xEB, 0xE1, 0xE5, 0x19, 0x7C, 0xFE, 0x7F, 0x38, 0x07, 0x20,
+    0x0A, 0x7D, 0xFE, 0xFE, 0x30, 0x05, 0x36, 0x00, 0x19, 0x18, 0xEF, 0xE1, 0xDD, 0x23, 0x23, 0x03,
+    0x78, 0xFE, 0x1F, 0x38, 0xD6, 0x79, 0xFE, 0xFE, 0x38, 0xD1, 0xFD, 0x2B, 0xFD, 0xE5, 0xC1, 0x78,
+    0xB1, 0x20, 0xB1, 0xDD, 0x22, 0x02, 0x80, 0xC9};
+
+/* BDOS calls, registers passed both ways
+0100 0E 09          LD C,9
+0102 11 13 01       LD DE,msg
+0105 CD 05 00       CALL 5
+0108 22 04 80       LD (8004h),HL
+010B 0E 02          LD C,2
+010D 1E 21          LD E,'!'
+010F CD 05 00       CALL 5
+0112 C9             RET
+0113          msg:  DB 'BDOS$'
+*/
+static const uint8 bdosProgram[] = {
+    0x0E, 0x09, 0x11, 0x13, 0x01, 0xCD, 0x05, 0x00, 0x22, 0x04, 0x80, 0x0E, 0x02, 0x1E, 0x21, 0xCD,
+    0x05, 0x00, 0xC9, 'B', 'D', 'O', 'S', '$'};
+
+static bool run_bdos()
+{
+    memcpy(&RAM[CODE_ADDR], bdosProgram, sizeof(bdosProgram));
+    bdosOutput.clear();
+    printf("BDOS calls: ");
+    run_program(CODE_ADDR);
+    bool ok = bdosOutput == "BDOS!" && RAM[0x8004] == 4 && RAM[0x8005] == 0;
+    printf(" %s\n", ok ? "OK" : "ERROR");
+    return ok;
+}
+
+static bool run_workload(const char *name, const uint8 *program, size_t len, uint16 reps,
+                         uint16 resultAddr, uint16 expected)
+{
+    memcpy(&RAM[CODE_ADDR], program, len);
+    RAM[CODE_ADDR + 2] = reps & 0xFF;
+    RAM[CODE_ADDR + 3] = reps >> 8;
+
+    InstrCount = 0;
+    double t = run_program(CODE_ADDR);
+    report(name, InstrCount, t);
+
+    uint16 result = RAM[resultAddr] | (RAM[resultAddr + 1] << 8);
+    if (result != expected)
+        printf("  result %04X, expected %04X\n", result, expected);
+    return result == expected;
+}
+
+static uint16 crc16(const uint8 *data, size_t len)
+{
+    uint16 crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= data[i] << 8;
+        for (int b = 0; b < 8; b++)
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+// Exerciser
+
+static uint32_t crc32_update(uint32_t crc, uint32_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+    {
+        crc ^= (value >> (i * 8)) & 0xFF;
+        for (int b = 0; b < 8; b++)
+            crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+    }
+    return crc;
+}
+
+// Base instruction length, without prefix
+static int base_length(uint8 op)
+{
+    switch (op)
+    {
+    case 0x06: case 0x0E: case 0x16: case 0x1E: case 0x26: case 0x2E: case 0x36: case 0x3E:
+    case 0xC6: case 0xCE: case 0xD6: case 0xDE: case 0xE6: case 0xEE: case 0xF6: case 0xFE:
+        return 2;
+    case 0x01: case 0x11: case 0x21: case 0x31: case 0x22: case 0x2A: case 0x32: case 0x3A:
+        return 3;
+    }
+    return 1;
+}
+
+// Base instructions using (HL), which become (IX+d) with a DD prefix
+static bool uses_hl_memory(uint8 op)
+{
+    if (op == 0x34 || op == 0x35 || op == 0x36)
+        return true;
+    if (op >= 0x40 && op < 0xC0 && op != 0x76)
+        return (op & 7) == 6 || (op >= 0x70 && op < 0x78);
+    return false;
+}
+
+// Branches, I/O, HALT and prefixes are not exercised
+static bool skip_base(uint8 op)
+{
+    switch (op)
+    {
+    case 0x10: case 0x18: case 0x20: case 0x28: case 0x30: case 0x38: case 0x76:
+    case 0xC3: case 0xC9: case 0xCB: case 0xCD: case 0xD3: case 0xDB: case 0xDD: case 0xE9: case 0xED: case 0xFD:
+        return true;
+    }
+    uint8 low = op & 7;
+    return op >= 0xC0 && (low == 0 || low == 2 || low == 4 || low == 7); // RET, JP, CALL cc, RST
+}
+
+static bool skip_ed(uint8 op)
+{
+    if (op >= 0x40 && op < 0x80)
+    {
+        uint8 low = op & 7;
+        return low == 0 || low == 1 || low == 5; // IN r,(C), OUT (C),r, RETN/RETI
+    }
+    return (op >= 0xA0 && op < 0xC0 && (op & 3) >= 2) || op >= 0xB0; // INI/OUTI..., repeats
+}
+
+struct exGroup
+{
+    const char *name;
+    uint8 prefix[2];
+    int prefixLen;
+};
+
+// Addresses the instruction may write to must not hit page zero, the code or the BDOS
+static bool safe_address(uint32 a)
+{
+    a &= 0xFFFF;
+    return a >= 0x0300 && a < 0xFD00;
+}
+
+static uint32_t exercise_group(const exGroup &g, int tests, std::mt19937 &gen)
+{
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (int op = 0; op < 256; op++)
+    {
+        uint8 code[8];
+        int len;
+        if (g.prefixLen == 0)
+        {
+            if (skip_base(op))
+                continue;
+            code[0] = op;
+            len = base_length(op);
+        }
+        else if (g.prefix[0] == 0xED)
+        {
+            if (skip_ed(op))
+                continue;
+            code[0] = 0xED;
+            code[1] = op;
+            len = ((op & 0xC7) == 0x43) ? 4 : 2; // LD (nn),rr / LD rr,(nn)
+        }
+        else if (g.prefixLen == 2)
+        {
+            // DD CB d op
+            code[0] = g.prefix[0];
+            code[1] = 0xCB;
+            code[3] = op;
+            len = 4;
+        }
+        else if (g.prefix[0] == 0xCB)
+        {
+            code[0] = 0xCB;
+            code[1] = op;
+            len = 2;
+        }
+        else
+        {
+            if (skip_base(op))
+                continue;
+            code[0] = g.prefix[0];
+            code[1] = op;
+            len = 1 + base_length(op) + (uses_hl_memory(op) ? 1 : 0);
+        }
+
+        for (int t = 0; t < tests; t++)
+        {
+            // random operands (displacement, immediates) and registers, writing only to memory for data
+            int start = g.prefixLen == 0 ? 1 : 2;
+            uint32 regs[8];
+            uint32 nn;
+            int8 disp;
+            do
+            {
+                for (int i = start; i < len; i++)
+                {
+                    if (g.prefixLen != 2 || i != 3)
+                        code[i] = gen() & 0xFF;
+                }
+                for (auto &r : regs)
+                    r = gen() & 0xFFFF;
+                disp = (int8)code[2];
+                nn = (len >= 3 && g.prefixLen != 2) ? code[len - 2] | (code[len - 1] << 8) : 0x1000;
+            } while (!(safe_address(regs[1]) && safe_address(regs[2]) && safe_address(regs[3]) &&
+                       safe_address(regs[4] + disp) && safe_address(regs[5] + disp) &&
+                       safe_address(regs[6] - 2) && safe_address(regs[6] + 2) && safe_address(nn)));
+
+            memcpy(&RAM[CODE_ADDR], code, len);
+            RAM[CODE_ADDR + len] = 0x76; // HALT
+
+            Z80reset();
+            PC = CODE_ADDR;
+            AF = regs[0];
+            BC = regs[1];
+            DE = regs[2];
+            HL = regs[3];
+            IX = regs[4];
+            IY = regs[5];
+            SP = regs[6];
+            IR = regs[7];
+            AF1 = gen() & 0xFFFF;
+            BC1 = gen() & 0xFFFF;
+            DE1 = gen() & 0xFFFF;
+            HL1 = gen() & 0xFFFF;
+            Z80run();
+
+            uint32 state[] = {(uint32)AF, (uint32)BC, (uint32)DE, (uint32)HL, (uint32)IX, (uint32)IY,
+                              (uint32)SP, (uint32)IR, (uint32)PC, (uint32)AF1, (uint32)BC1, (uint32)DE1,
+                              (uint32)HL1, (uint32)IFF};
+            for (uint32 v : state)
+                crc = crc32_update(crc, v & 0xFFFF, 2);
+            uint32 addrs[] = {regs[1], regs[2], regs[3], regs[4] + disp, regs[5] + disp, regs[6] - 2,
+                              regs[6] - 1, regs[6], regs[6] + 1};
+            for (uint32 a : addrs)
+                crc = crc32_update(crc, RAM[a & 0xFFFF], 1);
+            crc = crc32_update(crc, RAM[nn] | (RAM[(nn + 1) & 0xFFFF] << 8), 2);
+        }
+    }
+    return ~crc;
+}
+
+// CRCs of the switch dispatched core
+static const exGroup groups[] = {
+    {"base", {0, 0}, 0},
+    {"CB", {0xCB, 0}, 1},
+    {"ED", {0xED, 0}, 1},
+    {"DD", {0xDD, 0}, 1},
+    {"FD", {0xFD, 0}, 1},
+    {"DDCB", {0xDD, 0xCB}, 2},
+    {"FDCB", {0xFD, 0xCB}, 2},
+};
+static const uint32_t expectedCrc[] = {0xF5D336EB, 0x938E8DF8, 0xC6A0CDC4, 0x8A38174E, 0x6A4DC256, 0x6198CBCE, 0x695F6FC0};
+
+static bool exercise(int tests)
+{
+    bool ok = true;
+    std::mt19937 gen(1);
+
+    // random memory for operands
+    std::vector<uint8_t> data = bench_random_data(MEMSIZE, 2);
+    memcpy(RAM, data.data(), MEMSIZE);
+    page_zero();
+
+    bdosQuiet = true;
+    InstrCount = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < sizeof(groups) / sizeof(groups[0]); i++)
+    {
+        uint32_t crc = exercise_group(groups[i], tests, gen);
+        bool match = crc == expectedCrc[i];
+        printf("  %-6s CRC %08X %s\n", groups[i].name, crc, match ? "OK" : "ERROR");
+        ok = ok && match;
+    }
+    double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    bdosQuiet = false;
+    report("exerciser", InstrCount, t);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    RAM = (uint8 *)calloc(1, MEMSIZE);
+    bool ok = true;
+
+#ifdef CPU_THREADED
+    printf("Z80 core: table dispatch\n");
+#else
+    printf("Z80 core: switch dispatch\n");
+#endif
+
+    if (argc > 1)
+    {
+        // CP/M program, e.g. zexdoc.com
+        FILE *f = fopen(argv[1], "rb");
+        if (f == nullptr)
+        {
+            perror(argv[1]);
+            return 1;
+        }
+        page_zero();
+        size_t n = fread(&RAM[CODE_ADDR], 1, BDOS_ADDR - CODE_ADDR, f);
+        fclose(f);
+        printf("%s: %zu bytes\n", argv[1], n);
+        InstrCount = 0;
+        double t = run_program(CODE_ADDR);
+        printf("\n");
+        report(argv[1], InstrCount, t);
+        return 0;
+    }
+
+    page_zero();
+    ok = run_bdos();
+
+    std::vector<uint8_t> data = bench_random_data(0x2000);
+    memcpy(&RAM[0x4000], data.data(), data.size());
+    ok = run_workload("CRC-16 8 KB x 100", crcProgram, sizeof(crcProgram), 100, 0x8000,
+                      crc16(data.data(), data.size())) && ok;
+    ok = run_workload("sieve 8190 x 300", sieveProgram, sizeof(sieveProgram), 300, 0x8002, 1899) && ok;
+
+    ok = exercise(200) && ok;
+
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -1,6 +1,6 @@
 # pyright: reportUndefinedVariable=false
 
-import os, glob, re, shutil, configparser
+import os, glob, re, shutil, configparser, gzip
 from jinja2 import Environment, FileSystemLoader
 from yaml import load, Loader
 
@@ -25,6 +25,16 @@ def process_template(fname, build_platform, template_env, config, prefix, build_
     with open(destination, 'w') as f:
         f.write(r)
 
+def gzip_file(fname):
+    with open(fname, 'rb') as f:
+        data = f.read()
+    # mtime=0 keeps the output (and so its ETag) the same between builds
+    compressed = gzip.compress(data, compresslevel=9, mtime=0)
+    # not worth it for small or already compressed files
+    if len(compressed) < len(data) * 0.9:
+        with open(fname + '.gz', 'wb') as f:
+            f.write(compressed)
+
 def copy_file(fname, build_platform, prefix, build_data_dir=None):
     destination = prep_dst(fname, build_platform, prefix, build_data_dir)
     shutil.copy(fname, destination)
@@ -105,3 +115,11 @@ dev_specific_prefix = os.path.join('data', 'webui', 'device_specific', build_pla
 for filename in glob.iglob(f"{dev_specific_prefix}**", recursive=True):
     if os.path.isfile(filename) and filename != '.keep':
         copy_file(filename, build_platform, dev_specific_prefix, build_data_dir)
+
+# precompressed variants of static web UI files, served by FujiNet-PC to clients accepting gzip
+# (html files are parsed for <%TAGS%> when served, they are not compressed)
+if os.environ.get("FUJINET_WEBUI_GZIP") == "1":
+    www_prefix = os.path.join(build_data_dir, 'www', '')
+    for filename in glob.iglob(f"{www_prefix}**", recursive=True):
+        if os.path.isfile(filename) and os.path.splitext(filename)[1] in ('.css', '.js', '.svg', '.ico', '.txt'):
+            gzip_file(filename)
@@ -193,6 +193,7 @@ set(SOURCES src/main.cpp
     lib/http/httpServiceParser.h lib/http/httpServiceParser.cpp
     lib/http/httpServiceConfigurator.h lib/http/httpServiceConfigurator.cpp
     lib/http/httpServiceBrowser.h lib/http/httpServiceBrowser.cpp
+    lib/http/httpServiceAssets.h lib/http/httpServiceAssets.cpp
     lib/http/mgHttpClient.h lib/http/mgHttpClient.cpp
     lib/task/fnTask.h lib/task/fnTask.cpp
     lib/task/fnTaskManager.h lib/task/fnTaskManager.cpp
@@ -233,6 +234,7 @@ set(SOURCES src/main.cpp
     lib/fuji/fujiCmd.h
     lib/fuji/fujiHost.h lib/fuji/fujiHost.cpp
     lib/fuji/fujiDisk.h lib/fuji/fujiDisk.cpp
+    lib/fuji/fujiCopy.h lib/fuji/fujiCopy.cpp
     lib/bus/bus.h
     lib/device/device.h
     lib/device/disk.h
@@ -259,6 +261,8 @@ if(FUJINET_TARGET STREQUAL "ATARI")
     lib/bus/sio/siocom/sioport.h lib/bus/sio/siocom/sioport.cpp
     lib/bus/sio/siocom/serialsio.h lib/bus/sio/siocom/serialsio.cpp
     lib/bus/sio/siocom/netsio.h lib/bus/sio/siocom/netsio.cpp
+    lib/bus/sio/siocom/siotrace.h lib/bus/sio/siocom/siotrace.cpp
+    lib/bus/sio/siocom/traceport.h lib/bus/sio/siocom/traceport.cpp
     lib/bus/sio/siocom/fnSioCom.h lib/bus/sio/siocom/fnSioCom.cpp
     lib/media/atari/diskType.h lib/media/atari/diskType.cpp
     lib/media/atari/diskTypeAtr.h lib/media/atari/diskTypeAtr.cpp
@@ -473,6 +477,26 @@ add_custom_target(build_version DEPENDS "${CMAKE_BINARY_DIR}/include/build_versi
 add_dependencies(fujinet build_version)
 target_include_directories(fujinet PRIVATE "${CMAKE_BINARY_DIR}/include")
 
+# SIO trace replay benchmark (Atari only)
+# "fujinet-sio-replay" target, it is not built by default
+#   cmake --build . --target fujinet-sio-replay
+# Record trace with "fujinet -t trace.bin", replay it with "fujinet-sio-replay -c fnconfig.ini -r trace.bin"
+if(FUJINET_TARGET STREQUAL "ATARI")
+    add_executable(fujinet-sio-replay EXCLUDE_FROM_ALL ${SOURCES})
+    target_compile_definitions(fujinet-sio-replay PRIVATE SIO_TRACE_REPLAY)
+    target_include_directories(fujinet-sio-replay PRIVATE ${INCLUDE_DIRS} ${MBEDTLS_INCLUDE_DIR} "${CMAKE_BINARY_DIR}/include")
+    target_link_libraries(fujinet-sio-replay ${CRYPTO_LIBS} pthread expat cjson cjson_utils smb2 ssh)
+    if(CMAKE_SYSTEM_NAME STREQUAL "Windows")
+        target_link_libraries(fujinet-sio-replay crypt32 ws2_32 bcrypt)
+    endif()
+    if(DEFINED USE_LIBSERIAL)
+        target_include_directories(fujinet-sio-replay PRIVATE ${LIBSERIALPORT_INCLUDE_DIRS})
+        target_link_libraries(fujinet-sio-replay ${LIBSERIALPORT_LIBRARIES})
+        target_compile_options(fujinet-sio-replay PRIVATE ${LIBSERIALPORT_CFLAGS_OTHER})
+    endif()
+    add_dependencies(fujinet-sio-replay build_version)
+endif()
+
 # WebUI
 # "build_webui" target
 add_custom_command(
@@ -483,6 +507,7 @@ add_custom_command(
       FUJINET_BUILD_BOARD=${FUJINET_BUILD_BOARD}
       FUJINET_BUILD_PLATFORM=${FUJINET_BUILD_PLATFORM}
       BUILD_DATA_DIR=${BUILD_DATA_DIR}
+      FUJINET_WEBUI_GZIP=1
       python3 build_webui.py
 )
 add_custom_target(build_webui DEPENDS "${BUILD_DATA_DIR}")
@@ -524,3 +549,9 @@ set_property(
 set_property(
     DIRECTORY APPEND PROPERTY ADDITIONAL_CLEAN_FILES "${CMAKE_BINARY_DIR}/include"
 )
+
+# Host benchmarks (bench directory), not built by default
+option(FUJINET_BENCHMARKS "Build host benchmarks" OFF)
+if(FUJINET_BENCHMARKS)
+    add_subdirectory(bench)
+endif()
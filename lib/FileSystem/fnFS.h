@@ -55,6 +55,20 @@ struct fsdir_entry
 };
 typedef struct fsdir_entry fsdir_entry_t;
 
+// A copy the file system does itself, a part per step, see FileSystem::copy_open()
+class FileSystemCopy
+{
+public:
+    virtual ~FileSystemCopy() {}
+
+    // Copy the next part, waiting up to wait_ms for it.
+    // Returns 1 when the file is copied, 0 to be called again or -1 on error.
+    virtual int step(int wait_ms) = 0;
+
+    virtual uint64_t copied() = 0;
+    virtual uint64_t size() = 0;
+};
+
 class FileSystem
 {
 protected:
@@ -110,6 +124,14 @@ public:
 
     virtual bool rename(const char* pathFrom, const char* pathTo) = 0;
 
+    // Copy a file without moving the data through FujiNet (e.g. server side copy).
+    // Returns false if the file system can't, the caller has to copy the data itself then.
+    virtual bool copy(const char* /*pathFrom*/, const char* /*pathTo*/) { return false; }
+
+    // Start a copy the file system does in steps, deleting the FileSystemCopy before it is
+    // done removes the incomplete destination. Returns nullptr if the file system can't.
+    virtual FileSystemCopy *copy_open(const char* /*pathFrom*/, const char* /*pathTo*/) { return nullptr; }
+
     virtual bool is_dir(const char *path) = 0;
     virtual bool mkdir(const char* path) = 0;
     virtual bool rmdir(const char* path) = 0;
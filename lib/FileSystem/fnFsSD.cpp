@@ -20,6 +20,9 @@
 #include "compat_string.h"
 
 #include <algorithm>
+#ifndef ESP_PLATFORM
+#include <filesystem>
+#endif
 #include <memory>
 #include <vector>
 
@@ -541,6 +544,21 @@ bool FileSystemSDFAT::rename(const char* pathFrom, const char* pathTo)
 #endif
 }
 
+#ifndef ESP_PLATFORM
+// Let the host OS copy the file, it can use copy_file_range(), reflinks etc.
+bool FileSystemSDFAT::copy(const char* pathFrom, const char* pathTo)
+{
+    char * spath = _make_fullpath(pathFrom);
+    char * dpath = _make_fullpath(pathTo);
+    std::error_code ec;
+    bool result = std::filesystem::copy_file(spath, dpath, std::filesystem::copy_options::overwrite_existing, ec);
+    Debug_printf("FileSystemSDFAT::copy returned %d (%s) on \"%s\" -> \"%s\"\r\n", result, ec.message().c_str(), pathFrom, pathTo);
+    free(spath);
+    free(dpath);
+    return result;
+}
+#endif
+
 uint64_t FileSystemSDFAT::card_size()
 {
     return _card_capacity;
@@ -41,6 +41,9 @@ public:
     bool remove(const char* path) override;
 
     bool rename(const char* pathFrom, const char* pathTo) override;
+#ifndef ESP_PLATFORM
+    bool copy(const char* pathFrom, const char* pathTo) override;
+#endif
 
     bool is_dir(const char *path) override;
     bool mkdir(const char* path) override;
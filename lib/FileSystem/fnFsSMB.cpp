@@ -3,13 +3,33 @@
 
 #include <fcntl.h>
 #include <errno.h>
+#include <time.h>
+#include <string>
 #include "compat_string.h"
 
+#ifdef ESP_PLATFORM
+#include <sys/poll.h>
+#elif defined(_WIN32)
+#include <winsock2.h>
+#define poll WSAPoll
+#else
+#include <poll.h>
+#endif
+
 #include "../../include/debug.h"
 
 #include "smb2/smb2.h"
+#include "smb2/libsmb2-raw.h"
 #include "fnFileSMB.h"
 
+// Server side copy: chunks per FSCTL_SRV_COPYCHUNK_WRITE request and chunk size,
+// within the minimum limits every server has to accept (16 chunks of 1 MB)
+#define SMB_COPYCHUNK_COUNT 16
+#define SMB_COPYCHUNK_SIZE (1024 * 1024)
+#define SMB_RESUME_KEY_SIZE 24
+// Give up waiting for the server if nothing happens for so long
+#define SMB_IOCTL_TIMEOUT 30
+
 FileSystemSMB::FileSystemSMB()
 {
     Debug_printf("FileSystemSMB::ctor\n");
@@ -118,6 +138,278 @@ bool FileSystemSMB::rename(const char *pathFrom, const char *pathTo)
     return smb_error == 0;    
 }
 
+// Result of an ioctl sent with smb_ioctl_send(), it is freed by the callback if the caller gave up waiting
+struct smb_ioctl_result
+{
+    bool finished;
+    bool abandoned;
+    int status;
+    void *output;
+    uint32_t output_count;
+    time_t last; // last time the connection was active
+};
+
+static void smb_ioctl_cb(struct smb2_context *smb, int status, void *command_data, void *private_data)
+{
+    smb_ioctl_result *result = (smb_ioctl_result *)private_data;
+    struct smb2_ioctl_reply *rep = (struct smb2_ioctl_reply *)command_data;
+
+    if (status == SMB2_STATUS_SUCCESS && rep != nullptr)
+    {
+        result->output = rep->output;
+        result->output_count = rep->output_count;
+    }
+    if (result->abandoned)
+    {
+        if (result->output != nullptr)
+            smb2_free_data(smb, result->output);
+        free(result);
+        return;
+    }
+    result->status = status;
+    result->finished = true;
+}
+
+/* Queue an FSCTL, its reply is waited for with smb_ioctl_poll().
+   Returns nullptr if it could not be sent.
+*/
+static smb_ioctl_result *smb_ioctl_send(struct smb2_context *smb, uint32_t ctl_code, struct smb2fh *fh, void *input, uint32_t input_count)
+{
+    smb_ioctl_result *result = (smb_ioctl_result *)calloc(1, sizeof(smb_ioctl_result));
+    if (result == nullptr)
+        return nullptr;
+
+    struct smb2_ioctl_request req;
+    memset(&req, 0, sizeof(req));
+    req.ctl_code = ctl_code;
+    memcpy(req.file_id, smb2_get_file_id(fh), SMB2_FD_SIZE);
+    req.input_count = input_count;
+    req.input = input;
+    req.flags = SMB2_0_IOCTL_IS_FSCTL;
+
+    struct smb2_pdu *pdu = smb2_cmd_ioctl_async(smb, &req, smb_ioctl_cb, result);
+    if (pdu == nullptr)
+    {
+        free(result);
+        return nullptr;
+    }
+    smb2_queue_pdu(smb, pdu);
+    result->last = time(nullptr);
+    return result;
+}
+
+/* Service the connection for up to wait_ms until the reply has arrived.
+   Returns 1 when it has, 0 if not yet, -1 if the connection failed or the server didn't
+   answer for SMB_IOCTL_TIMEOUT. The result is abandoned then, the callback frees it.
+*/
+static int smb_ioctl_poll(struct smb2_context *smb, smb_ioctl_result *result, int wait_ms)
+{
+    if (result->finished)
+        return 1;
+
+    struct pollfd pfd;
+    pfd.fd = smb2_get_fd(smb);
+    pfd.events = smb2_which_events(smb);
+    pfd.revents = 0;
+
+    if (poll(&pfd, 1, wait_ms) < 0 || (pfd.revents == 0 && time(nullptr) - result->last > SMB_IOCTL_TIMEOUT) ||
+        (pfd.revents != 0 && smb2_service(smb, pfd.revents) < 0))
+    {
+        // reply may still arrive, let the callback free the result
+        result->abandoned = true;
+        return -1;
+    }
+    if (pfd.revents != 0)
+        result->last = time(nullptr);
+    return result->finished ? 1 : 0;
+}
+
+/* Take the reply of a finished ioctl and free the result.
+   Returns the reply data on success, to be released with smb2_free_data(), or nullptr.
+*/
+static void *smb_ioctl_reply(struct smb2_context *smb, smb_ioctl_result *result, uint32_t *output_count)
+{
+    void *output = result->output;
+    if (result->status != SMB2_STATUS_SUCCESS)
+    {
+        Debug_printf("FileSystemSMB ioctl failed, status 0x%08lx\n", (unsigned long)result->status);
+        if (output != nullptr)
+            smb2_free_data(smb, output);
+        output = nullptr;
+    }
+    *output_count = result->output_count;
+    free(result);
+    return output;
+}
+
+/* Send FSCTL and wait for the reply, as the synchronous libsmb2 functions do.
+   Returns the reply data on success, to be released with smb2_free_data(), or nullptr.
+*/
+static void *smb_ioctl(struct smb2_context *smb, uint32_t ctl_code, struct smb2fh *fh, void *input, uint32_t input_count, uint32_t *output_count)
+{
+    smb_ioctl_result *result = smb_ioctl_send(smb, ctl_code, fh, input, input_count);
+    if (result == nullptr)
+        return nullptr;
+
+    int rc;
+    while ((rc = smb_ioctl_poll(smb, result, 1000)) == 0)
+        ;
+    if (rc < 0)
+        return nullptr;
+    return smb_ioctl_reply(smb, result, output_count);
+}
+
+static void smb_put_le(uint8_t *p, uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++, value >>= 8)
+        p[i] = value & 0xFF;
+}
+
+static uint32_t smb_get_le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* Server side copy with FSCTL_SRV_COPYCHUNK_WRITE, the data does not have to travel
+   to FujiNet and back. Each step sends one request or checks if its reply has arrived.
+*/
+class FileSystemSMBCopy : public FileSystemCopy
+{
+public:
+    FileSystemSMBCopy(struct smb2_context *smb, struct smb2fh *src, struct smb2fh *dst, uint8_t *key,
+                      uint64_t size, const char *pathTo)
+        : _smb(smb), _src(src), _dst(dst), _size(size), _pathTo(pathTo)
+    {
+        memcpy(_request, key, SMB_RESUME_KEY_SIZE);
+    }
+
+    ~FileSystemSMBCopy() override
+    {
+        if (_pending != nullptr)
+            _pending->abandoned = true; // freed by the callback
+        smb2_close(_smb, _dst);
+        smb2_close(_smb, _src);
+        if (_offset < _size || _failed)
+            smb2_unlink(_smb, _pathTo.c_str());
+    }
+
+    int step(int wait_ms) override
+    {
+        if (_failed)
+            return -1;
+        if (_offset >= _size)
+            return 1;
+
+        if (_pending == nullptr)
+        {
+            // SRV_COPYCHUNK_COPY: source key, chunk count, reserved, chunks
+            int chunks = 0;
+            uint8_t *chunk = _request + SMB_RESUME_KEY_SIZE + 8;
+            for (uint64_t pos = _offset; chunks < SMB_COPYCHUNK_COUNT && pos < _size; chunks++, pos += SMB_COPYCHUNK_SIZE)
+            {
+                uint32_t len = (_size - pos < SMB_COPYCHUNK_SIZE) ? _size - pos : SMB_COPYCHUNK_SIZE;
+                smb_put_le(chunk, pos, 8);     // source offset
+                smb_put_le(chunk + 8, pos, 8); // target offset
+                smb_put_le(chunk + 16, len, 4);
+                smb_put_le(chunk + 20, 0, 4);
+                chunk += 24;
+            }
+            smb_put_le(_request + SMB_RESUME_KEY_SIZE, chunks, 4);
+            smb_put_le(_request + SMB_RESUME_KEY_SIZE + 4, 0, 4);
+
+            _pending = smb_ioctl_send(_smb, SMB2_FSCTL_SRV_COPYCHUNK_WRITE, _dst, _request, chunk - _request);
+            if (_pending == nullptr)
+                return fail();
+        }
+
+        int rc = smb_ioctl_poll(_smb, _pending, wait_ms);
+        if (rc < 0)
+        {
+            _pending = nullptr;
+            return fail();
+        }
+        if (rc == 0)
+            return 0;
+
+        uint32_t count = 0;
+        uint8_t *response = (uint8_t *)smb_ioctl_reply(_smb, _pending, &count);
+        _pending = nullptr;
+
+        // SRV_COPYCHUNK_RESPONSE: chunks written, chunk bytes written, total bytes written
+        uint32_t written = (response != nullptr && count >= 12) ? smb_get_le32(response + 8) : 0;
+        if (response != nullptr)
+            smb2_free_data(_smb, response);
+        if (written == 0)
+            return fail();
+
+        _offset += written;
+        if (_offset < _size)
+            return 0;
+
+        Debug_printf("FileSystemSMB copy to \"%s\" done\n", _pathTo.c_str());
+        return 1;
+    }
+
+    uint64_t copied() override { return _offset; }
+    uint64_t size() override { return _size; }
+
+private:
+    int fail()
+    {
+        Debug_printf("FileSystemSMB copy to \"%s\" failed\n", _pathTo.c_str());
+        _failed = true;
+        return -1;
+    }
+
+    struct smb2_context *_smb;
+    struct smb2fh *_src;
+    struct smb2fh *_dst;
+    uint64_t _size;
+    uint64_t _offset = 0;
+    std::string _pathTo;
+    smb_ioctl_result *_pending = nullptr;
+    bool _failed = false;
+    uint8_t _request[SMB_RESUME_KEY_SIZE + 8 + SMB_COPYCHUNK_COUNT * 24];
+};
+
+FileSystemCopy *FileSystemSMB::copy_open(const char *pathFrom, const char *pathTo)
+{
+    if (!_started || pathFrom == nullptr || pathTo == nullptr)
+        return nullptr;
+
+    // skip '/' at beginning
+    if (pathFrom[0] == '/')
+        pathFrom += 1;
+    if (pathTo[0] == '/')
+        pathTo += 1;
+
+    struct smb2fh *src = smb2_open(_smb, pathFrom, O_RDONLY);
+    if (src == nullptr)
+        return nullptr;
+
+    smb2_stat_64 st;
+    struct smb2fh *dst = nullptr;
+    uint8_t *key = nullptr;
+    uint32_t count = 0;
+    FileSystemCopy *copy = nullptr;
+
+    // the server must support server side copy of this file
+    if (smb2_fstat(_smb, src, &st) == 0)
+        key = (uint8_t *)smb_ioctl(_smb, SMB2_FSCTL_SRV_REQUEST_RESUME_KEY, src, nullptr, 0, &count);
+    if (key != nullptr && count >= SMB_RESUME_KEY_SIZE)
+        dst = smb2_open(_smb, pathTo, O_WRONLY | O_CREAT | O_TRUNC);
+    if (dst != nullptr)
+        copy = new FileSystemSMBCopy(_smb, src, dst, key, st.smb2_size, pathTo);
+    else
+        smb2_close(_smb, src);
+
+    if (key != nullptr)
+        smb2_free_data(_smb, key);
+
+    Debug_printf("FileSystemSMB::copy_open(\"%s\", \"%s\") - %s\n", pathFrom, pathTo, copy ? "started" : "not supported");
+    return copy;
+}
+
 FILE  *FileSystemSMB::file_open(const char *path, const char *mode)
 {
     Debug_printf("FileSystemSMB::file_open() - ERROR! Use filehandler_open() instead\n");
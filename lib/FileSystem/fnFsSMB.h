@@ -39,6 +39,8 @@ public:
 
     bool rename(const char *pathFrom, const char *pathTo) override;
 
+    FileSystemCopy *copy_open(const char *pathFrom, const char *pathTo) override;
+
     bool is_dir(const char *path) override;
     bool mkdir(const char* path) override { return true; };
     bool rmdir(const char* path) override { return true; };
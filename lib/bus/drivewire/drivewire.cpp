@@ -43,17 +43,45 @@ static void IRAM_ATTR drivewire_isr_handler(void *arg)
 }
 #endif
 
-// Calculate 8-bit checksum
+// Calculate 16-bit checksum (sum of all bytes)
 inline uint16_t drivewire_checksum(uint8_t *buf, unsigned short len)
 {
     uint16_t chk = 0;
+    int i = 0;
 
-    for (int i = 0; i < len; i++)
+    // add 8 bytes at a time into four 16-bit lanes, a lane gets at most 2 * 255 per step,
+    // flush lanes every 128 steps before they can overflow
+    while (len - i >= 8)
+    {
+        uint64_t lanes = 0;
+        for (int steps = 0; steps < 128 && len - i >= 8; steps++, i += 8)
+        {
+            uint64_t v;
+            memcpy(&v, buf + i, sizeof(v));
+            lanes += (v & 0x00FF00FF00FF00FFULL) + ((v >> 8) & 0x00FF00FF00FF00FFULL);
+        }
+        chk += (uint16_t)(lanes + (lanes >> 16) + (lanes >> 32) + (lanes >> 48));
+    }
+
+    for (; i < len; i++)
         chk += buf[i];
 
     return chk;
 }
 
+// Read drive number and 24-bit LSN which follow OP_READEX / OP_WRITE opcode
+static bool drivewire_read_drive_lsn(uint8_t &drive_num, uint32_t &lsn)
+{
+    uint8_t hdr[4];
+
+    if (!fnDwCom.read_exact(hdr, sizeof(hdr)))
+        return false;
+
+    drive_num = hdr[0];
+    lsn = (hdr[1] << 16) | (hdr[2] << 8) | hdr[3];
+    return true;
+}
+
 #ifdef ESP_PLATFORM
 static void drivewire_intr_task(void *arg)
 {
@@ -101,6 +129,8 @@ void systemBus::op_reset()
 {
     Debug_printv("op_reset()");
     
+    _drivewire_flush_disks();
+
     // When a reset transaction occurs, set the mounted disk image to the CONFIG disk image.
     theFuji.boot_config = true;
     theFuji.insert_boot_device(Config.get_general_boot_mode());
@@ -116,11 +146,12 @@ void systemBus::op_readex()
 
     uint8_t rc = DISK_CTRL_STATUS_CLEAR;
 
-    drive_num = fnDwCom.read();
-
-    lsn = fnDwCom.read() << 16;
-    lsn |= fnDwCom.read() << 8;
-    lsn |= fnDwCom.read();
+    if (!drivewire_read_drive_lsn(drive_num, lsn))
+    {
+        Debug_printv("Timeout reading drive and LSN");
+        fnDwCom.flush_input();
+        return;
+    }
 
     Debug_printf("OP_READ: DRIVE %3u - SECTOR %8lu\n", drive_num, lsn);
 
@@ -172,12 +203,12 @@ void systemBus::op_readex()
     if (rc != DISK_CTRL_STATUS_CLEAR)
         memset(blk_buffer, 0x00, blk_size);
 
-    // send sector data
-    fnDwCom.write(blk_buffer, blk_size);
-
-    // receive checksum
-    c1 = (fnDwCom.read()) << 8;
-    c1 |= fnDwCom.read();
+    // send sector data and receive checksum
+    if (!fnDwCom.send_block_get_checksum(blk_buffer, blk_size, c1))
+    {
+        Debug_printv("Timeout waiting for checksum");
+        return;
+    }
 
     // test checksum
     if (rc == DISK_CTRL_STATUS_CLEAR)
@@ -200,16 +231,18 @@ void systemBus::op_write()
 {
     drivewireDisk *d = nullptr;
     uint16_t c1 = 0, c2 = 0;
+    uint8_t ck[2];
 
-    drive_num = fnDwCom.read();
-
-    lsn = fnDwCom.read() << 16;
-    lsn |= fnDwCom.read() << 8;
-    lsn |= fnDwCom.read();
+    if (!drivewire_read_drive_lsn(drive_num, lsn))
+    {
+        Debug_printv("Timeout reading drive and LSN");
+        fnDwCom.flush_input();
+        return;
+    }
 
     size_t s = fnDwCom.readBytes(sector_data, MEDIA_BLOCK_SIZE);
 
-    if (s != MEDIA_BLOCK_SIZE)
+    if (s != MEDIA_BLOCK_SIZE || !fnDwCom.read_exact(ck, sizeof(ck)))
     {
         Debug_printv("Insufficient # of bytes for write, total recvd: %u", s);
         fnDwCom.flush_input();
@@ -217,8 +250,8 @@ void systemBus::op_write()
     }
 
     // Todo handle checksum.
-    c1 = fnDwCom.read();
-    c1 |= fnDwCom.read() << 8;
+    c1 = ck[0];
+    c1 |= ck[1] << 8;
 
     c2 = drivewire_checksum(sector_data, MEDIA_BLOCK_SIZE);
 
@@ -254,6 +287,9 @@ void systemBus::op_write()
         return;
     }
 
+    _write_pending = true;
+    _last_write_ms = fnSystem.millis();
+
     fnDwCom.write(0x00); // success
 }
 
@@ -424,6 +460,18 @@ void systemBus::_drivewire_process_queue()
 {
 }
 
+// Write out sectors buffered by mounted disks
+void systemBus::_drivewire_flush_disks()
+{
+    _write_pending = false;
+
+    for (int i = 0; i < MAX_DISK_DEVICES; i++)
+    {
+        if (theFuji.get_disks(i)->disk_dev.flush())
+            Debug_printf("Disk %d flush error\n", i);
+    }
+}
+
 /*
  Primary DRIVEWIRE serivce loop:
  * If MOTOR line asserted, hand DRIVEWIRE processing over to the TAPE device
@@ -458,6 +506,8 @@ void systemBus::service()
 
     if (fnDwCom.available())
         _drivewire_process_cmd();
+    else if (_write_pending && fnSystem.millis() - _last_write_ms >= DRIVEWIRE_WRITE_FLUSH_MS)
+        _drivewire_flush_disks();
 
     fnDwCom.poll(1);
 
@@ -547,6 +597,8 @@ void systemBus::shutdown()
 {
     shuttingDown = true;
 
+    _drivewire_flush_disks();
+
     // TODO: implement device shutdown for all sub-busses
 
     for (std::map<uint8_t, drivewireNetwork *>::iterator it = _netDev.begin();
@@ -33,6 +33,10 @@
 
 #define DRIVEWIRE_BAUDRATE 57600
 
+// Sectors written by the CoCo are buffered by the disk media and written out
+// once the bus was quiet for this long
+#define DRIVEWIRE_WRITE_FLUSH_MS 500
+
 /* Operation Codes */
 #define		OP_NOP		0
 #define     OP_JEFF     0xA5
@@ -193,6 +197,13 @@ private:
 
     void _drivewire_process_cmd();
     void _drivewire_process_queue();
+    void _drivewire_flush_disks();
+
+    /**
+     * @brief Disk writes waiting to be flushed and time of the last one
+     */
+    bool _write_pending = false;
+    uint64_t _last_write_ms = 0;
 
     /**
      * @brief Current Baud Rate
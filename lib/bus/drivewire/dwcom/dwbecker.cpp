@@ -46,6 +46,8 @@ BeckerPort::BeckerPort() :
     _listening(true),
     _fd(-1),
     _listen_fd(-1),
+    _rxhead(0),
+    _rxtail(0),
     _state(&BeckerStopped::getInstance()),
     _errcount(0)
 {}
@@ -68,6 +70,8 @@ void BeckerPort::begin(int baud)
 
 void BeckerPort::end()
 {
+    rxbuffer_flush();
+
     // close sockets
     if (_fd >= 0)
     {
@@ -96,6 +100,10 @@ int BeckerPort::available()
     if (_state != &BeckerConnected::getInstance())
         return 0;
 
+    // data already received
+    if (rxbuffer_available() > 0)
+        return rxbuffer_available();
+
     // check if socket is still connected
     if (!connected())
     {
@@ -124,6 +132,8 @@ void BeckerPort::flush_input()
     if (_state != &BeckerConnected::getInstance())
         return;
 
+    rxbuffer_flush();
+
     // waste all input data
     uint8_t rxbuf[256];
     int avail;
@@ -420,6 +430,7 @@ bool BeckerPort::accept_connection()
 
 void BeckerPort::suspend(int short_ms, int long_ms, int threshold)
 {
+    rxbuffer_flush();
     if (_fd >= 0)
     {
         closesocket(_fd);
@@ -436,6 +447,7 @@ void BeckerPort::suspend(int short_ms, int long_ms, int threshold)
 
 void BeckerPort::suspend_on_disconnect()
 {
+    rxbuffer_flush();
     if (_listening && _listen_fd >=0)
     {
         if (_fd >= 0)
@@ -513,6 +525,10 @@ bool BeckerPort::connected()
 
 bool BeckerPort::poll_connection(int ms)
 {
+    // buffered data are waiting to be processed
+    if (rxbuffer_available() > 0)
+        return true;
+
     if (wait_sock_readable(ms) && !connected())
     {
         // connection was closed or it has an error
@@ -529,20 +545,48 @@ timeval BeckerPort::timeval_from_ms(const uint32_t millis)
   return tv;
 }
 
+size_t BeckerPort::rxbuffer_get(uint8_t *buffer, size_t size)
+{
+    size_t n = rxbuffer_available();
+    if (n > size)
+        n = size;
+    memcpy(buffer, _rxbuf + _rxhead, n);
+    _rxhead += n;
+    if (_rxhead == _rxtail)
+        rxbuffer_flush();
+    return n;
+}
+
 size_t BeckerPort::do_read(uint8_t *buffer, size_t size)
 {
     int result;
-    int to_recv;
-    int rxbytes = 0;
+    size_t rxbytes = rxbuffer_get(buffer, size);
 
     while (rxbytes < size)
     {
-        to_recv = size - rxbytes;
-        result = read_sock(buffer+rxbytes, to_recv);
-        if (result > 0)
-            rxbytes += result;
-        else // result <= 0 for disconnected or write error
-            break;
+        size_t to_recv = size - rxbytes;
+        if (to_recv >= BECKER_RXBUF_SIZE)
+        {
+            // large read, receive directly into caller's buffer
+            result = read_sock(buffer+rxbytes, to_recv);
+            if (result > 0)
+                rxbytes += result;
+            else // result <= 0 for disconnected or read error
+                break;
+        }
+        else
+        {
+            // small read, receive whatever is available into our buffer
+            result = read_sock(_rxbuf, BECKER_RXBUF_SIZE);
+            if (result > 0)
+            {
+                _rxhead = 0;
+                _rxtail = result;
+                rxbytes += rxbuffer_get(buffer+rxbytes, to_recv);
+            }
+            else // result <= 0 for disconnected or read error
+                break;
+        }
     }
     return rxbytes;
 }
@@ -11,6 +11,7 @@
 #define BECKER_IOWAIT_MS        500
 #define BECKER_CONNECT_TMOUT    2000
 #define BECKER_SUSPEND_MS       5000
+#define BECKER_RXBUF_SIZE       1024
 
 class BeckerPort;
 
@@ -94,6 +95,12 @@ private:
     int _fd;
     int _listen_fd;
 
+    // receive buffer, filled by single recv() with everything available on socket
+    // so small reads (opcode, drive, LSN, checksum) do not need select() + recv() each
+    uint8_t _rxbuf[BECKER_RXBUF_SIZE];
+    size_t _rxhead;
+    size_t _rxtail;
+
     // state machine handlers for poll(), read() and write()
     BeckerState *_state;
 
@@ -125,6 +132,9 @@ protected:
 	static timeval timeval_from_ms(const uint32_t millis);
 
 	size_t do_read(uint8_t *buffer, size_t size);
+	size_t rxbuffer_available() { return _rxtail - _rxhead; }
+	size_t rxbuffer_get(uint8_t *buffer, size_t size);
+	void rxbuffer_flush() { _rxhead = _rxtail = 0; }
 	ssize_t do_write(const uint8_t *buffer, size_t size);
 
     ssize_t read_sock(const uint8_t *buffer, size_t size, uint32_t timeout_ms=BECKER_IOWAIT_MS);
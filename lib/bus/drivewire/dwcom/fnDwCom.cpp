@@ -27,6 +27,19 @@ int DwCom::read()
     return byte;
 }
 
+// send data block and receive checksum
+bool DwCom::send_block_get_checksum(const uint8_t *buffer, size_t size, uint16_t &checksum)
+{
+    uint8_t ck[2];
+
+    _dwPort->write(buffer, size);
+    if (!read_exact(ck, sizeof(ck)))
+        return false;
+
+    checksum = (ck[0] << 8) | ck[1];
+    return true;
+}
+
 // print utility functions
 
 size_t DwCom::_print_number(unsigned long n, uint8_t base)
@@ -71,6 +71,12 @@ public:
     // write C-string
     ssize_t write(const char *str) { return _dwPort->write((const uint8_t *)str, strlen(str)); }
 
+    // read exactly length bytes, false on timeout or error
+    bool read_exact(uint8_t *buffer, size_t length) { return _dwPort->read(buffer, length) == length; }
+
+    // send data block and receive 16-bit checksum (MSB first) computed by the computer
+    bool send_block_get_checksum(const uint8_t *buffer, size_t size, uint16_t &checksum);
+
     // read single byte, mimic UARTManager
     int read();
     // write single byte, mimic UARTManager
@@ -443,6 +443,8 @@ void IRAM_ATTR iwmBus::service()
   switch (iwm_phases())
   {
   case iwm_phases_t::idle:
+    if (_write_pending && fnSystem.millis() - _last_write_ms >= IWM_WRITE_FLUSH_MS)
+      flush_disks();
     break;
   case iwm_phases_t::reset:
     Debug_printf("\r\nReset");
@@ -773,6 +775,27 @@ void iwmBus::disableDevice(uint8_t device_id)
   p->device_active = false;
 }
 
+// A disk cached a write, flush it once the bus is idle
+void iwmBus::disk_written()
+{
+  _write_pending = true;
+  _last_write_ms = fnSystem.millis();
+}
+
+// Write out blocks cached by the SmartPort disks, failed ones are tried again later
+void iwmBus::flush_disks()
+{
+  _write_pending = false;
+  for (int i = 0; i < MAX_DISK_DEVICES - MAX_DISK2_DEVICES; i++)
+  {
+    if (theFuji.get_disks(i)->disk_dev.flush())
+    {
+      Debug_printf("\r\nDisk %d flush error", i);
+      disk_written();
+    }
+  }
+}
+
 // Give devices an opportunity to clean up before a reboot
 void iwmBus::shutdown()
 {
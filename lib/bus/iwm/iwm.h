@@ -33,6 +33,9 @@ enum {
   SP_CMD_WRITE	= 0x09,
 };
 
+// SmartPort disk writes are cached by the media and flushed once the bus was idle this long
+#define IWM_WRITE_FLUSH_MS 500
+
 // see page 81-82 in Apple IIc ROM reference and Table 7-5 in IIgs firmware ref
 #define SP_ERR_NOERROR 0x00    // no error
 #define SP_ERR_BADCMD 0x01     // invalid command
@@ -310,6 +313,11 @@ private:
   int old_track = -1;
   int new_track = -1;
 
+  // SmartPort disk writes waiting in the media caches and time of the last one
+  bool _write_pending = false;
+  uint64_t _last_write_ms = 0;
+  void flush_disks();
+
 public:
   std::forward_list<iwmDevice *> _daisyChain;
 
@@ -336,6 +344,9 @@ public:
   bool getShuttingDown() { return shuttingDown; };
   bool en35Host = false; // TRUE if we are connected to a host that supports the /EN35 signal
 
+  // Called by disks after a block was written, cached blocks are flushed once the bus is idle
+  void disk_written();
+
 };
 
 extern iwmBus IWM;
@@ -109,6 +109,8 @@ uint8_t virtualDevice::bus_to_peripheral(uint8_t *buf, unsigned short len)
     while (0 == fnSioCom.available())
         fnSystem.yield();
     uint8_t ck_rcv = fnSioCom.read();
+
+    fnSioTrace.data_from_computer(buf, len, ck_rcv);
 #endif
 
     uint8_t ck_tst = sio_checksum(buf, len);
@@ -296,6 +298,7 @@ void systemBus::_sio_process_cmd()
 #ifndef ESP_PLATFORM
         // reset counter if checksum was correct
         _command_frame_counter = 0;
+        fnSioTrace.begin_command((uint8_t *)&tempFrame, sizeof(tempFrame));
 #endif
         if (tempFrame.device == SIO_DEVICEID_DISK && _fujiDev != nullptr && _fujiDev->boot_config)
         {
@@ -304,6 +307,9 @@ void systemBus::_sio_process_cmd()
             {
                 Debug_printf("Disabling CONFIG boot.\n");
                 _fujiDev->boot_config = false;
+#ifndef ESP_PLATFORM
+                fnSioTrace.end_command();
+#endif
                 return;
             }
             else
@@ -359,6 +365,8 @@ void systemBus::_sio_process_cmd()
     }
 
 #ifndef ESP_PLATFORM
+    fnSioTrace.end_command();
+
     if (!_command_processed)
     {
         // Notify NetSIO hub that we are not interested to handle this command
@@ -11,6 +11,7 @@
  * It uses SioPort for data exchange and to control SIO lines
  * SioPort can be physical serial port (SerialSioPort) to communicate with real Atari computer
  * or network SIO (NetSio = SIO over UDP) for use with Altirra Atari Emulator
+ * or recorded SIO trace (TraceSioPort) for replay benchmark
  */
 
 SioCom fnSioCom;
@@ -241,6 +242,9 @@ void SioCom::set_sio_mode(sio_mode mode)
     case sio_mode::NETSIO:
         _sioPort = &_netSio;
         break;
+    case sio_mode::TRACE:
+        _sioPort = &_traceSio;
+        break;
     default:
         _sioPort = &_serialSio;
     }
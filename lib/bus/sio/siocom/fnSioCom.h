@@ -6,6 +6,7 @@
 #include "sioport.h"
 #include "netsio.h"
 #include "serialsio.h"
+#include "traceport.h"
 
 /*
  * SIO Communication class
@@ -13,6 +14,7 @@
  * It uses SioPort for data exchange and to control SIO lines
  * SioPort can be physical serial port (SerialSioPort) to communicate with real Atari computer
  * or network SIO (NetSio = SIO over UDP) for use with Altirra Atari Emulator
+ * or recorded SIO trace (TraceSioPort) for replay benchmark
  */
 
 class SioCom
@@ -22,7 +24,8 @@ public:
     enum sio_mode
     {
         SERIAL = 0,
-        NETSIO
+        NETSIO,
+        TRACE
     };
 
 private:
@@ -30,6 +33,7 @@ private:
     SioPort *_sioPort;
     SerialSioPort _serialSio;
     NetSioPort _netSio;
+    TraceSioPort _traceSio;
 
     size_t _print_number(unsigned long n, uint8_t base);
 
@@ -86,6 +90,10 @@ public:
     void netsio_empty_sync();
     void netsio_write_size(int write_size);
 
+    // specific to TraceSioPort
+    bool set_trace_file(const char *path) { return _traceSio.open(path); }
+    TraceSioPort *get_trace_port() { return &_traceSio; }
+
     // get/set SIO mode
     sio_mode get_sio_mode() {return _sio_mode;}
     void set_sio_mode(sio_mode mode);
@@ -0,0 +1,190 @@
+#ifndef ESP_PLATFORM
+
+#ifdef BUILD_ATARI
+
+#include "siotrace.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+
+#include "../../include/debug.h"
+
+#include "fnSystem.h"
+
+SioTrace fnSioTrace;
+
+bool SioTrace::start(const char *path)
+{
+    stop();
+
+    _fp = fopen(path, "wb");
+    if (_fp == nullptr)
+    {
+        Debug_printf("SIO trace: failed to create \"%s\"\n", path);
+        return false;
+    }
+
+    uint8_t header[12] = {0};
+    memcpy(header, SIOTRACE_MAGIC, 8);
+    header[8] = SIOTRACE_VERSION & 0xFF;
+    header[9] = SIOTRACE_VERSION >> 8;
+    fwrite(header, 1, sizeof(header), _fp);
+
+    _last_us = fnSystem.micros();
+    _in_command = false;
+    Debug_printf("SIO trace: recording to \"%s\"\n", path);
+    return true;
+}
+
+void SioTrace::stop()
+{
+    if (_fp != nullptr)
+    {
+        fclose(_fp);
+        _fp = nullptr;
+        Debug_println("SIO trace: recording stopped");
+    }
+}
+
+void SioTrace::write_record(uint8_t type, const uint8_t *data, uint16_t len)
+{
+    uint64_t now = fnSystem.micros();
+    uint64_t delta = now - _last_us;
+    _last_us = now;
+    if (delta > UINT32_MAX)
+        delta = UINT32_MAX;
+
+    uint8_t hdr[7];
+    hdr[0] = type;
+    hdr[1] = delta & 0xFF;
+    hdr[2] = (delta >> 8) & 0xFF;
+    hdr[3] = (delta >> 16) & 0xFF;
+    hdr[4] = (delta >> 24) & 0xFF;
+    hdr[5] = len & 0xFF;
+    hdr[6] = len >> 8;
+    fwrite(hdr, 1, sizeof(hdr), _fp);
+    if (len > 0)
+        fwrite(data, 1, len, _fp);
+}
+
+void SioTrace::begin_command(const uint8_t *frame, size_t len)
+{
+    _in_command = true;
+    _device = frame[0];
+    _command = frame[1];
+    _cmd_start_us = fnSystem.micros();
+
+    if (_fp != nullptr)
+        write_record(SIOTRACE_REC_COMMAND, frame, len);
+}
+
+void SioTrace::data_from_computer(const uint8_t *buf, uint16_t len, uint8_t checksum)
+{
+    if (_fp == nullptr || !_in_command || len == UINT16_MAX)
+        return;
+
+    // data frame is stored together with checksum byte, exactly as received
+    std::vector<uint8_t> frame(buf, buf + len);
+    frame.push_back(checksum);
+    write_record(SIOTRACE_REC_DATA, frame.data(), frame.size());
+}
+
+void SioTrace::end_command()
+{
+    if (!_in_command)
+        return;
+    _in_command = false;
+
+    if (_fp != nullptr)
+    {
+        write_record(SIOTRACE_REC_END, nullptr, 0);
+        fflush(_fp);
+    }
+
+    if (_collect)
+    {
+        uint64_t elapsed = fnSystem.micros() - _cmd_start_us;
+        _samples.push_back({_device, _command, (uint32_t)std::min<uint64_t>(elapsed, UINT32_MAX)});
+    }
+}
+
+bool SioTrace::load(const char *path, std::vector<sio_trace_record_t> &records)
+{
+    FILE *fp = fopen(path, "rb");
+    if (fp == nullptr)
+        return false;
+
+    uint8_t header[12];
+    if (fread(header, 1, sizeof(header), fp) != sizeof(header) || memcmp(header, SIOTRACE_MAGIC, 8) != 0)
+    {
+        fclose(fp);
+        return false;
+    }
+    if ((header[8] | (header[9] << 8)) != SIOTRACE_VERSION)
+    {
+        fclose(fp);
+        return false;
+    }
+
+    records.clear();
+    uint8_t hdr[7];
+    while (fread(hdr, 1, sizeof(hdr), fp) == sizeof(hdr))
+    {
+        sio_trace_record_t rec;
+        rec.type = hdr[0];
+        rec.delta_us = hdr[1] | (hdr[2] << 8) | (hdr[3] << 16) | ((uint32_t)hdr[4] << 24);
+        uint16_t len = hdr[5] | (hdr[6] << 8);
+        rec.data.resize(len);
+        if (len > 0 && fread(rec.data.data(), 1, len, fp) != len)
+            break; // truncated record, ignore the rest
+        records.push_back(std::move(rec));
+    }
+
+    fclose(fp);
+    return true;
+}
+
+// Percentile of sorted values (nearest-rank)
+static uint32_t _percentile(const std::vector<uint32_t> &sorted, int pct)
+{
+    if (sorted.empty())
+        return 0;
+    size_t rank = (sorted.size() * pct + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static void _print_line(FILE *out, const char *label, std::vector<uint32_t> &values)
+{
+    std::sort(values.begin(), values.end());
+    fprintf(out, "%-10s %7zu %9u %9u %9u %9u\n", label, values.size(),
+            _percentile(values, 50), _percentile(values, 90), _percentile(values, 99),
+            values.empty() ? 0 : values.back());
+}
+
+void SioTrace::print_report(FILE *out)
+{
+    std::map<uint16_t, std::vector<uint32_t>> by_command;
+    std::vector<uint32_t> all;
+
+    for (const sample_t &s : _samples)
+    {
+        by_command[(s.device << 8) | s.command].push_back(s.elapsed_us);
+        all.push_back(s.elapsed_us);
+    }
+
+    fprintf(out, "%-10s %7s %9s %9s %9s %9s\n", "DEV:CMD", "count", "p50[us]", "p90[us]", "p99[us]", "max[us]");
+    for (auto &entry : by_command)
+    {
+        char label[16];
+        uint8_t cmd = entry.first & 0xFF;
+        snprintf(label, sizeof(label), "%02X:%02X %c", entry.first >> 8, cmd, (cmd >= 0x20 && cmd < 0x7F) ? cmd : '.');
+        _print_line(out, label, entry.second);
+    }
+    _print_line(out, "total", all);
+}
+
+#endif // BUILD_ATARI
+
+#endif // !ESP_PLATFORM
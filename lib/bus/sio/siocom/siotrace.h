@@ -0,0 +1,84 @@
+#ifndef SIOTRACE_H
+#define SIOTRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+/*
+ * SIO command trace
+ *
+ * Recording: SIO bus traffic (command frames and data frames sent by Atari) is written
+ * into compact binary file, together with per-command timing.
+ * Replay: the same trace is fed back via TraceSioPort and the per-command latencies
+ * are collected here, to be reported as percentiles.
+ *
+ * File format (little-endian):
+ *   header:  "FNSIOTRC" (8 bytes), uint16 version, uint16 reserved
+ *   records: uint8 type, uint32 delta_us (since previous record), uint16 length, data[length]
+ */
+
+#define SIOTRACE_MAGIC      "FNSIOTRC"
+#define SIOTRACE_VERSION    1
+
+#define SIOTRACE_REC_COMMAND 'C'    // command frame (device, command, aux1, aux2, checksum)
+#define SIOTRACE_REC_DATA    'D'    // data frame from computer (data + checksum byte)
+#define SIOTRACE_REC_END     'E'    // command processing finished (no data)
+
+struct sio_trace_record_t
+{
+    uint8_t type;
+    uint32_t delta_us;
+    std::vector<uint8_t> data;
+};
+
+class SioTrace
+{
+public:
+    // latency sample of one replayed (or recorded) command
+    struct sample_t
+    {
+        uint8_t device;
+        uint8_t command;
+        uint32_t elapsed_us;
+    };
+
+private:
+    FILE *_fp = nullptr;
+    uint64_t _last_us = 0;
+    uint64_t _cmd_start_us = 0;
+    bool _in_command = false;
+    uint8_t _device = 0;
+    uint8_t _command = 0;
+    bool _collect = false;
+    std::vector<sample_t> _samples;
+
+    void write_record(uint8_t type, const uint8_t *data, uint16_t len);
+
+public:
+    ~SioTrace() { stop(); }
+
+    // start/stop recording into file
+    bool start(const char *path);
+    void stop();
+    bool recording() { return _fp != nullptr; }
+
+    // collect latency samples (used by replay)
+    void set_collect(bool collect) { _collect = collect; }
+    const std::vector<sample_t> &samples() { return _samples; }
+    void print_report(FILE *out);
+
+    // hooks called from systemBus / virtualDevice
+    void begin_command(const uint8_t *frame, size_t len);
+    void data_from_computer(const uint8_t *buf, uint16_t len, uint8_t checksum);
+    void end_command();
+
+    // read whole trace file, returns false if file is missing or invalid
+    static bool load(const char *path, std::vector<sio_trace_record_t> &records);
+};
+
+extern SioTrace fnSioTrace;
+
+#endif // SIOTRACE_H
@@ -0,0 +1,153 @@
+#ifndef ESP_PLATFORM
+
+#ifdef BUILD_ATARI
+
+#include "traceport.h"
+
+#include "../../include/debug.h"
+
+TraceSioPort::TraceSioPort() :
+    _next(0),
+    _command_asserted(false),
+    _busy(false),
+    _frame_read(false),
+    _baud(SIOPORT_DEFAULT_BAUD),
+    _tx_bytes(0)
+{}
+
+bool TraceSioPort::open(const char *path)
+{
+    _next = 0;
+    _rx.clear();
+    _command_asserted = false;
+    _busy = false;
+    _frame_read = false;
+    _tx_bytes = 0;
+
+    if (!SioTrace::load(path, _records))
+    {
+        Debug_printf("TraceSioPort: failed to load trace \"%s\"\n", path);
+        return false;
+    }
+    Debug_printf("TraceSioPort: %zu records loaded from \"%s\"\n", _records.size(), path);
+    return true;
+}
+
+size_t TraceSioPort::commands_total()
+{
+    size_t n = 0;
+    for (const sio_trace_record_t &rec : _records)
+        if (rec.type == SIOTRACE_REC_COMMAND)
+            n++;
+    return n;
+}
+
+bool TraceSioPort::finished()
+{
+    skip_to_command();
+    return _next >= _records.size() && !_command_asserted;
+}
+
+// Drop records which were not consumed by previous command (e.g. data frame
+// which was not requested because device behaves differently now)
+void TraceSioPort::skip_to_command()
+{
+    if (_command_asserted || _busy)
+        return;
+    while (_next < _records.size() && _records[_next].type != SIOTRACE_REC_COMMAND)
+        _next++;
+}
+
+// Called by bus at the end of each service loop iteration
+bool TraceSioPort::poll(int ms)
+{
+    if (_busy)
+    {
+        // previous command is done, drop anything it did not read
+        _busy = false;
+        _frame_read = false;
+        _rx.clear();
+    }
+    return !finished();
+}
+
+bool TraceSioPort::command_asserted()
+{
+    if (!_command_asserted && !_busy)
+    {
+        skip_to_command();
+        if (_next < _records.size())
+        {
+            // present next command frame
+            const sio_trace_record_t &rec = _records[_next++];
+            _rx.insert(_rx.end(), rec.data.begin(), rec.data.end());
+            _command_asserted = true;
+        }
+    }
+    return _command_asserted;
+}
+
+// Move next data frame of current command into receive queue
+bool TraceSioPort::load_data_frame()
+{
+    if (_next < _records.size() && _records[_next].type == SIOTRACE_REC_DATA)
+    {
+        const sio_trace_record_t &rec = _records[_next++];
+        _rx.insert(_rx.end(), rec.data.begin(), rec.data.end());
+        return true;
+    }
+    return false;
+}
+
+int TraceSioPort::available()
+{
+    // nothing is pending after the command frame, its data frame comes when the device reads
+    if (_rx.empty() && _frame_read)
+        return 0;
+    if (_rx.empty() && _busy && !load_data_frame())
+    {
+        // device waits for more data than was recorded, feed it a filler byte
+        // (checksum will not match) instead of blocking the replay forever
+        _rx.push_back(0);
+    }
+    return _rx.size();
+}
+
+int TraceSioPort::read()
+{
+    if (_rx.empty() && !_command_asserted)
+    {
+        _frame_read = false;
+        load_data_frame();
+    }
+    if (_rx.empty())
+        return -1;
+
+    uint8_t b = _rx.front();
+    _rx.pop_front();
+    // command line is de-asserted once whole command frame was read
+    if (_rx.empty() && _command_asserted)
+    {
+        _command_asserted = false;
+        _busy = true;
+        _frame_read = true;
+    }
+    return b;
+}
+
+size_t TraceSioPort::read(uint8_t *buffer, size_t length)
+{
+    size_t n = 0;
+    while (n < length)
+    {
+        int b = read();
+        if (b < 0)
+            break;
+        buffer[n++] = (uint8_t)b;
+    }
+    return n;
+}
+
+#endif // BUILD_ATARI
+
+#endif // !ESP_PLATFORM
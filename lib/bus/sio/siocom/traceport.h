@@ -0,0 +1,70 @@
+#ifndef TRACEPORT_H
+#define TRACEPORT_H
+
+#include <deque>
+#include <vector>
+
+#include "sioport.h"
+#include "siotrace.h"
+
+/*
+ * Implementation of SIO Port replaying recorded SIO trace (see siotrace.h)
+ * Command frames are presented with CMD line asserted, data frames are handed out
+ * when device reads from the port. Next command frame is presented only after the bus
+ * polled the port, i.e. after previous command was processed.
+ * Anything written by devices is counted and dropped.
+ * Replay runs as fast as possible, recorded delays are not reproduced.
+ */
+
+class TraceSioPort : public SioPort
+{
+private:
+    std::vector<sio_trace_record_t> _records;
+    size_t _next;               // index of next record to be replayed
+    std::deque<uint8_t> _rx;    // bytes ready to be read by device
+    bool _command_asserted;
+    bool _busy;                 // command frame was read, waiting for bus service to finish
+    bool _frame_read;           // command frame was read, device did not read since
+    uint32_t _baud;
+    size_t _tx_bytes;
+
+    void skip_to_command();
+    bool load_data_frame();
+
+public:
+    TraceSioPort();
+    bool open(const char *path);
+    bool finished();
+    size_t commands_total();
+    size_t bytes_written() { return _tx_bytes; }
+
+    virtual void begin(int baud) override { _baud = baud; }
+    virtual void end() override {}
+    virtual bool poll(int ms) override;
+
+    virtual void set_baudrate(uint32_t baud) override { _baud = baud; }
+    virtual uint32_t get_baudrate() override { return _baud; }
+
+    virtual bool command_asserted() override;
+    virtual bool motor_asserted() override { return false; }
+    virtual void set_proceed(bool level) override {}
+    virtual void set_interrupt(bool level) override {}
+
+    virtual void bus_idle(uint16_t ms) override {}
+
+    virtual int available() override;
+    virtual void flush() override {}
+    virtual void flush_input() override { _rx.clear(); }
+
+    // read single byte
+    virtual int read() override;
+    // read bytes into buffer
+    virtual size_t read(uint8_t *buffer, size_t length) override;
+
+    // write single byte
+    virtual ssize_t write(uint8_t b) override { _tx_bytes++; return 1; }
+    // write buffer
+    virtual ssize_t write(const uint8_t *buffer, size_t size) override { _tx_bytes += size; return size; }
+};
+
+#endif // TRACEPORT_H
@@ -7,6 +7,10 @@
 #define IRAM_ATTR
 #endif
 
+#ifndef DRAM_ATTR
+#define DRAM_ATTR
+#endif
+
 #ifndef configTICK_RATE_HZ
 #define configTICK_RATE_HZ      100
 #endif
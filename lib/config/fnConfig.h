@@ -1,6 +1,8 @@
 #ifndef _FN_CONFIG_H
 #define _FN_CONFIG_H
 
+#include <atomic>
+#include <mutex>
 #include <string>
 
 #include "printer.h"
@@ -42,6 +44,19 @@
 
 #define CONFIG_FILEBUFFSIZE 2048
 
+// Changes saved within this time are written to the config file together
+#ifndef CONFIG_SAVE_DELAY_MS
+#define CONFIG_SAVE_DELAY_MS 2000
+#endif
+
+// The old config while a save swaps in the new file, restored by load() if the swap was cut short
+#define CONFIG_BACKUP_SUFFIX ".bak"
+
+// A save that could not be written is tried again after this time
+#ifndef CONFIG_SAVE_RETRY_MS
+#define CONFIG_SAVE_RETRY_MS 10000
+#endif
+
 #define CONFIG_DEFAULT_SNTPSERVER "pool.ntp.org"
 
 #define PHONEBOOK_CHAR_WIDTH 12
@@ -294,14 +309,44 @@ public:
 #endif
 
     void load();
+    // Saving is deferred, the file is written by service() after the save delay
     void save();
+    void service();
+    // Write pending or failed saves now, before reboot or exit
+    void flush();
 
     void mark_dirty() { _dirty = true; };
 
+    // 0 writes the file in save() right away
+    void set_save_delay(uint32_t ms) { _save_delay_ms = ms; };
+    // Saves requested and written, the difference was avoided by deferring them
+    uint32_t get_saves_requested() { return _saves_requested; };
+    uint32_t get_saves_written() { return _saves_written; };
+
     fnConfig();
 
 private:
-    bool _dirty = false;
+    std::atomic<bool> _dirty{false};
+
+    // The pending save, shared by the callers of save(), service() and the writer
+    std::mutex _save_lock;
+    std::string _save_data;
+    bool _save_pending = false;
+    uint64_t _save_due = 0;
+
+    uint32_t _save_delay_ms = CONFIG_SAVE_DELAY_MS;
+    std::atomic<uint32_t> _saves_requested{0};
+    std::atomic<uint32_t> _saves_written{0};
+    std::atomic<bool> _save_writing{false};
+
+    std::string _serialize();
+    void _save_start(std::string data, bool background);
+    void _save_retry(std::string &data);
+#ifdef ESP_PLATFORM
+    void _save_write(std::string data, bool to_flash);
+#else
+    void _save_write(std::string data, std::string path);
+#endif
 
     int _read_line(std::stringstream &ss, std::string &line, char abort_if_starts_with = '\0');
 
@@ -13,6 +13,31 @@
 
 #include "../../include/debug.h"
 
+/* Put the old config back if power was lost while a save swapped in the new file
+*/
+#ifdef ESP_PLATFORM
+static void _restore_backup(FileSystem *fs, const char *path)
+{
+    std::string bakpath = std::string(path) + CONFIG_BACKUP_SUFFIX;
+    if (!fs->exists(path) && fs->exists(bakpath.c_str()))
+    {
+        Debug_printf("fnConfig::load restoring %s\r\n", bakpath.c_str());
+        fs->rename(bakpath.c_str(), path);
+    }
+}
+#else
+static void _restore_backup(const char *path)
+{
+    std::string bakpath = std::string(path) + CONFIG_BACKUP_SUFFIX;
+    struct stat st;
+    if (stat(path, &st) < 0 && stat(bakpath.c_str(), &st) == 0)
+    {
+        Debug_printf("fnConfig::load restoring %s\r\n", bakpath.c_str());
+        rename(bakpath.c_str(), path);
+    }
+}
+#endif
+
 /* Load configuration data from FLASH. If no config file exists in FLASH,
    copy it from SD if a copy exists there.
 */
@@ -34,6 +59,7 @@ void fnConfig::load()
 
         if (fsFlash.exists(CONFIG_FILENAME))
             fsFlash.remove(CONFIG_FILENAME);
+        fsFlash.remove(CONFIG_FILENAME CONFIG_BACKUP_SUFFIX);
 
         // full reset, so set us as not encrypting
         _general.encrypt_passphrase = false;
@@ -72,6 +98,9 @@ New behavior: copy from SD first if available, then read FLASH.
 */
     // See if we have a copy on SD load it to check if we should write to flash (only copy from SD if we don't have a local copy)
     FILE *fin = NULL; //declare fin
+    _restore_backup(&fsFlash, CONFIG_FILENAME);
+    if (fnSDFAT.running())
+        _restore_backup(&fnSDFAT, CONFIG_FILENAME);
     if (fnSDFAT.running() && fnSDFAT.exists(CONFIG_FILENAME))
     {
         Debug_println("Load fnconfig.ini from SD");
@@ -92,7 +121,8 @@ New behavior: copy from SD first if available, then read FLASH.
  #else
 // !ESP_PLATFORM
     Debug_printf("fnConfig::load \"%s\"\n", _general.config_file_path.c_str());
-        
+    _restore_backup(_general.config_file_path.c_str());
+
     struct stat st;
     if (stat(_general.config_file_path.c_str(), &st) < 0)
     {
@@ -5,26 +5,225 @@
 
 #include <cstring>
 #include <sstream>
+#include <thread>
+#include <utility>
+
+#ifdef ESP_PLATFORM
+#include <esp_pthread.h>
+#endif
 
 #include "../../include/debug.h"
 
-/* Save configuration data to FLASH. If SD is mounted, save a backup copy there.
+// Stack of the thread writing the config file
+#define CONFIG_SAVE_STACK_SIZE 4096
+
+/* Request the configuration to be saved. The config is serialized here, on the thread
+   which changed it, and the file is written by service() once the save delay has passed,
+   so changes made by a series of commands are written only once.
 */
 void fnConfig::save()
 {
-    int i;
+    if (!_dirty)
+    {
+        Debug_println("fnConfig::save not dirty, not saving");
+        return;
+    }
+
+    _saves_requested++;
+
+    std::string data = _serialize();
+
+    if (_save_delay_ms == 0)
+    {
+        _save_start(std::move(data), false);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(_save_lock);
+    _save_data = std::move(data);
+    if (!_save_pending)
+    {
+        _save_pending = true;
+        _save_due = fnSystem.millis() + _save_delay_ms;
+    }
+}
+
+/* Write the configuration in the background if a save is due. Called from the main loop.
+*/
+void fnConfig::service()
+{
+    std::string data;
+    {
+        std::lock_guard<std::mutex> lock(_save_lock);
+        if (!_save_pending || _save_writing || fnSystem.millis() < _save_due)
+            return;
+        _save_pending = false;
+        data.swap(_save_data);
+    }
+    _save_start(std::move(data), true);
+}
+
+/* Write a pending, failed or not yet requested save now and wait for it, e.g. before reboot
+*/
+void fnConfig::flush()
+{
+    // A failed write queues itself again
+    while (_save_writing)
+        fnSystem.delay(1);
+
+    std::string data;
+    if (_dirty)
+        data = _serialize();
+    {
+        std::lock_guard<std::mutex> lock(_save_lock);
+        if (data.empty())
+            data.swap(_save_data);
+        _save_pending = false;
+        _save_data.clear();
+    }
+    if (!data.empty())
+        _save_start(std::move(data), false);
+}
 
+/* Queue the data of a failed write again, unless a newer save is pending
+*/
+void fnConfig::_save_retry(std::string &data)
+{
+    std::lock_guard<std::mutex> lock(_save_lock);
+    if (!_save_pending)
+    {
+        _save_data.swap(data);
+        _save_pending = true;
+        _save_due = fnSystem.millis() + CONFIG_SAVE_RETRY_MS;
+    }
+}
+
+/* Write the configuration data to a temporary file and rename it over the old one,
+   so the config is never left half written. Where rename won't replace a file the old
+   one is kept as CONFIG_BACKUP_SUFFIX until the new one is in place, load() restores it.
+*/
 #ifdef ESP_PLATFORM
-    Debug_println("fnConfig::save");
+static bool _write_atomic(FileSystem *fs, const char *path, const std::string &data)
+{
+    std::string tmppath = std::string(path) + ".tmp";
+
+    FILE *fout = fs->file_open(tmppath.c_str(), "w");
+    if (fout == nullptr)
+        return false;
+    size_t z = fwrite(data.c_str(), 1, data.length(), fout);
+    bool ok = (fclose(fout) == 0) && z == data.length();
+    Debug_printf("fnConfig::save wrote %u bytes\r\n", (unsigned)z);
+
+    // FAT and SPIFFS do not replace an existing file on rename
+    if (ok && !fs->rename(tmppath.c_str(), path))
+    {
+        std::string bakpath = std::string(path) + CONFIG_BACKUP_SUFFIX;
+        fs->remove(bakpath.c_str());
+        ok = fs->rename(path, bakpath.c_str()) && fs->rename(tmppath.c_str(), path);
+        if (ok)
+            fs->remove(bakpath.c_str());
+        else if (!fs->exists(path))
+            fs->rename(bakpath.c_str(), path);
+    }
+    if (!ok)
+        fs->remove(tmppath.c_str());
+    return ok;
+}
 #else
-    Debug_printf("fnConfig::save \"%s\"\r\n", _general.config_file_path.c_str());
+static bool _write_atomic(const char *path, const std::string &data)
+{
+    std::string tmppath = std::string(path) + ".tmp";
+
+    FILE *fout = fopen(tmppath.c_str(), FILE_WRITE);
+    if (fout == nullptr)
+        return false;
+    size_t z = fwrite(data.c_str(), 1, data.length(), fout);
+    bool ok = (fclose(fout) == 0) && z == data.length();
+    Debug_printf("fnConfig::save wrote %u bytes\r\n", (unsigned)z);
+
+    // Windows does not replace an existing file on rename
+    if (ok && rename(tmppath.c_str(), path) != 0)
+    {
+        std::string bakpath = std::string(path) + CONFIG_BACKUP_SUFFIX;
+        remove(bakpath.c_str());
+        ok = rename(path, bakpath.c_str()) == 0 && rename(tmppath.c_str(), path) == 0;
+        if (ok)
+            remove(bakpath.c_str());
+        else
+            rename(bakpath.c_str(), path);
+    }
+    if (!ok)
+        remove(tmppath.c_str());
+    return ok;
+}
 #endif
 
-    if (!_dirty)
+/* Save configuration data to FLASH. If SD is mounted, save a backup copy there.
+*/
+#ifdef ESP_PLATFORM
+void fnConfig::_save_write(std::string data, bool to_flash)
+{
+    bool ok = true;
+
+    if (to_flash) //only if spiffs is enabled
     {
-        Debug_println("fnConfig::save not dirty, not saving");
-        return;
+        Debug_println("FLASH Config Storage: Enabled. Saving config to FLASH");
+        if (!_write_atomic(&fsFlash, CONFIG_FILENAME, data))
+        {
+            Debug_println("Failed to write config on FLASH");
+            ok = false;
+        }
+        // Copy to SD if possible, only when wrote FLASH first
+        else if (fnSDFAT.running())
+        {
+            Debug_println("Attempting config copy to SD");
+            if (!_write_atomic(&fnSDFAT, CONFIG_FILENAME, data))
+                Debug_println("Failed to copy config to SD");
+        }
     }
+    else
+    {
+        Debug_println("FLASH Config Storage: Disabled. Saving config to SD");
+        if (!_write_atomic(&fnSDFAT, CONFIG_FILENAME, data))
+        {
+            Debug_println("Failed to write config on SD");
+            ok = false;
+        }
+    }
+    if (ok)
+    {
+        _saves_written++;
+        Debug_printf("fnConfig::save %lu of %lu saves written\r\n", (unsigned long)_saves_written, (unsigned long)_saves_requested);
+    }
+    else
+        _save_retry(data);
+    _save_writing = false;
+}
+#else
+void fnConfig::_save_write(std::string data, std::string path)
+{
+    if (!_write_atomic(path.c_str(), data))
+    {
+        Debug_printf("Failed to write config file\r\n");
+        _save_retry(data);
+    }
+    else
+    {
+        _saves_written++;
+        Debug_printf("fnConfig::save %lu of %lu saves written\r\n", (unsigned long)_saves_written, (unsigned long)_saves_requested);
+    }
+    _save_writing = false;
+}
+#endif
+
+/* Serialize the configuration into the data of one write
+*/
+std::string fnConfig::_serialize()
+{
+    int i;
+
+    // Changes made from here on make it dirty again
+    _dirty = false;
 
     // We're going to write a stringstream so that we have only one write to file at the end
     std::stringstream ss;
@@ -199,55 +398,48 @@ void fnConfig::save()
     ss << "flowcontrol=" << _bos.flowcontrol << LINETERM;
 #endif
 
+    return ss.str();
+}
+
+/* Write serialized configuration data, in a new thread if background is set
+*/
+void fnConfig::_save_start(std::string data, bool background)
+{
 #ifdef ESP_PLATFORM
-    // Write the results out
-    FILE *fout = NULL;
-    if (fnConfig::get_general_fnconfig_spifs() == true) //only if spiffs is enabled
-    {
-        Debug_println("FLASH Config Storage: Enabled. Saving config to FLASH");
-        if ( !(fout = fsFlash.file_open(CONFIG_FILENAME, "w")))
-        {
-            Debug_println("Failed to Open config on FLASH");
-            return;
-        }
-    }
-    else
-    {
-        Debug_println("FLASH Config Storage: Disabled. Saving config to SD");
-        if ( !(fout = fnSDFAT.file_open(CONFIG_FILENAME, "w")))
-        {
-            Debug_println("Failed to Open config on SD");
-            return;
-        }
-    }
+    Debug_println("fnConfig::save");
 #else
-// !ESP_PLATFORM
-    // Write the results out
-    FILE *fout = fopen(_general.config_file_path.c_str(), FILE_WRITE);
-    if (fout == nullptr)
+    Debug_printf("fnConfig::save \"%s\"\r\n", _general.config_file_path.c_str());
+#endif
+
+    // Only one writer at a time, file systems are only touched by it from here on
+    bool idle = false;
+    while (!_save_writing.compare_exchange_weak(idle, true))
     {
-        Debug_printf("Failed to open config file\r\n");
-        return;
+        idle = false;
+        fnSystem.delay(1);
     }
-#endif
-    std::string result = ss.str();
-    size_t z = fwrite(result.c_str(), 1, result.length(), fout);
-    (void)z; // Get around unused var
-    Debug_printf("fnConfig::save wrote %u bytes\r\n", (unsigned)z);
-    fclose(fout);
-    
-    _dirty = false;
 
 #ifdef ESP_PLATFORM
-    // Copy to SD if possible, only when wrote FLASH first 
-    if (fnSDFAT.running() && fnConfig::get_general_fnconfig_spifs() == true)
+    bool to_flash = fnConfig::get_general_fnconfig_spifs();
+    if (background)
     {
-        Debug_println("Attempting config copy to SD");
-        if (0 == fnSystem.copy_file(&fsFlash, CONFIG_FILENAME, &fnSDFAT, CONFIG_FILENAME))
-        {
-            Debug_println("Failed to copy config to SD");
-            return;
-        }
+        esp_pthread_cfg_t prev;
+        if (esp_pthread_get_cfg(&prev) != ESP_OK)
+            prev = esp_pthread_get_default_config();
+        esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+        cfg.stack_size = CONFIG_SAVE_STACK_SIZE;
+        cfg.thread_name = "config_save";
+        esp_pthread_set_cfg(&cfg);
+        std::thread(&fnConfig::_save_write, this, std::move(data), to_flash).detach();
+        // The cfg stays set for this task, put back what it had before
+        esp_pthread_set_cfg(&prev);
     }
+    else
+        _save_write(std::move(data), to_flash);
+#else
+    if (background)
+        std::thread(&fnConfig::_save_write, this, std::move(data), _general.config_file_path).detach();
+    else
+        _save_write(std::move(data), _general.config_file_path);
 #endif
 }
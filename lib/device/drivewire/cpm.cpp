@@ -86,6 +86,7 @@ void drivewireCPM::boot()
     {
         vTaskDelete(cpmTaskHandle);
         cpmTaskHandle = NULL;
+        _sys_closeall(); // write what the program left open
     }
 
     xTaskCreatePinnedToCore(cpmTask, "cpmtask", 32768, NULL, 20, &cpmTaskHandle, 1);
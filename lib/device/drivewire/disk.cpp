@@ -31,6 +31,7 @@ mediatype_t drivewireDisk::mount(fnFile *f, const char *filename, uint32_t disks
     // Destroy any existing MediaType
     if (_media != nullptr)
     {
+        _media->flush();
         delete _media;
         _media = nullptr;
     }
@@ -65,6 +66,8 @@ mediatype_t drivewireDisk::mount(fnFile *f, const char *filename, uint32_t disks
     
 void drivewireDisk::unmount()
 {
+    // file is closed by the caller, make sure buffered writes reach it first
+    flush();
 }
 
 bool drivewireDisk::read(uint32_t lsn, uint8_t *buf)
@@ -92,6 +95,13 @@ bool drivewireDisk::write(uint32_t lsn, uint8_t *buf)
     return r;
 }
 
+bool drivewireDisk::flush()
+{
+    if (_media == nullptr)
+        return false;
+    return _media->flush();
+}
+
 void drivewireDisk::get_media_buffer(uint8_t **p_buffer, uint16_t *p_blk_size)
 {
     if (_media)
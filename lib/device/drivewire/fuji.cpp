@@ -10,6 +10,7 @@
 
 #include <cstdint>
 #include <cstring>
+#include <algorithm>
 
 #include "../../../include/debug.h"
 
@@ -1375,26 +1376,19 @@ void drivewireFuji::base64_encode_input()
 
     std::vector<unsigned char> p(len);
     fnDwCom.readBytes(p.data(), len);
-    base64.base64_buffer += std::string((const char *)p.data(), len);
+    base64.encode_input(p.data(), len);
     errorCode = 1;
 }
 
 void drivewireFuji::base64_encode_compute()
 {
-    size_t out_len;
-
-    std::unique_ptr<char[]> p = Base64::encode(base64.base64_buffer.c_str(), base64.base64_buffer.size(), &out_len);
-
-    if (!p)
+    if (!base64.encode_compute())
     {
         Debug_printf("base64_encode_compute() failed.\n");
         errorCode = 144;
         return;
     }
 
-    base64.base64_buffer.clear();
-    base64.base64_buffer = std::string(p.get(), out_len);
-
     errorCode = 1;
 }
 
@@ -1431,9 +1425,7 @@ void drivewireFuji::base64_encode_output()
     }
 
     std::vector<unsigned char> p(len);
-    std::memcpy(p.data(), base64.base64_buffer.data(), len);
-    base64.base64_buffer.erase(0, len);
-    base64.base64_buffer.shrink_to_fit();
+    base64.take_buffer(p.data(), std::min((size_t)len, base64.base64_buffer.length()));
 
     response = std::string((const char *)p.data(), len);
     errorCode = 1;    
@@ -1454,29 +1446,23 @@ void drivewireFuji::base64_decode_input()
 
     std::vector<unsigned char> p(len);
     fnDwCom.readBytes(p.data(), len);
-    base64.base64_buffer += std::string((const char *)p.data(), len);
+    base64.decode_input((const char *)p.data(), len);
 
     errorCode = 1;
 }
 
 void drivewireFuji::base64_decode_compute()
 {
-    size_t out_len;
-
     Debug_printf("FUJI: BASE64 DECODE COMPUTE\n");
 
-    std::unique_ptr<unsigned char[]> p = Base64::decode(base64.base64_buffer.c_str(), base64.base64_buffer.size(), &out_len);
-    if (!p)
+    if (!base64.decode_compute())
     {
         Debug_printf("base64_encode compute failed\n");
         errorCode = 144;
         return;
     }
 
-    base64.base64_buffer.clear();
-    base64.base64_buffer = std::string((const char *)p.get(), out_len);
-
-    Debug_printf("Resulting BASE64 encoded data is: %u bytes\n", out_len);
+    Debug_printf("Resulting BASE64 encoded data is: %u bytes\n", base64.base64_buffer.length());
     errorCode = 1;
 }
 
@@ -1534,9 +1520,7 @@ void drivewireFuji::base64_decode_output()
     }
 
     std::vector<unsigned char> p(len);
-    memcpy(p.data(), base64.base64_buffer.data(), len);
-    base64.base64_buffer.erase(0, len);
-    base64.base64_buffer.shrink_to_fit();
+    base64.take_buffer(p.data(), len);
     response.clear();
     response.shrink_to_fit();
     response = std::string((const char *)p.data(), len);
@@ -71,7 +71,11 @@ void iecCpm::iec_open()
 void iecCpm::iec_close()
 {
     if (cpmTaskHandle != NULL)
+    {
         vTaskDelete(cpmTaskHandle);
+        cpmTaskHandle = NULL;
+        _sys_closeall(); // write what the program left open
+    }
 
     commanddata.init();
     state = DEVICE_IDLE;
@@ -328,7 +328,14 @@ void iwmCPM::process(iwm_decoded_cmd_t cmd)
 
 void iwmCPM::shutdown()
 {
-    // TODO: clean shutdown.
+#ifdef ESP_PLATFORM // OS
+    if (cpmTaskHandle != NULL)
+    {
+        vTaskDelete(cpmTaskHandle);
+        cpmTaskHandle = NULL;
+    }
+#endif
+    _sys_closeall(); // write what the program left open
 }
 
 #endif /* BUILD_APPLE */
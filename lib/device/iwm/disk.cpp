@@ -328,8 +328,7 @@ void iwmDisk::iwm_readblock(iwm_decoded_cmd_t cmd)
   
   // send_data_packet();
   Debug_printf("\r\nsending block packet ...");
-  if (IWM.iwm_send_packet(id(), iwm_packet_type_t::data, 0, data_buffer, BLOCK_DATA_LEN))
-   ((MediaTypePO*)_disk)->reset_seek_opto();  // force seek next time if send error
+  IWM.iwm_send_packet(id(), iwm_packet_type_t::data, 0, data_buffer, BLOCK_DATA_LEN);
 }
 
 void iwmDisk::iwm_writeblock(iwm_decoded_cmd_t cmd)
@@ -384,7 +383,10 @@ void iwmDisk::iwm_writeblock(iwm_decoded_cmd_t cmd)
       }
 
       uint16_t sdstato = BLOCK_DATA_LEN;
-      _disk->write(block_num, &sdstato, data_buffer);
+      if (_disk->write(block_num, &sdstato, data_buffer))
+        sdstato = 1; // I/O error
+      else
+        IWM.disk_written(); // cached, bus flushes it once idle
       
       if (sdstato != BLOCK_DATA_LEN)
       {
@@ -413,6 +415,14 @@ void iwmDisk::iwm_writeblock(iwm_decoded_cmd_t cmd)
 
 void iwmDisk::shutdown()
 {
+  flush();
+}
+
+bool iwmDisk::flush()
+{
+  if (_disk == nullptr)
+    return false;
+  return _disk->flush();
 }
 
 iwmDisk::iwmDisk()
@@ -50,6 +50,8 @@ public:
     fujiHost *host = nullptr;
     mediatype_t mount(fnFile *f, const char *filename, uint32_t disksize, mediatype_t disk_type = MEDIATYPE_UNKNOWN);
     void unmount();
+    // Write out blocks cached by the media, returns TRUE on error
+    bool flush();
     bool write_blank(fnFile *f, uint16_t sectorSize, uint16_t numSectors);
     bool write_blank(fnFile *f, uint16_t numBlocks);
 
@@ -144,8 +144,12 @@ void IRAM_ATTR iwmDisk2::change_track(int indicator)
   // and where the track data is located so it can convert it
   if (((MediaTypeWOZ *)_disk)->trackmap(track_pos) != 255)
   {
+    // DSK images are nibblized one track at a time as the head gets there
+    uint8_t *track = (_disk->_mediatype == MEDIATYPE_DO || _disk->_mediatype == MEDIATYPE_PO)
+                         ? ((MediaTypeDSK *)_disk)->get_track(track_pos)
+                         : ((MediaTypeWOZ *)_disk)->get_track(track_pos);
     diskii_xface.copy_track(
-        ((MediaTypeWOZ *)_disk)->get_track(track_pos),
+        track,
         ((MediaTypeWOZ *)_disk)->track_len(track_pos),
         ((MediaTypeWOZ *)_disk)->num_bits(track_pos),
         NS_PER_BIT_TIME * ((MediaTypeWOZ *)_disk)->optimal_bit_timing);
@@ -1472,9 +1472,7 @@ void iwmFuji::handle_ctl_eject(uint8_t spid)
 
 void iwmFuji::iwm_ctrl_hash_input()
 {
-    std::vector<uint8_t> data(data_len, 0);
-    std::copy(&data_buffer[0], &data_buffer[0] + data_len, data.begin());
-    hasher.add_data(data);
+    hasher.add_data(data_buffer, data_len);
 }
 
 void iwmFuji::iwm_ctrl_hash_compute(bool clear_data)
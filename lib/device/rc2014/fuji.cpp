@@ -980,18 +980,15 @@ void rc2014Fuji::rc2014_base64_encode_input()
     rc2014_send_ack();
     rc2014_recv_buffer((uint8_t *)p.data(), len);
     rc2014_send_ack();
-    base64.base64_buffer += std::string((const char *)p.data(), len);
+    base64.encode_input(p.data(), len);
     rc2014_send_complete();
 }
 
 void rc2014Fuji::rc2014_base64_encode_compute()
 {
-    size_t out_len;
-
     Debug_printf("FUJI: BASE64 ENCODE COMPUTE\n");
 
-    std::unique_ptr<char[]> p = Base64::encode(base64.base64_buffer.c_str(), base64.base64_buffer.size(), &out_len);
-    if (!p)
+    if (!base64.encode_compute())
     {
         Debug_printf("base64_encode compute failed\n");
         rc2014_send_error();
@@ -1000,10 +997,7 @@ void rc2014Fuji::rc2014_base64_encode_compute()
 
     rc2014_send_ack();
 
-    base64.base64_buffer.clear();
-    base64.base64_buffer = std::string(p.get(), out_len);
-
-    Debug_printf("Resulting BASE64 encoded data is: %u bytes\n", out_len);
+    Debug_printf("Resulting BASE64 encoded data is: %u bytes\n", base64.base64_buffer.length());
     rc2014_send_complete();
 }
 
@@ -1051,9 +1045,7 @@ void rc2014Fuji::rc2014_base64_encode_output()
     std::vector<unsigned char> p(len);
     rc2014_send_ack();
 
-    memcpy(p.data(), base64.base64_buffer.data(), len);
-    base64.base64_buffer.erase(0, len);
-    base64.base64_buffer.shrink_to_fit();
+    base64.take_buffer(p.data(), len);
 
     rc2014_send_buffer(p.data(), len);
     rc2014_flush();
@@ -1078,18 +1070,15 @@ void rc2014Fuji::rc2014_base64_decode_input()
 
     rc2014_recv_buffer((uint8_t *)p.data(), len);
     rc2014_send_ack();
-    base64.base64_buffer += std::string((const char *)p.data(), len);
+    base64.decode_input((const char *)p.data(), len);
     rc2014_send_complete();
 }
 
 void rc2014Fuji::rc2014_base64_decode_compute()
 {
-    size_t out_len;
-
     Debug_printf("FUJI: BASE64 DECODE COMPUTE\n");
 
-    std::unique_ptr<unsigned char[]> p = Base64::decode(base64.base64_buffer.c_str(),base64.base64_buffer.size(),&out_len);
-    if (!p)
+    if (!base64.decode_compute())
     {
         Debug_printf("base64_encode compute failed\n");
         rc2014_send_error();
@@ -1098,10 +1087,7 @@ void rc2014Fuji::rc2014_base64_decode_compute()
 
     rc2014_send_ack();
 
-    base64.base64_buffer.clear();
-    base64.base64_buffer = std::string((const char *)p.get(), out_len);
-
-    Debug_printf("Resulting BASE64 encoded data is: %u bytes\n", out_len);
+    Debug_printf("Resulting BASE64 encoded data is: %u bytes\n", base64.base64_buffer.length());
     rc2014_send_complete();
 }
 
@@ -1150,9 +1136,7 @@ void rc2014Fuji::rc2014_base64_decode_output()
 
     std::vector<unsigned char> p(len);
     rc2014_send_ack();
-    memcpy(p.data(), base64.base64_buffer.data(), len);
-    base64.base64_buffer.erase(0, len);
-    base64.base64_buffer.shrink_to_fit();
+    base64.take_buffer(p.data(), len);
 
     rc2014_send_buffer(p.data(), len);
     rc2014_flush();
@@ -4,6 +4,7 @@
 
 #ifdef ESP_PLATFORM
 #include <driver/ledc.h>
+#include <esp_pthread.h>
 #endif
 
 #include <cstdint>
@@ -13,6 +14,7 @@
 #include <libgen.h>
 #endif
 #include <map>
+#include <thread>
 #include <vector>
 #include "compat_string.h"
 
@@ -33,9 +35,13 @@
 
 #include "base64.h"
 #include "hash.h"
+#include "fnTaskManager.h"
 
 #define ADDITIONAL_DETAILS_BYTES 10
 
+// Stack of the threads mounting hosts in mount_all()
+#define MOUNT_ALL_STACK_SIZE 8192
+
 sioFuji theFuji; // global fuji device object
 
 // sioDisk sioDiskDevs[MAX_HOSTS];
@@ -543,6 +549,8 @@ void sioFuji::sio_set_boot_config()
 }
 
 // Do SIO copy
+// aux1 = source host slot, aux2 = destination host slot, with FUJI_COPY_BACKGROUND set
+// the command completes right away and the progress is read with FUJICMD_COPY_STATUS
 void sioFuji::sio_copy_file()
 {
     uint8_t csBuf[256];
@@ -550,19 +558,9 @@ void sioFuji::sio_copy_file()
     std::string sourcePath;
     std::string destPath;
     uint8_t ck;
-    fnFile *sourceFile;
-    fnFile *destFile;
-    char *dataBuf;
     unsigned char sourceSlot;
     unsigned char destSlot;
-
-    dataBuf = (char *)malloc(532);
-
-    if (dataBuf == nullptr)
-    {
-        sio_error();
-        return;
-    }
+    bool background = (cmdFrame.aux2 & FUJI_COPY_BACKGROUND) != 0;
 
     memset(&csBuf, 0, sizeof(csBuf));
 
@@ -571,7 +569,6 @@ void sioFuji::sio_copy_file()
     if (ck != sio_checksum(csBuf, sizeof(csBuf)))
     {
         sio_error();
-        free(dataBuf);
         return;
     }
 
@@ -583,26 +580,33 @@ void sioFuji::sio_copy_file()
     if (copySpec.empty() || copySpec.find_first_of("|") == std::string::npos)
     {
         sio_error();
-        free(dataBuf);
         return;
     }
 
     if (cmdFrame.aux1 < 1 || cmdFrame.aux1 > 8)
     {
         sio_error();
-        free(dataBuf);
         return;
     }
 
-    if (cmdFrame.aux2 < 1 || cmdFrame.aux2 > 8)
+    destSlot = cmdFrame.aux2 & ~FUJI_COPY_BACKGROUND;
+    if (destSlot < 1 || destSlot > 8)
+    {
+        sio_error();
+        return;
+    }
+
+    // One copy at a time
+    if (_copyTaskId != 0 && _copyStatus.state == COPYSTATE_RUNNING)
     {
+        Debug_printf("Copy File: still copying\n");
         sio_error();
-        free(dataBuf);
         return;
     }
+    _copyTaskId = 0;
 
     sourceSlot = cmdFrame.aux1 - 1;
-    destSlot = cmdFrame.aux2 - 1;
+    destSlot -= 1;
 
     // All good, after this point...
 
@@ -622,70 +626,101 @@ void sioFuji::sio_copy_file()
     _fnHosts[sourceSlot].mount();
     _fnHosts[destSlot].mount();
 
-    // Open files...
-    sourceFile = _fnHosts[sourceSlot].fnfile_open(sourcePath.c_str(), (char *)sourcePath.c_str(), sourcePath.size() + 1, FILE_READ);
+    fujiCopyTask *task = new fujiCopyTask(&_fnHosts[sourceSlot], sourcePath, &_fnHosts[destSlot], destPath, &_copyStatus,
+                                          background ? FUJI_COPY_STEP_SIZE : FUJI_COPY_BLOCK_SIZE);
 
-    if (sourceFile == nullptr)
+    if (!background)
     {
-        sio_error();
-        free(dataBuf);
+        // Complete when the file is copied
+        bool ok = task->run();
+        delete task;
+        if (ok)
+            sio_complete();
+        else
+            sio_error();
         return;
     }
 
-    destFile = _fnHosts[destSlot].fnfile_open(destPath.c_str(), (char *)destPath.c_str(), destPath.size() + 1, FILE_WRITE);
-
-    if (destFile == nullptr)
+    _copyTaskId = taskMgr.submit_task(task);
+    if (_copyTaskId == 0)
     {
+        delete task;
+        _copyStatus.state = COPYSTATE_ERROR;
         sio_error();
-        fnio::fclose(sourceFile);
-        free(dataBuf);
         return;
     }
+    sio_complete();
+}
 
-    size_t readCount = 0;
-    size_t readTotal = 0;
-    size_t writeCount = 0;
-    size_t expected = _fnHosts[sourceSlot].file_size(sourceFile); // get the filesize
-    bool err = false;
-    do
-    {
-        readCount = fnio::fread(dataBuf, 1, 532, sourceFile);
-        readTotal += readCount;
-        // Check if we got enough bytes on the read
-        if (readCount < 532 && readTotal != expected)
-        {
-            err = true;
-            break;
-        }
-        writeCount = fnio::fwrite(dataBuf, 1, readCount, destFile);
-        // Check if we sent enough bytes on the write
-        if (writeCount != readCount)
-        {
-            err = true;
-            break;
-        }
-        Debug_printf("Copy File: %d bytes of %d\n", readTotal, expected);
-    } while (readTotal < expected);
+// Stop background copy, before the hosts it uses change
+void sioFuji::copy_abort()
+{
+    if (_copyTaskId != 0 && _copyStatus.state == COPYSTATE_RUNNING)
+        taskMgr.abort_task(_copyTaskId);
+    _copyTaskId = 0;
+}
 
-    if (err == true)
-    {
-        // Remove the destination file and error
-        _fnHosts[destSlot].file_remove((char *)destPath.c_str());
-        sio_error();
-        Debug_printf("Copy File Error! wCount: %d, rCount: %d, rTotal: %d, Expect: %d\n", writeCount, readCount, readTotal, expected);
-    }
-    else
+// Progress of the last copy: state, bytes copied, file size
+void sioFuji::sio_copy_status()
+{
+    uint8_t status[9];
+
+    status[0] = _copyStatus.state;
+    status[1] = _copyStatus.copied & 0xFF;
+    status[2] = (_copyStatus.copied >> 8) & 0xFF;
+    status[3] = (_copyStatus.copied >> 16) & 0xFF;
+    status[4] = (_copyStatus.copied >> 24) & 0xFF;
+    status[5] = _copyStatus.total & 0xFF;
+    status[6] = (_copyStatus.total >> 8) & 0xFF;
+    status[7] = (_copyStatus.total >> 16) & 0xFF;
+    status[8] = (_copyStatus.total >> 24) & 0xFF;
+
+    bus_to_computer(status, sizeof(status), false);
+}
+
+// Hosts used by mount_all(), each one is mounted and its images opened in its own thread
+struct mountAllHost
+{
+    fujiHost *host = nullptr;
+    bool mounted = false;
+    std::vector<int> slots;
+    unsigned long mount_ms = 0;
+    unsigned long open_ms[MAX_DISK_DEVICES] = {0};
+};
+
+// Mount the host, then open its images one after another, the file system of a host
+// may not be used from more than one thread
+static void mount_all_host(mountAllHost *mh, fujiDisk *disks)
+{
+    unsigned long start = fnSystem.millis();
+    mh->mounted = mh->host->mount();
+    mh->mount_ms = fnSystem.millis() - start;
+
+    if (!mh->mounted)
+        return;
+
+    for (int i : mh->slots)
     {
-        sio_complete();
-    }
+        fujiDisk &disk = disks[i];
+        char flag[4] = {'r', 'b', 0, 0};
+
+        if (disk.access_mode == DISK_ACCESS_MODE_WRITE)
+            flag[2] = '+';
 
-    // copyEnd:
-    fnio::fclose(sourceFile);
-    fnio::fclose(destFile);
-    free(dataBuf);
+        Debug_printf("Selecting '%s' from host #%u as %s on D%u:\n",
+                     disk.filename, disk.host_slot, flag, i + 1);
+
+        start = fnSystem.millis();
+        disk.fileh = mh->host->fnfile_open(disk.filename, disk.filename, sizeof(disk.filename), flag);
+        // We need the file size for loading XEX files and for CASSETTE, so get that too
+        if (disk.fileh != nullptr)
+            disk.disk_size = mh->host->file_size(disk.fileh);
+        mh->open_ms[i] = fnSystem.millis() - start;
+    }
 }
 
 // Mount all
+// Distinct hosts are mounted in parallel, so boot waits for the slowest host instead of all of them
 #ifdef ESP_PLATFORM
 void sioFuji::mount_all()
 #else
@@ -693,59 +728,94 @@ int sioFuji::mount_all(bool siomode)
 #endif
 {
     bool nodisks = true; // Check at the end if no disks are in a slot and disable config
+    bool failed = false;
+    unsigned long start = fnSystem.millis();
 
-    for (int i = 0; i < 8; i++)
+    // Group the slots by host
+    mountAllHost hosts[MAX_HOSTS];
+    for (int i = 0; i < MAX_DISK_DEVICES; i++)
     {
         fujiDisk &disk = _fnDisks[i];
-        fujiHost &host = _fnHosts[disk.host_slot];
-        char flag[4] = {'r', 'b', 0, 0};
-
-        if (disk.access_mode == DISK_ACCESS_MODE_WRITE)
-            flag[2] = '+';
 
         if (disk.host_slot != INVALID_HOST_SLOT && strlen(disk.filename) > 0)
         {
             nodisks = false; // We have a disk in a slot
 
-            if (host.mount() == false)
-            {
+            hosts[disk.host_slot].host = &_fnHosts[disk.host_slot];
+            hosts[disk.host_slot].slots.push_back(i);
+        }
+    }
+
 #ifdef ESP_PLATFORM
-                sio_error();
-                return;
-#else
-                return _on_error(siomode);
+    // Network file systems need more stack than the pthread default
+    esp_pthread_cfg_t prev;
+    if (esp_pthread_get_cfg(&prev) != ESP_OK)
+        prev = esp_pthread_get_default_config();
+    esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+    cfg.stack_size = MOUNT_ALL_STACK_SIZE;
+    cfg.thread_name = "mount_all";
+    esp_pthread_set_cfg(&cfg);
 #endif
-            }
 
-            Debug_printf("Selecting '%s' from host #%u as %s on D%u:\n",
-                         disk.filename, disk.host_slot, flag, i + 1);
+    std::vector<std::thread> threads;
+    for (int h = 0; h < MAX_HOSTS; h++)
+    {
+        if (hosts[h].host != nullptr)
+            threads.emplace_back(mount_all_host, &hosts[h], _fnDisks);
+    }
+#ifdef ESP_PLATFORM
+    // The cfg stays set for this task, put back what it had before
+    esp_pthread_set_cfg(&prev);
+#endif
+    for (auto &t : threads)
+        t.join();
+
+    // Mount the images in slot order, up to the first one that failed
+    for (int i = 0; i < MAX_DISK_DEVICES; i++)
+    {
+        fujiDisk &disk = _fnDisks[i];
 
-            disk.fileh = host.fnfile_open(disk.filename, disk.filename, sizeof(disk.filename), flag);
+        if (disk.host_slot == INVALID_HOST_SLOT || strlen(disk.filename) == 0)
+            continue;
 
-            if (disk.fileh == nullptr)
+        mountAllHost &mh = hosts[disk.host_slot];
+        Debug_printf("D%u: host #%u mounted in %lu ms, image opened in %lu ms\n",
+                     i + 1, disk.host_slot, mh.mount_ms, mh.open_ms[i]);
+
+        if (failed || !mh.mounted || disk.fileh == nullptr)
+        {
+            // Later slots stay unmounted, as if they were never tried
+            if (failed && disk.fileh != nullptr)
             {
-#ifdef ESP_PLATFORM
-                sio_error();
-                return;
-#else
-                return _on_error(siomode);
-#endif
+                fnio::fclose(disk.fileh);
+                disk.fileh = nullptr;
             }
+            failed = true;
+            continue;
+        }
 
-            // We've gotten this far, so make sure our bootable CONFIG disk is disabled
-            boot_config = false;
-            status_wait_count = 0;
+        // We've gotten this far, so make sure our bootable CONFIG disk is disabled
+        boot_config = false;
+        status_wait_count = 0;
 
-            // We need the file size for loading XEX files and for CASSETTE, so get that too
-            disk.disk_size = host.file_size(disk.fileh);
+        // Set the host slot for high score mode
+        // TODO: Refactor along with mount disk image.
+        disk.disk_dev.host = mh.host;
 
-            // Set the host slot for high score mode
-            // TODO: Refactor along with mount disk image.
-            disk.disk_dev.host = &host;
+        // And now mount it
+        disk.disk_type = disk.disk_dev.mount(disk.fileh, disk.filename, disk.disk_size);
+    }
 
-            // And now mount it
-            disk.disk_type = disk.disk_dev.mount(disk.fileh, disk.filename, disk.disk_size);
-        }
+    Debug_printf("mount_all %s in %lu ms\n", failed ? "failed" : "completed", (unsigned long)(fnSystem.millis() - start));
+
+    if (failed)
+    {
+#ifdef ESP_PLATFORM
+        sio_error();
+        return;
+#else
+        return _on_error(siomode);
+#endif
     }
 
     if (nodisks)
@@ -1643,6 +1713,8 @@ void sioFuji::sio_unmount_host()
         return;
     }
 
+    copy_abort();
+
     // Unmount any disks associated with host slot
     for (int i = 0; i < MAX_DISK_DEVICES; i++)
     {
@@ -1691,6 +1763,8 @@ void sioFuji::sio_write_host_slots()
 
     if (sio_checksum((uint8_t *)hostSlots, sizeof(hostSlots)) == ck)
     {
+        copy_abort();
+
         for (int i = 0; i < MAX_HOSTS; i++)
             _fnHosts[i].set_hostname(hostSlots[i]);
 
@@ -1843,6 +1917,8 @@ void sioFuji::sio_write_device_slots()
 // Temporary(?) function while we move from old config storage to new
 void sioFuji::_populate_slots_from_config()
 {
+    copy_abort(); // the web UI can change the hosts under a background copy
+
     for (int i = 0; i < MAX_HOSTS; i++)
     {
         if (Config.get_host_type(i) == fnConfig::host_types::HOSTTYPE_INVALID)
@@ -2201,28 +2277,22 @@ void sioFuji::sio_base64_encode_input()
 
     std::vector<unsigned char> p(len);
     bus_to_peripheral(p.data(), len);
-    base64.base64_buffer += std::string((const char *)p.data(), len);
+    base64.encode_input(p.data(), len);
     sio_complete();
 }
 
 void sioFuji::sio_base64_encode_compute()
 {
-    size_t out_len;
-
     Debug_printf("FUJI: BASE64 ENCODE COMPUTE\n");
 
-    std::unique_ptr<char[]> p = Base64::encode(base64.base64_buffer.c_str(), base64.base64_buffer.size(), &out_len);
-    if (!p)
+    if (!base64.encode_compute())
     {
         Debug_printf("base64_encode compute failed\n");
         sio_error();
         return;
     }
 
-    base64.base64_buffer.clear();
-    base64.base64_buffer = std::string(p.get(), out_len);
-
-    Debug_printf("Resulting BASE64 encoded data is: %u bytes\n", out_len);
+    Debug_printf("Resulting BASE64 encoded data is: %u bytes\n", base64.base64_buffer.length());
     sio_complete();
 }
 
@@ -2271,9 +2341,7 @@ void sioFuji::sio_base64_encode_output()
     }
 
     std::vector<unsigned char> p(len);
-    std::memcpy(p.data(), base64.base64_buffer.data(), len);
-    base64.base64_buffer.erase(0, len);
-    base64.base64_buffer.shrink_to_fit();
+    base64.take_buffer(p.data(), len);
 
     bus_to_computer(p.data(), len, false);
 }
@@ -2299,28 +2367,22 @@ void sioFuji::sio_base64_decode_input()
 
     std::vector<unsigned char> p(len);
     bus_to_peripheral(p.data(), len);
-    base64.base64_buffer += std::string((const char *)p.data(), len);
+    base64.decode_input((const char *)p.data(), len);
     sio_complete();
 }
 
 void sioFuji::sio_base64_decode_compute()
 {
-    size_t out_len;
-
     Debug_printf("FUJI: BASE64 DECODE COMPUTE\n");
 
-    std::unique_ptr<unsigned char[]> p = Base64::decode(base64.base64_buffer.c_str(), base64.base64_buffer.size(), &out_len);
-    if (!p)
+    if (!base64.decode_compute())
     {
         Debug_printf("base64_encode compute failed\n");
         sio_error();
         return;
     }
 
-    base64.base64_buffer.clear();
-    base64.base64_buffer = std::string((const char *)p.get(), out_len);
-
-    Debug_printf("Resulting BASE64 encoded data is: %u bytes\n", out_len);
+    Debug_printf("Resulting BASE64 encoded data is: %u bytes\n", base64.base64_buffer.length());
     sio_complete();
 }
 
@@ -2372,9 +2434,7 @@ void sioFuji::sio_base64_decode_output()
     }
 
     std::vector<unsigned char> p(len);
-    memcpy(p.data(), base64.base64_buffer.data(), len);
-    base64.base64_buffer.erase(0, len);
-    base64.base64_buffer.shrink_to_fit();
+    base64.take_buffer(p.data(), len);
     bus_to_computer(p.data(), len, false);
 }
 
@@ -2658,6 +2718,10 @@ void sioFuji::sio_process(uint32_t commanddata, uint8_t checksum)
         sio_ack();
         sio_hash_clear();
         break;
+    case FUJICMD_COPY_STATUS:
+        sio_ack();
+        sio_copy_status();
+        break;
     case FUJICMD_RANDOM_NUMBER:
         sio_ack();
         sio_random_number();
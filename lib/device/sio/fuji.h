@@ -18,6 +18,7 @@
 #include "fujiHost.h"
 #include "fujiDisk.h"
 #include "fujiCmd.h"
+#include "fujiCopy.h"
 
 #include "hash.h"
 
@@ -114,7 +115,12 @@ private:
     mbedtls_sha512_context _sha512;
 
     Hash::Algorithm algorithm = Hash::Algorithm::UNKNOWN;
-    
+
+    fujiCopyStatus _copyStatus;
+    uint8_t _copyTaskId = 0; // background copy, if any
+
+    void copy_abort();
+
 protected:
     void sio_reset_fujinet();          // 0xFF
     void sio_net_get_ssid();           // 0xFE
@@ -177,6 +183,7 @@ protected:
     void sio_hash_output();            // 0xC5
     void sio_get_adapter_config_extended(); // 0xC4
     void sio_hash_clear();             // 0xC2
+    void sio_copy_status();            // 0xC1
 
     void sio_status() override;
     void sio_process(uint32_t commanddata, uint8_t checksum) override;
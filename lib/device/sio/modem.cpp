@@ -13,8 +13,6 @@
 
 #include "utils.h"
 
-#define RECVBUFSIZE 1024
-
 #define SIO_MODEMCMD_LOAD_RELOCATOR 0x21
 #define SIO_MODEMCMD_LOAD_HANDLER 0x26
 #define SIO_MODEMCMD_TYPE1_POLL 0x3F
@@ -409,12 +407,14 @@ void modem::sio_control()
     {
         XMT = (cmdFrame.aux1 & 0x01 ? true : false);
         Debug_printf("XMT=%d\n", XMT);
+        modemSniffer->dumpEvent(CAPTURE_EVENT_XMT, XMT);
     }
 
     if (cmdFrame.aux1 & 0x20)
     {
         RTS = (cmdFrame.aux1 & 0x10 ? true : false);
         Debug_printf("RTS=%d\n", RTS);
+        modemSniffer->dumpEvent(CAPTURE_EVENT_RTS, RTS);
     }
 
     if (cmdFrame.aux1 & 0x80)
@@ -422,9 +422,11 @@ void modem::sio_control()
         DTR = (cmdFrame.aux1 & 0x40 ? true : false);
 
         Debug_printf("DTR=%d\n", DTR);
+        modemSniffer->dumpEvent(CAPTURE_EVENT_DTR, DTR);
 
         if (DTR == 0 && tcpClient.connected())
         {
+            modemSniffer->dumpEvent(CAPTURE_EVENT_NO_CARRIER);
             tcpClient.stop(); // Hang up if DTR drops.
             CRX = false;
             cmdMode = true;
@@ -943,6 +945,8 @@ void modem::at_handle_get()
         }
 
         cmdMode = false;
+        rxPos = rxLen = 0;
+        modemSniffer->dumpEvent(CAPTURE_EVENT_CONNECT, modemBaud);
 
         // Send a HTTP request before continuing the connection as usual
         std::string request = "GET ";
@@ -1067,6 +1071,8 @@ void modem::at_handle_answer()
         CRX = true;
 
         cmdMode = false;
+        rxPos = rxLen = 0;
+        modemSniffer->dumpEvent(CAPTURE_EVENT_CONNECT, modemBaud);
         SYSTEM_BUS.uart->flush();
         answerHack = false;
     }
@@ -1131,6 +1137,8 @@ void modem::at_handle_dial()
             answered = false;
             answerTimer = fnSystem.millis();
             cmdMode = false;
+            rxPos = rxLen = 0;
+            modemSniffer->dumpEvent(CAPTURE_EVENT_CONNECT, modemBaud);
         }
         else
         {
@@ -1282,6 +1290,7 @@ void modem::modemCommand()
             "ATH2",
             "+++ATZ",
             "ATS2=128 X1 M0",
+            "AT+SNIFF=PCAP",
             "AT+SNIFF",
             "AT-SNIFF",
             "AT+TERM=VT52",
@@ -1344,6 +1353,7 @@ void modem::modemCommand()
     case AT_H1:
         if (tcpClient.connected() == true)
         {
+            modemSniffer->dumpEvent(CAPTURE_EVENT_NO_CARRIER);
             tcpClient.flush();
             tcpClient.stop();
             cmdMode = true;
@@ -1475,7 +1485,9 @@ void modem::modemCommand()
         else
             at_cmd_println("OK");
         break;
+    case AT_SNIFFPCAP:
     case AT_SNIFF:
+        get_modem_sniffer()->setCapture(cmd_match == AT_SNIFFPCAP);
         get_modem_sniffer()->setEnable(true);
         if (numericResultCode == true)
             at_cmd_resultCode(RESULT_CODE_OK);
@@ -1736,89 +1748,8 @@ void modem::sio_handle_modem()
             }
         }
 
-        int sioBytesAvail = SYSTEM_BUS.uart->available();
-        //int sioBytesAvail = std::min(0, SYSTEM_BUS.uart->available());
-
-        // send from Atari to Fujinet
-        if (sioBytesAvail && tcpClient.connected())
-        {
-            fnLedManager.set(eLed::LED_BT,true);
-            
-            // In telnet in worst case we have to escape every uint8_t
-            // so leave half of the buffer always free
-            //int max_buf_size;
-            //if (telnet == true)
-            //  max_buf_size = TX_BUF_SIZE / 2;
-            //else
-            //  max_buf_size = TX_BUF_SIZE;
-
-            // Read from serial, the amount available up to
-            // maximum size of the buffer
-            int sioBytesRead = SYSTEM_BUS.uart->readBytes(&txBuf[0], //SIO_UART.readBytes(&txBuf[0],
-                                                   (sioBytesAvail > TX_BUF_SIZE) ? TX_BUF_SIZE : sioBytesAvail);
-
-            // Disconnect if going to AT mode with "+++" sequence
-            for (int i = 0; i < (int)sioBytesRead; i++)
-            {
-                if (txBuf[i] == '+')
-                    plusCount++;
-                else
-                    plusCount = 0;
-                if (plusCount >= 3)
-                {
-                    plusTime = fnSystem.millis();
-                }
-                if (txBuf[i] != '+')
-                {
-                    plusCount = 0;
-                }
-            }
-
-            // Write the buffer to TCP finally
-            if (use_telnet == true)
-            {
-                telnet_send(telnet, (const char *)txBuf, sioBytesRead);
-            }
-            else
-            {
-                tcpClient.write(&txBuf[0], sioBytesRead);
-            }
-            // And send it off to the sniffer, if enabled.
-            modemSniffer->dumpOutput(&txBuf[0], sioBytesRead);
-            _lasttime = fnSystem.millis();
-
-            fnLedManager.set(eLed::LED_BT,false);
-        }
-
-        // read from Fujinet to Atari
-        unsigned char buf[RECVBUFSIZE];
-        int bytesAvail = 0;
-
-        // check to see how many bytes are avail to read
-        while ((bytesAvail = tcpClient.available()) > 0)
-        {
-            fnLedManager.set(eLed::LED_BT,true);
-
-            // read as many as our buffer size will take (RECVBUFSIZE)
-            unsigned int bytesRead =
-                tcpClient.read(buf, (bytesAvail > RECVBUFSIZE) ? RECVBUFSIZE : bytesAvail);
-
-            if (use_telnet == true)
-            {
-                telnet_recv(telnet, (const char *)buf, bytesRead);
-            }
-            else
-            {
-                SYSTEM_BUS.uart->write(buf, bytesRead);
-                SYSTEM_BUS.uart->flush();
-            }
-
-            fnLedManager.set(eLed::LED_BT,false);
- 
-            // And dump to sniffer, if enabled.
-            modemSniffer->dumpInput(buf, bytesRead);
-            _lasttime = fnSystem.millis();
-        }
+        int moved = pump_to_tcp() + pump_to_sio();
+        pump_led(moved > 0);
     }
 
     // If we have received "+++" as last bytes from serial port and there
@@ -1828,6 +1759,7 @@ void modem::sio_handle_modem()
         if (fnSystem.millis() - plusTime > 1000)
         {
             Debug_println("Going back to command mode");
+            modemSniffer->dumpEvent(CAPTURE_EVENT_COMMAND_MODE);
 
             at_cmd_println("OK");
     
@@ -1837,9 +1769,15 @@ void modem::sio_handle_modem()
         }
     }
 
+    // Data received before the connection was closed is written out first
+    if (rxPos != rxLen)
+        return;
+
     // Go to command mode if TCP disconnected and not in command mode
     if (!tcpClient.connected() && (cmdMode == false) && (DTR == 0))
     {
+        pump_led(false);
+        modemSniffer->dumpEvent(CAPTURE_EVENT_NO_CARRIER);
         tcpClient.flush();
         tcpClient.stop();
         cmdMode = true;
@@ -1858,6 +1796,8 @@ void modem::sio_handle_modem()
     }
     else if ((!tcpClient.connected()) && (cmdMode == false))
     {
+        pump_led(false);
+        modemSniffer->dumpEvent(CAPTURE_EVENT_NO_CARRIER);
         cmdMode = true;
         telnet_free(telnet);
         telnet = telnet_init(telopts, _telnet_event_handler, 0, this);
@@ -1876,6 +1816,119 @@ void modem::sio_handle_modem()
     }
 }
 
+/**
+ * Update the "+++" count with data from the Atari. Only the '+' run at the end of
+ * the data matters, so it is counted from the end instead of checking every byte.
+ */
+void modem::pump_guard(const uint8_t *buf, int len)
+{
+    int run = 0;
+
+    while (run < len && run < 3 && buf[len - 1 - run] == '+')
+        run++;
+
+    if (run == len)
+        plusCount = std::min(plusCount + run, 3);
+    else
+        plusCount = run;
+
+    if (plusCount >= 3)
+        plusTime = fnSystem.millis();
+}
+
+/**
+ * Light the LED while data is moving, without toggling it on every pass
+ */
+void modem::pump_led(bool on)
+{
+    if (on != pumpLed)
+    {
+        pumpLed = on;
+        fnLedManager.set(eLed::LED_BT, on);
+    }
+}
+
+/**
+ * Send what the Atari has written to the TCP connection
+ */
+int modem::pump_to_tcp()
+{
+    int sioBytesAvail = SYSTEM_BUS.uart->available();
+
+    if (sioBytesAvail <= 0 || !tcpClient.connected())
+        return 0;
+
+    // Read from serial, the amount available up to
+    // maximum size of the buffer
+    int sioBytesRead = SYSTEM_BUS.uart->readBytes(&txBuf[0],
+                                                  (sioBytesAvail > TX_BUF_SIZE) ? TX_BUF_SIZE : sioBytesAvail);
+    if (sioBytesRead <= 0)
+        return 0;
+
+    // Disconnect if going to AT mode with "+++" sequence
+    pump_guard(txBuf, sioBytesRead);
+
+    // Write the buffer to TCP finally
+    if (use_telnet == true)
+    {
+        telnet_send(telnet, (const char *)txBuf, sioBytesRead);
+    }
+    else
+    {
+        tcpClient.write(&txBuf[0], sioBytesRead);
+    }
+    // And send it off to the sniffer, if enabled.
+    modemSniffer->dumpOutput(&txBuf[0], sioBytesRead);
+    _lasttime = fnSystem.millis();
+
+    return sioBytesRead;
+}
+
+/**
+ * Write data received from TCP to the Atari. TCP is read a buffer at a time, which is
+ * written out no faster than the modem baud rate sends it, a slice per pass. The UART
+ * write waits for room in the transmit FIFO, so bigger writes would keep the modem from
+ * reading what the Atari sends until its receive buffer overflows.
+ */
+int modem::pump_to_sio()
+{
+    if (rxPos == rxLen)
+    {
+        int bytesAvail = tcpClient.available();
+        if (bytesAvail <= 0)
+            return 0;
+
+        // read as many as our buffer size will take (RX_BUF_SIZE)
+        rxPos = 0;
+        rxLen = tcpClient.read(rxBuf, (bytesAvail > RX_BUF_SIZE) ? RX_BUF_SIZE : bytesAvail);
+        if (rxLen <= 0)
+        {
+            rxLen = 0;
+            return 0;
+        }
+    }
+
+    int slice = std::max(1, (int)(modemBaud / 10 * PUMP_SLICE_MS / 1000));
+    int len = std::min(rxLen - rxPos, slice);
+    uint8_t *buf = &rxBuf[rxPos];
+
+    if (use_telnet == true)
+    {
+        telnet_recv(telnet, (const char *)buf, len);
+    }
+    else
+    {
+        SYSTEM_BUS.uart->write(buf, len);
+    }
+    rxPos += len;
+
+    // And dump to sniffer, if enabled.
+    modemSniffer->dumpInput(buf, len);
+    _lasttime = fnSystem.millis();
+
+    return len;
+}
+
 void modem::shutdown()
 {
     if (modemSniffer != nullptr)
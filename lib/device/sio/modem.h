@@ -65,6 +65,8 @@
 #define RING_INTERVAL 3000 // How often to print RING when having a new incoming connection (ms)
 #define MAX_CMD_LENGTH 256 // Maximum length for AT command
 #define TX_BUF_SIZE 256    // Buffer where to read from serial before writing to TCP (that direction is very blocking by the ESP TCP stack, so we can't do one byte a time.)
+#define RX_BUF_SIZE 1024   // Buffer where to read from TCP before writing to serial, written a slice at a time
+#define PUMP_SLICE_MS 50   // Most data written to serial per pass, as milliseconds at the modem baud rate
 
 #define ANSWER_TIMER_MS 2000 // milliseconds to wait before issuing CONNECT command, to simulate carrier negotiation.
 #define RING_TIMEOUT 10 // How many times to allow rings before "hanging up"
@@ -126,6 +128,7 @@ private:
         AT_OFFHOOK,
         AT_ZPPP_ignored,
         AT_BBSX_ignored,
+        AT_SNIFFPCAP,
         AT_SNIFF,
         AT_UNSNIFF,
         AT_TERMVT52,
@@ -171,6 +174,10 @@ private:
     uint64_t plusTime = 0;         // When did we last receive a "+++" sequence
 #endif
     uint8_t txBuf[TX_BUF_SIZE];
+    uint8_t rxBuf[RX_BUF_SIZE];    // Received from TCP, not written to serial yet
+    int rxPos = 0;
+    int rxLen = 0;
+    bool pumpLed = false;          // LED_BT lit for data transfer
     bool cmdOutput=true;            // toggle whether to emit command output
     bool numericResultCode=false;   // Use numeric result codes? (ATV0)
     bool autoAnswer=false;          // Auto answer? (ATS0?)
@@ -212,6 +219,12 @@ private:
 
     void modemCommand(); // Execute modem AT command
 
+    // Connected mode data transfer
+    void pump_guard(const uint8_t *buf, int len); // Look for "+++" at the end of data from the Atari
+    int pump_to_tcp();                            // Atari to TCP, returns bytes moved
+    int pump_to_sio();                            // TCP to Atari, returns bytes moved
+    void pump_led(bool on);
+
     // CR/EOL aware println() functions for AT mode
     void at_connect_resultCode(int modemBaud);
     void at_cmd_resultCode(int resultCode);
@@ -8,39 +8,88 @@
 
 #include "Connection.h"
 
+void Connection::set_is_connected(const bool is_connected)
+{
+	{
+		// taking the lock makes sure a thread in wait_for_request() either sees the new state or gets the notification
+		std::lock_guard<std::mutex> lock(request_mutex_);
+		is_connected_ = is_connected;
+	}
+	request_cv_.notify_all();
+}
+
 // This is called after AppleWin sends a request to a device, and is waiting for the response
 std::vector<uint8_t> Connection::wait_for_response(uint8_t request_id, std::chrono::seconds timeout)
 {
-	std::unique_lock<std::mutex> lock(data_mutex_);
-	// mutex is unlocked as it goes into a wait, so then the inserting thread can
-	// add to map, and this can then pick it up when notified, or timeout.
-	if (!data_cv_.wait_for(lock, timeout, [this, request_id]() { return data_map_.count(request_id) > 0; }))
+	Slot &slot = slots_[request_id];
+	std::unique_lock<std::mutex> lock(slot.mutex);
+	// mutex is unlocked as it goes into a wait, so then the reading thread can
+	// fill the slot, and this can then pick it up when notified, or timeout.
+	if (!slot.cv.wait_for(lock, timeout, [&slot]() { return slot.ready; }))
 	{
 		throw std::runtime_error("Timeout waiting for response");
 	}
-	std::vector<uint8_t> response_data = data_map_[request_id];
-	data_map_.erase(request_id);
-	return response_data;
+	slot.ready = false;
+	return std::move(slot.data);
 }
 
 // This is used by devices that are waiting for requests from AppleWin.
 // The codebase is used both sides of the connection.
 std::vector<uint8_t> Connection::wait_for_request()
 {
-	// Use a timeout so we can stop waiting for responses
-	while (is_connected_)
+	while (true)
 	{
-		std::unique_lock<std::mutex> lock(data_mutex_);
-		if (data_cv_.wait_for(lock, std::chrono::milliseconds(100), [this]() { return !data_map_.empty(); }))
+		uint8_t request_id;
 		{
-			const auto it = data_map_.begin();
-			std::vector<uint8_t> request_data = it->second;
-			data_map_.erase(it);
+			std::unique_lock<std::mutex> lock(request_mutex_);
+			// woken up by new packet or by disconnect, no need to poll
+			request_cv_.wait(lock, [this]() { return !request_ids_.empty() || !is_connected_; });
+			if (request_ids_.empty())
+			{
+				return std::vector<uint8_t>();
+			}
+			request_id = request_ids_.front();
+			request_ids_.pop_front();
+		}
+
+		Slot &slot = slots_[request_id];
+		std::lock_guard<std::mutex> lock(slot.mutex);
+		// the packet could have been taken already by wait_for_response()
+		if (slot.ready)
+		{
+			slot.ready = false;
+			return std::move(slot.data);
+		}
+	}
+}
+
+void Connection::packet_received(const uint8_t *packet, size_t len)
+{
+	const uint8_t id = packet[0];
+	Slot &slot = slots_[id];
+	{
+		std::lock_guard<std::mutex> lock(slot.mutex);
+		slot.data.assign(packet, packet + len);
+		slot.ready = true;
+	}
+	slot.cv.notify_one();
 
-			return request_data;
+	{
+		std::lock_guard<std::mutex> lock(request_mutex_);
+		// side which only sends requests never consumes this queue, keep it bounded.
+		// the oldest id was overwritten by newer packets in its slot long ago.
+		if (request_ids_.size() >= slots_.size())
+		{
+			request_ids_.pop_front();
 		}
+		request_ids_.push_back(id);
 	}
-	return std::vector<uint8_t>();
+	request_cv_.notify_one();
+}
+
+void Connection::receive_data(const uint8_t *data, size_t len)
+{
+	slip_decoder_.feed(data, len, [this](const uint8_t *packet, size_t packet_len) { packet_received(packet, packet_len); });
 }
 
 void Connection::join()
@@ -6,14 +6,17 @@
 #include <chrono>
 #include <condition_variable>
 #include <cstdint>
-#include <map>
+#include <deque>
 #include <mutex>
 #include <thread>
 #include <vector>
 
+#include "../slip/SLIP.h"
+
 class Connection
 {
 public:
+	Connection() : slip_frame_(SLIP_MAX_FRAME_SIZE), slip_decoder_(slip_frame_.data(), slip_frame_.size()) {}
 	virtual ~Connection() = default;
 	virtual void send_data(const std::vector<uint8_t> &data) = 0;
 
@@ -21,7 +24,7 @@ public:
 	virtual void close_connection() = 0;
 
 	bool is_connected() const { return is_connected_; }
-	void set_is_connected(const bool is_connected) { is_connected_ = is_connected; }
+	void set_is_connected(bool is_connected);
 
 	std::vector<uint8_t> wait_for_response(uint8_t request_id, std::chrono::seconds timeout);
 	std::vector<uint8_t> wait_for_request();
@@ -31,12 +34,32 @@ public:
 private:
 	std::atomic<bool> is_connected_{false};
 
+	// One slot per request id, each with its own completion signalling,
+	// so a waiter is woken only by the packet it is waiting for
+	struct Slot
+	{
+		std::mutex mutex;
+		std::condition_variable cv;
+		bool ready = false;
+		std::vector<uint8_t> data;
+	};
+	std::array<Slot, 256> slots_;
+
+	// Ids of received packets in arrival order, for wait_for_request()
+	std::deque<uint8_t> request_ids_;
+	std::mutex request_mutex_;
+	std::condition_variable request_cv_;
+
+	void packet_received(const uint8_t *packet, size_t len);
+
 protected:
-	std::map<uint8_t, std::vector<uint8_t>> data_map_;
-	std::thread reading_thread_;
+	// Feed raw SLIP encoded data read from the transport, frames may be split across calls
+	void receive_data(const uint8_t *data, size_t len);
+
+	std::vector<uint8_t> slip_frame_;
+	SLIPDecoder slip_decoder_;
 
-	std::mutex data_mutex_;
-	std::condition_variable data_cv_;
+	std::thread reading_thread_;
 };
 
 #endif
\ No newline at end of file
@@ -5,7 +5,7 @@
 #include "Requestor.h"
 #include "Listener.h"
 
-uint8_t Requestor::request_number_ = 0;
+std::atomic<uint8_t> Requestor::request_number_{0};
 
 Requestor::Requestor() = default;
 
@@ -31,9 +31,8 @@ std::unique_ptr<Response> Requestor::send_request(const Request &request, Connec
 
 uint8_t Requestor::next_request_number()
 {
-	const uint8_t current_number = request_number_;
-	request_number_ = (request_number_ + 1) % 256;
-	return current_number;
+	// wraps around at 256, safe to call from multiple threads with requests outstanding
+	return request_number_.fetch_add(1);
 }
 
 #endif
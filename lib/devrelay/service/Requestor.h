@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <memory>
 
 #include "Connection.h"
@@ -16,5 +17,5 @@ public:
 	static uint8_t next_request_number();
 
 private:
-	static uint8_t request_number_;
+	static std::atomic<uint8_t> request_number_;
 };
@@ -53,8 +53,14 @@ void TCPConnection::send_data(const std::vector<uint8_t> &data)
 		return;
 	}
 
-	const auto slip_data = SLIP::encode(data);
-	send(socket_, reinterpret_cast<const char *>(slip_data.data()), slip_data.size(), 0);
+	// encode into per thread buffer, which is reused for all sends
+	thread_local std::vector<uint8_t> slip_data;
+	if (slip_data.size() < SLIP::max_encoded_size(data.size()))
+	{
+		slip_data.resize(SLIP::max_encoded_size(data.size()));
+	}
+	const size_t slip_size = SLIP::encode(data.data(), data.size(), slip_data.data(), slip_data.size());
+	send(socket_, reinterpret_cast<const char *>(slip_data.data()), slip_size, 0);
 }
 
 void TCPConnection::create_read_channel()
@@ -63,7 +69,6 @@ void TCPConnection::create_read_channel()
 
 	// Start a new thread to listen for incoming data
 	reading_thread_ = std::thread([self = std::move(self_ptr)]() {
-		std::vector<uint8_t> complete_data;
 		std::vector<uint8_t> buffer(1024);
 		bool is_initialising = true;
 
@@ -107,31 +112,10 @@ void TCPConnection::create_read_channel()
 				if (valread > 0)
 				{
 					// LogFileOutput("SmartPortOverSlip TCPConnection, inserting data, valread: %d\n", valread);
-					complete_data.insert(complete_data.end(), buffer.begin(), buffer.begin() + valread);
+					// decoder keeps partial frames between reads
+					self->receive_data(buffer.data(), valread);
 				}
 			} while (valread == 1024);
-
-			if (!complete_data.empty())
-			{
-				std::vector<std::vector<uint8_t>> decoded_packets = SLIP::split_into_packets(complete_data.data(), complete_data.size());
-				// LogFileOutput("SmartPortOverSlip TCPConnection, packets decoded: %d\n", decoded_packets.size());
-
-				if (!decoded_packets.empty())
-				{
-					for (const auto &packet : decoded_packets)
-					{
-						if (!packet.empty())
-						{
-							{
-								std::lock_guard<std::mutex> lock(self->data_mutex_);
-								self->data_map_[packet[0]] = packet;
-							}
-							self->data_cv_.notify_all();
-						}
-					}
-				}
-				complete_data.clear();
-			}
 		}
 		GetCommandListener().connection_closed(self.get());
 		LogFileOutput("TCPConnection::create_read_channel - thread is EXITING\n");
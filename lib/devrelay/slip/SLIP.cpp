@@ -6,29 +6,46 @@
 
 std::vector<uint8_t> SLIP::encode(const std::vector<uint8_t> &data)
 {
-	std::vector<uint8_t> encoded_data;
+	std::vector<uint8_t> encoded_data(max_encoded_size(data.size()));
+	encoded_data.resize(encode(data.data(), data.size(), encoded_data.data(), encoded_data.size()));
+	return encoded_data;
+}
+
+size_t SLIP::encode(const uint8_t *data, size_t len, uint8_t *out, size_t out_size)
+{
+	if (out_size < max_encoded_size(len))
+	{
+		return 0;
+	}
+
+	uint8_t *o = out;
+	const uint8_t *p = data;
+	const uint8_t *end = data + len;
 
 	// start with SLIP_END
-	encoded_data.push_back(SLIP_END);
+	*o++ = SLIP_END;
 
-	// Escape any SLIP special characters in the packet data
-	for (uint8_t byte : data)
+	while (p < end)
 	{
-		if (byte == SLIP_END || byte == SLIP_ESC)
+		// Copy everything up to the next SLIP special character in one go
+		const uint8_t *special = find_special(p, end);
+		memcpy(o, p, special - p);
+		o += special - p;
+		p = special;
+
+		// Escape the special character
+		if (p < end)
 		{
-			encoded_data.push_back(SLIP_ESC);
-			encoded_data.push_back(byte == SLIP_END ? SLIP_ESC_END : SLIP_ESC_ESC);
-		}
-		else
-		{
-			encoded_data.push_back(byte);
+			*o++ = SLIP_ESC;
+			*o++ = (*p == SLIP_END) ? SLIP_ESC_END : SLIP_ESC_ESC;
+			p++;
 		}
 	}
 
 	// Add the SLIP END byte to the end of the encoded data
-	encoded_data.push_back(SLIP_END);
+	*o++ = SLIP_END;
 
-	return encoded_data;
+	return o - out;
 }
 
 std::vector<uint8_t> SLIP::decode(const std::vector<uint8_t> &data)
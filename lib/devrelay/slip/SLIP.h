@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <cstring>
 #include <stdint.h>
 #include <vector>
 
@@ -9,6 +10,9 @@
 #define SLIP_ESC_END 0334 /* ESC ESC_END means END data byte */
 #define SLIP_ESC_ESC 0335 /* ESC ESC_ESC means ESC data byte */
 
+// Largest decoded frame: 8 bytes of header plus up to 64K of payload (byte count is 16 bit)
+#define SLIP_MAX_FRAME_SIZE (65536 + 16)
+
 class SLIP
 {
 public:
@@ -16,4 +20,142 @@ public:
 	static std::vector<uint8_t> encode(const std::vector<uint8_t> &data);
 	static std::vector<uint8_t> decode(const std::vector<uint8_t> &data);
 	static std::vector<std::vector<uint8_t>> split_into_packets(const uint8_t *data, size_t bytes_read);
+
+	// Encode one frame into caller provided buffer, which must hold at least max_encoded_size(len) bytes.
+	// Returns the encoded size, or 0 if the output buffer is too small.
+	static size_t encode(const uint8_t *data, size_t len, uint8_t *out, size_t out_size);
+	static constexpr size_t max_encoded_size(size_t len) { return 2 * len + 2; }
+
+	// Returns pointer to first SLIP_END or SLIP_ESC byte in [p, end), or end if there is none.
+	static const uint8_t *find_special(const uint8_t *p, const uint8_t *end)
+	{
+		// test 8 bytes at a time, most of the data has nothing to escape
+		const uint64_t ones = 0x0101010101010101ULL;
+		const uint64_t highs = 0x8080808080808080ULL;
+		while (end - p >= 8)
+		{
+			uint64_t v;
+			memcpy(&v, p, sizeof(v));
+			const uint64_t e = v ^ (ones * SLIP_END);
+			const uint64_t s = v ^ (ones * SLIP_ESC);
+			if ((((e - ones) & ~e) | ((s - ones) & ~s)) & highs)
+				break;
+			p += 8;
+		}
+		while (p < end && *p != SLIP_END && *p != SLIP_ESC)
+			p++;
+		return p;
+	}
+};
+
+// Incremental SLIP decoder.
+// Data can be fed in chunks of any size, frames split across reads are reassembled into
+// the caller provided buffer. Each complete frame is handed to the callback as (const uint8_t *data, size_t len),
+// the data is only valid during the callback. Frames with invalid escapes or larger than the buffer are dropped.
+class SLIPDecoder
+{
+public:
+	SLIPDecoder(uint8_t *buffer, size_t capacity) : buffer_(buffer), capacity_(capacity) {}
+
+	template <typename Callback>
+	void feed(const uint8_t *data, size_t len, Callback &&on_frame)
+	{
+		const uint8_t *p = data;
+		const uint8_t *end = data + len;
+		while (p < end)
+		{
+			switch (state_)
+			{
+			case State::NotParsing:
+				// skip anything up to the SLIP_END which marks start of a frame
+				p = static_cast<const uint8_t *>(memchr(p, SLIP_END, end - p));
+				if (p == nullptr)
+					return;
+				p++;
+				start_frame();
+				break;
+
+			case State::Parsing:
+			{
+				// copy run of ordinary bytes in one go
+				const uint8_t *special = SLIP::find_special(p, end);
+				append(p, special - p);
+				p = special;
+				if (p == end)
+					break;
+				if (*p == SLIP_END)
+				{
+					// repeated SLIP_END with nothing in between is just a frame start
+					if (length_ > 0 || dropped_)
+					{
+						if (!dropped_)
+							on_frame(static_cast<const uint8_t *>(buffer_), length_);
+						state_ = State::NotParsing;
+					}
+				}
+				else
+				{
+					state_ = State::Escape;
+				}
+				p++;
+				break;
+			}
+
+			case State::Escape:
+				if (*p == SLIP_ESC_END)
+					append_byte(SLIP_END);
+				else if (*p == SLIP_ESC_ESC)
+					append_byte(SLIP_ESC);
+				else
+					dropped_ = true; // invalid escape sequence
+				state_ = State::Parsing;
+				p++;
+				break;
+			}
+		}
+	}
+
+	void reset() { state_ = State::NotParsing; }
+
+private:
+	enum class State
+	{
+		NotParsing,
+		Parsing,
+		Escape
+	};
+
+	void start_frame()
+	{
+		state_ = State::Parsing;
+		length_ = 0;
+		dropped_ = false;
+	}
+
+	void append(const uint8_t *data, size_t len)
+	{
+		if (len == 0)
+			return;
+		if (length_ + len > capacity_)
+		{
+			dropped_ = true;
+			return;
+		}
+		memcpy(buffer_ + length_, data, len);
+		length_ += len;
+	}
+
+	void append_byte(uint8_t b)
+	{
+		if (length_ < capacity_)
+			buffer_[length_++] = b;
+		else
+			dropped_ = true;
+	}
+
+	uint8_t *buffer_;
+	size_t capacity_;
+	size_t length_ = 0;
+	bool dropped_ = false;
+	State state_ = State::NotParsing;
 };
@@ -1,57 +1,82 @@
 #include <cstdint>
 #include <cstring>
 #include <cstdlib>
+#include <algorithm>
 #include <memory>
 #include <vector>
 #include "base64.h"
 
 Base64 base64;
 
-std::unique_ptr<char[]> Base64::base64_gen_encode(const unsigned char* src, size_t len, size_t* out_len, const char* table, int add_pad) {
-    char *out, *pos;
-    const unsigned char *end, *in;
-    size_t olen;
-    int line_len;
+size_t Base64::Encoder::update(const void* src, size_t len, char* out) {
+    const unsigned char *in = static_cast<const unsigned char*>(src);
+    const unsigned char *end = in + len;
+    char *pos = out;
 
-    if (len >= SIZE_MAX / 4)
-        return nullptr;
-    olen = len * 4 / 3 + 4; /* 3-byte blocks to 4-byte */
-    if (add_pad)
-        olen += olen / 72; /* line feeds */
-    olen++; /* nul termination */
-    if (olen < len)
-        return nullptr; /* integer overflow */
-    out = new char[olen];
-    if (out == nullptr)
-        return nullptr;
+    // complete the block left over from previous update
+    if (carry_len > 0) {
+        size_t need = 3 - carry_len;
+        if (len < need) {
+            std::memcpy(carry + carry_len, in, len);
+            carry_len += len;
+            return 0;
+        }
+        unsigned char block[3];
+        std::memcpy(block, carry, carry_len);
+        std::memcpy(block + carry_len, in, need);
+        in += need;
+        carry_len = 0;
+        uint32_t v = (block[0] << 16) | (block[1] << 8) | block[2];
+        *pos++ = table[v >> 18];
+        *pos++ = table[(v >> 12) & 0x3f];
+        *pos++ = table[(v >> 6) & 0x3f];
+        *pos++ = table[v & 0x3f];
+        line_len += 4;
+        if (add_pad && line_len >= 72) {
+            *pos++ = '\n';
+            line_len = 0;
+        }
+    }
 
-    end = src + len;
-    in = src;
-    pos = out;
-    line_len = 0;
     while (end - in >= 3) {
-        *pos++ = table[(in[0] >> 2) & 0x3f];
-        *pos++ = table[(((in[0] & 0x03) << 4) | (in[1] >> 4)) & 0x3f];
-        *pos++ = table[(((in[1] & 0x0f) << 2) | (in[2] >> 6)) & 0x3f];
-        *pos++ = table[in[2] & 0x3f];
-        in += 3;
-        line_len += 4;
+        // whole blocks up to the end of the line are done in one go, 24 bits at a time
+        size_t blocks = (end - in) / 3;
+        if (add_pad)
+            blocks = std::min(blocks, (size_t)(72 - line_len) / 4);
+        for (size_t i = 0; i < blocks; i++) {
+            uint32_t v = (in[0] << 16) | (in[1] << 8) | in[2];
+            pos[0] = table[v >> 18];
+            pos[1] = table[(v >> 12) & 0x3f];
+            pos[2] = table[(v >> 6) & 0x3f];
+            pos[3] = table[v & 0x3f];
+            in += 3;
+            pos += 4;
+        }
+        line_len += (int)blocks * 4;
         if (add_pad && line_len >= 72) {
             *pos++ = '\n';
             line_len = 0;
         }
     }
 
-    if (end - in) {
-        *pos++ = table[(in[0] >> 2) & 0x3f];
-        if (end - in == 1) {
-            *pos++ = table[((in[0] & 0x03) << 4) & 0x3f];
+    carry_len = end - in;
+    std::memcpy(carry, in, carry_len);
+    return pos - out;
+}
+
+size_t Base64::Encoder::finalize(char* out) {
+    char *pos = out;
+
+    if (carry_len) {
+        *pos++ = table[(carry[0] >> 2) & 0x3f];
+        if (carry_len == 1) {
+            *pos++ = table[((carry[0] & 0x03) << 4) & 0x3f];
             if (add_pad)
                 *pos++ = '=';
         } else {
-            *pos++ = table[(((in[0] & 0x03) << 4) |
-                    (in[1] >> 4)) & 0x3f];
-            *pos++ = table[((in[1] & 0x0f) << 2) & 0x3f];
+            *pos++ = table[(((carry[0] & 0x03) << 4) |
+                    (carry[1] >> 4)) & 0x3f];
+            *pos++ = table[((carry[1] & 0x0f) << 2) & 0x3f];
         }
         if (add_pad)
             *pos++ = '=';
@@ -61,90 +86,178 @@ std::unique_ptr<char[]> Base64::base64_gen_encode(const unsigned char* src, size
     if (add_pad && line_len)
         *pos++ = '\n';
 
-    *pos = '\0';
-    if (out_len)
-        *out_len = pos - out;
-    return std::unique_ptr<char[]>(out);
+    reset();
+    return pos - out;
+}
+
+void Base64::Encoder::update(const void* src, size_t len, std::string& out) {
+    size_t size = out.size();
+    out.resize(size + max_update_size(len));
+    out.resize(size + update(src, len, &out[size]));
 }
 
-std::unique_ptr<unsigned char[]> Base64::base64_gen_decode(const char* src, size_t len, size_t* out_len, const char* table) {
-    unsigned char dtable[256], *out, *pos, block[4], tmp;
-    size_t i, count, olen;
-    int pad = 0;
-    size_t extra_pad;
+void Base64::Encoder::finalize(std::string& out) {
+    char tail[max_finalize_size];
+    out.append(tail, finalize(tail));
+}
 
+Base64::Decoder::Decoder(bool url) {
+    const char *table = url ? base64_url_table : base64_table;
     std::memset(dtable, 0x80, 256);
-    for (i = 0; i < sizeof(base64_table) - 1; i++)
+    for (size_t i = 0; i < sizeof(base64_table) - 1; i++)
         dtable[(unsigned char) table[i]] = (unsigned char) i;
-    dtable['='] = 0;
+    dtable['='] = 0x40;
+}
 
-    count = 0;
-    for (i = 0; i < len; i++) {
-        if (dtable[(unsigned char) src[i]] != 0x80)
-            count++;
+// Add one character to the current block
+size_t Base64::Decoder::put(unsigned char c, unsigned char* out) {
+    unsigned char tmp = dtable[c];
+    if (tmp == 0x80 || done)
+        return 0;
+
+    total++;
+    if (tmp == 0x40) {
+        pad++;
+        tmp = 0;
     }
+    block[count++] = tmp;
+    if (count < 4)
+        return 0;
 
-    if (count == 0)
-        return nullptr;
-    extra_pad = (4 - count % 4) % 4;
+    out[0] = (block[0] << 2) | (block[1] >> 4);
+    out[1] = (block[1] << 4) | (block[2] >> 2);
+    out[2] = (block[2] << 6) | block[3];
+    count = 0;
+    if (pad) {
+        done = true;
+        if (pad > 2) {
+            /* Invalid padding */
+            error = true;
+            return 0;
+        }
+        return 3 - pad;
+    }
+    return 3;
+}
 
-    olen = (count + extra_pad) / 4 * 3;
-    pos = out = new unsigned char[olen];
-    if (out == nullptr)
-        return nullptr;
+size_t Base64::Decoder::update(const char* src, size_t len, unsigned char* out) {
+    const unsigned char *in = reinterpret_cast<const unsigned char*>(src);
+    const unsigned char *end = in + len;
+    unsigned char *pos = out;
 
-    count = 0;
-    for (i = 0; i < len + extra_pad; i++) {
-        unsigned char val;
-
-        if (i >= len)
-            val = '=';
-        else
-            val = src[i];
-        tmp = dtable[val];
-        if (tmp == 0x80)
-            continue;
-
-        if (val == '=')
-            pad++;
-        block[count] = tmp;
-        count++;
-        if (count == 4) {
-            *pos++ = (block[0] << 2) | (block[1] >> 4);
-            *pos++ = (block[1] << 4) | (block[2] >> 2);
-            *pos++ = (block[2] << 6) | block[3];
-            count = 0;
-            if (pad) {
-                if (pad == 1)
-                    pos--;
-                else if (pad == 2)
-                    pos -= 2;
-                else {
-                    /* Invalid padding */
-                    delete[] out;
-                    return nullptr;
-                }
-                break;
+    while (in < end && !done) {
+        // whole blocks of valid characters are decoded 24 bits at a time, anything else
+        // (line feeds, padding, block split between updates) one character at a time
+        if (count == 0) {
+            while (end - in >= 4) {
+                unsigned char a = dtable[in[0]], b = dtable[in[1]], c = dtable[in[2]], d = dtable[in[3]];
+                if ((a | b | c | d) & 0xC0)
+                    break;
+                uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+                pos[0] = v >> 16;
+                pos[1] = v >> 8;
+                pos[2] = v;
+                pos += 3;
+                in += 4;
+                total += 4;
             }
+            if (in == end)
+                break;
         }
+        pos += put(*in++, pos);
+    }
+
+    return pos - out;
+}
+
+bool Base64::Decoder::finalize(unsigned char* out, size_t* out_len) {
+    unsigned char *pos = out;
+
+    // missing padding is added
+    size_t extra_pad = (4 - total % 4) % 4;
+    bool ok = total > 0;
+    if (ok && !done) {
+        for (size_t i = 0; i < extra_pad; i++)
+            pos += put('=', pos);
     }
+    ok = ok && !error;
 
     *out_len = pos - out;
+    reset();
+    return ok;
+}
+
+void Base64::Decoder::update(const char* src, size_t len, std::string& out) {
+    size_t size = out.size();
+    out.resize(size + max_update_size(len));
+    out.resize(size + update(src, len, reinterpret_cast<unsigned char*>(&out[size])));
+}
+
+bool Base64::Decoder::finalize(std::string& out) {
+    unsigned char tail[max_finalize_size];
+    size_t len;
+    bool ok = finalize(tail, &len);
+    out.append(reinterpret_cast<char*>(tail), len);
+    return ok;
+}
+
+bool Base64::decode_compute() {
+    if (!decoder.finalize(base64_buffer)) {
+        base64_buffer.clear();
+        return false;
+    }
+    return true;
+}
+
+void Base64::take_buffer(void* dst, size_t len) {
+    std::memcpy(dst, base64_buffer.data(), len);
+    if (len < base64_buffer.size())
+        base64_buffer.erase(0, len);
+    else {
+        base64_buffer.clear();
+        base64_buffer.shrink_to_fit();
+    }
+}
+
+std::unique_ptr<char[]> Base64::base64_gen_encode(const unsigned char* src, size_t len, size_t* out_len, bool url) {
+    if (len >= SIZE_MAX / 4)
+        return nullptr;
+
+    Encoder encoder(url);
+    char *out = new char[Encoder::max_update_size(len) + Encoder::max_finalize_size + 1];
+    size_t olen = encoder.update(src, len, out);
+    olen += encoder.finalize(out + olen);
+    out[olen] = '\0';
+    if (out_len)
+        *out_len = olen;
+    return std::unique_ptr<char[]>(out);
+}
+
+std::unique_ptr<unsigned char[]> Base64::base64_gen_decode(const char* src, size_t len, size_t* out_len, bool url) {
+    Decoder decoder(url);
+    unsigned char *out = new unsigned char[Decoder::max_update_size(len) + Decoder::max_finalize_size];
+    size_t olen = decoder.update(src, len, out);
+    size_t tail_len;
+    if (!decoder.finalize(out + olen, &tail_len)) {
+        delete[] out;
+        return nullptr;
+    }
+    *out_len = olen + tail_len;
     return std::unique_ptr<unsigned char[]>(out);
 }
 
 std::unique_ptr<char[]> Base64::encode(const void* src, size_t len, size_t* out_len) {
-    return base64_gen_encode(static_cast<const unsigned char*>(src), len, out_len, base64_table, 1);
+    return base64_gen_encode(static_cast<const unsigned char*>(src), len, out_len, false);
 }
 
 std::unique_ptr<char[]> Base64::url_encode(const void* src, size_t len, size_t* out_len) {
-    return base64_gen_encode(static_cast<const unsigned char*>(src), len, out_len, base64_url_table, 0);
+    return base64_gen_encode(static_cast<const unsigned char*>(src), len, out_len, true);
 }
 
 std::unique_ptr<unsigned char[]> Base64::decode(const char* src, size_t len, size_t* out_len) {
-    return base64_gen_decode(src, len, out_len, base64_table);
+    return base64_gen_decode(src, len, out_len, false);
 }
 
 std::unique_ptr<unsigned char[]> Base64::url_decode(const char* src, size_t len, size_t* out_len) {
-    return base64_gen_decode(src, len, out_len, base64_url_table);
+    return base64_gen_decode(src, len, out_len, true);
 }
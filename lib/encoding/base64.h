@@ -19,8 +19,8 @@ private:
     static inline const char base64_table[65] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
     static inline const char base64_url_table[65] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
 
-    static std::unique_ptr<char[]> base64_gen_encode(const unsigned char* src, size_t len, size_t* out_len, const char* table, int add_pad);
-    static std::unique_ptr<unsigned char[]> base64_gen_decode(const char* src, size_t len, size_t* out_len, const char* table);
+    static std::unique_ptr<char[]> base64_gen_encode(const unsigned char* src, size_t len, size_t* out_len, bool url);
+    static std::unique_ptr<unsigned char[]> base64_gen_decode(const char* src, size_t len, size_t* out_len, bool url);
 
 public:
     /**
@@ -50,13 +50,84 @@ public:
     static std::unique_ptr<unsigned char[]> decode(const char* src, size_t len, size_t* out_len);
     static std::unique_ptr<unsigned char[]> url_decode(const char* src, size_t len, size_t* out_len);
 
+    /**
+     * Incremental encoder, output is the same as encode() / url_encode() of all the data.
+     * Data can be fed in pieces of any size as it arrives, e.g. straight from a receive buffer.
+     */
+    class Encoder {
+    public:
+        Encoder(bool url = false) : table(url ? base64_url_table : base64_table), add_pad(!url) {}
+
+        // Largest output of update() with len bytes of input, and of finalize()
+        static size_t max_update_size(size_t len) { return (len + 2) / 3 * 4 * 73 / 72 + 1; }
+        static const size_t max_finalize_size = 5;
+
+        // Returns number of characters written to out
+        size_t update(const void* src, size_t len, char* out);
+        size_t finalize(char* out);
+        void update(const void* src, size_t len, std::string& out);
+        void finalize(std::string& out);
+        void reset() { carry_len = 0; line_len = 0; }
+
+    private:
+        const char* table;
+        bool add_pad;
+        unsigned char carry[2];  // bytes left over from previous update, less than a 3 byte block
+        size_t carry_len = 0;
+        int line_len = 0;
+    };
+
+    /**
+     * Incremental decoder, output is the same as decode() / url_decode() of all the data.
+     * Characters outside of the alphabet (line feeds) are skipped, also between updates.
+     */
+    class Decoder {
+    public:
+        Decoder(bool url = false);
+
+        static size_t max_update_size(size_t len) { return (len / 4 + 1) * 3; }
+        static const size_t max_finalize_size = 3;
+
+        // Returns number of bytes written to out
+        size_t update(const char* src, size_t len, unsigned char* out);
+        // Returns false if the data was not valid base64 (nothing to decode or invalid padding)
+        bool finalize(unsigned char* out, size_t* out_len);
+        void update(const char* src, size_t len, std::string& out);
+        bool finalize(std::string& out);
+        void reset() { count = 0; pad = 0; total = 0; done = false; error = false; }
+
+    private:
+        size_t put(unsigned char c, unsigned char* out);
+
+        unsigned char dtable[256]; // 0x80 not in alphabet, 0x40 padding
+        unsigned char block[4];
+        size_t count = 0;  // characters in block
+        int pad = 0;
+        size_t total = 0;  // valid characters seen
+        bool done = false; // padding ends the data
+        bool error = false;
+    };
+
     std::string get_buffer() const { return base64_buffer; }
     void set_buffer(const std::string& buffer) { base64_buffer = buffer; }
-    void clear_buffer() { base64_buffer.clear(); }
+    void clear_buffer() { base64_buffer.clear(); encoder.reset(); decoder.reset(); }
     void add_buffer(const std::string& extra) { base64_buffer += extra; }
 
+    // FUJI BASE64 commands: input is converted as it is received and collected in base64_buffer,
+    // compute completes the conversion. Compute returns false if the conversion failed.
+    void encode_input(const void* data, size_t len) { encoder.update(data, len, base64_buffer); }
+    bool encode_compute() { encoder.finalize(base64_buffer); return true; }
+    void decode_input(const char* data, size_t len) { decoder.update(data, len, base64_buffer); }
+    bool decode_compute();
+    // Move first len bytes of the converted data to dst, len must not exceed base64_buffer size
+    void take_buffer(void* dst, size_t len);
+
     std::string base64_buffer;
 
+private:
+    Encoder encoder;
+    Decoder decoder;
+
 };
 
 extern Base64 base64;
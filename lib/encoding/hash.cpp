@@ -1,10 +1,124 @@
-#include <sstream>
-#include <iomanip>
-
 #include "hash.h"
 
 Hash hasher;
 
+Hash::Context::Context(const Context& other) : _algorithm(other._algorithm) {
+    switch (_algorithm) {
+        case Algorithm::MD5:
+            mbedtls_md5_init(&_ctx.md5);
+            mbedtls_md5_clone(&_ctx.md5, &other._ctx.md5);
+            break;
+        case Algorithm::SHA1:
+            mbedtls_sha1_init(&_ctx.sha1);
+            mbedtls_sha1_clone(&_ctx.sha1, &other._ctx.sha1);
+            break;
+        case Algorithm::SHA256:
+            mbedtls_sha256_init(&_ctx.sha256);
+            mbedtls_sha256_clone(&_ctx.sha256, &other._ctx.sha256);
+            break;
+        case Algorithm::SHA512:
+            mbedtls_sha512_init(&_ctx.sha512);
+            mbedtls_sha512_clone(&_ctx.sha512, &other._ctx.sha512);
+            break;
+        default:
+            break;
+    }
+}
+
+Hash::Context::~Context() {
+    free();
+}
+
+void Hash::Context::free() {
+    switch (_algorithm) {
+        case Algorithm::MD5:
+            mbedtls_md5_free(&_ctx.md5);
+            break;
+        case Algorithm::SHA1:
+            mbedtls_sha1_free(&_ctx.sha1);
+            break;
+        case Algorithm::SHA256:
+            mbedtls_sha256_free(&_ctx.sha256);
+            break;
+        case Algorithm::SHA512:
+            mbedtls_sha512_free(&_ctx.sha512);
+            break;
+        default:
+            break;
+    }
+    _algorithm = Algorithm::UNKNOWN;
+}
+
+void Hash::Context::start(Algorithm algorithm) {
+    free();
+    _algorithm = algorithm;
+    switch (_algorithm) {
+        case Algorithm::MD5:
+            mbedtls_md5_init(&_ctx.md5);
+            mbedtls_md5_starts(&_ctx.md5);
+            break;
+        case Algorithm::SHA1:
+            mbedtls_sha1_init(&_ctx.sha1);
+            mbedtls_sha1_starts(&_ctx.sha1);
+            break;
+        case Algorithm::SHA256:
+            mbedtls_sha256_init(&_ctx.sha256);
+            mbedtls_sha256_starts(&_ctx.sha256, 0);
+            break;
+        case Algorithm::SHA512:
+            mbedtls_sha512_init(&_ctx.sha512);
+            mbedtls_sha512_starts(&_ctx.sha512, 0);
+            break;
+        default:
+            break;
+    }
+}
+
+void Hash::Context::update(const uint8_t* data, size_t len) {
+    switch (_algorithm) {
+        case Algorithm::MD5:
+            mbedtls_md5_update(&_ctx.md5, data, len);
+            break;
+        case Algorithm::SHA1:
+            mbedtls_sha1_update(&_ctx.sha1, data, len);
+            break;
+        case Algorithm::SHA256:
+            mbedtls_sha256_update(&_ctx.sha256, data, len);
+            break;
+        case Algorithm::SHA512:
+            mbedtls_sha512_update(&_ctx.sha512, data, len);
+            break;
+        default:
+            break;
+    }
+}
+
+size_t Hash::Context::finalize(uint8_t* output) {
+    size_t length = 0;
+    switch (_algorithm) {
+        case Algorithm::MD5:
+            mbedtls_md5_finish(&_ctx.md5, output);
+            length = 16;
+            break;
+        case Algorithm::SHA1:
+            mbedtls_sha1_finish(&_ctx.sha1, output);
+            length = 20;
+            break;
+        case Algorithm::SHA256:
+            mbedtls_sha256_finish(&_ctx.sha256, output);
+            length = 32;
+            break;
+        case Algorithm::SHA512:
+            mbedtls_sha512_finish(&_ctx.sha512, output);
+            length = 64;
+            break;
+        default:
+            break;
+    }
+    free();
+    return length;
+}
+
 Hash::Hash() {}
 
 Hash::~Hash() {
@@ -41,16 +155,32 @@ Hash::Algorithm Hash::from_string(std::string hash_name)
     }
 }
 
+void Hash::start() {
+    for (int i = 0; i < NUM_ALGORITHMS; i++)
+        contexts[i].start(static_cast<Algorithm>(i));
+    started = true;
+}
+
+void Hash::add_data(const uint8_t* data, size_t len) {
+    if (!started)
+        start();
+    for (int i = 0; i < NUM_ALGORITHMS; i++)
+        contexts[i].update(data, len);
+}
+
 void Hash::add_data(const std::vector<uint8_t>& data) {
-    accumulated_data.insert(accumulated_data.end(), data.begin(), data.end());
+    add_data(data.data(), data.size());
 }
 
 void Hash::add_data(const std::string& data) {
-    accumulated_data.insert(accumulated_data.end(), data.begin(), data.end());
+    add_data(reinterpret_cast<const uint8_t*>(data.data()), data.size());
 }
 
+// Contexts are only kept while there is data, on ESP32 they can hold the SHA hardware
 void Hash::clear() {
-    accumulated_data.clear();
+    for (int i = 0; i < NUM_ALGORITHMS; i++)
+        contexts[i].start(Algorithm::UNKNOWN);
+    started = false;
 }
 
 size_t Hash::hash_length(Algorithm algorithm, bool is_hex) const {
@@ -76,18 +206,18 @@ size_t Hash::hash_length(Algorithm algorithm, bool is_hex) const {
 
 void Hash::compute(Algorithm algorithm, bool clear_data) {
     hash_output.clear();
-    switch (algorithm) {
-        case Algorithm::SHA1:
-            compute_sha1();
-            break;
-        case Algorithm::SHA256:
-            compute_sha256();
-            break;
-        case Algorithm::SHA512:
-            compute_sha512();
-            break;
-        default:
-            break;
+    if (algorithm != Algorithm::UNKNOWN) {
+        if (!started)
+            start(); // hash of no data
+        hash_output.resize(hash_length(algorithm, false));
+        Context& ctx = contexts[static_cast<int>(algorithm)];
+        if (clear_data) {
+            ctx.finalize(hash_output.data());
+        } else {
+            // more data can be added, so final hash is computed on a copy
+            Context copy(ctx);
+            copy.finalize(hash_output.data());
+        }
     }
     if (clear_data) {
         clear();
@@ -102,41 +232,13 @@ std::string Hash::output_hex() const {
     return bytes_to_hex(hash_output);
 }
 
-void Hash::compute_sha1() {
-    mbedtls_sha1_context ctx;
-    mbedtls_sha1_init(&ctx);
-    mbedtls_sha1_starts(&ctx);
-    mbedtls_sha1_update(&ctx, accumulated_data.data(), accumulated_data.size());
-    hash_output.resize(20);
-    mbedtls_sha1_finish(&ctx, hash_output.data());
-    mbedtls_sha1_free(&ctx);
-}
-
-void Hash::compute_sha256() {
-    mbedtls_sha256_context ctx;
-    mbedtls_sha256_init(&ctx);
-    mbedtls_sha256_starts(&ctx, 0);
-    mbedtls_sha256_update(&ctx, accumulated_data.data(), accumulated_data.size());
-    hash_output.resize(32);
-    mbedtls_sha256_finish(&ctx, hash_output.data());
-    mbedtls_sha256_free(&ctx);
-}
-
-void Hash::compute_sha512() {
-    mbedtls_sha512_context ctx;
-    mbedtls_sha512_init(&ctx);
-    mbedtls_sha512_starts(&ctx, 0);
-    mbedtls_sha512_update(&ctx, accumulated_data.data(), accumulated_data.size());
-    hash_output.resize(64);
-    mbedtls_sha512_finish(&ctx, hash_output.data());
-    mbedtls_sha512_free(&ctx);
-}
-
 std::string Hash::bytes_to_hex(const std::vector<uint8_t>& bytes) const {
-    std::stringstream hex_stream;
-    hex_stream << std::hex << std::setfill('0');
+    static const char hex_digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(bytes.size() * 2);
     for (auto byte : bytes) {
-        hex_stream << std::setw(2) << static_cast<int>(byte);
+        hex += hex_digits[byte >> 4];
+        hex += hex_digits[byte & 0x0f];
     }
-    return hex_stream.str();
-}
\ No newline at end of file
+    return hex;
+}
@@ -14,9 +14,37 @@ public:
         UNKNOWN = -1, MD5, SHA1, SHA256, SHA512
     };
 
+    // Incremental hash with one algorithm, data can be fed in pieces of any size as it arrives
+    class Context {
+    public:
+        Context() {}
+        Context(const Context& other); // copies the state, e.g. to get hash of data so far
+        Context& operator=(const Context& other) = delete;
+        ~Context();
+
+        void start(Algorithm algorithm);
+        void update(const uint8_t* data, size_t len);
+        // Writes hash_length(algorithm) bytes to output and returns that length.
+        // Context has to be started again before it is used for more data.
+        size_t finalize(uint8_t* output);
+        Algorithm algorithm() const { return _algorithm; }
+
+    private:
+        void free();
+
+        Algorithm _algorithm = Algorithm::UNKNOWN;
+        union {
+            mbedtls_md5_context md5;
+            mbedtls_sha1_context sha1;
+            mbedtls_sha256_context sha256;
+            mbedtls_sha512_context sha512;
+        } _ctx;
+    };
+
     Hash();
     ~Hash();
 
+    void add_data(const uint8_t* data, size_t len);
     void add_data(const std::vector<uint8_t>& data);
     void add_data(const std::string& data);
     void clear();
@@ -29,15 +57,16 @@ public:
     static Hash::Algorithm from_string(std::string hash_name);
 
 private:
-    std::vector<uint8_t> accumulated_data;
+    // Algorithm is only given to compute(), so data is hashed with each of them as it is added
+    static const int NUM_ALGORITHMS = 4;
+    Context contexts[NUM_ALGORITHMS];
+    bool started = false;
     std::vector<uint8_t> hash_output;
 
-    void compute_sha1();
-    void compute_sha256();
-    void compute_sha512();
+    void start();
     std::string bytes_to_hex(const std::vector<uint8_t>& bytes) const;
 };
 
 extern Hash hasher;
 
-#endif // HASH_H
\ No newline at end of file
+#endif // HASH_H
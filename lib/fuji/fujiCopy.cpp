@@ -0,0 +1,170 @@
+#include "fujiCopy.h"
+
+#include <cstdlib>
+
+#ifdef ESP_PLATFORM
+#include <esp_heap_caps.h>
+#endif
+
+#include "../../include/debug.h"
+
+fujiCopyTask::fujiCopyTask(fujiHost *source, const std::string &sourcePath, fujiHost *dest, const std::string &destPath,
+                           fujiCopyStatus *status, size_t blocksize)
+{
+    _source = source;
+    _dest = dest;
+    _sourcePath = sourcePath;
+    _destPath = destPath;
+    _status = status;
+    _blocksize = blocksize;
+
+    _status->state = COPYSTATE_RUNNING;
+    _status->copied = 0;
+    _status->total = 0;
+}
+
+fujiCopyTask::~fujiCopyTask()
+{
+    close_files();
+}
+
+int fujiCopyTask::get_progress()
+{
+    if (_status->total == 0)
+        return _status->state == COPYSTATE_DONE ? 100 : 0;
+    return (int)((uint64_t)_status->copied * 100 / _status->total);
+}
+
+void fujiCopyTask::close_files()
+{
+    if (_sourceFile != nullptr)
+        fnio::fclose(_sourceFile);
+    if (_destFile != nullptr)
+        fnio::fclose(_destFile);
+    _sourceFile = nullptr;
+    _destFile = nullptr;
+    delete _fsCopy; // removes the destination if it isn't complete
+    _fsCopy = nullptr;
+    free(_buf);
+    _buf = nullptr;
+}
+
+int fujiCopyTask::start()
+{
+    char fullpath[MAX_PATHLEN];
+
+    // Hosts on the same file system may not need the data to travel through FujiNet
+    _fsCopy = _source->file_copy_open(_sourcePath.c_str(), _dest, _destPath.c_str());
+    if (_fsCopy != nullptr)
+    {
+        _status->total = _fsCopy->size() > UINT32_MAX ? UINT32_MAX : _fsCopy->size();
+        Debug_printf("fujiCopyTask #%d copying by file system, %lu bytes\n", _id, (unsigned long)_status->total);
+        return 0;
+    }
+
+    _sourceFile = _source->fnfile_open(_sourcePath.c_str(), fullpath, sizeof(fullpath), FILE_READ);
+    if (_sourceFile == nullptr)
+        return -1;
+
+    _expected = _source->file_size(_sourceFile);
+    if (_expected > 0)
+        _status->total = _expected;
+
+    if (_source->file_copy(_sourcePath.c_str(), _dest, _destPath.c_str()))
+    {
+        Debug_printf("fujiCopyTask #%d copied by file system\n", _id);
+        close_files();
+        _status->copied = _status->total;
+        return 0;
+    }
+
+#ifdef ESP_PLATFORM
+    _buf = (uint8_t *)heap_caps_malloc(_blocksize, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
+    if (_buf == nullptr)
+#endif
+        _buf = (uint8_t *)malloc(_blocksize);
+    if (_buf == nullptr)
+        return -1;
+
+    _destFile = _dest->fnfile_open(_destPath.c_str(), fullpath, sizeof(fullpath), FILE_WRITE);
+    if (_destFile == nullptr)
+        return -1;
+    _destPath = fullpath; // for removal on error
+
+    Debug_printf("fujiCopyTask #%d started, %ld bytes\n", _id, _expected);
+    return 0;
+}
+
+int fujiCopyTask::abort()
+{
+    bool created = _destFile != nullptr;
+    close_files();
+
+    // Remove the incomplete destination file
+    if (created)
+        _dest->file_remove((char *)_destPath.c_str());
+
+    _status->state = COPYSTATE_ERROR;
+    Debug_printf("fujiCopyTask #%d failed after %lu bytes\n", _id, (unsigned long)_status->copied);
+    return 0;
+}
+
+int fujiCopyTask::step()
+{
+    if (_fsCopy != nullptr)
+    {
+        int result = _fsCopy->step(_wait_ms);
+        _status->copied = _fsCopy->copied() > UINT32_MAX ? UINT32_MAX : _fsCopy->copied();
+        if (result <= 0)
+            return result;
+
+        close_files();
+        _status->state = COPYSTATE_DONE;
+        Debug_printf("fujiCopyTask #%d copied %lu bytes by file system\n", _id, (unsigned long)_status->copied);
+        return 1;
+    }
+
+    // Done by the file system already
+    if (_sourceFile == nullptr)
+    {
+        _status->state = COPYSTATE_DONE;
+        return 1;
+    }
+
+    // Network file systems may return less than asked before the end, fill the block
+    size_t readCount = 0;
+    while (readCount < _blocksize)
+    {
+        size_t n = fnio::fread(_buf + readCount, 1, _blocksize - readCount, _sourceFile);
+        if (n == 0)
+            break;
+        readCount += n;
+    }
+    if (readCount > 0 && fnio::fwrite(_buf, 1, readCount, _destFile) != readCount)
+        return -1;
+    _status->copied += readCount;
+
+    if (readCount == _blocksize && (_expected < 0 || _status->copied < (unsigned long)_expected))
+        return 0; // continue
+
+    // A read of nothing is the end of the file, an error if size was known and not reached
+    if (_expected >= 0 && _status->copied != (unsigned long)_expected)
+        return -1;
+
+    close_files();
+    _status->state = COPYSTATE_DONE;
+    Debug_printf("fujiCopyTask #%d copied %lu bytes\n", _id, (unsigned long)_status->copied);
+    return 1;
+}
+
+bool fujiCopyTask::run()
+{
+    _wait_ms = 1000;
+    int result = start();
+    while (result == 0)
+        result = step();
+
+    if (result < 0)
+        abort();
+    return result > 0;
+}
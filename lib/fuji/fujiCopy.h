@@ -0,0 +1,80 @@
+#ifndef _FUJI_COPY_
+#define _FUJI_COPY_
+
+#include <stdint.h>
+#include <string>
+
+#include "fnTask.h"
+#include "fnio.h"
+#include "fujiHost.h"
+
+// Bytes moved through FujiNet per step of a copy
+#ifndef FUJI_COPY_BLOCK_SIZE
+#define FUJI_COPY_BLOCK_SIZE 16384
+#endif
+
+// Same for a background copy, the bus is serviced between steps. Two TNFS packets each way.
+#ifndef FUJI_COPY_STEP_SIZE
+#define FUJI_COPY_STEP_SIZE 1024
+#endif
+
+// Set in the destination slot of FUJICMD_COPY_FILE to copy in the background
+#define FUJI_COPY_BACKGROUND 0x80
+
+enum fujiCopyState
+{
+    COPYSTATE_IDLE = 0,
+    COPYSTATE_RUNNING,
+    COPYSTATE_DONE,
+    COPYSTATE_ERROR
+};
+
+// Progress of the last copy, kept by the device as the task is deleted when it ends
+struct fujiCopyStatus
+{
+    fujiCopyState state = COPYSTATE_IDLE;
+    uint32_t copied = 0;
+    uint32_t total = 0;
+};
+
+/*
+ * Copies a file from one host slot to another, one block per step. Either submitted
+ * to taskMgr to run in the background or run to the end with run().
+ * If both hosts share the file system, it is asked to copy the file itself first
+ * (SMB server side copy, a request per step, or host OS copy on FujiNet-PC).
+ */
+class fujiCopyTask : public fnTask
+{
+public:
+    fujiCopyTask(fujiHost *source, const std::string &sourcePath, fujiHost *dest, const std::string &destPath,
+                 fujiCopyStatus *status, size_t blocksize = FUJI_COPY_BLOCK_SIZE);
+    virtual ~fujiCopyTask() override;
+    virtual int get_progress() override;
+
+    // Copy everything in the calling task, returns true on success
+    bool run();
+
+protected:
+    virtual int start() override;
+    virtual int abort() override;
+    virtual int step() override;
+
+private:
+    void close_files();
+
+    fujiHost *_source;
+    fujiHost *_dest;
+    std::string _sourcePath;
+    std::string _destPath;
+    fujiCopyStatus *_status;
+
+    fnFile *_sourceFile = nullptr;
+    fnFile *_destFile = nullptr;
+    FileSystemCopy *_fsCopy = nullptr;
+    int _wait_ms = 0; // how long a file system copy step may wait, run() doesn't need to return
+    uint8_t *_buf = nullptr;
+    size_t _blocksize;
+    long _expected = -1;
+};
+
+#endif // _FUJI_COPY_
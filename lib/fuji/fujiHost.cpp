@@ -264,6 +264,46 @@ bool fujiHost::file_remove(char *fullpath)
     return _fs->remove(fullpath);
 }
 
+/* Copy a file within the file system shared by this and the destination host
+ * Returns true on success, false if it failed or is not supported
+*/
+bool fujiHost::file_copy(const char *path, fujiHost *desthost, const char *destpath)
+{
+    if (_type == HOSTTYPE_UNINITIALIZED || _fs == nullptr || desthost == nullptr || desthost->_fs != _fs)
+        return false;
+
+    // Add our prefixes
+    char realpath[MAX_PATHLEN];
+    char realdestpath[MAX_PATHLEN];
+    if (false == util_concat_paths(realpath, _prefix, path, sizeof(realpath)) ||
+        false == util_concat_paths(realdestpath, desthost->_prefix, destpath, sizeof(realdestpath)))
+        return false;
+
+    Debug_printf("::file_copy \"%s\" -> \"%s\"\n", realpath, realdestpath);
+
+    return _fs->copy(realpath, realdestpath);
+}
+
+/* Start a copy within the file system shared by this and the destination host, done in steps
+ * Returns nullptr if it is not supported
+*/
+FileSystemCopy *fujiHost::file_copy_open(const char *path, fujiHost *desthost, const char *destpath)
+{
+    if (_type == HOSTTYPE_UNINITIALIZED || _fs == nullptr || desthost == nullptr || desthost->_fs != _fs)
+        return nullptr;
+
+    // Add our prefixes
+    char realpath[MAX_PATHLEN];
+    char realdestpath[MAX_PATHLEN];
+    if (false == util_concat_paths(realpath, _prefix, path, sizeof(realpath)) ||
+        false == util_concat_paths(realdestpath, desthost->_prefix, destpath, sizeof(realdestpath)))
+        return nullptr;
+
+    Debug_printf("::file_copy_open \"%s\" -> \"%s\"\n", realpath, realdestpath);
+
+    return _fs->copy_open(realpath, realdestpath);
+}
+
 /* Returns pointer to current hostname and, if provided, fills buffer with that string
 */
 const char *fujiHost::get_hostname(char *buffer, size_t buffersize)
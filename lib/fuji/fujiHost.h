@@ -73,6 +73,12 @@ public:
 
     bool file_remove(char *fullpath);
 
+    // Copy a file to another host without moving the data through FujiNet (e.g. server side copy),
+    // only possible if both hosts use the same file system. Returns false if it could not be done.
+    bool file_copy(const char *path, fujiHost *desthost, const char *destpath);
+    // Same, done by the file system in steps. Returns nullptr if it can't.
+    FileSystemCopy *file_copy_open(const char *path, fujiHost *desthost, const char *destpath);
+
     // Directory functions
     bool dir_open(const char *path, const char *pattern, uint16_t options = 0);
     void dir_close();
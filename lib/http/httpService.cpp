@@ -3,6 +3,7 @@
 
 #include "httpService.h"
 
+#include <algorithm>
 #include <sstream>
 #include <vector>
 
@@ -128,7 +129,8 @@ const char *fnHttpService::find_mimetype_str(const char *extension)
         {"txt", "text/plain"},
         {"bin", "application/octet-stream"},
         {"js", "text/javascript"},
-        {"atascii", "application/octet-stream"}};
+        {"atascii", "application/octet-stream"},
+        {"pcapng", "application/x-pcapng"}};
 
     if (extension != NULL)
     {
@@ -202,9 +204,8 @@ void fnHttpService::send_header_footer(httpd_req_t *req, int headfoot)
         }
         else
         {
-            fread(buf, 1, sz, fInput);
-            string contents(buf);
-            contents = fnHttpServiceParser::parse_contents(contents);
+            size_t len = fread(buf, 1, sz, fInput);
+            string contents = fnHttpServiceParser::parse_contents(std::string_view(buf, strnlen(buf, len)));
 
             httpd_resp_sendstr_chunk(req, contents.c_str());
         }
@@ -247,9 +248,8 @@ void fnHttpService::send_file_parsed(httpd_req_t *req, const char *filename)
         }
         else
         {
-            fread(buf, 1, sz, fInput);
-            string contents(buf);
-            contents = fnHttpServiceParser::parse_contents(contents);
+            size_t len = fread(buf, 1, sz, fInput);
+            string contents = fnHttpServiceParser::parse_contents(std::string_view(buf, strnlen(buf, len)));
 
             httpd_resp_send(req, contents.c_str(), contents.length());
         }
@@ -427,6 +427,37 @@ esp_err_t fnHttpService::get_handler_file_in_path(httpd_req_t *req)
     return ESP_OK;
 }
 
+// File extension for printer output of given paper type, and whether it's downloaded rather than shown
+static const char *print_output_ext(paper_t paper, bool &sendAsAttachment)
+{
+    sendAsAttachment = true;
+
+    switch (paper)
+    {
+    case RAW:
+        return "bin";
+    case TRIM:
+        return "atascii";
+    case ASCII:
+        sendAsAttachment = false;
+        return "txt";
+    case PDF:
+        return "pdf";
+    case SVG:
+        sendAsAttachment = false;
+        return "svg";
+    case PNG:
+        sendAsAttachment = false;
+        return "png";
+    case HTML:
+    case HTML_ATASCII:
+        sendAsAttachment = false;
+        return "html";
+    default:
+        return "bin";
+    }
+}
+
 esp_err_t fnHttpService::get_handler_print(httpd_req_t *req)
 {
     Debug_println("Print request handler");
@@ -459,42 +490,8 @@ esp_err_t fnHttpService::get_handler_print(httpd_req_t *req)
     }
 
     // Build a print output name
-    const char *exts;
-
-    bool sendAsAttachment = true;
-
-    // Choose an extension based on current printer papertype
-    switch (currentPrinter->getPaperType())
-    {
-    case RAW:
-        exts = "bin";
-        break;
-    case TRIM:
-        exts = "atascii";
-        break;
-    case ASCII:
-        exts = "txt";
-        sendAsAttachment = false;
-        break;
-    case PDF:
-        exts = "pdf";
-        break;
-    case SVG:
-        exts = "svg";
-        sendAsAttachment = false;
-        break;
-    case PNG:
-        exts = "png";
-        sendAsAttachment = false;
-        break;
-    case HTML:
-    case HTML_ATASCII:
-        exts = "html";
-        sendAsAttachment = false;
-        break;
-    default:
-        exts = "bin";
-    }
+    bool sendAsAttachment;
+    const char *exts = print_output_ext(currentPrinter->getPaperType(), sendAsAttachment);
 
     string filename = "printout.";
     filename += exts;
@@ -548,6 +545,56 @@ esp_err_t fnHttpService::get_handler_print(httpd_req_t *req)
     return ESP_OK;
 }
 
+// Output of the print job in progress, the job is left open
+esp_err_t fnHttpService::get_handler_print_live(httpd_req_t *req)
+{
+    Debug_println("Live print request handler");
+
+    fnHTTPD.clearErrMsg();
+
+    PRINTER_CLASS *printer = (PRINTER_CLASS *)fnPrinters.get_ptr(0);
+    printer_emu *currentPrinter = printer == nullptr ? nullptr : printer->getPrinterPtr();
+
+    size_t length = 0;
+    std::string tail;
+    FILE *poutput = currentPrinter == nullptr ? nullptr : currentPrinter->provideLiveReadHandle(length, tail);
+    if (poutput == nullptr)
+    {
+        fnHTTPD.addToErrMsg("No print job in progress.\n");
+        send_file(req, "error_page.html");
+        return ESP_OK;
+    }
+
+    bool sendAsAttachment;
+    string filename = "printout.";
+    filename += print_output_ext(currentPrinter->getPaperType(), sendAsAttachment);
+
+    // always shown in browser, it is reloaded as the job goes on
+    set_file_content_type(req, filename.c_str());
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+
+    char *buf = (char *)malloc(FNWS_SEND_BUFF_SIZE);
+    size_t count = 0, total = 0;
+    while (total < length)
+    {
+        count = fread((uint8_t *)buf, 1, std::min((size_t)FNWS_SEND_BUFF_SIZE, length - total), poutput);
+        if (count == 0)
+            break;
+        total += count;
+        httpd_resp_send_chunk(req, buf, count);
+    }
+    if (!tail.empty())
+        httpd_resp_send_chunk(req, tail.data(), tail.size());
+    httpd_resp_send_chunk(req, nullptr, 0);
+
+    Debug_printf("Sent %u bytes of print job in progress\n", (unsigned)(total + tail.size()));
+
+    free(buf);
+    fclose(poutput);
+
+    return ESP_OK;
+}
+
 esp_err_t fnHttpService::get_handler_modem_sniffer(httpd_req_t *req)
 {
     Debug_printf("Modem Sniffer output request handler\n");
@@ -556,6 +603,20 @@ esp_err_t fnHttpService::get_handler_modem_sniffer(httpd_req_t *req)
 
     ModemSniffer *modemSniffer = sioR->get_modem_sniffer();
     Debug_printf("Got modem Sniffer.\n");
+
+    // Each URL only serves the output of its own mode
+    const char *filename = modemSniffer->getCapture() ? "/modem-sniffer.pcapng" : "/modem-sniffer.txt";
+    size_t len = strlen(filename);
+    if (strncmp(req->uri, filename, len) != 0 || (req->uri[len] != '\0' && req->uri[len] != '?'))
+    {
+        Debug_printf("Sniffer output is %s, not %s\n", filename, req->uri);
+        fnHTTPD.addToErrMsg("The modem sniffer is not in this mode. Its output is at ");
+        fnHTTPD.addToErrMsg(filename);
+        fnHTTPD.addToErrMsg("\n");
+        send_file(req, "error_page.html");
+        return ESP_OK;
+    }
+
     time_t now = fnSystem.millis();
 
     if (now - sioR->get_last_activity_time() < PRINTER_BUSY_TIME) // re-using printer timeout constant.
@@ -574,7 +635,7 @@ esp_err_t fnHttpService::get_handler_modem_sniffer(httpd_req_t *req)
         return ESP_OK;
     }
 
-    set_file_content_type(req, "modem-sniffer.txt");
+    set_file_content_type(req, filename);
 
     // Finally, write the data
     // Send the file content out in chunks
@@ -1383,6 +1444,13 @@ httpd_handle_t fnHttpService::start_server(serverstate &state)
          .is_websocket = false,
          .handle_ws_control_frames = false,
          .supported_subprotocol = nullptr},
+        {.uri = "/print/live",
+         .method = HTTP_GET,
+         .handler = get_handler_print_live,
+         .user_ctx = NULL,
+         .is_websocket = false,
+         .handle_ws_control_frames = false,
+         .supported_subprotocol = nullptr},
         {.uri = "/modem-sniffer.txt",
          .method = HTTP_GET,
          .handler = get_handler_modem_sniffer,
@@ -1390,6 +1458,13 @@ httpd_handle_t fnHttpService::start_server(serverstate &state)
          .is_websocket = false,
          .handle_ws_control_frames = false,
          .supported_subprotocol = nullptr},
+        {.uri = "/modem-sniffer.pcapng",
+         .method = HTTP_GET,
+         .handler = get_handler_modem_sniffer,
+         .user_ctx = NULL,
+         .is_websocket = false,
+         .handle_ws_control_frames = false,
+         .supported_subprotocol = nullptr},
         {.uri = "/favicon.ico",
          .method = HTTP_GET,
          .handler = get_handler_file_in_path,
@@ -14,6 +14,7 @@ MIME types are assigned based on file extention.  See/update
     static std::map<string, string> mime_map
 
 Unless parsable, files are sent in FNWS_SEND_BUFF_SIZE blocks.
+FujiNet-PC keeps them in memory instead (see httpServiceAssets.h).
 
 If a file has an extention pre-determined to support parsing (see/update
     fnHttpServiceParser::is_parsable() for a the list) then the
@@ -41,6 +42,7 @@ If a file has an extention pre-determined to support parsing (see/update
 #else
 #include "mongoose.h"
 #undef mkdir
+#include "httpServiceAssets.h"
 #endif
 
 // FNWS_FILE_ROOT should end in a slash '/'
@@ -69,6 +71,9 @@ class fnHttpService
         struct mg_mgr *hServer;
 #endif
         FileSystem *_FS = nullptr;
+#ifndef ESP_PLATFORM
+        fnHttpServiceAssets _assets;
+#endif
     } state;
 
     enum _fnwserr
@@ -112,7 +117,8 @@ class fnHttpService
     static const char * get_basename(const char *filepath);
     static void set_file_content_type(struct mg_connection *c, const char *filepath);
     static void send_file_parsed(struct mg_connection *c, const char *filename);
-    static void send_file(struct mg_connection *c, const char *filename);
+    static void send_file(struct mg_connection *c, const char *filename, struct mg_http_message *hm = nullptr);
+    static void load_assets(serverstate &state, const std::string &dir);
     static int redirect_or_result(mg_connection *c, mg_http_message *hm, int result);
 
     friend class fnHttpServiceBrowser; // allow browser to call above functions
@@ -133,6 +139,7 @@ public:
     static esp_err_t get_handler_file_in_query(httpd_req_t *req);
     static esp_err_t get_handler_file_in_path(httpd_req_t *req);
     static esp_err_t get_handler_print(httpd_req_t *req);
+    static esp_err_t get_handler_print_live(httpd_req_t *req);
     static esp_err_t get_handler_modem_sniffer(httpd_req_t *req);
     static esp_err_t get_handler_mount(httpd_req_t *req);
     static esp_err_t get_handler_eject(httpd_req_t *req);
@@ -148,6 +155,7 @@ public:
 #else
 // !ESP_PLATFORM
     static int get_handler_print(struct mg_connection *c);
+    static int get_handler_print_live(struct mg_connection *c);
     // static esp_err_t get_handler_modem_sniffer(httpd_req_t *req);
     static int get_handler_swap(struct mg_connection *c, struct mg_http_message *hm);
     static int get_handler_mount(struct mg_connection *c, struct mg_http_message *hm);
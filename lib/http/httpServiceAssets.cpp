@@ -0,0 +1,153 @@
+#ifndef ESP_PLATFORM
+
+#include "httpServiceAssets.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#define GZIP_SUFFIX ".gz"
+#define GZIP_SUFFIX_LEN (sizeof(GZIP_SUFFIX) - 1)
+
+void fnHttpServiceAssets::add(const std::string &path, std::string &&content)
+{
+    _bytes += content.size();
+
+    if (path.size() > GZIP_SUFFIX_LEN && path.compare(path.size() - GZIP_SUFFIX_LEN, GZIP_SUFFIX_LEN, GZIP_SUFFIX) == 0)
+    {
+        // files may come in any order, the plain one can be added later
+        fnHttpAsset &asset = _assets[path.substr(0, path.size() - GZIP_SUFFIX_LEN)];
+        _bytes -= asset.gzip.size();
+        asset.gzip_etag = make_etag(content);
+        asset.gzip_etag.insert(asset.gzip_etag.size() - 1, "-gz");
+        asset.gzip = std::move(content);
+        return;
+    }
+
+    fnHttpAsset &asset = _assets[path];
+    _bytes -= asset.content.size();
+    asset.etag = make_etag(content);
+    asset.content = std::move(content);
+}
+
+const fnHttpAsset *fnHttpServiceAssets::find(const std::string &path) const
+{
+    auto it = _assets.find(path);
+    // gzip variant without the plain file is not served
+    if (it == _assets.end() || it->second.etag.empty())
+        return nullptr;
+    return &it->second;
+}
+
+void fnHttpServiceAssets::clear()
+{
+    _assets.clear();
+    _bytes = 0;
+}
+
+void fnHttpServiceAssets::send(mg_connection *c, const fnHttpAsset *asset, const char *mimetype, mg_http_message *hm)
+{
+    // gzip variant is preferred if the client accepts it
+    bool gzip = false;
+    if (hm != nullptr && !asset->gzip.empty())
+    {
+        mg_str *accept = mg_http_get_header(hm, "Accept-Encoding");
+        gzip = accept != nullptr && accepts_gzip(accept->ptr, accept->len);
+    }
+    const std::string &etag = gzip ? asset->gzip_etag : asset->etag;
+    const std::string &body = gzip ? asset->gzip : asset->content;
+    const char *vary = asset->gzip.empty() ? "" : "Vary: Accept-Encoding\r\n";
+
+    mg_str *inm = hm != nullptr ? mg_http_get_header(hm, "If-None-Match") : nullptr;
+    if (inm != nullptr && etag_matches(inm->ptr, inm->len, etag))
+    {
+        mg_printf(c, "HTTP/1.1 304 Not Modified\r\nETag: %s\r\nCache-Control: no-cache\r\n%s\r\n", etag.c_str(), vary);
+        return;
+    }
+
+    mg_printf(c, "HTTP/1.1 200 OK\r\n");
+    if (mimetype != nullptr)
+        mg_printf(c, "Content-Type: %s\r\n", mimetype);
+    if (gzip)
+        mg_printf(c, "Content-Encoding: gzip\r\n");
+    // always revalidate, the ETag makes that cheap
+    mg_printf(c, "ETag: %s\r\nCache-Control: no-cache\r\n%sContent-Length: %lu\r\n\r\n",
+              etag.c_str(), vary, (unsigned long)body.size());
+    mg_send(c, body.data(), body.size());
+}
+
+// Quoted 64-bit FNV-1a hash and length of the content
+std::string fnHttpServiceAssets::make_etag(const std::string &content)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (unsigned char ch : content)
+    {
+        h ^= ch;
+        h *= 0x100000001b3ULL;
+    }
+    char buf[40];
+    snprintf(buf, sizeof(buf), "\"%016llx-%zx\"", (unsigned long long)h, content.size());
+    return buf;
+}
+
+bool fnHttpServiceAssets::etag_matches(const char *if_none_match, size_t len, const std::string &etag)
+{
+    const char *p = if_none_match;
+    const char *end = if_none_match + len;
+    while (p < end)
+    {
+        // comma separated list of entity tags, weak ones compare equal too (RFC 9110 13.1.2)
+        while (p < end && (*p == ' ' || *p == '\t' || *p == ','))
+            p++;
+        const char *tag = p;
+        while (p < end && *p != ',')
+            p++;
+        const char *tag_end = p;
+        while (tag_end > tag && (tag_end[-1] == ' ' || tag_end[-1] == '\t'))
+            tag_end--;
+        if (tag_end - tag == 1 && *tag == '*')
+            return true;
+        if (tag_end - tag > 2 && tag[0] == 'W' && tag[1] == '/')
+            tag += 2;
+        if ((size_t)(tag_end - tag) == etag.size() && memcmp(tag, etag.data(), etag.size()) == 0)
+            return true;
+    }
+    return false;
+}
+
+bool fnHttpServiceAssets::accepts_gzip(const char *accept_encoding, size_t len)
+{
+    const char *p = accept_encoding;
+    const char *end = accept_encoding + len;
+    while (p < end)
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == ','))
+            p++;
+        const char *coding = p;
+        while (p < end && *p != ',' && *p != ';' && *p != ' ' && *p != '\t')
+            p++;
+        size_t coding_len = p - coding;
+        bool match = (coding_len == 4 && strncasecmp(coding, "gzip", 4) == 0) || (coding_len == 1 && *coding == '*');
+
+        // "q=0" means not acceptable
+        bool rejected = false;
+        while (p < end && *p != ',')
+        {
+            if (*p == 'q' && p + 1 < end && p[1] == '=')
+            {
+                const char *q = p + 2;
+                rejected = true;
+                for (; q < end && *q != ',' && *q != ';'; q++)
+                    if (*q >= '1' && *q <= '9')
+                        rejected = false;
+            }
+            p++;
+        }
+        if (match && !rejected)
+            return true;
+    }
+    return false;
+}
+
+#endif // !ESP_PLATFORM
@@ -0,0 +1,58 @@
+/* FujiNet web server helper class
+
+In-memory copy of the static web UI files (FNWS_FILE_ROOT), loaded once when
+the server starts, so requests are answered without touching the file system.
+
+Each file gets a strong ETag computed from its content, clients presenting it
+in If-None-Match get "304 Not Modified". If the web UI build placed a
+precompressed "<name>.gz" next to a file, it is kept as gzip variant of that
+file and sent to clients accepting gzip encoding (with its own ETag).
+
+Parsable files (see fnHttpServiceParser::is_parsable()) are not kept here,
+the parser keeps them compiled.
+*/
+#ifndef HTTPSERVICEASSETS_H
+#define HTTPSERVICEASSETS_H
+
+#include <stddef.h>
+
+#include <map>
+#include <string>
+
+#include "mongoose.h"
+#undef mkdir
+
+struct fnHttpAsset
+{
+    std::string content;
+    std::string etag;
+    std::string gzip;       // precompressed variant, empty if there is none
+    std::string gzip_etag;
+};
+
+class fnHttpServiceAssets
+{
+    std::map<std::string, fnHttpAsset> _assets;
+    size_t _bytes = 0;
+
+public:
+    // Store file content under path relative to FNWS_FILE_ROOT, "<path>.gz" becomes gzip variant of <path>
+    void add(const std::string &path, std::string &&content);
+    // Returns cached file, nullptr if there is none
+    const fnHttpAsset *find(const std::string &path) const;
+    void clear();
+
+    // Send cached file, or "304 Not Modified" if the client has it already (hm can be nullptr)
+    static void send(mg_connection *c, const fnHttpAsset *asset, const char *mimetype, mg_http_message *hm);
+
+    size_t count() const { return _assets.size(); }
+    size_t bytes() const { return _bytes; }
+
+    static std::string make_etag(const std::string &content);
+    // True if If-None-Match header value lists etag (or is "*")
+    static bool etag_matches(const char *if_none_match, size_t len, const std::string &etag);
+    // True if Accept-Encoding header value allows gzip
+    static bool accepts_gzip(const char *accept_encoding, size_t len);
+};
+
+#endif // HTTPSERVICEASSETS_H
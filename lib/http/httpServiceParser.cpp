@@ -1,7 +1,11 @@
 
 #include "httpServiceParser.h"
 
+#include <sys/stat.h>
+
+#include <map>
 #include <sstream>
+#include <type_traits>
 
 #include "../../include/debug.h"
 
@@ -16,253 +20,289 @@ using namespace std;
 
 #define MAX_PRINTER_LIST_BUFFER (2048)
 
-const string fnHttpServiceParser::substitute_tag(const string &tag)
+enum tagids
 {
-    enum tagids
-    {
-        FN_HOSTNAME = 0,
+    FN_HOSTNAME = 0,
 #ifndef ESP_PLATFORM
-        FN_DEVICE_NAME,
-        FN_LABEL,
+    FN_DEVICE_NAME,
+    FN_LABEL,
 #endif
-        FN_VERSION,
-        FN_IPADDRESS,
-        FN_IPMASK,
-        FN_IPGATEWAY,
-        FN_IPDNS,
-        FN_WIFISSID,
-        FN_WIFIBSSID,
-        FN_WIFIMAC,
-        FN_WIFIDETAIL,
+    FN_VERSION,
+    FN_IPADDRESS,
+    FN_IPMASK,
+    FN_IPGATEWAY,
+    FN_IPDNS,
+    FN_WIFISSID,
+    FN_WIFIBSSID,
+    FN_WIFIMAC,
+    FN_WIFIDETAIL,
 #ifndef ESP_PLATFORM
-        FN_UNAME,
+    FN_UNAME,
 #endif
-        FN_SPIFFS_SIZE,
-        FN_SPIFFS_USED,
-        FN_SD_SIZE,
-        FN_SD_USED,
-        FN_UPTIME_STRING,
-        FN_UPTIME,
-        FN_CURRENTTIME,
-        FN_TIMEZONE,
-        FN_ROTATION_SOUNDS,
-        FN_UDPSTREAM_HOST,
-        FN_HEAPSIZE,
-        FN_SYSSDK,
-        FN_SYSCPUREV,
-        FN_BUSVOLTS,
-        FN_SIO_HSINDEX,
-        FN_SIO_HSBAUD,
-        FN_PRINTER1_MODEL,
-        FN_PRINTER1_PORT,
-        FN_PLAY_RECORD,
-        FN_PULLDOWN,
-        FN_CASSETTE_ENABLED,
-        FN_CONFIG_ENABLED,
-        FN_STATUS_WAIT_ENABLED,
-        FN_BOOT_MODE,
-        FN_PRINTER_ENABLED,
-        FN_MODEM_ENABLED,
-        FN_MODEM_SNIFFER_ENABLED,
+    FN_SPIFFS_SIZE,
+    FN_SPIFFS_USED,
+    FN_SD_SIZE,
+    FN_SD_USED,
+    FN_UPTIME_STRING,
+    FN_UPTIME,
+    FN_CURRENTTIME,
+    FN_TIMEZONE,
+    FN_ROTATION_SOUNDS,
+    FN_UDPSTREAM_HOST,
+    FN_HEAPSIZE,
+    FN_SYSSDK,
+    FN_SYSCPUREV,
+    FN_BUSVOLTS,
+    FN_SIO_HSINDEX,
+    FN_SIO_HSBAUD,
+    FN_PRINTER1_MODEL,
+    FN_PRINTER1_PORT,
+    FN_PLAY_RECORD,
+    FN_PULLDOWN,
+    FN_CASSETTE_ENABLED,
+    FN_CONFIG_ENABLED,
+    FN_STATUS_WAIT_ENABLED,
+    FN_BOOT_MODE,
+    FN_PRINTER_ENABLED,
+    FN_MODEM_ENABLED,
+    FN_MODEM_SNIFFER_ENABLED,
 #ifndef ESP_PLATFORM
-        FN_SERIAL_PORT,
-        FN_SERIAL_PORT_BAUD,
-        FN_SERIAL_COMMAND,
-        FN_SERIAL_PROCEED,
-        FN_SIO_HSTEXT,
-        FN_NETSIO_ENABLED,
-        FN_NETSIO_HOST,
+    FN_SERIAL_PORT,
+    FN_SERIAL_PORT_BAUD,
+    FN_SERIAL_COMMAND,
+    FN_SERIAL_PROCEED,
+    FN_SIO_HSTEXT,
+    FN_NETSIO_ENABLED,
+    FN_NETSIO_HOST,
 #endif
-        FN_DRIVE1HOST,
-        FN_DRIVE2HOST,
-        FN_DRIVE3HOST,
-        FN_DRIVE4HOST,
-        FN_DRIVE5HOST,
-        FN_DRIVE6HOST,
-        FN_DRIVE7HOST,
-        FN_DRIVE8HOST,
+    FN_DRIVE1HOST,
+    FN_DRIVE2HOST,
+    FN_DRIVE3HOST,
+    FN_DRIVE4HOST,
+    FN_DRIVE5HOST,
+    FN_DRIVE6HOST,
+    FN_DRIVE7HOST,
+    FN_DRIVE8HOST,
 #ifndef ESP_PLATFORM
-        FN_DRIVE1BROWSER,
-        FN_DRIVE2BROWSER,
-        FN_DRIVE3BROWSER,
-        FN_DRIVE4BROWSER,
-        FN_DRIVE5BROWSER,
-        FN_DRIVE6BROWSER,
-        FN_DRIVE7BROWSER,
-        FN_DRIVE8BROWSER,
+    FN_DRIVE1BROWSER,
+    FN_DRIVE2BROWSER,
+    FN_DRIVE3BROWSER,
+    FN_DRIVE4BROWSER,
+    FN_DRIVE5BROWSER,
+    FN_DRIVE6BROWSER,
+    FN_DRIVE7BROWSER,
+    FN_DRIVE8BROWSER,
 #endif
-        FN_DRIVE1MOUNT,
-        FN_DRIVE2MOUNT,
-        FN_DRIVE3MOUNT,
-        FN_DRIVE4MOUNT,
-        FN_DRIVE5MOUNT,
-        FN_DRIVE6MOUNT,
-        FN_DRIVE7MOUNT,
-        FN_DRIVE8MOUNT,
-        FN_HOST1,
-        FN_HOST2,
-        FN_HOST3,
-        FN_HOST4,
-        FN_HOST5,
-        FN_HOST6,
-        FN_HOST7,
-        FN_HOST8,
-        FN_DRIVE1DEVICE,
-        FN_DRIVE2DEVICE,
-        FN_DRIVE3DEVICE,
-        FN_DRIVE4DEVICE,
-        FN_DRIVE5DEVICE,
-        FN_DRIVE6DEVICE,
-        FN_DRIVE7DEVICE,
-        FN_DRIVE8DEVICE,
-        FN_HOST1PREFIX,
-        FN_HOST2PREFIX,
-        FN_HOST3PREFIX,
-        FN_HOST4PREFIX,
-        FN_HOST5PREFIX,
-        FN_HOST6PREFIX,
-        FN_HOST7PREFIX,
-        FN_HOST8PREFIX,
-        FN_ERRMSG,
-        FN_HARDWARE_VER,
-        FN_PRINTER_LIST,
-        FN_ENCRYPT_PASSPHRASE_ENABLED,
-        FN_APETIME_ENABLED,
-        FN_CPM_ENABLED,
-        FN_CPM_CCP,
-        FN_ALT_CFG,
-        FN_PCLINK_ENABLED,
-        FN_LASTTAG
-    };
-
-    const char *tagids[FN_LASTTAG] =
-    {
-        "FN_HOSTNAME",
+    FN_DRIVE1MOUNT,
+    FN_DRIVE2MOUNT,
+    FN_DRIVE3MOUNT,
+    FN_DRIVE4MOUNT,
+    FN_DRIVE5MOUNT,
+    FN_DRIVE6MOUNT,
+    FN_DRIVE7MOUNT,
+    FN_DRIVE8MOUNT,
+    FN_HOST1,
+    FN_HOST2,
+    FN_HOST3,
+    FN_HOST4,
+    FN_HOST5,
+    FN_HOST6,
+    FN_HOST7,
+    FN_HOST8,
+    FN_DRIVE1DEVICE,
+    FN_DRIVE2DEVICE,
+    FN_DRIVE3DEVICE,
+    FN_DRIVE4DEVICE,
+    FN_DRIVE5DEVICE,
+    FN_DRIVE6DEVICE,
+    FN_DRIVE7DEVICE,
+    FN_DRIVE8DEVICE,
+    FN_HOST1PREFIX,
+    FN_HOST2PREFIX,
+    FN_HOST3PREFIX,
+    FN_HOST4PREFIX,
+    FN_HOST5PREFIX,
+    FN_HOST6PREFIX,
+    FN_HOST7PREFIX,
+    FN_HOST8PREFIX,
+    FN_ERRMSG,
+    FN_HARDWARE_VER,
+    FN_PRINTER_LIST,
+    FN_ENCRYPT_PASSPHRASE_ENABLED,
+    FN_APETIME_ENABLED,
+    FN_CPM_ENABLED,
+    FN_CPM_CCP,
+    FN_ALT_CFG,
+    FN_PCLINK_ENABLED,
+    FN_LASTTAG
+};
+
+static const char *tagids[FN_LASTTAG] =
+{
+    "FN_HOSTNAME",
 #ifndef ESP_PLATFORM
-        "FN_DEVICE_NAME",
-        "FN_LABEL",
+    "FN_DEVICE_NAME",
+    "FN_LABEL",
 #endif
-        "FN_VERSION",
-        "FN_IPADDRESS",
-        "FN_IPMASK",
-        "FN_IPGATEWAY",
-        "FN_IPDNS",
-        "FN_WIFISSID",
-        "FN_WIFIBSSID",
-        "FN_WIFIMAC",
-        "FN_WIFIDETAIL",
+    "FN_VERSION",
+    "FN_IPADDRESS",
+    "FN_IPMASK",
+    "FN_IPGATEWAY",
+    "FN_IPDNS",
+    "FN_WIFISSID",
+    "FN_WIFIBSSID",
+    "FN_WIFIMAC",
+    "FN_WIFIDETAIL",
 #ifndef ESP_PLATFORM
-        "FN_UNAME",
+    "FN_UNAME",
 #endif
-        "FN_SPIFFS_SIZE",
-        "FN_SPIFFS_USED",
-        "FN_SD_SIZE",
-        "FN_SD_USED",
-        "FN_UPTIME_STRING",
-        "FN_UPTIME",
-        "FN_CURRENTTIME",
-        "FN_TIMEZONE",
-        "FN_ROTATION_SOUNDS",
-        "FN_UDPSTREAM_HOST",
-        "FN_HEAPSIZE",
-        "FN_SYSSDK",
-        "FN_SYSCPUREV",
-        "FN_BUSVOLTS",
-        "FN_SIO_HSINDEX",
-        "FN_SIO_HSBAUD",
-        "FN_PRINTER1_MODEL",
-        "FN_PRINTER1_PORT",
-        "FN_PLAY_RECORD",
-        "FN_PULLDOWN",
-        "FN_CASSETTE_ENABLED",
-        "FN_CONFIG_ENABLED",
-        "FN_STATUS_WAIT_ENABLED",
-        "FN_BOOT_MODE",
-        "FN_PRINTER_ENABLED",
-        "FN_MODEM_ENABLED",
-        "FN_MODEM_SNIFFER_ENABLED",
+    "FN_SPIFFS_SIZE",
+    "FN_SPIFFS_USED",
+    "FN_SD_SIZE",
+    "FN_SD_USED",
+    "FN_UPTIME_STRING",
+    "FN_UPTIME",
+    "FN_CURRENTTIME",
+    "FN_TIMEZONE",
+    "FN_ROTATION_SOUNDS",
+    "FN_UDPSTREAM_HOST",
+    "FN_HEAPSIZE",
+    "FN_SYSSDK",
+    "FN_SYSCPUREV",
+    "FN_BUSVOLTS",
+    "FN_SIO_HSINDEX",
+    "FN_SIO_HSBAUD",
+    "FN_PRINTER1_MODEL",
+    "FN_PRINTER1_PORT",
+    "FN_PLAY_RECORD",
+    "FN_PULLDOWN",
+    "FN_CASSETTE_ENABLED",
+    "FN_CONFIG_ENABLED",
+    "FN_STATUS_WAIT_ENABLED",
+    "FN_BOOT_MODE",
+    "FN_PRINTER_ENABLED",
+    "FN_MODEM_ENABLED",
+    "FN_MODEM_SNIFFER_ENABLED",
 #ifndef ESP_PLATFORM
-        "FN_SERIAL_PORT",
-        "FN_SERIAL_PORT_BAUD",
-        "FN_SERIAL_COMMAND",
-        "FN_SERIAL_PROCEED",
-        "FN_SIO_HSTEXT",
-        "FN_NETSIO_ENABLED",
-        "FN_NETSIO_HOST",
+    "FN_SERIAL_PORT",
+    "FN_SERIAL_PORT_BAUD",
+    "FN_SERIAL_COMMAND",
+    "FN_SERIAL_PROCEED",
+    "FN_SIO_HSTEXT",
+    "FN_NETSIO_ENABLED",
+    "FN_NETSIO_HOST",
 #endif
-        "FN_DRIVE1HOST",
-        "FN_DRIVE2HOST",
-        "FN_DRIVE3HOST",
-        "FN_DRIVE4HOST",
-        "FN_DRIVE5HOST",
-        "FN_DRIVE6HOST",
-        "FN_DRIVE7HOST",
-        "FN_DRIVE8HOST",
+    "FN_DRIVE1HOST",
+    "FN_DRIVE2HOST",
+    "FN_DRIVE3HOST",
+    "FN_DRIVE4HOST",
+    "FN_DRIVE5HOST",
+    "FN_DRIVE6HOST",
+    "FN_DRIVE7HOST",
+    "FN_DRIVE8HOST",
 #ifndef ESP_PLATFORM
-        "FN_DRIVE1BROWSER",
-        "FN_DRIVE2BROWSER",
-        "FN_DRIVE3BROWSER",
-        "FN_DRIVE4BROWSER",
-        "FN_DRIVE5BROWSER",
-        "FN_DRIVE6BROWSER",
-        "FN_DRIVE7BROWSER",
-        "FN_DRIVE8BROWSER",
+    "FN_DRIVE1BROWSER",
+    "FN_DRIVE2BROWSER",
+    "FN_DRIVE3BROWSER",
+    "FN_DRIVE4BROWSER",
+    "FN_DRIVE5BROWSER",
+    "FN_DRIVE6BROWSER",
+    "FN_DRIVE7BROWSER",
+    "FN_DRIVE8BROWSER",
 #endif
-        "FN_DRIVE1MOUNT",
-        "FN_DRIVE2MOUNT",
-        "FN_DRIVE3MOUNT",
-        "FN_DRIVE4MOUNT",
-        "FN_DRIVE5MOUNT",
-        "FN_DRIVE6MOUNT",
-        "FN_DRIVE7MOUNT",
-        "FN_DRIVE8MOUNT",
-        "FN_HOST1",
-        "FN_HOST2",
-        "FN_HOST3",
-        "FN_HOST4",
-        "FN_HOST5",
-        "FN_HOST6",
-        "FN_HOST7",
-        "FN_HOST8",
-        "FN_DRIVE1DEVICE",
-        "FN_DRIVE2DEVICE",
-        "FN_DRIVE3DEVICE",
-        "FN_DRIVE4DEVICE",
-        "FN_DRIVE5DEVICE",
-        "FN_DRIVE6DEVICE",
-        "FN_DRIVE7DEVICE",
-        "FN_DRIVE8DEVICE",
-        "FN_HOST1PREFIX",
-        "FN_HOST2PREFIX",
-        "FN_HOST3PREFIX",
-        "FN_HOST4PREFIX",
-        "FN_HOST5PREFIX",
-        "FN_HOST6PREFIX",
-        "FN_HOST7PREFIX",
-        "FN_HOST8PREFIX",
-        "FN_ERRMSG",
-        "FN_HARDWARE_VER",
-        "FN_PRINTER_LIST",
-        "FN_ENCRYPT_PASSPHRASE_ENABLED",
-        "FN_APETIME_ENABLED",
-        "FN_CPM_ENABLED",
-        "FN_CPM_CCP",
-        "FN_ALT_CFG",
-        "FN_PCLINK_ENABLED",
-    };
-
-    stringstream resultstream;
-
-    // Debug_printf("Substituting tag '%s'\n", tag.c_str());
-
-    int tagid;
-    for (tagid = 0; tagid < FN_LASTTAG; tagid++)
+    "FN_DRIVE1MOUNT",
+    "FN_DRIVE2MOUNT",
+    "FN_DRIVE3MOUNT",
+    "FN_DRIVE4MOUNT",
+    "FN_DRIVE5MOUNT",
+    "FN_DRIVE6MOUNT",
+    "FN_DRIVE7MOUNT",
+    "FN_DRIVE8MOUNT",
+    "FN_HOST1",
+    "FN_HOST2",
+    "FN_HOST3",
+    "FN_HOST4",
+    "FN_HOST5",
+    "FN_HOST6",
+    "FN_HOST7",
+    "FN_HOST8",
+    "FN_DRIVE1DEVICE",
+    "FN_DRIVE2DEVICE",
+    "FN_DRIVE3DEVICE",
+    "FN_DRIVE4DEVICE",
+    "FN_DRIVE5DEVICE",
+    "FN_DRIVE6DEVICE",
+    "FN_DRIVE7DEVICE",
+    "FN_DRIVE8DEVICE",
+    "FN_HOST1PREFIX",
+    "FN_HOST2PREFIX",
+    "FN_HOST3PREFIX",
+    "FN_HOST4PREFIX",
+    "FN_HOST5PREFIX",
+    "FN_HOST6PREFIX",
+    "FN_HOST7PREFIX",
+    "FN_HOST8PREFIX",
+    "FN_ERRMSG",
+    "FN_HARDWARE_VER",
+    "FN_PRINTER_LIST",
+    "FN_ENCRYPT_PASSPHRASE_ENABLED",
+    "FN_APETIME_ENABLED",
+    "FN_CPM_ENABLED",
+    "FN_CPM_CCP",
+    "FN_ALT_CFG",
+    "FN_PCLINK_ENABLED",
+};
+
+/* Appends tag values to the page being rendered.
+   Formats them the same way as std::ostream would, without building intermediate strings.
+*/
+class tag_writer
+{
+    string &_out;
+
+public:
+    explicit tag_writer(string &out) : _out(out) {}
+
+    tag_writer &operator<<(const string &s) { _out += s; return *this; }
+    tag_writer &operator<<(const char *s) { _out += s; return *this; }
+    tag_writer &operator<<(char *s) { _out += s; return *this; }
+    tag_writer &operator<<(char c) { _out += c; return *this; }
+    tag_writer &operator<<(signed char c) { _out += (char)c; return *this; }
+    tag_writer &operator<<(unsigned char c) { _out += (char)c; return *this; }
+    tag_writer &operator<<(bool b) { _out += b ? '1' : '0'; return *this; }
+
+    template <typename T>
+    tag_writer &operator<<(T value)
     {
-        if (0 == tag.compare(tagids[tagid]))
-        {
-            break;
-        }
+        static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "unsupported tag value type");
+        char buf[32];
+        int len;
+        if constexpr (std::is_floating_point<T>::value)
+            len = snprintf(buf, sizeof(buf), "%g", (double)value);
+        else if constexpr (std::is_enum<T>::value || std::is_signed<T>::value)
+            len = snprintf(buf, sizeof(buf), "%lld", (long long)value);
+        else
+            len = snprintf(buf, sizeof(buf), "%llu", (unsigned long long)value);
+        _out.append(buf, len);
+        return *this;
     }
+};
+
+int fnHttpServiceParser::find_tag(const char *tag, size_t taglen)
+{
+    for (int tagid = 0; tagid < FN_LASTTAG; tagid++)
+    {
+        if (strncmp(tag, tagids[tagid], taglen) == 0 && tagids[tagid][taglen] == '\0')
+            return tagid;
+    }
+    return -1;
+}
+
+/* Append value of tag to out, unknown tags are replaced by their name
+*/
+void fnHttpServiceParser::substitute_tag(int tagid, const char *tag, size_t taglen, string &out)
+{
+    tag_writer resultstream(out);
 
     int drive_slot, host_slot;
     char disk_id;
@@ -625,11 +665,9 @@ const string fnHttpServiceParser::substitute_tag(const string &tag)
         resultstream << Config.get_config_filename();
         break;
     default:
-        resultstream << tag;
+        out.append(tag, taglen);
         break;
     }
-    // Debug_printf("Substitution result: \"%s\"\n", resultstream.str().c_str());
-    return resultstream.str();
 }
 
 bool fnHttpServiceParser::is_parsable(const char *extension)
@@ -642,37 +680,80 @@ bool fnHttpServiceParser::is_parsable(const char *extension)
     return false;
 }
 
-/* Look for anything between <% and %> tags
- And send that to a routine that looks for suitable substitutions
- Returns string with subtitutions in place
+/* Split source into literal text and tags, tags are resolved to their ids once here
+*/
+void fnHttpServiceTemplate::compile(std::string &&source, int (*find_tag)(const char *tag, size_t taglen))
+{
+    _source = std::move(source);
+    _segments.clear();
+
+    scan(
+        _source,
+        [&](size_t offset, size_t length) { _segments.push_back({(uint32_t)offset, (uint32_t)length, -1}); },
+        // unknown tags are replaced by their name, which is just literal text
+        [&](size_t offset, size_t length) {
+            _segments.push_back({(uint32_t)offset, (uint32_t)length, find_tag(&_source[offset], length)});
+        });
+}
+
+/* Compiled pages by path, with size and modification time of the file they came from
 */
-string fnHttpServiceParser::parse_contents(const string &contents)
+struct compiled_page
+{
+    fnHttpServiceTemplate page;
+    bool compiled = false;  // an empty file compiles to an empty page
+    off_t size;
+    time_t mtime;
+};
+static std::map<string, compiled_page> compiled_pages;
+
+bool fnHttpServiceParser::render_file(FileSystem *fs, const char *path, string &out)
 {
-    std::stringstream ss;
-    size_t pos = 0, x, y;
-    do
+    string fullpath = string(fs->basepath()) + path;
+    struct stat st;
+    if (stat(fullpath.c_str(), &st) != 0)
+        st.st_size = st.st_mtime = -1;
+
+    compiled_page &cp = compiled_pages[path];
+    if (!cp.compiled || cp.size != st.st_size || cp.mtime != st.st_mtime || st.st_size < 0)
     {
-        x = contents.find("<%", pos);
-        if (x == string::npos)
+        Debug_printf("Compiling page '%s'\n", path);
+        FILE *fInput = fs->file_open(path);
+        if (fInput == nullptr)
         {
-            ss << contents.substr(pos);
-            break;
+            compiled_pages.erase(path);
+            return false;
         }
-        // Found opening tag, now find ending
-        y = contents.find("%>", x + 2);
-        if (y == string::npos)
-        {
-            ss << contents.substr(pos);
-            break;
-        }
-        // Now we have starting and ending tags
-        if (x > 0)
-            ss << contents.substr(pos, x - pos);
-        ss << substitute_tag(contents.substr(x + 2, y - x - 2));
-        pos = y + 2;
-    } while (true);
-
-    return ss.str();
+        string source(FileSystem::filesize(fInput), '\0');
+        source.resize(fread(&source[0], 1, source.size(), fInput));
+        fclose(fInput);
+
+        cp.page.compile(std::move(source), find_tag);
+        cp.compiled = true;
+        cp.size = st.st_size;
+        cp.mtime = st.st_mtime;
+    }
+
+    cp.page.render(out, substitute_tag);
+    return true;
+}
+
+/* Look for anything between <% and %> tags
+ And send that to a routine that looks for suitable substitutions
+ Returns string with subtitutions in place
+*/
+string fnHttpServiceParser::parse_contents(std::string_view contents)
+{
+    string result;
+    result.reserve(contents.size());
+    fnHttpServiceTemplate::scan(
+        contents,
+        [&](size_t offset, size_t length) { result.append(contents, offset, length); },
+        [&](size_t offset, size_t length) {
+            const char *tag = contents.data() + offset;
+            substitute_tag(find_tag(tag, length), tag, length, result);
+        });
+    return result;
 }
 
 long fnHttpServiceParser::uptime_seconds()
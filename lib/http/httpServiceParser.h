@@ -9,25 +9,89 @@ If a file has an extention pre-determined to support parsing (see/update
     * The entire file contents are loaded into an in-memory string.
     * Anything with the pattern <%PARSE_TAG%> is replaced with an
     * appropriate value as determined by the 
-    *       string substitute_tag(const string &tag)
+    *       void substitute_tag(int tagid, ...)
     * function.
     * 
-See const fnHttpServiceParser::substitute_tag() for
+See fnHttpServiceParser::substitute_tag() for
 currently supported tags.
 
+Pages served from files are compiled once into a list of literal text spans
+and tag ids (fnHttpServiceTemplate), and compiled again only when the file
+size or modification time changes. Rendering appends literal text and tag
+values to the output buffer, without searching the page again.
+
 */
 #ifndef HTTPSERVICEPARSER_H
 #define HTTPSERVICEPARSER_H
 
+#include <stdint.h>
+
 #include <string>
+#include <string_view>
+#include <vector>
+
+#include "fnFS.h"
+
+class fnHttpServiceTemplate
+{
+    struct segment
+    {
+        uint32_t offset;    // span of source, literal text or tag name
+        uint32_t length;
+        int tagid;          // -1 for literal text
+    };
+
+    std::string _source;
+    std::vector<segment> _segments;
+
+public:
+    // Split source into literal text and anything between <% and %> tags, calls
+    // literal(offset, length) and tag(offset, length) for the parts in order
+    template <typename Literal, typename Tag>
+    static void scan(std::string_view source, Literal &&literal, Tag &&tag)
+    {
+        size_t pos = 0, x, y;
+        while ((x = source.find("<%", pos)) != std::string_view::npos &&
+               (y = source.find("%>", x + 2)) != std::string_view::npos)
+        {
+            if (x > pos)
+                literal(pos, x - pos);
+            tag(x + 2, y - x - 2);
+            pos = y + 2;
+        }
+        if (pos < source.size())
+            literal(pos, source.size() - pos);
+    }
+
+    // Compile page source, find_tag() returns tag id for tag name or -1 if the tag is unknown
+    void compile(std::string &&source, int (*find_tag)(const char *tag, size_t taglen));
+    bool empty() const { return _segments.empty(); }
+
+    // Append rendered page to out, substitute(tagid, tag, taglen, out) appends value of the tag
+    template <typename Substitute>
+    void render(std::string &out, Substitute &&substitute) const
+    {
+        for (const segment &s : _segments)
+        {
+            if (s.tagid < 0)
+                out.append(_source, s.offset, s.length);
+            else
+                substitute(s.tagid, _source.data() + s.offset, s.length, out);
+        }
+    }
+};
 
 class fnHttpServiceParser
 {
     static std::string format_uptime();
     static long uptime_seconds();
-    static const std::string substitute_tag(const std::string &tag);
+    static int find_tag(const char *tag, size_t taglen);
+    static void substitute_tag(int tagid, const char *tag, size_t taglen, std::string &out);
 public:
-    static std::string parse_contents(const std::string &contents);
+    // Append rendered page from file at path on fs to out, false if the file cannot be opened
+    static bool render_file(FileSystem *fs, const char *path, std::string &out);
+    // Page with the tags substituted, for pages which aren't compiled and kept
+    static std::string parse_contents(std::string_view contents);
     static bool is_parsable(const char *extension);
 };
 
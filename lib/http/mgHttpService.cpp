@@ -4,6 +4,7 @@
 
 #ifndef ESP_PLATFORM
 
+#include <algorithm>
 #include <sstream>
 #include <vector>
 #include <map>
@@ -124,57 +125,32 @@ void fnHttpService::set_file_content_type(struct mg_connection *c, const char *f
 */
 void fnHttpService::send_file_parsed(struct mg_connection *c, const char *filename)
 {
-    Debug_printf("Opening file for parsing: '%s'\n", filename);
-
-    _fnwserr err = fnwserr_noerrr;
-
     // Retrieve server state
     serverstate *pState = &fnHTTPD.state; // ops TODO
-    FILE *fInput = pState->_FS->file_open(filename);
 
-    if (fInput == nullptr)
-    {
-        Debug_println("Failed to open file for parsing");
-        err = fnwserr_fileopen;
-    }
-    else
+    // Rendered page, buffer is kept to avoid reallocating it for every request
+    static string contents;
+    contents.clear();
+    if (!fnHttpServiceParser::render_file(pState->_FS, filename, contents))
     {
-        // We're going to load the whole thing into memory, so watch out for big files!
-        size_t sz = FileSystem::filesize(fInput) + 1;
-        char *buf = (char *)calloc(sz, 1);
-        if (buf == NULL)
-        {
-            Debug_printf("Couldn't allocate %u bytes to load file contents!\n", (unsigned)sz);
-            err = fnwserr_memory;
-        }
-        else
-        {
-            fread(buf, 1, sz, fInput);
-            string contents(buf);
-            free(buf);
-            contents = fnHttpServiceParser::parse_contents(contents);
-
-            mg_printf(c, "HTTP/1.1 200 OK\r\n");
-            // Set the response content type
-            set_file_content_type(c, filename);
-            // Set the expected length of the content
-            size_t len = contents.length();
-            mg_printf(c, "Content-Length: %lu\r\n\r\n", (unsigned long)len);
-            // Send parsed content
-            mg_send(c, contents.c_str(), len);
-        }
+        Debug_printf("Failed to open file for parsing: '%s'\n", filename);
+        return_http_error(c, fnwserr_fileopen);
+        return;
     }
 
-    if (fInput != nullptr)
-        fclose(fInput);
-
-    if (err != fnwserr_noerrr)
-        return_http_error(c, err);
+    mg_printf(c, "HTTP/1.1 200 OK\r\n");
+    // Set the response content type
+    set_file_content_type(c, filename);
+    // Set the expected length of the content
+    size_t len = contents.length();
+    mg_printf(c, "Content-Length: %lu\r\n\r\n", (unsigned long)len);
+    // Send parsed content
+    mg_send(c, contents.c_str(), len);
 }
 
 /* Send file content after parsing for replaceable strings
 */
-void fnHttpService::send_file(struct mg_connection *c, const char *filename)
+void fnHttpService::send_file(struct mg_connection *c, const char *filename, struct mg_http_message *hm)
 {
     // Debug_printf("send_file '%s'\r\n", filename);
 
@@ -195,6 +171,13 @@ void fnHttpService::send_file(struct mg_connection *c, const char *filename)
     // Retrieve server state
     serverstate *pState = &fnHTTPD.state; // ops TODO
 
+    const fnHttpAsset *asset = pState->_assets.find(filename);
+    if (asset != nullptr)
+    {
+        fnHttpServiceAssets::send(c, asset, find_mimetype_str(get_extension(filename)), hm);
+        return;
+    }
+
     FILE *fInput = pState->_FS->file_open(fpath.c_str());
     if (fInput == nullptr)
     {
@@ -222,6 +205,43 @@ void fnHttpService::send_file(struct mg_connection *c, const char *filename)
     }
 }
 
+/* Load files under dir (relative to FNWS_FILE_ROOT, empty or ending with '/') into asset cache
+*/
+void fnHttpService::load_assets(serverstate &state, const std::string &dir)
+{
+    string root = FNWS_FILE_ROOT + dir;
+
+    // collect names first, file system has one directory stream only
+    std::vector<std::pair<string, bool>> entries;
+    if (!state._FS->dir_open(root.c_str(), "", 0))
+        return;
+    fsdir_entry_t *dirent;
+    while ((dirent = state._FS->dir_read()) != nullptr)
+        if (dirent->filename[0] != '.')
+            entries.push_back({dirent->filename, dirent->isDir});
+    state._FS->dir_close();
+
+    for (const auto &entry : entries)
+    {
+        string path = dir + entry.first;
+        if (entry.second)
+        {
+            load_assets(state, path + "/");
+            continue;
+        }
+        // parsable files are compiled by fnHttpServiceParser when first requested
+        if (fnHttpServiceParser::is_parsable(get_extension(path.c_str())))
+            continue;
+        FILE *f = state._FS->file_open((FNWS_FILE_ROOT + path).c_str());
+        if (f == nullptr)
+            continue;
+        string content(FileSystem::filesize(f), '\0');
+        content.resize(fread(&content[0], 1, content.size(), f));
+        fclose(f);
+        state._assets.add(path, std::move(content));
+    }
+}
+
 int fnHttpService::redirect_or_result(mg_connection *c, mg_http_message *hm, int result)
 {
     // get "redirect" query variable
@@ -239,6 +259,37 @@ int fnHttpService::redirect_or_result(mg_connection *c, mg_http_message *hm, int
     return result;
 }
 
+// File extension for printer output of given paper type, and whether it's downloaded rather than shown
+static const char *print_output_ext(paper_t paper, bool &sendAsAttachment)
+{
+    sendAsAttachment = true;
+
+    switch (paper)
+    {
+    case RAW:
+        return "bin";
+    case TRIM:
+        return "atascii";
+    case ASCII:
+        sendAsAttachment = false;
+        return "txt";
+    case PDF:
+        return "pdf";
+    case SVG:
+        sendAsAttachment = false;
+        return "svg";
+    case PNG:
+        sendAsAttachment = false;
+        return "png";
+    case HTML:
+    case HTML_ATASCII:
+        sendAsAttachment = false;
+        return "html";
+    default:
+        return "bin";
+    }
+}
+
 int fnHttpService::get_handler_print(struct mg_connection *c)
 {
     Debug_println("Print request handler");
@@ -257,42 +308,8 @@ int fnHttpService::get_handler_print(struct mg_connection *c)
     printer_emu *currentPrinter = printer->getPrinterPtr();
 
     // Build a print output name
-    const char *exts;
-
-    bool sendAsAttachment = true;
-
-    // Choose an extension based on current printer papertype
-    switch (currentPrinter->getPaperType())
-    {
-    case RAW:
-        exts = "bin";
-        break;
-    case TRIM:
-        exts = "atascii";
-        break;
-    case ASCII:
-        exts = "txt";
-        sendAsAttachment = false;
-        break;
-    case PDF:
-        exts = "pdf";
-        break;
-    case SVG:
-        exts = "svg";
-        sendAsAttachment = false;
-        break;
-    case PNG:
-        exts = "png";
-        sendAsAttachment = false;
-        break;
-    case HTML:
-    case HTML_ATASCII:
-        exts = "html";
-        sendAsAttachment = false;
-        break;
-    default:
-        exts = "bin";
-    }
+    bool sendAsAttachment;
+    const char *exts = print_output_ext(currentPrinter->getPaperType(), sendAsAttachment);
 
     string filename = "printout.";
     filename += exts;
@@ -346,6 +363,56 @@ int fnHttpService::get_handler_print(struct mg_connection *c)
     return 0; //ESP_OK;
 }
 
+// Output of the print job in progress, the job is left open
+int fnHttpService::get_handler_print_live(struct mg_connection *c)
+{
+    Debug_println("Live print request handler");
+
+    PRINTER_CLASS *printer = (PRINTER_CLASS *)fnPrinters.get_ptr(0);
+    printer_emu *currentPrinter = printer == nullptr ? nullptr : printer->getPrinterPtr();
+
+    size_t length = 0;
+    std::string tail;
+    FILE *poutput = currentPrinter == nullptr ? nullptr : currentPrinter->provideLiveReadHandle(length, tail);
+    if (poutput == nullptr)
+    {
+        mg_http_reply(c, 404, "", "No print job in progress\n");
+        return -1;
+    }
+
+    bool sendAsAttachment;
+    string filename = "printout.";
+    filename += print_output_ext(currentPrinter->getPaperType(), sendAsAttachment);
+
+    // always shown in browser, it is reloaded as the job goes on
+    mg_printf(c, "HTTP/1.1 200 OK\r\n");
+    set_file_content_type(c, filename.c_str());
+    mg_printf(c, "Cache-Control: no-store\r\n");
+    // chunked, a short read doesn't leave the client waiting for a promised length
+    mg_printf(c, "Transfer-Encoding: chunked\r\n\r\n");
+
+    char *buf = (char *)malloc(FNWS_SEND_BUFF_SIZE);
+    size_t count = 0, total = 0;
+    while (total < length)
+    {
+        count = fread((uint8_t *)buf, 1, std::min((size_t)FNWS_SEND_BUFF_SIZE, length - total), poutput);
+        if (count == 0)
+            break;
+        total += count;
+        mg_http_write_chunk(c, buf, count);
+    }
+    if (tail.size() > 0)
+        mg_http_write_chunk(c, tail.data(), tail.size());
+    mg_http_write_chunk(c, "", 0);
+
+    Debug_printf("Sent %u bytes of print job in progress\n", (unsigned)(total + tail.size()));
+
+    free(buf);
+    fclose(poutput);
+
+    return 0;
+}
+
 int fnHttpService::post_handler_config(struct mg_connection *c, struct mg_http_message *hm)
 {
 
@@ -499,7 +566,7 @@ void fnHttpService::cb(struct mg_connection *c, int ev, void *ev_data)
         else if (mg_http_match_uri(hm, "/"))
         {
             // index handler
-            send_file(c, "index.html");
+            send_file(c, "index.html", hm);
         }
         else if (mg_http_match_uri(hm, "/file"))
         {
@@ -509,7 +576,7 @@ void fnHttpService::cb(struct mg_connection *c, int ev, void *ev_data)
             {
                 strncpy(fname, hm->query.ptr, hm->query.len);
                 fname[hm->query.len] = '\0';
-                send_file(c, fname);
+                send_file(c, fname, hm);
             }
             else
             {
@@ -533,6 +600,11 @@ void fnHttpService::cb(struct mg_connection *c, int ev, void *ev_data)
             // print handler
             get_handler_print(c);
         }
+        else if (mg_http_match_uri(hm, "/print/live"))
+        {
+            // print job in progress handler
+            get_handler_print_live(c);
+        }
         else if (mg_http_match_uri(hm, "/browse/#"))
         {
             // browse handler
@@ -598,6 +670,10 @@ struct mg_mgr * fnHttpService::start_server(serverstate &srvstate)
     // Set filesystem where we expect to find our static files
     srvstate._FS = &fsFlash;
 
+    srvstate._assets.clear();
+    load_assets(srvstate, "");
+    Debug_printf("Web UI: %zu files, %zu bytes cached\n", srvstate._assets.count(), srvstate._assets.bytes());
+
     Debug_printf("Starting web server %s\n", s_listening_address.c_str());
 
     // mg_log_set(MG_LL_DEBUG);
@@ -642,6 +718,7 @@ void fnHttpService::stop()
         Debug_println("Stopping web service");
         // httpd_stop(state.hServer);
         mg_mgr_free(state.hServer);
+        state._assets.clear();
         state._FS = nullptr;
         state.hServer = nullptr;
     }
@@ -1,7 +1,11 @@
 #ifdef BUILD_APPLE
 
+#ifdef ESP_PLATFORM
+#include "esp_heap_caps.h"
+#endif
 #include "mediaType.h"
 #include "utils.h"
+#include "../../include/debug.h"
 
 #include <cstdint>
 #include <cstring>
@@ -29,6 +33,8 @@ bool MediaType::format(uint16_t *responsesize)
 
 void MediaType::unmount()
 {
+    flush();
+    cache_free();
     if (_media_fileh != nullptr)
     {
         fnio::fclose(_media_fileh);
@@ -36,6 +42,171 @@ void MediaType::unmount()
     }
 }
 
+// Set up chunk cache for image of image_size bytes starting at image_offset
+// Returns TRUE if an error condition occurred
+bool MediaType::cache_init(uint32_t image_offset, uint32_t image_size)
+{
+    cache_free();
+#ifdef ESP_PLATFORM
+    _cache = (uint8_t *)heap_caps_malloc(MEDIA_CACHE_CHUNKS * MEDIA_CACHE_CHUNK_SIZE, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
+#else
+    _cache = (uint8_t *)malloc(MEDIA_CACHE_CHUNKS * MEDIA_CACHE_CHUNK_SIZE);
+#endif
+    if (_cache == nullptr)
+    {
+        Debug_printf("\r\nNo RAM for block cache");
+        return true;
+    }
+    for (int i = 0; i < MEDIA_CACHE_CHUNKS; i++)
+        _cache_slots[i] = {MEDIA_CACHE_NO_CHUNK, 0, false};
+    _cache_clock = 0;
+    _cache_last_chunk = MEDIA_CACHE_NO_CHUNK;
+    _cache_image_offset = image_offset;
+    _cache_image_size = image_size;
+    _cache_write_error = false;
+    return false;
+}
+
+void MediaType::cache_free()
+{
+    free(_cache);
+    _cache = nullptr;
+}
+
+void MediaType::cache_invalidate(uint32_t chunk)
+{
+    for (int i = 0; i < MEDIA_CACHE_CHUNKS; i++)
+        if (_cache_slots[i].chunk == chunk)
+            _cache_slots[i] = {MEDIA_CACHE_NO_CHUNK, 0, false};
+}
+
+// Returns TRUE if an error condition occurred
+bool MediaType::cache_write_back(media_cache_slot_t &slot)
+{
+    if (!slot.dirty)
+        return false;
+
+    uint32_t pos = slot.chunk * MEDIA_CACHE_CHUNK_SIZE;
+    size_t len = _cache_image_size - pos < MEDIA_CACHE_CHUNK_SIZE ? _cache_image_size - pos : MEDIA_CACHE_CHUNK_SIZE;
+    uint8_t *data = &_cache[(&slot - _cache_slots) * MEDIA_CACHE_CHUNK_SIZE];
+
+    if (fnio::fseek(_media_fileh, _cache_image_offset + pos, SEEK_SET) != 0 ||
+        fnio::fwrite(data, 1, len, _media_fileh) != len)
+    {
+        // the chunk stays dirty, the next write back tries again
+        Debug_printf("\r\nBlock cache write back error, chunk %lu", (unsigned long)slot.chunk);
+        _cache_write_error = true;
+        return true;
+    }
+    slot.dirty = false;
+    return false;
+}
+
+bool MediaType::cache_write_failed()
+{
+    bool failed = _cache_write_error;
+    _cache_write_error = false;
+    return failed;
+}
+
+// Returns TRUE if an error condition occurred
+bool MediaType::cache_load(media_cache_slot_t &slot, uint32_t chunk)
+{
+    if (cache_write_back(slot))
+        return true;
+
+    uint32_t pos = chunk * MEDIA_CACHE_CHUNK_SIZE;
+    size_t len = _cache_image_size - pos < MEDIA_CACHE_CHUNK_SIZE ? _cache_image_size - pos : MEDIA_CACHE_CHUNK_SIZE;
+    uint8_t *data = &_cache[(&slot - _cache_slots) * MEDIA_CACHE_CHUNK_SIZE];
+
+    slot = {MEDIA_CACHE_NO_CHUNK, 0, false};
+    if (fnio::fread(data, 1, len, _media_fileh) != len)
+        return true;
+    if (len < MEDIA_CACHE_CHUNK_SIZE)
+        memset(&data[len], 0, MEDIA_CACHE_CHUNK_SIZE - len);
+
+    slot = {chunk, ++_cache_clock, false};
+    return false;
+}
+
+uint8_t *MediaType::cache_get(uint32_t chunk, bool for_write)
+{
+    if (_cache == nullptr || chunk * MEDIA_CACHE_CHUNK_SIZE >= _cache_image_size)
+        return nullptr;
+
+    bool sequential = chunk == _cache_last_chunk + 1;
+    _cache_last_chunk = chunk;
+
+    for (int i = 0; i < MEDIA_CACHE_CHUNKS; i++)
+    {
+        if (_cache_slots[i].chunk == chunk)
+        {
+            _cache_slots[i].used = ++_cache_clock;
+            _cache_slots[i].dirty |= for_write;
+            return &_cache[i * MEDIA_CACHE_CHUNK_SIZE];
+        }
+    }
+
+    // Miss: load the chunk, when reading through the image also the ones after it.
+    // They are consecutive in the file, so seek only once.
+    uint32_t count = sequential ? MEDIA_CACHE_READAHEAD : 1;
+    int first_slot = -1;
+    for (uint32_t c = chunk; c < chunk + count && c * MEDIA_CACHE_CHUNK_SIZE < _cache_image_size; c++)
+    {
+        if (c != chunk)
+        {
+            // don't load chunks we already have
+            bool cached = false;
+            for (int i = 0; i < MEDIA_CACHE_CHUNKS; i++)
+                cached |= _cache_slots[i].chunk == c;
+            if (cached)
+                break;
+        }
+
+        int lru = -1;
+        for (int i = 0; i < MEDIA_CACHE_CHUNKS; i++)
+            if (i != first_slot && (lru < 0 || _cache_slots[i].used < _cache_slots[lru].used))
+                lru = i;
+
+        if (c == chunk)
+        {
+            if (cache_write_back(_cache_slots[lru]) ||
+                fnio::fseek(_media_fileh, _cache_image_offset + c * MEDIA_CACHE_CHUNK_SIZE, SEEK_SET) != 0 ||
+                cache_load(_cache_slots[lru], c))
+                return nullptr;
+            first_slot = lru;
+        }
+        else
+        {
+            // read ahead only into clean slots, a write back would move the file position
+            if (_cache_slots[lru].dirty || cache_load(_cache_slots[lru], c))
+                break;
+        }
+    }
+
+    // read ahead chunks must not push out the requested one
+    _cache_slots[first_slot].used = ++_cache_clock;
+    _cache_slots[first_slot].dirty = for_write;
+    return &_cache[first_slot * MEDIA_CACHE_CHUNK_SIZE];
+}
+
+bool MediaType::flush()
+{
+    if (_cache == nullptr)
+        return false;
+
+    bool err = false;
+    for (int i = 0; i < MEDIA_CACHE_CHUNKS; i++)
+        err |= cache_write_back(_cache_slots[i]);
+    if (err)
+        return true;
+
+    // everything is written now, also the chunks whose write back failed before
+    _cache_write_error = false;
+    fnio::fflush(_media_fileh);
+    return false;
+}
+
 mediatype_t MediaType::discover_mediatype(const char *filename)
 {
     //should probably look inside the file to help figure it out
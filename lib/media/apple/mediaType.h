@@ -15,6 +15,21 @@
 
 #define DISK_CTRL_STATUS_CLEAR 0x00
 
+// SmartPort images (PO, DO) are cached in chunks of one 16 sector track, i.e. 8 ProDOS blocks
+#define MEDIA_CACHE_CHUNK_SIZE 4096
+#define MEDIA_CACHE_BLOCKS_PER_CHUNK (MEDIA_CACHE_CHUNK_SIZE / 512)
+#define MEDIA_CACHE_CHUNKS 4
+// chunks loaded at once when reads move on to the next chunk
+#define MEDIA_CACHE_READAHEAD 2
+#define MEDIA_CACHE_NO_CHUNK 0xFFFFFFFF
+
+struct media_cache_slot_t
+{
+    uint32_t chunk;
+    uint32_t used;
+    bool dirty;
+};
+
 enum mediatype_t
 {
     MEDIATYPE_UNKNOWN = 0,
@@ -40,6 +55,28 @@ protected:
     uint16_t _high_score_block_lb = 0; /* High score block (lower bound) to allow write. 1-65535 */
     uint16_t _high_score_block_ub = 0; /* High score block (upper bound) to allow write. 1-65535 */
 
+    // Chunk cache, LRU of MEDIA_CACHE_CHUNKS chunks. Modified chunks are written
+    // back when evicted or by flush().
+    uint8_t *_cache = nullptr;
+    media_cache_slot_t _cache_slots[MEDIA_CACHE_CHUNKS];
+    uint32_t _cache_clock = 0;
+    uint32_t _cache_last_chunk = MEDIA_CACHE_NO_CHUNK;
+    uint32_t _cache_image_offset = 0; // file offset of chunk 0
+    uint32_t _cache_image_size = 0;
+    // A chunk could not be written back and is still dirty, write() reports it once
+    // and flush() until the chunks are written
+    bool _cache_write_error = false;
+
+    bool cache_init(uint32_t image_offset, uint32_t image_size);
+    void cache_free();
+    // Returns chunk data, loading it if needed, or nullptr on error
+    uint8_t *cache_get(uint32_t chunk, bool for_write);
+    void cache_invalidate(uint32_t chunk);
+    bool cache_write_back(media_cache_slot_t &slot);
+    // Returns TRUE, once, if a write back failed since the last call
+    bool cache_write_failed();
+    bool cache_load(media_cache_slot_t &slot, uint32_t chunk);
+
 public:
     // struct
     // {
@@ -81,6 +118,8 @@ public:
     virtual bool read(uint32_t blockNum, uint16_t *count, uint8_t* buffer) = 0;
     // Returns TRUE if an error condition occurred
     virtual bool write(uint32_t blockNum, uint16_t *count, uint8_t* buffer) = 0;
+    // Write out cached changes, returns TRUE if an error condition occurred
+    virtual bool flush();
 
     // virtual uint16_t sector_size(uint16_t sectornum);
     
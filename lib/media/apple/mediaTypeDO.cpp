@@ -11,40 +11,40 @@
 #define BYTES_PER_SECTOR 256
 #define BYTES_PER_TRACK 4096
 
+static_assert(MEDIA_CACHE_CHUNK_SIZE == BYTES_PER_TRACK, "DO cache chunks must be tracks");
+
 // .DO (DOS ordered) disk images are stored in DOS 3.3 logical sector order.
 // Each 512 byte ProDOS block is stored as two 256 byte DOS sectors.
 // see https://retrocomputing.stackexchange.com/questions/15056/converting-apple-ii-prodos-blocks-to-dos-tracks-and-sectors
 
 // This table maps ProDOS blocks to pairs of DOS logical sectors.
-static const int prodos2dos[8][2] = { {0, 14}, {13, 12}, {11, 10}, {9, 8}, {7, 6}, {5, 4}, {3, 2}, {1, 15} };
-
+// static const int prodos2dos[8][2] = { {0, 14}, {13, 12}, {11, 10}, {9, 8}, {7, 6}, {5, 4}, {3, 2}, {1, 15} };
+// precomputed as byte offsets of the two sector halves within the track
+static const uint16_t prodos2dos_offset[BLOCKS_PER_TRACK][2] = {
+    {0 * BYTES_PER_SECTOR, 14 * BYTES_PER_SECTOR}, {13 * BYTES_PER_SECTOR, 12 * BYTES_PER_SECTOR},
+    {11 * BYTES_PER_SECTOR, 10 * BYTES_PER_SECTOR}, {9 * BYTES_PER_SECTOR, 8 * BYTES_PER_SECTOR},
+    {7 * BYTES_PER_SECTOR, 6 * BYTES_PER_SECTOR}, {5 * BYTES_PER_SECTOR, 4 * BYTES_PER_SECTOR},
+    {3 * BYTES_PER_SECTOR, 2 * BYTES_PER_SECTOR}, {1 * BYTES_PER_SECTOR, 15 * BYTES_PER_SECTOR}
+};
+
+// Tracks are cached whole (MEDIA_CACHE_CHUNK_SIZE == BYTES_PER_TRACK), a block is
+// assembled from its two sectors in the cached track.
 bool MediaTypeDO::read(uint32_t blockNum, uint16_t *count, uint8_t* buffer)
 {
-    bool err = false;
-    uint32_t track = blockNum / BLOCKS_PER_TRACK;
-    const int* sectors = prodos2dos[blockNum % BLOCKS_PER_TRACK];
-
-    err = read_sector(track, sectors[0], buffer);
-
-    if (!err)
-        err = read_sector(track, sectors[1], &buffer[BYTES_PER_SECTOR]);
-
-    return err;
-}
-
-bool MediaTypeDO::read_sector(int track, int sector, uint8_t* buffer)
-{
-    Debug_printf("\r\nMediaTypeDO read track %d sector %d", track, sector);
-    
-    bool err = false;
-    uint32_t offset = (track * BYTES_PER_TRACK) + (sector * BYTES_PER_SECTOR);
-
-    err = fnio::fseek(_media_fileh, offset, SEEK_SET) != 0;
+    if (blockNum >= num_blocks)
+    {
+        Debug_printf("\r\nread block BEYOND END %lu > %lu", blockNum, num_blocks);
+        return true;
+    }
 
-    if (!err)
-        err = fnio::fread(buffer, 1, BYTES_PER_SECTOR, _media_fileh) != BYTES_PER_SECTOR;
+    uint8_t *track = cache_get(blockNum / BLOCKS_PER_TRACK, false);
+    if (track == nullptr)
+        return true;
 
-    return err;
+    const uint16_t *sectors = prodos2dos_offset[blockNum % BLOCKS_PER_TRACK];
+    memcpy(buffer, &track[sectors[0]], BYTES_PER_SECTOR);
+    memcpy(&buffer[BYTES_PER_SECTOR], &track[sectors[1]], BYTES_PER_SECTOR);
+    return false;
 }
 
 bool MediaTypeDO::write(uint32_t blockNum, uint16_t *count, uint8_t* buffer)
@@ -56,31 +56,18 @@ bool MediaTypeDO::write(uint32_t blockNum, uint16_t *count, uint8_t* buffer)
         return true;
     }
 
-    bool err = false;
-    uint32_t track = blockNum / BLOCKS_PER_TRACK;
-    const int* sectors = prodos2dos[blockNum % BLOCKS_PER_TRACK];
-
-    err = write_sector(track, sectors[0], buffer);
-
-    if (!err)
-        err = write_sector(track, sectors[1], &buffer[BYTES_PER_SECTOR]);
-
-    return err;
-}
-
-bool MediaTypeDO::write_sector(int track, int sector, uint8_t* buffer)
-{
-    Debug_printf("\r\nMediaTypeDO write track %d sector %d", track, sector);
-
-    bool err = false;
-    uint32_t offset = (track * BYTES_PER_TRACK) + (sector * BYTES_PER_SECTOR);
-
-    err = fnio::fseek(_media_fileh, offset, SEEK_SET) != 0;
+    // an earlier write that was cached could not be written to the file
+    if (cache_write_failed())
+        return true;
 
-    if (!err)
-        err = fnio::fwrite(buffer, 1, BYTES_PER_SECTOR, _media_fileh) != BYTES_PER_SECTOR;
+    uint8_t *track = cache_get(blockNum / BLOCKS_PER_TRACK, true);
+    if (track == nullptr)
+        return true;
 
-    return err;
+    const uint16_t *sectors = prodos2dos_offset[blockNum % BLOCKS_PER_TRACK];
+    memcpy(&track[sectors[0]], buffer, BYTES_PER_SECTOR);
+    memcpy(&track[sectors[1]], &buffer[BYTES_PER_SECTOR], BYTES_PER_SECTOR);
+    return false;
 }
 
 bool MediaTypeDO::format(uint16_t *responsesize)
@@ -104,6 +91,8 @@ mediatype_t MediaTypeDO::mount(fnFile *f, uint32_t disksize)
     diskiiemulation = false;
     _media_fileh = f;
     num_blocks = disksize / BYTES_PER_BLOCK;
+    if (cache_init(0, disksize))
+        return MEDIATYPE_UNKNOWN;
     return MEDIATYPE_DO;
 }
 
@@ -7,10 +7,6 @@
 
 class MediaTypeDO : public MediaType
 {
-private:
-    bool read_sector(int track, int sector, uint8_t* buffer);
-    bool write_sector(int track, int sector, uint8_t* buffer);
-
 public:
     virtual bool read(uint32_t blockNum, uint16_t *count, uint8_t* buffer) override;
     virtual bool write(uint32_t blockNum, uint16_t *count, uint8_t* buffer) override;
@@ -5,6 +5,7 @@
 #endif
 #include "mediaTypeDSK.h"
 #include "../../include/debug.h"
+#include "compat_esp.h" // empty IRAM_ATTR macro for FujiNet-PC
 #include <string.h>
 
 
@@ -22,6 +23,25 @@
 // forward reference
 static void serialise_track(uint8_t *dest, const uint8_t *src, uint8_t track_number, bool is_prodos);
 
+MediaTypeDSK::~MediaTypeDSK()
+{
+    free_buffers();
+}
+
+void MediaTypeDSK::free_buffers()
+{
+    free(dsk);
+    dsk = nullptr;
+    free(trk_cache);
+    trk_cache = nullptr;
+}
+
+void MediaTypeDSK::unmount()
+{
+    MediaTypeWOZ::unmount();
+    free_buffers();
+}
+
 mediatype_t MediaTypeDSK::mount(fnFile *f, uint32_t disksize)
 {
     switch (disksize) {
@@ -40,12 +60,22 @@ mediatype_t MediaTypeDSK::mount(fnFile *f, uint32_t disksize)
     num_tracks = disksize / BYTES_PER_TRACK;
 
     // allocated SPRAM
+    // sectors are kept, tracks are nibblized on demand by get_track()
     const size_t dsk_image_size = num_tracks * BYTES_PER_TRACK;
+    free_buffers();
 #ifdef ESP_PLATFORM
-    uint8_t *dsk = (uint8_t*)heap_caps_malloc(dsk_image_size, MALLOC_CAP_SPIRAM);
+    dsk = (uint8_t*)heap_caps_malloc(dsk_image_size, MALLOC_CAP_SPIRAM);
+    trk_cache = (uint8_t *)heap_caps_malloc(DSK_TRACK_CACHE_SIZE * WOZ1_NUM_BLKS * 512, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
 #else
-	uint8_t *dsk = (uint8_t*)malloc(dsk_image_size);
+	dsk = (uint8_t*)malloc(dsk_image_size);
+    trk_cache = (uint8_t *)malloc(DSK_TRACK_CACHE_SIZE * WOZ1_NUM_BLKS * 512);
 #endif
+    if (dsk == nullptr || trk_cache == nullptr)
+    {
+        Debug_printf("\nNo RAM allocated!");
+        free_buffers();
+        return MEDIATYPE_UNKNOWN;
+    }
     if (fnio::fseek(f, 0, SEEK_SET) != 0)
         return MEDIATYPE_UNKNOWN;
     size_t bytes_read = fnio::fread(dsk, 1, dsk_image_size, f);
@@ -54,9 +84,9 @@ mediatype_t MediaTypeDSK::mount(fnFile *f, uint32_t disksize)
 
     dsk2woz_info();
     dsk2woz_tmap();
-	dsk2woz_tracks(dsk);
+	if (dsk2woz_tracks())
+        return MEDIATYPE_UNKNOWN;
 
-    free(dsk);
     return MEDIATYPE_WOZ;
 }
 
@@ -94,7 +124,7 @@ void MediaTypeDSK::dsk2woz_tmap()
 #endif
 }
 
-bool MediaTypeDSK::dsk2woz_tracks(uint8_t *dsk)
+bool MediaTypeDSK::dsk2woz_tracks()
 {    // depend upon little endian-ness
 
     // woz1 track data organized as:
@@ -107,47 +137,61 @@ bool MediaTypeDSK::dsk2woz_tracks(uint8_t *dsk)
     // +6653	uint8	    Splice Bit Count	Bit count of splice nibble (write hint).
     // +6654	uint16		Reserved for future use.
 
-    // Debug_printf("\nStart Block, Block Count, Bit Count");
-    
 	Debug_printf("\nMediaTypeDSK is_prodos: %s", _mediatype == MEDIATYPE_PO ? "Y" : "N");
 
-	// TODO: adapt this to that
-	// Write out all tracks.
+    // Every track has the same layout, encode track 0 to learn its length.
+    // It stays in the cache, it is the first one the head visits.
+    memset(cache_track, 0xff, sizeof(cache_track));
+    memset(cache_used, 0, sizeof(cache_used));
+    cache_clock = 0;
+
+    uint8_t *temp_ptr = trk_cache;
+    memset(temp_ptr, 0, WOZ1_NUM_BLKS * 512);
+    serialise_track(temp_ptr, dsk, 0, _mediatype == MEDIATYPE_PO);
+    cache_track[0] = 0;
+    cache_used[0] = ++cache_clock;
+
+    temp_ptr += WOZ1_TRACK_LEN;
+    uint16_t bytes_used = temp_ptr[0] + (temp_ptr[1] << 8);
+    temp_ptr += sizeof(uint16_t);
+    uint16_t bit_count = temp_ptr[0] + (temp_ptr[1] << 8);
+    Debug_printf("\nDSK tracks: %d bytes containing %d bits", bytes_used, bit_count);
+
 	for (size_t c = 0; c < num_tracks; c++)
 	{
-		uint16_t bytes_used;
-		uint16_t bit_count;
-#ifdef ESP_PLATFORM
-		uint8_t* temp_ptr = (uint8_t *)heap_caps_malloc(WOZ1_NUM_BLKS * 512, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
-#else
-		uint8_t* temp_ptr = (uint8_t *)malloc(WOZ1_NUM_BLKS * 512);
-#endif
-		if (temp_ptr != nullptr)
-		{
-			trk_ptrs[c] = temp_ptr;
-			memset(trk_ptrs[c], 0, WOZ1_NUM_BLKS * 512);
-			serialise_track(trk_ptrs[c], &dsk[c * 16 * 256], c, _mediatype == MEDIATYPE_PO);
-			temp_ptr += WOZ1_TRACK_LEN;
-			bytes_used = temp_ptr[0] + (temp_ptr[1] << 8);
-			temp_ptr += sizeof(uint16_t);
-			bit_count = temp_ptr[0] + (temp_ptr[1] << 8);
-			trks[c].block_count = WOZ1_NUM_BLKS; //bytes_used / 512;
-			// if (bytes_used % 512)
-			// 	trks[c].block_count++;
-			trks[c].bit_count = bit_count;
-			Debug_printf("\nStored %d bytes containing %d bits of track %d into location %lu", bytes_used, bit_count, c, trk_ptrs[c]);
-			Debug_printf(" -- %02x %02x %02x %02x %02x", trk_ptrs[c][0], trk_ptrs[c][1], trk_ptrs[c][2], trk_ptrs[c][3], trk_ptrs[c][4] );
-		}
-		else
-		{
-			Debug_printf("\nNo RAM allocated!");
-			free(temp_ptr);
-			return true;
-            }
+        trk_ptrs[c] = nullptr; // owned by trk_cache, see get_track()
+        trks[c].block_count = WOZ1_NUM_BLKS; //bytes_used / 512;
+        trks[c].bit_count = bit_count;
 	}
 	return false;
 }
 
+uint8_t * IRAM_ATTR MediaTypeDSK::get_track(int t)
+{
+    uint8_t track = tmap[t];
+    if (track == 255 || trk_cache == nullptr)
+        return nullptr;
+
+    int slot = 0;
+    for (int i = 0; i < DSK_TRACK_CACHE_SIZE; i++)
+    {
+        if (cache_track[i] == track)
+        {
+            cache_used[i] = ++cache_clock;
+            return &trk_cache[i * WOZ1_NUM_BLKS * 512];
+        }
+        if (cache_used[i] < cache_used[slot])
+            slot = i;
+    }
+
+    // replace least recently used track, the image is read only so there is nothing to write back
+    uint8_t *dest = &trk_cache[slot * WOZ1_NUM_BLKS * 512];
+    serialise_track(dest, &dsk[track * BYTES_PER_TRACK], track, _mediatype == MEDIATYPE_PO);
+    cache_track[slot] = track;
+    cache_used[slot] = ++cache_clock;
+    return dest;
+}
+
 // ================ code below from TomHarte dsk2woz program ===============
 /* MIT License
 
@@ -295,7 +339,7 @@ SOFTWARE.
 	@param value An indicator of the bit to write. If this is zero then a 0 is written; otherwise a 1 is written.
 	@return The position immediately after the bit.
 */
-static size_t write_bit(uint8_t *buffer, size_t position, int value) {
+static size_t IRAM_ATTR write_bit(uint8_t *buffer, size_t position, int value) {
 	buffer[position >> 3] |= (value ? 0x80 : 0x00) >> (position & 7);
 	return position + 1;
 }
@@ -310,7 +354,7 @@ static size_t write_bit(uint8_t *buffer, size_t position, int value) {
 	@param value The byte to write.
 	@return The position immediately after the byte.
 */
-static size_t write_byte(uint8_t *buffer, size_t position, int value) {
+static size_t IRAM_ATTR write_byte(uint8_t *buffer, size_t position, int value) {
 	const size_t shift = position & 7;
 	const size_t byte_position = position >> 3;
 
@@ -328,7 +372,7 @@ static size_t write_byte(uint8_t *buffer, size_t position, int value) {
 	@param value The byte to encode and write.
 	@return The position immediately after the encoded byte.
 */
-static size_t write_4_and_4(uint8_t *buffer, size_t position, int value) {
+static size_t IRAM_ATTR write_4_and_4(uint8_t *buffer, size_t position, int value) {
 	position = write_byte(buffer, position, (value >> 1) | 0xaa);
 	position = write_byte(buffer, position, value | 0xaa);
 	return position;
@@ -341,64 +385,53 @@ static size_t write_4_and_4(uint8_t *buffer, size_t position, int value) {
 	@param position The position to write at.
 	@return The position immediately after the sync word.
 */
-static size_t write_sync(uint8_t *buffer, size_t position) {
+static size_t IRAM_ATTR write_sync(uint8_t *buffer, size_t position) {
 	position = write_byte(buffer, position, 0xff);
 	return position + 2; // Skip two bits, i.e. leave them as 0s.
 }
 
+// 6-bit values to disk bytes
+static const uint8_t DRAM_ATTR six_and_two_mapping[64] = {
+	0x96, 0x97, 0x9a, 0x9b, 0x9d, 0x9e, 0x9f, 0xa6,
+	0xa7, 0xab, 0xac, 0xad, 0xae, 0xaf, 0xb2, 0xb3,
+	0xb4, 0xb5, 0xb6, 0xb7, 0xb9, 0xba, 0xbb, 0xbc,
+	0xbd, 0xbe, 0xbf, 0xcb, 0xcd, 0xce, 0xcf, 0xd3,
+	0xd6, 0xd7, 0xd9, 0xda, 0xdb, 0xdc, 0xdd, 0xde,
+	0xdf, 0xe5, 0xe6, 0xe7, 0xe9, 0xea, 0xeb, 0xec,
+	0xed, 0xee, 0xef, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6,
+	0xf7, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff
+};
+
+// bottom two bits of a byte, swapped
+static const uint8_t DRAM_ATTR bit_reverse[4] = {0, 2, 1, 3};
+
 /*!
-	Converts a 256-byte source buffer into the 343 byte values that
-	contain the Apple 6-and-2 encoding of that buffer.
+	Appends the Apple 6-and-2 encoding of a 256-byte buffer: 343 disk bytes,
+	86 bytes of shuffled and combined bottom two bits, 256 bytes of the
+	remaining six bits and a checksum. Each value is exclusive ORed with
+	the one before it and mapped to a disk byte in a single pass.
 
-	@param dest The at-least-343 byte buffer to which the encoded sector is written.
+	@param buffer The buffer to write into.
+	@param position The position to write at.
 	@param src The 256-byte source data.
+	@return The position immediately after the encoded sector.
 */
-static void encode_6_and_2(uint8_t *dest, const uint8_t *src) {
-	const uint8_t six_and_two_mapping[] = {
-		0x96, 0x97, 0x9a, 0x9b, 0x9d, 0x9e, 0x9f, 0xa6,
-		0xa7, 0xab, 0xac, 0xad, 0xae, 0xaf, 0xb2, 0xb3,
-		0xb4, 0xb5, 0xb6, 0xb7, 0xb9, 0xba, 0xbb, 0xbc,
-		0xbd, 0xbe, 0xbf, 0xcb, 0xcd, 0xce, 0xcf, 0xd3,
-		0xd6, 0xd7, 0xd9, 0xda, 0xdb, 0xdc, 0xdd, 0xde,
-		0xdf, 0xe5, 0xe6, 0xe7, 0xe9, 0xea, 0xeb, 0xec,
-		0xed, 0xee, 0xef, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6,
-		0xf7, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff
-	};
-
-	// Fill in byte values: the first 86 bytes contain shuffled
-	// and combined copies of the bottom two bits of the sector
-	// contents; the 256 bytes afterwards are the remaining
-	// six bits.
-	const uint8_t bit_reverse[] = {0, 2, 1, 3};
-	for(size_t c = 0; c < 84; ++c) {
-		dest[c] =
+static size_t IRAM_ATTR write_6_and_2(uint8_t *buffer, size_t position, const uint8_t *src) {
+	uint8_t previous = 0;
+	for(size_t c = 0; c < 86; ++c) {
+		uint8_t value =
 			bit_reverse[src[c]&3] |
-			(bit_reverse[src[c + 86]&3] << 2) |
-			(bit_reverse[src[c + 172]&3] << 4);
+			(bit_reverse[src[c + 86]&3] << 2);
+		if(c < 84) value |= bit_reverse[src[c + 172]&3] << 4;
+		position = write_byte(buffer, position, six_and_two_mapping[value ^ previous]);
+		previous = value;
 	}
-	dest[84] =
-		(bit_reverse[src[84]&3] << 0) |
-		(bit_reverse[src[170]&3] << 2);
-	dest[85] =
-		(bit_reverse[src[85]&3] << 0) |
-		(bit_reverse[src[171]&3] << 2);
-
 	for(size_t c = 0; c < 256; ++c) {
-		dest[86 + c] = src[c] >> 2;
-	}
-
-	// Exclusive OR each byte with the one before it.
-	dest[342] = dest[341];
-	size_t location = 342;
-	while(location > 1) {
-		--location;
-		dest[location] ^= dest[location-1];
-	}
-
-	// Map six-bit values up to full bytes.
-	for(size_t c = 0; c < 343; ++c) {
-		dest[c] = six_and_two_mapping[dest[c]];
+		const uint8_t value = src[c] >> 2;
+		position = write_byte(buffer, position, six_and_two_mapping[value ^ previous]);
+		previous = value;
 	}
+	return write_byte(buffer, position, six_and_two_mapping[previous]);
 }
 
 /*!
@@ -411,7 +444,7 @@ static void encode_6_and_2(uint8_t *dest, const uint8_t *src) {
 	@param track_number The track number to encode into this track.
 	@param is_prodos @c true if the DSK image is in Pro-DOS order; @c false if it is in DOS 3.3 order.
 */
-static void serialise_track(uint8_t *dest, const uint8_t *src, uint8_t track_number, bool is_prodos) {
+static void IRAM_ATTR serialise_track(uint8_t *dest, const uint8_t *src, uint8_t track_number, bool is_prodos) {
 	size_t track_position = 0;	// This is the track position **in bits**.
 	memset(dest, 0, 6646);
 
@@ -461,11 +494,7 @@ static void serialise_track(uint8_t *dest, const uint8_t *src, uint8_t track_num
 		const int logical_sector = (sector == 15) ? 15 : ((sector * (is_prodos ? 8 : 7)) % 15);
 
 		// Sector contents.
-		uint8_t contents[343];
-		encode_6_and_2(contents, &src[logical_sector * 256]);
-		for(size_t c = 0; c < sizeof(contents); ++c) {
-			track_position = write_byte(dest, track_position, contents[c]);			
-		}
+		track_position = write_6_and_2(dest, track_position, &src[logical_sector * 256]);
 
 		// Epilogue.
 		track_position = write_byte(dest, track_position, 0xde);
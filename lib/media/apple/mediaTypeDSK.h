@@ -14,20 +14,37 @@
 //     uint32_t bit_count;
 // };
 
+// Number of nibblized tracks kept around, older ones are re-encoded when visited again
+#define DSK_TRACK_CACHE_SIZE 8
 
 class MediaTypeDSK  : public MediaTypeWOZ
 {
 private:
     size_t num_tracks = 0;
 
+    // DSK image sectors, tracks are nibblized from it when the head first moves there
+    uint8_t *dsk = nullptr;
+
+    // LRU of nibblized tracks
+    uint8_t *trk_cache = nullptr;
+    uint8_t cache_track[DSK_TRACK_CACHE_SIZE];
+    uint32_t cache_used[DSK_TRACK_CACHE_SIZE];
+    uint32_t cache_clock = 0;
+
     void dsk2woz_info();
     void dsk2woz_tmap();
-    bool dsk2woz_tracks(uint8_t *dsk); 
+    bool dsk2woz_tracks();
+    void free_buffers();
 
 public:
+    ~MediaTypeDSK();
 
     virtual mediatype_t mount(fnFile *f, uint32_t disksize) override;
-    // virtual void unmount() override;
+    virtual void unmount() override;
+
+    // Nibblized track at quarter track position t, encoded on first use.
+    // Hides MediaTypeWOZ::get_track(), called from the Disk II head step interrupt.
+    uint8_t *get_track(int t);
 
     // static bool create(FILE *f, uint32_t numBlock);
 };
@@ -6,65 +6,70 @@
 #include "utils.h"
 #include "../../include/debug.h"
 
+#define BLOCK_SIZE 512
+
 bool MediaTypePO::read(uint32_t blockNum, uint16_t *count, uint8_t* buffer)
 {
-    size_t readsize = *count;
-if (blockNum == 0 || blockNum != last_block_num + 1) // example optimization, only do seek if not reading next block -tschak
-  {
-     if (fnio::fseek(_media_fileh, (blockNum * readsize) + offset, SEEK_SET))
-    {
-        reset_seek_opto();
+    if (*count != BLOCK_SIZE || blockNum >= num_blocks)
         return true;
-    }
-  }
 
-  if (high_score_enabled && blockNum >= _high_score_block_lb && blockNum <= _high_score_block_ub)
-    last_block_num = INVALID_SECTOR_VALUE; // try to invalidate cache if game re-reads hs table
-  else
-    last_block_num = blockNum;
+    // blocks come from the track sized chunk cache
+    uint8_t *chunk = cache_get(blockNum / MEDIA_CACHE_BLOCKS_PER_CHUNK, false);
+    if (chunk == nullptr)
+        return true;
 
-  readsize = fnio::fread((unsigned char *)buffer, 1, readsize, _media_fileh); // Reading block from SD Card
-  return (readsize != *count);
+    memcpy(buffer, &chunk[(blockNum % MEDIA_CACHE_BLOCKS_PER_CHUNK) * BLOCK_SIZE], BLOCK_SIZE);
+    return false;
 }
 
 bool MediaTypePO::write(uint32_t blockNum, uint16_t *count, uint8_t* buffer)
 {
     size_t writesize = *count;
 
+    if (writesize != BLOCK_SIZE || blockNum >= num_blocks)
+        return true;
+
     if (high_score_enabled && blockNum >= _high_score_block_lb && blockNum <= _high_score_block_ub)
     {
+        // high score blocks bypass the cache, they go through their own writable file handle
+        cache_invalidate(blockNum / MEDIA_CACHE_BLOCKS_PER_CHUNK);
+
         Debug_printf("high score: Swapping file handles\r\n");
         oldFileh = _media_fileh;
         hsFileh = _media_host->fnfile_open(_disk_filename, _disk_filename, strlen(_disk_filename) +1, "rb+");
         _media_fileh = hsFileh;
-    }
 
-    if (blockNum != last_block_num + 1) // example optimization, only do seek if not writing next block -tschak
-    {
-         if (fnio::fseek(_media_fileh, (blockNum * writesize) + offset, SEEK_SET))
-        {
-            reset_seek_opto();
-            return true;
-        }
-    }
-    last_block_num = blockNum;
-    writesize = fnio::fwrite((unsigned char *)buffer, 1, writesize, _media_fileh);
-    if (writesize != *count)
-    {
-       reset_seek_opto();
-       return true;
-    }
+        bool err = fnio::fseek(_media_fileh, (blockNum * writesize) + offset, SEEK_SET) != 0 ||
+                   fnio::fwrite((unsigned char *)buffer, 1, writesize, _media_fileh) != writesize;
 
-    if (high_score_enabled && blockNum >= _high_score_block_lb && blockNum <= _high_score_block_ub)
-    {
         Debug_printf("high score: Reverting file handles.\r\n");
         if (hsFileh != nullptr)
             fnio::fclose(hsFileh);
 
         _media_fileh = oldFileh;
-        last_block_num = INVALID_SECTOR_VALUE; // Invalidate cache
+        return err;
+    }
+
+    if (high_score_enabled)
+    {
+        // A high score disk is reported writable even when its image is open read only, so
+        // other blocks are written through: a write the file can't take fails right away
+        // instead of being cached and lost on write back.
+        cache_invalidate(blockNum / MEDIA_CACHE_BLOCKS_PER_CHUNK);
+        return fnio::fseek(_media_fileh, (blockNum * writesize) + offset, SEEK_SET) != 0 ||
+               fnio::fwrite((unsigned char *)buffer, 1, writesize, _media_fileh) != writesize;
     }
 
+    // an earlier write that was cached could not be written to the file
+    if (cache_write_failed())
+        return true;
+
+    // written to the cache, goes to the file when the chunk is evicted or flushed
+    uint8_t *chunk = cache_get(blockNum / MEDIA_CACHE_BLOCKS_PER_CHUNK, true);
+    if (chunk == nullptr)
+        return true;
+
+    memcpy(&chunk[(blockNum % MEDIA_CACHE_BLOCKS_PER_CHUNK) * BLOCK_SIZE], buffer, BLOCK_SIZE);
     return false;
 }
 
@@ -103,6 +108,8 @@ mediatype_t MediaTypePO::mount(fnFile *f, uint32_t disksize)
   _media_fileh = f;
   disksize -= offset;
   num_blocks = disksize/512;
+  if (cache_init(offset, num_blocks * BLOCK_SIZE))
+    return MEDIATYPE_UNKNOWN;
   return MEDIATYPE_PO;
 }
 
@@ -8,7 +8,6 @@
 class MediaTypePO : public MediaType
 {
 private:
-    uint32_t last_block_num = 0xFFFFFFFF;
     uint32_t offset = 0;
 public:
     virtual bool read(uint32_t blockNum, uint16_t *count, uint8_t* buffer) override;
@@ -23,7 +22,6 @@ public:
     // static bool create(FILE *f, uint32_t numBlock);
 
     size_t size() {return _media_num_sectors;}
-    void reset_seek_opto() {last_block_num = 0xFFFFFFFF;};
 };
 
 
@@ -18,11 +18,8 @@ mediatype_t MediaTypeWOZ::mount(fnFile *f, uint32_t disksize)
     if (wozX_check_header())
         return MEDIATYPE_UNKNOWN;
 
-    // work through INFO chunk
-    if (wozX_read_info())
-        return MEDIATYPE_UNKNOWN;
-
-    if (wozX_read_tmap())
+    // work through INFO and TMAP chunks
+    if (wozX_read_chunks())
         return MEDIATYPE_UNKNOWN;
         
     // read TRKS table
@@ -47,17 +44,33 @@ mediatype_t MediaTypeWOZ::mount(fnFile *f, uint32_t disksize)
 void MediaTypeWOZ::unmount()
 {
     MediaType::unmount();
+    free(trk_arena);
+    trk_arena = nullptr;
     for (int i = 0; i < MAX_TRACKS; i++)
-    {
-        if (trk_ptrs[i] != nullptr)
-            free(trk_ptrs[i]);
-    }
+        trk_ptrs[i] = nullptr;
+}
+
+uint8_t *MediaTypeWOZ::alloc_arena(size_t size)
+{
+    free(trk_arena);
+#ifdef ESP_PLATFORM
+    trk_arena = (uint8_t *)heap_caps_malloc(size, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
+#else
+    trk_arena = (uint8_t *)malloc(size);
+#endif
+    if (trk_arena == nullptr)
+        Debug_printf("\nNo RAM allocated!");
+    return trk_arena;
 }
 
 bool MediaTypeWOZ::wozX_check_header()
 {
-    char hdr[12];
-    fnio::fread(&hdr, sizeof(char), 12, _media_fileh);
+    char hdr[WOZ_HEADER_LEN];
+    if (fnio::fread(&hdr, sizeof(char), WOZ_HEADER_LEN, _media_fileh) != WOZ_HEADER_LEN)
+    {
+        Debug_printf("\nError reading WOZ header");
+        return true;
+    }
     if (hdr[0] == 'W' && hdr[1] == 'O' && hdr[2] == 'Z')
     {
         woz_version = hdr[3];
@@ -79,21 +92,30 @@ bool MediaTypeWOZ::wozX_check_header()
     return false;  
 }
 
-bool MediaTypeWOZ::wozX_read_info()
+// Read INFO, TMAP and the TRKS chunk header with one read and check they are where
+// WOZ1/WOZ2 put them
+bool MediaTypeWOZ::wozX_read_chunks()
 {
-    if (fnio::fseek(_media_fileh, 12, SEEK_SET))
+    uint8_t chunks[WOZ_TRKS_DATA_OFFSET - WOZ_INFO_OFFSET];
+    if (fnio::fseek(_media_fileh, WOZ_INFO_OFFSET, SEEK_SET) ||
+        fnio::fread(chunks, 1, sizeof(chunks), _media_fileh) != sizeof(chunks))
     {
-        Debug_printf("\nError seeking INFO chunk");
+        Debug_printf("\nError reading WOZ chunks");
         return true;
     }
-    uint32_t chunk_id, chunk_size;
-    fnio::fread(&chunk_id, sizeof(chunk_id), 1, _media_fileh);
-    Debug_printf("\nINFO Chunk ID: %08x", chunk_id);
-    fnio::fread(&chunk_size, sizeof(chunk_size), 1, _media_fileh);
-    Debug_printf("\nINFO Chunk size: %d", chunk_size);
-    Debug_printf("\nNow at byte %d", fnio::ftell(_media_fileh));
-    // could read a whole bunch of other stuff  ...
 
+    const uint8_t *info = &chunks[0];
+    const uint8_t *tmap_chunk = &chunks[WOZ_TMAP_OFFSET - WOZ_INFO_OFFSET];
+    const uint8_t *trks_chunk = &chunks[WOZ_TRKS_OFFSET - WOZ_INFO_OFFSET];
+    if (memcmp(info, "INFO", 4) || memcmp(tmap_chunk, "TMAP", 4) || memcmp(trks_chunk, "TRKS", 4))
+    {
+        Debug_printf("\nUnexpected WOZ chunk layout");
+        return true;
+    }
+    trks_chunk_size = trks_chunk[4] | (trks_chunk[5] << 8) | (trks_chunk[6] << 16) | ((uint32_t)trks_chunk[7] << 24);
+    Debug_printf("\nTRKS Chunk size: %lu", (unsigned long)trks_chunk_size);
+
+    // INFO chunk data starts after 8 bytes of chunk id and size
     switch (woz_version)
     {
     case WOZ1:
@@ -101,45 +123,17 @@ bool MediaTypeWOZ::wozX_read_info()
         optimal_bit_timing = WOZ1_BIT_TIME; // 4 x 8 x 125 ns = 4 us
         break;
     case WOZ2:
-        // but jump to offset 44 to get the track size
-        {
-            // jump to offset 39 to get bit timing
-            fnio::fseek(_media_fileh, 39, SEEK_CUR);
-            uint8_t bit_timing;
-            fnio::fread(&bit_timing, sizeof(uint8_t), 1, _media_fileh);
-            optimal_bit_timing = bit_timing;
-            Debug_printf("\nWOZ2 Optimal Bit Timing = 125 ns X %d = %d ns",optimal_bit_timing, (int)optimal_bit_timing * 125);
-            // and jump to offset 44 to get the track size
-            fnio::fseek(_media_fileh, 4, SEEK_CUR);
-            uint16_t largest_track;
-            fnio::fread(&largest_track, sizeof(uint16_t), 1, _media_fileh);
-            num_blocks = largest_track;
-        }
+        // bit timing at offset 39, largest track at offset 44
+        optimal_bit_timing = info[8 + 39];
+        Debug_printf("\nWOZ2 Optimal Bit Timing = 125 ns X %d = %d ns",optimal_bit_timing, (int)optimal_bit_timing * 125);
+        num_blocks = info[8 + 44] | (info[8 + 45] << 8);
         break;
     default:
         Debug_printf("\nWOZ version %c not supported", woz_version);
         return true;
     }
 
-    return false;
-}
-
-bool MediaTypeWOZ::wozX_read_tmap()
-{ // read TMAP
-    if (fnio::fseek(_media_fileh, 80, SEEK_SET))
-    {
-        Debug_printf("\nError seeking TMAP chunk");
-        return true;
-    }
-
-    uint32_t chunk_id, chunk_size;
-    fnio::fread(&chunk_id, sizeof(chunk_id), 1, _media_fileh);
-    Debug_printf("\nTMAP Chunk ID: %08x", chunk_id);
-    fnio::fread(&chunk_size, sizeof(chunk_size), 1, _media_fileh);
-    Debug_printf("\nTMAP Chunk size: %d", chunk_size);
-    Debug_printf("\nNow at byte %d", fnio::ftell(_media_fileh));
-
-    fnio::fread(&tmap, sizeof(tmap[0]), MAX_TRACKS, _media_fileh);
+    memcpy(tmap, &tmap_chunk[8], MAX_TRACKS);
 #ifdef DEBUG
     Debug_printf("\nTrack, Index");
     for (int i = 0; i < MAX_TRACKS; i++)
@@ -151,7 +145,6 @@ bool MediaTypeWOZ::wozX_read_tmap()
 
 bool MediaTypeWOZ::woz1_read_tracks()
 {    // depend upon little endian-ness
-    fnio::fseek(_media_fileh, 256, SEEK_SET);
 
     // woz1 track data organized as:
     // Offset	Size	    Name	        Usage
@@ -163,90 +156,108 @@ bool MediaTypeWOZ::woz1_read_tracks()
     // +6653	uint8	    Splice Bit Count	Bit count of splice nibble (write hint).
     // +6654	uint16		Reserved for future use.
 
+    // The whole TRKS chunk is read into the arena, tracks are used in place
+    size_t n = trks_chunk_size / WOZ1_TRK_RECORD_LEN;
+    if (n > MAX_TRACKS)
+        n = MAX_TRACKS;
+    if (n == 0 || alloc_arena(n * WOZ1_TRK_RECORD_LEN) == nullptr)
+        return true;
+
+    fnio::fseek(_media_fileh, WOZ_TRKS_DATA_OFFSET, SEEK_SET);
+    n = fnio::fread(trk_arena, WOZ1_TRK_RECORD_LEN, n, _media_fileh);
+
     Debug_printf("\nStart Block, Block Count, Bit Count");
     
-#ifdef ESP_PLATFORM
-    uint8_t *temp_ptr = (uint8_t *)heap_caps_malloc(WOZ1_NUM_BLKS * 512, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
-#else
-    uint8_t *temp_ptr = (uint8_t *)malloc(WOZ1_NUM_BLKS * 512);
-#endif
-    uint16_t bytes_used;
-    uint16_t bit_count;
-
-    for (int i = 0; i < MAX_TRACKS; i++)
+    memset(trks, 0, sizeof(trks));
+    for (size_t i = 0; i < n; i++)
     {
-        memset(temp_ptr, 0, WOZ1_NUM_BLKS * 512);
-        fnio::fread(temp_ptr, 1, WOZ1_TRACK_LEN, _media_fileh);
-        fnio::fread(&bytes_used, sizeof(bytes_used), 1, _media_fileh);
-        fnio::fread(&bit_count, sizeof(bit_count), 1, _media_fileh);
+        uint8_t *rec = &trk_arena[i * WOZ1_TRK_RECORD_LEN];
+        uint16_t bytes_used = rec[WOZ1_TRACK_LEN] | (rec[WOZ1_TRACK_LEN + 1] << 8);
+        uint16_t bit_count = rec[WOZ1_TRACK_LEN + 2] | (rec[WOZ1_TRACK_LEN + 3] << 8);
         trks[i].block_count = bytes_used / 512;
         if (bytes_used % 512)
             trks[i].block_count++;
         trks[i].bit_count = bit_count;
         if (bit_count > 0)
         {
-            size_t s = trks[i].block_count * 512;
-#ifdef ESP_PLATFORM
-            trk_ptrs[i] = (uint8_t *)heap_caps_malloc(s, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
-#else
-            trk_ptrs[i] = (uint8_t *)malloc(s);
-#endif
-            if (trk_ptrs[i] != nullptr)
-            {
-                Debug_printf("\nStoring %d bytes of track %d into location %lu", bytes_used, i, trk_ptrs[i]);
-                memset(trk_ptrs[i],0,s);
-                memcpy(trk_ptrs[i], temp_ptr, bytes_used);
-            }
-            else
-            {
-                Debug_printf("\nNo RAM allocated!");
-                free(temp_ptr);
-                return true;
-            }
+            trk_ptrs[i] = rec;
+            Debug_printf("\nTrack %d: %d bytes at location %lu", i, bytes_used, trk_ptrs[i]);
         }
         else
         {
             trk_ptrs[i] = nullptr;
             Debug_printf("\nTrack %d is blank!",i);
         }
-        fnio::fread(temp_ptr, 1, 6, _media_fileh); // read through rest of bytes in track
     }
-    free(temp_ptr);
     return false;
 }
 
 bool MediaTypeWOZ::woz2_read_tracks()
 {    // depend upon little endian-ness
-    fnio::fseek(_media_fileh, 256, SEEK_SET);
-    fnio::fread(&trks, sizeof(TRK_t), MAX_TRACKS, _media_fileh);
+    fnio::fseek(_media_fileh, WOZ_TRKS_DATA_OFFSET, SEEK_SET);
+    if (fnio::fread(&trks, sizeof(TRK_t), MAX_TRACKS, _media_fileh) != MAX_TRACKS)
+    {
+        Debug_printf("\nError reading TRKS table");
+        return true;
+    }
 #ifdef DEBUG
     Debug_printf("\nStart Block, Block Count, Bit Count");
     for (int i=0; i<MAX_TRACKS; i++)
         Debug_printf("\n%d, %d, %lu", trks[i].start_block, trks[i].block_count, trks[i].bit_count);
 #endif
+
+    // size up the arena, tracks are normally stored back to back
+    size_t total = 0;
+    uint32_t first_block = UINT32_MAX;
+    uint32_t end_block = 0;
+    for (int i=0; i<MAX_TRACKS; i++)
+    {
+        if (trks[i].block_count == 0)
+            continue;
+        total += trks[i].block_count * 512;
+        if (trks[i].start_block < first_block)
+            first_block = trks[i].start_block;
+        if (trks[i].start_block + trks[i].block_count > end_block)
+            end_block = trks[i].start_block + trks[i].block_count;
+    }
+    if (total == 0)
+        return false; // all tracks blank
+    if (alloc_arena(total) == nullptr)
+        return true;
+
+    if ((end_block - first_block) * 512 == total)
+    {
+        // contiguous, read all tracks in one go
+        Debug_printf("\nReading %u bytes of tracks into location %lu", (unsigned)total, trk_arena);
+        fnio::fseek(_media_fileh, first_block * 512, SEEK_SET);
+        if (fnio::fread(trk_arena, 1, total, _media_fileh) != total)
+        {
+            Debug_printf("\nError reading tracks");
+            return true;
+        }
+        for (int i=0; i<MAX_TRACKS; i++)
+            if (trks[i].block_count != 0)
+                trk_ptrs[i] = &trk_arena[(trks[i].start_block - first_block) * 512];
+        return false;
+    }
+
     // read WOZ tracks into RAM
+    uint8_t *p = trk_arena;
     for (int i=0; i<MAX_TRACKS; i++)
     {
         size_t s = trks[i].block_count * 512;
         if (s != 0)
         {
-#ifdef ESP_PLATFORM
-            trk_ptrs[i] = (uint8_t *)heap_caps_malloc(s, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
-#else
-            trk_ptrs[i] = (uint8_t *)malloc(s);
-#endif
-            if (trk_ptrs[i] != nullptr)
-            {
-                Debug_printf("\nReading %d bytes of track %d into location %lu", s, i, trk_ptrs[i]);
-                fnio::fseek(_media_fileh, trks[i].start_block * 512, SEEK_SET);
-                fnio::fread(trk_ptrs[i], 1, s, _media_fileh);
-                Debug_printf("\n%d, %d, %lu", trks[i].start_block, trks[i].block_count, trks[i].bit_count);
-            }
-            else
+            trk_ptrs[i] = p;
+            p += s;
+            Debug_printf("\nReading %d bytes of track %d into location %lu", s, i, trk_ptrs[i]);
+            fnio::fseek(_media_fileh, trks[i].start_block * 512, SEEK_SET);
+            if (fnio::fread(trk_ptrs[i], 1, s, _media_fileh) != s)
             {
-                Debug_printf("\nNo RAM allocated!");
+                Debug_printf("\nError reading track %d", i);
                 return true;
             }
+            Debug_printf("\n%d, %d, %lu", trks[i].start_block, trks[i].block_count, trks[i].bit_count);
         }
     }
     return false;
@@ -9,6 +9,14 @@
 #define WOZ1_TRACK_LEN 6646
 #define WOZ1_NUM_BLKS 13
 #define WOZ1_BIT_TIME 32
+#define WOZ1_TRK_RECORD_LEN (WOZ1_NUM_BLKS * 512) // bitstream plus 10 bytes of track info
+
+// fixed chunk layout at the start of WOZ1 and WOZ2 files
+#define WOZ_HEADER_LEN 12
+#define WOZ_INFO_OFFSET 12
+#define WOZ_TMAP_OFFSET 80
+#define WOZ_TRKS_OFFSET 248
+#define WOZ_TRKS_DATA_OFFSET 256
 struct TRK_t
 {
     uint16_t start_block;
@@ -22,16 +30,20 @@ class MediaTypeWOZ : public MediaType
 private:
     char woz_version;
 
+    uint32_t trks_chunk_size = 0;
+
     bool wozX_check_header();
-    bool wozX_read_info();
-    bool wozX_read_tmap();
+    bool wozX_read_chunks();
     bool woz1_read_tracks();
     bool woz2_read_tracks();
+    uint8_t *alloc_arena(size_t size);
 
 protected:
     uint8_t tmap[MAX_TRACKS];
     TRK_t trks[MAX_TRACKS];
     uint8_t *trk_ptrs[MAX_TRACKS] = { };
+    // one allocation holding all tracks, trk_ptrs point into it
+    uint8_t *trk_arena = nullptr;
 
 public:
     virtual bool read(uint32_t blockNum, uint16_t *count, uint8_t* buffer) override { return false; };
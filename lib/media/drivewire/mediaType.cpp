@@ -26,6 +26,11 @@ bool MediaType::write(uint32_t blockNum, bool verify)
     return true;
 }
 
+bool MediaType::flush()
+{
+    return false;
+}
+
 void MediaType::get_block_buffer(uint8_t **p_buffer, uint16_t *p_blk_size)
 {
     *p_buffer = &_media_blockbuff[0];
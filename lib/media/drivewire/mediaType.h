@@ -63,6 +63,8 @@ public:
     virtual bool read(uint32_t blockNum, uint16_t *readcount) = 0;
     // Returns TRUE if an error condition occurred
     virtual bool write(uint32_t blockNum, bool verify);
+    // Write out any buffered data, returns TRUE if an error condition occurred
+    virtual bool flush();
 
     virtual void get_block_buffer(uint8_t **p_buffer, uint16_t *p_blk_size);
     
@@ -15,6 +15,52 @@ uint32_t MediaTypeDSK::_block_to_offset(uint32_t blockNum)
     return blockNum * MEDIA_BLOCK_SIZE;
 }
 
+// Seek to given LSN unless the file is already positioned there
+// Returns TRUE if an error condition occurred
+bool MediaTypeDSK::_seek_block(uint32_t blockNum)
+{
+    if (blockNum == _file_block)
+        return false;
+
+    if (fnio::fseek(_media_fileh, _block_to_offset(blockNum), SEEK_SET) != 0)
+    {
+        _file_block = INVALID_SECTOR_VALUE;
+        return true;
+    }
+    _file_block = blockNum;
+    return false;
+}
+
+// Load up to count LSNs starting at blockNum into the cache
+// Returns TRUE if an error condition occurred
+bool MediaTypeDSK::_cache_fill(uint32_t blockNum, uint32_t count)
+{
+    // pending writes go out before the cache is reused
+    if (flush())
+        return true;
+
+    if (count > DSK_CACHE_BLOCKS)
+        count = DSK_CACHE_BLOCKS;
+    if (count > _media_num_blocks - blockNum)
+        count = _media_num_blocks - blockNum;
+
+    _cache_count = 0;
+    if (_seek_block(blockNum))
+        return true;
+
+    size_t n = fnio::fread(_cache, MEDIA_BLOCK_SIZE, count, _media_fileh);
+    if (n == 0)
+    {
+        _file_block = INVALID_SECTOR_VALUE;
+        return true;
+    }
+
+    _cache_first = blockNum;
+    _cache_count = n;
+    _file_block = blockNum + n;
+    return false;
+}
+
 // Returns TRUE if an error condition occurred
 bool MediaTypeDSK::read(uint32_t blockNum, uint16_t *readcount)
 {
@@ -24,34 +70,33 @@ bool MediaTypeDSK::read(uint32_t blockNum, uint16_t *readcount)
     // Debug_print("DW DSK READ\n");
 
     // Return an error if we're trying to read beyond the end of the disk
-    if (blockNum > _media_num_blocks)
+    if (blockNum >= _media_num_blocks)
     {
-        Debug_printf("::read block %d > %d\n", blockNum, _media_num_blocks);
+        Debug_printf("::read block %d >= %d\n", blockNum, _media_num_blocks);
         _media_controller_status = 2;
         return true;
     }
 
-    memset(_media_blockbuff, 0, sizeof(_media_blockbuff));
+    _media_controller_status = 0;
 
-    bool err = false;
-    // Perform a seek if we're not reading the sector after the last one we read
-    if (blockNum != _media_last_block + 1)
+    if (!_cache_contains(blockNum))
     {
-        uint32_t offset = _block_to_offset(blockNum);
-        err = fnio::fseek(_media_fileh, offset, SEEK_SET) != 0;
+        // OS-9 and RS-DOS read mostly consecutive LSNs: when the request continues
+        // where the cache ends, read ahead a whole track, otherwise fetch just this LSN
+        bool sequential = _cache_count > 0 && blockNum == _cache_first + _cache_count;
+
+        if (_cache_fill(blockNum, sequential ? DSK_CACHE_BLOCKS : 1))
+        {
+            memset(_media_blockbuff, 0, sizeof(_media_blockbuff));
+            _media_last_block = INVALID_SECTOR_VALUE;
+            return true;
+        }
     }
-    
-    if (err == false)
-        err = fnio::fread(_media_blockbuff, 1, MEDIA_BLOCK_SIZE, _media_fileh) != MEDIA_BLOCK_SIZE;
-
-    if (err == false)
-        _media_last_block = blockNum;
-    else
-        _media_last_block = INVALID_SECTOR_VALUE;
 
-    _media_controller_status = 0;
+    memcpy(_media_blockbuff, _cache_block(blockNum), MEDIA_BLOCK_SIZE);
+    _media_last_block = blockNum;
 
-    return err;
+    return false;
 }
 
 // Returns TRUE if an error condition occurred
@@ -59,27 +104,73 @@ bool MediaTypeDSK::write(uint32_t blockNum, bool verify)
 {
     // Debug_printf("DSK WRITE\n", blockNum, _media_num_blocks);
 
-    uint32_t offset = _block_to_offset(blockNum);
-
     _media_last_block = INVALID_SECTOR_VALUE;
 
-    // Perform a seek if we're writing to the sector after the last one
-    int e;
-    e = fnio::fseek(_media_fileh, offset, SEEK_SET);
-    if (e != 0)
+    // Collect the LSN into the cache if it is already there or directly follows it,
+    // otherwise write out what we have and start a new run with this LSN
+    if (!_cache_contains(blockNum) &&
+        (blockNum != _cache_first + _cache_count || _cache_count == DSK_CACHE_BLOCKS))
     {
-        Debug_printf("::write seek error %d\n", e);
-        _media_controller_status = 2;
+        if (flush())
+        {
+            _media_controller_status = 2;
+            return true;
+        }
+        _cache_first = blockNum;
+        _cache_count = 0;
+    }
+
+    memcpy(_cache + (blockNum - _cache_first) * MEDIA_BLOCK_SIZE, _media_blockbuff, MEDIA_BLOCK_SIZE);
+    if (blockNum == _cache_first + _cache_count)
+        _cache_count++;
+
+    if (_dirty_count == 0)
+    {
+        _dirty_first = blockNum;
+        _dirty_count = 1;
+    }
+    else if (blockNum < _dirty_first)
+    {
+        _dirty_count += _dirty_first - blockNum;
+        _dirty_first = blockNum;
+    }
+    else if (blockNum >= _dirty_first + _dirty_count)
+    {
+        _dirty_count = blockNum - _dirty_first + 1;
+    }
+
+    _media_controller_status = 0;
+    return false;
+}
+
+// Write collected LSNs to the image
+// Returns TRUE if an error condition occurred
+bool MediaTypeDSK::flush()
+{
+    if (_dirty_count == 0)
+        return false;
+
+    uint32_t first = _dirty_first;
+    uint32_t count = _dirty_count;
+    _dirty_count = 0;
+
+    if (_seek_block(first))
+    {
+        Debug_printf("::flush seek error, block %u\n", first);
+        _cache_count = 0;
         return true;
     }
-    // Write the data
-    e = fnio::fwrite(&_media_blockbuff, 1, MEDIA_BLOCK_SIZE, _media_fileh);
 
-    if (e != MEDIA_BLOCK_SIZE)
+    // Write the data
+    size_t e = fnio::fwrite(_cache_block(first), MEDIA_BLOCK_SIZE, count, _media_fileh);
+    if (e != count)
     {
-        Debug_printf("::write error %d, %d\n", e, errno);
+        Debug_printf("::flush write error %u of %u blocks, %d\n", (unsigned)e, count, errno);
+        _file_block = INVALID_SECTOR_VALUE;
+        _cache_count = 0;
         return true;
     }
+    _file_block = first + count;
 
     int ret = fnio::fflush(_media_fileh);    // This doesn't seem to be connected to anything in ESP-IDF VF, so it may not do anything
     
@@ -88,10 +179,12 @@ bool MediaTypeDSK::write(uint32_t blockNum, bool verify)
     // https://discord.com/channels/655893677146636301/1209535440915406848/1231880068528214026
     // fnio::fflush() should be sufficient for syncing as well.
 //    ret = fsync(fileno(_media_fileh)); // Since we might get reset at any moment, go ahead and sync the file (not clear if fflush does this)
-    Debug_printf("DSK::write fsync:%d\n", ret);
+    Debug_printf("DSK::flush %u blocks at %u, fsync:%d\n", count, first, ret);
+
+    // image may have grown
+    if (first + count > _media_num_blocks)
+        _media_num_blocks = first + count;
 
-    _media_last_block = INVALID_SECTOR_VALUE;
-    _media_controller_status = 0;
     return false;
 }
 
@@ -113,6 +206,9 @@ mediatype_t MediaTypeDSK::mount(fnFile *f, uint32_t disksize)
     _media_fileh = f;
     _mediatype = MEDIATYPE_DSK;
     _media_num_blocks = disksize / MEDIA_BLOCK_SIZE;
+    _cache_count = 0;
+    _dirty_count = 0;
+    _file_block = INVALID_SECTOR_VALUE;
 
     return _mediatype;
 }
@@ -5,14 +5,35 @@
 
 #include "mediaType.h"
 
+// Number of LSNs held by the sector cache, one 18 sector CoCo track
+#define DSK_CACHE_BLOCKS 18
+
 class MediaTypeDSK : public MediaType
 {
 private:
     uint32_t _block_to_offset(uint32_t blockNum);
 
+    // Sector cache, holds _cache_count consecutive LSNs starting at _cache_first.
+    // Sequential reads fetch the next DSK_CACHE_BLOCKS LSNs in one go, consecutive
+    // writes are collected in the cache (_dirty_first, _dirty_count) and written
+    // by flush() with a single seek and write.
+    uint8_t _cache[DSK_CACHE_BLOCKS * MEDIA_BLOCK_SIZE];
+    uint32_t _cache_first = 0;
+    uint32_t _cache_count = 0;
+    uint32_t _dirty_first = 0;
+    uint32_t _dirty_count = 0;
+    // LSN at current file position, avoids seeking on sequential access
+    uint32_t _file_block = INVALID_SECTOR_VALUE;
+
+    bool _cache_contains(uint32_t blockNum) { return blockNum - _cache_first < _cache_count; }
+    uint8_t *_cache_block(uint32_t blockNum) { return &_cache[(blockNum - _cache_first) * MEDIA_BLOCK_SIZE]; }
+    bool _cache_fill(uint32_t blockNum, uint32_t count);
+    bool _seek_block(uint32_t blockNum);
+
 public:
     virtual bool read(uint32_t blockNum, uint16_t *readcount) override;
     virtual bool write(uint32_t blockNum, bool verify) override;
+    virtual bool flush() override;
 
     virtual bool format(uint16_t *responsesize) override;
 
@@ -3,7 +3,7 @@
 
 #include "mediaTypeMOOF.h"
 #include "../../include/debug.h"
-// #include <string.h>
+#include <string.h>
 
 mediatype_t MediaTypeMOOF::mount(FILE *f, uint32_t disksize)
 {
@@ -13,12 +13,10 @@ mediatype_t MediaTypeMOOF::mount(FILE *f, uint32_t disksize)
     if (moof_check_header())
         return MEDIATYPE_UNKNOWN;
 
-    // work through INFO chunk
-    if (moof_read_info())
+    // work through INFO and TMAP chunks
+    if (moof_read_chunks())
         return MEDIATYPE_UNKNOWN;
 
-    if (moof_read_tmap())
-        return MEDIATYPE_UNKNOWN;
     if (moof_read_tracks())
         return MEDIATYPE_UNKNOWN;
 
@@ -29,12 +27,12 @@ void MediaTypeMOOF::unmount()
 {
     MediaType::unmount();
 #ifdef CACHE_IMAGE
+    free(trk_arena);
+    trk_arena = nullptr;
     for (int i = 0; i < MAX_TRACKS; i++)
     {
-        if (trk_ptrs[i] != nullptr)
-            free(trk_ptrs[i]);
-            
         trk_ptrs[i] = nullptr;
+        trk_loaded[i] = false;
     }
 #else
     free(trk_buffer);
@@ -66,23 +64,31 @@ bool MediaTypeMOOF::moof_check_header()
     return false;
 }
 
-bool MediaTypeMOOF::moof_read_info()
+// Read INFO, TMAP and the TRKS chunk header with one read and check they are
+// where MOOF puts them
+bool MediaTypeMOOF::moof_read_chunks()
 {
-    if (fseek(_media_fileh, 12, SEEK_SET))
+    uint8_t chunks[MOOF_TRKS_DATA_OFFSET - MOOF_INFO_OFFSET];
+    if (fseek(_media_fileh, MOOF_INFO_OFFSET, SEEK_SET) ||
+        fread(chunks, 1, sizeof(chunks), _media_fileh) != sizeof(chunks))
     {
-        Debug_printf("\nError seeking INFO chunk");
+        Debug_printf("\nError reading MOOF chunks");
         return true;
     }
-    uint32_t chunk_id, chunk_size;
-    fread(&chunk_id, sizeof(chunk_id), 1, _media_fileh);
-    Debug_printf("\nINFO Chunk ID: %08x", chunk_id);
-    fread(&chunk_size, sizeof(chunk_size), 1, _media_fileh);
-    Debug_printf("\nINFO Chunk size: %d", chunk_size);
-
-    uint8_t info_version, disk_type;
-    fread(&info_version, sizeof(info_version), 1, _media_fileh);
+
+    // chunk data starts after 8 bytes of chunk id and size
+    const uint8_t *info = &chunks[0];
+    const uint8_t *tmap_chunk = &chunks[MOOF_TMAP_OFFSET - MOOF_INFO_OFFSET];
+    const uint8_t *trks_chunk = &chunks[MOOF_TRKS_OFFSET - MOOF_INFO_OFFSET];
+    if (memcmp(info, "INFO", 4) || memcmp(tmap_chunk, "TMAP", 4) || memcmp(trks_chunk, "TRKS", 4))
+    {
+        Debug_printf("\nUnexpected MOOF chunk layout");
+        return true;
+    }
+
+    uint8_t info_version = info[8];
+    uint8_t disk_type = info[9];
     Debug_printf("\nINFO Version: %d", info_version);
-    fread(&disk_type, sizeof(disk_type), 1, _media_fileh);
     Debug_printf("\nDisk type: %d", disk_type);
     // 1 = SSDD GCR (400K)
     // 2 = DSDD GCR (800K)
@@ -111,40 +117,12 @@ bool MediaTypeMOOF::moof_read_info()
         return true;
     }
 
-    Debug_printf("\nNow at byte %d", ftell(_media_fileh));
-    // blow the next two bytes
-    getc(_media_fileh);
-    getc(_media_fileh);
-    // get the bit timing:
-    uint8_t bit_timing;
-    fread(&bit_timing, sizeof(bit_timing), 1, _media_fileh);
-    optimal_bit_timing = bit_timing;
+    // bit timing at offset 4, largest track at offset 38
+    optimal_bit_timing = info[8 + 4];
     Debug_printf("\nMOOF Optimal Bit Timing = 125 ns X %d = %d ns", optimal_bit_timing, (int)optimal_bit_timing * 125);
-    // and jump to get the track size
-    fseek(_media_fileh, 58, SEEK_SET);
-    uint16_t largest_track;
-    fread(&largest_track, sizeof(largest_track), 1, _media_fileh);
-    num_blocks = largest_track;
-
-    return false;
-}
-
-bool MediaTypeMOOF::moof_read_tmap()
-{ // read TMAP
-    if (fseek(_media_fileh, 80, SEEK_SET))
-    {
-        Debug_printf("\nError seeking TMAP chunk");
-        return true;
-    }
-
-    uint32_t chunk_id, chunk_size;
-    fread(&chunk_id, sizeof(chunk_id), 1, _media_fileh);
-    Debug_printf("\nTMAP Chunk ID: %08x", chunk_id);
-    fread(&chunk_size, sizeof(chunk_size), 1, _media_fileh);
-    Debug_printf("\nTMAP Chunk size: %d", chunk_size);
-    Debug_printf("\nNow at byte %d", ftell(_media_fileh));
+    num_blocks = info[8 + 38] | (info[8 + 39] << 8);
 
-    fread(&tmap, sizeof(tmap[0]), MAX_TRACKS, _media_fileh);
+    memcpy(tmap, &tmap_chunk[8], MAX_TRACKS);
 #ifdef DEBUG
     Debug_printf("\nTrack, Index");
     for (int i = 0; i < MAX_TRACKS; i++)
@@ -158,7 +136,20 @@ uint8_t *MediaTypeMOOF::get_track(int t)
 {
 
 #ifdef CACHE_IMAGE
-    return trk_ptrs[tmap[t]];
+    uint8_t i = tmap[t];
+    if (i == 255 || trk_ptrs[i] == nullptr)
+        return nullptr;
+    if (!trk_loaded[i])
+    {
+        // first visit, called from the bus service loop so file access is fine here
+        size_t s = trks[i].block_count * 512;
+        Debug_printf("\nReading %d bytes of track %d into location %lu", s, i, trk_ptrs[i]);
+        fseek(_media_fileh, trks[i].start_block * 512, SEEK_SET);
+        if (fread(trk_ptrs[i], 1, s, _media_fileh) != s)
+            Debug_printf("\nError reading track %d", i);
+        trk_loaded[i] = true;
+    }
+    return trk_ptrs[i];
 #else
     size_t s = trks[t].block_count * 512;
     Debug_printf("\nReading %d bytes of track %d", s, t);
@@ -172,8 +163,12 @@ uint8_t *MediaTypeMOOF::get_track(int t)
 
 bool MediaTypeMOOF::moof_read_tracks()
 { // depend upon little endian-ness
-    fseek(_media_fileh, 256, SEEK_SET);
-    fread(&trks, sizeof(TRK_t), MAX_TRACKS, _media_fileh);
+    fseek(_media_fileh, MOOF_TRKS_DATA_OFFSET, SEEK_SET);
+    if (fread(&trks, sizeof(TRK_t), MAX_TRACKS, _media_fileh) != MAX_TRACKS)
+    {
+        Debug_printf("\nError reading TRKS table");
+        return true;
+    }
 #ifdef DEBUG
     Debug_printf("\nStart Block, Block Count, Bit Count");
     for (int i = 0; i < MAX_TRACKS; i++)
@@ -181,26 +176,29 @@ bool MediaTypeMOOF::moof_read_tracks()
 #endif
 
 #ifdef CACHE_IMAGE
-    // read MOOF tracks into RAM
+    // one arena for all tracks, tracks are read by get_track() when first needed
+    size_t total = 0;
+    for (int i = 0; i < MAX_TRACKS; i++)
+        total += trks[i].block_count * 512;
+    if (total != 0)
+    {
+        trk_arena = (uint8_t *)heap_caps_malloc(total, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
+        if (trk_arena == nullptr)
+        {
+            Debug_printf("\nNo RAM allocated!");
+            return true;
+        }
+        Debug_printf("\n%d bytes allocated for MOOF tracks", total);
+    }
+    uint8_t *p = trk_arena;
     for (int i = 0; i < MAX_TRACKS; i++)
     {
+        trk_loaded[i] = false;
         trk_ptrs[i] = nullptr;
-        size_t s = trks[i].block_count * 512;
-        if (s != 0)
+        if (trks[i].block_count != 0)
         {
-            trk_ptrs[i] = (uint8_t *)heap_caps_malloc(s, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
-            if (trk_ptrs[i] != nullptr)
-            {
-                Debug_printf("\nReading %d bytes of track %d into location %lu", s, i, trk_ptrs[i]);
-                fseek(_media_fileh, trks[i].start_block * 512, SEEK_SET);
-                fread(trk_ptrs[i], 1, s, _media_fileh);
-                Debug_printf("\n%d, %d, %lu", trks[i].start_block, trks[i].block_count, trks[i].bit_count);
-            }
-            else
-            {
-                Debug_printf("\nNo RAM allocated!");
-                return true;
-            }
+            trk_ptrs[i] = p;
+            p += trks[i].block_count * 512;
         }
     }
 #else
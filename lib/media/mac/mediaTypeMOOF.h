@@ -11,6 +11,13 @@
 
 #define CACHE_IMAGE
 
+// fixed chunk layout at the start of MOOF files
+#define MOOF_HEADER_LEN 12
+#define MOOF_INFO_OFFSET 12
+#define MOOF_TMAP_OFFSET 80
+#define MOOF_TRKS_OFFSET 248
+#define MOOF_TRKS_DATA_OFFSET 256
+
 struct TRK_t
 {
     uint16_t start_block;
@@ -32,15 +39,17 @@ private:
     moof_disk_type_t moof_disktype;
 
     bool moof_check_header();
-    bool moof_read_info();
-    bool moof_read_tmap();
+    bool moof_read_chunks();
     bool moof_read_tracks();
 
 protected:
     uint8_t tmap[MAX_TRACKS];
     TRK_t trks[MAX_TRACKS];
 #ifdef CACHE_IMAGE
+    // all tracks share one allocation, each is read from the file on first use
+    uint8_t *trk_arena = nullptr;
     uint8_t *trk_ptrs[MAX_TRACKS] = {};
+    bool trk_loaded[MAX_TRACKS] = {};
 #else
     uint8_t *trk_buffer;
 #endif
@@ -0,0 +1,45 @@
+/**
+ * Binary capture format of the modem sniffer
+ *
+ * pcapng (https://www.ietf.org/archive/id/draft-tuexen-opsawg-pcapng-05.html) in the byte order
+ * of the writer: a section header block, one interface description block with link type
+ * LINKTYPE_USER0 and microsecond timestamps, then an enhanced packet block per record.
+ * Wireshark opens it, the data can be decoded there with a DLT_USER0 dissector.
+ *
+ * Each packet starts with a header of CAPTURE_HEADER_SIZE bytes
+ *   0: record type, capture_record_type
+ *   1: event, capture_event, for CAPTURE_EVENT records
+ *   2: event value, 16 bits little endian
+ * followed by the data of CAPTURE_TO_COMPUTER and CAPTURE_TO_NETWORK records.
+ */
+
+#ifndef MODEM_CAPTURE_H
+#define MODEM_CAPTURE_H
+
+#define CAPTURE_LINKTYPE 147 // LINKTYPE_USER0
+#define CAPTURE_HEADER_SIZE 4
+
+#define PCAPNG_SHB 0x0A0D0D0A
+#define PCAPNG_IDB 0x00000001
+#define PCAPNG_EPB 0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1A2B3C4D
+
+enum capture_record_type
+{
+    CAPTURE_TO_COMPUTER = 0, // received from the network
+    CAPTURE_TO_NETWORK = 1,  // sent by the computer
+    CAPTURE_EVENT = 2
+};
+
+enum capture_event
+{
+    CAPTURE_EVENT_DTR = 1,      // value is the new state
+    CAPTURE_EVENT_RTS = 2,      // value is the new state
+    CAPTURE_EVENT_XMT = 3,      // value is the new state
+    CAPTURE_EVENT_CONNECT = 4,  // value is the modem baud rate
+    CAPTURE_EVENT_NO_CARRIER = 5,
+    CAPTURE_EVENT_COMMAND_MODE = 6, // "+++" escape
+    CAPTURE_EVENT_DROPPED = 7   // value is the number of bytes the writer could not keep up with
+};
+
+#endif /* MODEM_CAPTURE_H */
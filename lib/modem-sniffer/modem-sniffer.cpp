@@ -6,6 +6,13 @@
 #include <string.h>
 #include <errno.h>
 
+#include <algorithm>
+#include <chrono>
+
+#ifdef ESP_PLATFORM
+#include <esp_pthread.h>
+#endif
+
 #include "modem-sniffer.h"
 
 #include "../../include/debug.h"
@@ -26,9 +33,19 @@ ModemSniffer::~ModemSniffer()
 {
     Debug_printf("ModemSniffer::~ModemSniffer()\n");
 
+    if (writerThread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(ringLock);
+            stopWriter = true;
+        }
+        ringCond.notify_all();
+        writerThread.join();
+    }
+
     if (_file != nullptr)
     {
-        Debug_printf("Closing" SNIFFER_OUTPUT_FILE "\n");
+        Debug_printf("Closing %s\n", outputFile());
         fclose(_file);
         _file = nullptr;
     }
@@ -36,10 +53,12 @@ ModemSniffer::~ModemSniffer()
 
 size_t ModemSniffer::getOutputSize()
 {
+    std::lock_guard<std::mutex> lock(fileLock);
+
     if (_file != nullptr)
         return FileSystem::filesize(_file);
 
-    long result = activeFS->filesize(SNIFFER_OUTPUT_FILE);
+    long result = activeFS->filesize(outputFile());
 
     return result == -1 ? 0 : result;
 }
@@ -48,11 +67,14 @@ void ModemSniffer::closeOutput()
 {
     Debug_print("ModemSniffer::closeOutput\n");
 
+    drain();
+    std::lock_guard<std::mutex> lock(fileLock);
+
 #ifdef ESP_PLATFORM
 // jk: why?
     if (_file == nullptr)
     {
-        _file = activeFS->file_open(SNIFFER_OUTPUT_FILE, "r+"); // Seeks don't work right if we use "append" mode - use "r+"
+        _file = activeFS->file_open(outputFile(), "r+"); // Seeks don't work right if we use "append" mode - use "r+"
         
         if (_file == nullptr)
         {
@@ -78,7 +100,7 @@ FILE *ModemSniffer::closeOutputAndProvideReadHandle()
     Debug_print("ModemSniffer::closeOutputAndProvideReadHandle()\n");
 
     closeOutput();
-    FILE *result = activeFS->file_open(SNIFFER_OUTPUT_FILE); // read-only.
+    FILE *result = activeFS->file_open(outputFile()); // read-only.
     if (result == nullptr)
     {
         Debug_printf("Error opening sniffer output: %d - %s\n", errno, strerror(errno));
@@ -92,79 +114,227 @@ void ModemSniffer::restartOutput()
     if (_file != nullptr)
         fclose(_file);
 
-    _file = activeFS->file_open(SNIFFER_OUTPUT_FILE, "wb"); // This should create/truncate the file
+    _file = activeFS->file_open(outputFile(), "wb"); // This should create/truncate the file
 
     Debug_printf("ModemSniffer::restartOutput(%p)\n", _file);
+
+    if (_file != nullptr && capture)
+    {
+        using namespace std::chrono;
+        captureEpoch = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count() -
+                       duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+
+        // Section header, version 1.0, unknown section length
+        uint32_t shb[] = {PCAPNG_SHB, 28, PCAPNG_BYTE_ORDER_MAGIC, 1, 0xFFFFFFFF, 0xFFFFFFFF, 28};
+        // Interface description, if_name option, default microsecond timestamps
+        uint32_t idb[] = {PCAPNG_IDB, 44, CAPTURE_LINKTYPE, 0, (13 << 16) | 2, 0, 0, 0, 0, 0, 44};
+        memcpy(&idb[5], "FujiNet modem", 13);
+        fwrite(shb, 1, sizeof(shb), _file);
+        fwrite(idb, 1, sizeof(idb), _file);
+    }
 }
 
 void ModemSniffer::dumpInput(uint8_t *buf, unsigned short len)
 {
-    if (enable == false)
+    dump(CAPTURE_TO_COMPUTER, (capture_event)0, 0, buf, len);
+}
+
+void ModemSniffer::dumpOutput(uint8_t *buf, unsigned short len)
+{
+    dump(CAPTURE_TO_NETWORK, (capture_event)0, 0, buf, len);
+}
+
+void ModemSniffer::dumpEvent(capture_event event, uint16_t value)
+{
+    if (capture)
+        dump(CAPTURE_EVENT, event, value, nullptr, 0);
+}
+
+void ModemSniffer::setCapture(bool _capture)
+{
+    if (_capture == capture)
         return;
 
-    if (_file == nullptr)
+    closeOutput();
+    capture = _capture;
+}
+
+void ModemSniffer::dump(capture_record_type type, capture_event event, uint16_t value, const uint8_t *buf, unsigned short len)
+{
+    if (enable == false || (len == 0 && type != CAPTURE_EVENT))
+        return;
+
+    if (!writerThread.joinable())
     {
-        restartOutput();
+        ring.resize(SNIFFER_BUFFER_SIZE);
+#ifdef ESP_PLATFORM
+        esp_pthread_cfg_t prev;
+        if (esp_pthread_get_cfg(&prev) != ESP_OK)
+            prev = esp_pthread_get_default_config();
+        esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+        cfg.stack_size = SNIFFER_WRITER_STACK_SIZE;
+        cfg.thread_name = "sniffer";
+        esp_pthread_set_cfg(&cfg);
+#endif
+        writerThread = std::thread(&ModemSniffer::writer, this);
+#ifdef ESP_PLATFORM
+        // Put back the config this task had before
+        esp_pthread_set_cfg(&prev);
+#endif
     }
 
-    if (direction != INPUT)
+    record r;
+    r.time = std::chrono::duration_cast<std::chrono::microseconds>(
+                 std::chrono::steady_clock::now().time_since_epoch())
+                 .count();
+    r.len = len;
+    r.value = value;
+    r.type = type;
+    r.event = event;
+
+    size_t head = ringHead.load(std::memory_order_relaxed);
+    if (head - ringTail.load(std::memory_order_acquire) + sizeof(r) + len > ring.size())
     {
-        fprintf(_file, "\n\nINCOMING: ");
-        Debug_printf("\n\nINCOMING: ");
+        dropped += len;
+        return;
     }
 
-    direction = INPUT;
-
-    for (int i = 0; i < len; i++)
+    const uint8_t *parts[2] = {(const uint8_t *)&r, buf};
+    size_t lengths[2] = {sizeof(r), len};
+    for (int i = 0; i < 2 && lengths[i] > 0; i++)
     {
-        if (buf[i] > 0x20 && buf[i] < 0x7F)
-        {
-            // Printable ASCII character.
-            fprintf(_file, "'%c' ", buf[i]);
-            Debug_printf("'%c' ", buf[i]);
-        }
-        else
-        {
-            // non-printable ASCII character.
-            fprintf(_file, "%02x ", buf[i]);
-            Debug_printf("%02x ", buf[i]);
-        }
+        size_t offset = head % ring.size();
+        size_t first = std::min(lengths[i], ring.size() - offset);
+        memcpy(&ring[offset], parts[i], first);
+        memcpy(&ring[0], parts[i] + first, lengths[i] - first);
+        head += lengths[i];
     }
-    fflush(_file);
+    ringHead.store(head, std::memory_order_release);
+    ringCond.notify_one();
 }
 
-void ModemSniffer::dumpOutput(uint8_t *buf, unsigned short len)
+void ModemSniffer::drain()
 {
-    if (enable == false)
+    if (!writerThread.joinable())
         return;
 
-    if (_file == nullptr)
+    std::unique_lock<std::mutex> lock(ringLock);
+    while (ringTail.load() != ringHead.load() || writing)
     {
-        restartOutput();
+        ringCond.notify_one();
+        ringCond.wait_for(lock, std::chrono::milliseconds(10));
     }
+}
+
+void ModemSniffer::writer()
+{
+    std::vector<uint8_t> records;
+    std::string text;
 
-    if (direction != OUTPUT)
+    while (true)
     {
-        fprintf(_file, "\n\nOUTGOING: ");
-        Debug_printf("\n\nOUTGOING: ");
+        size_t head = ringHead.load(std::memory_order_acquire);
+        size_t tail = ringTail.load(std::memory_order_relaxed);
+        if (head == tail)
+        {
+            if (stopWriter)
+                break; // stopped and nothing left to write
+
+            // The modem doesn't take the lock to notify, so a wakeup can be missed. Don't sleep long.
+            std::unique_lock<std::mutex> lock(ringLock);
+            ringCond.notify_all(); // drained
+            ringCond.wait_for(lock, std::chrono::milliseconds(100));
+            continue;
+        }
+
+        // Take everything queued so far, the modem can queue more while it is written
+        writing = true;
+        records.resize(head - tail);
+        size_t offset = tail % ring.size();
+        size_t first = std::min(records.size(), ring.size() - offset);
+        memcpy(records.data(), &ring[offset], first);
+        memcpy(records.data() + first, &ring[0], records.size() - first);
+        ringTail.store(head, std::memory_order_release);
+        uint32_t lost = dropped.exchange(0);
+
+        std::lock_guard<std::mutex> file(fileLock);
+        if (_file == nullptr)
+            restartOutput();
+
+        text.clear();
+        int64_t time = 0;
+        for (size_t pos = 0; pos + sizeof(record) <= records.size();)
+        {
+            record r;
+            memcpy(&r, &records[pos], sizeof(r));
+            if (capture)
+                formatCapture(r, &records[pos + sizeof(r)], text);
+            else if (r.type != CAPTURE_EVENT)
+                format(r.type == CAPTURE_TO_COMPUTER ? INPUT : OUTPUT, &records[pos + sizeof(r)], r.len, text);
+            pos += sizeof(r) + r.len;
+            time = r.time;
+        }
+        if (lost > 0 && capture)
+        {
+            record r = {time, 0, (uint16_t)std::min(lost, (uint32_t)UINT16_MAX), CAPTURE_EVENT, CAPTURE_EVENT_DROPPED};
+            formatCapture(r, nullptr, text);
+        }
+        else if (lost > 0)
+        {
+            text += "\n\n(" + std::to_string(lost) + " bytes not logged)";
+        }
+
+        if (_file != nullptr)
+        {
+            fwrite(text.data(), 1, text.size(), _file);
+            fflush(_file);
+        }
+        if (!capture)
+            Debug_print(text.c_str());
+
+        writing = false;
     }
+}
 
-    direction = OUTPUT;
+void ModemSniffer::format(_direction dir, const uint8_t *buf, size_t len, std::string &out)
+{
+    // Input was logged in lower case hex, output in upper case
+    const char *hex = dir == INPUT ? "0123456789abcdef" : "0123456789ABCDEF";
 
-    for (int i = 0; i < len; i++)
+    if (direction != dir)
+        out += dir == INPUT ? "\n\nINCOMING: " : "\n\nOUTGOING: ";
+    direction = dir;
+
+    for (size_t i = 0; i < len; i++)
     {
         if (buf[i] > 0x20 && buf[i] < 0x7F)
         {
             // Printable ASCII character.
-            fprintf(_file, "'%c' ", buf[i]);
-            Debug_printf("'%c' ", buf[i]);
+            char c[] = {'\'', (char)buf[i], '\'', ' '};
+            out.append(c, sizeof(c));
         }
         else
         {
             // non-printable ASCII character.
-            fprintf(_file, "%02X ", buf[i]);
-            Debug_printf("%02X ", buf[i]);
+            char c[] = {hex[buf[i] >> 4], hex[buf[i] & 0x0F], ' '};
+            out.append(c, sizeof(c));
         }
     }
-    fflush(_file);
+}
+
+void ModemSniffer::formatCapture(const record &r, const uint8_t *data, std::string &out)
+{
+    uint32_t caplen = CAPTURE_HEADER_SIZE + r.len;
+    uint32_t padded = (caplen + 3) & ~3;
+    uint32_t blocklen = 32 + padded;
+    uint64_t ts = captureEpoch + r.time;
+
+    uint32_t epb[] = {PCAPNG_EPB, blocklen, 0, (uint32_t)(ts >> 32), (uint32_t)ts, caplen, caplen};
+    uint8_t header[CAPTURE_HEADER_SIZE] = {r.type, r.event, (uint8_t)(r.value & 0xFF), (uint8_t)(r.value >> 8)};
+
+    out.append((const char *)epb, sizeof(epb));
+    out.append((const char *)header, sizeof(header));
+    out.append((const char *)data, r.len);
+    out.append(padded - caplen, '\0');
+    out.append((const char *)&blocklen, sizeof(blocklen));
 }
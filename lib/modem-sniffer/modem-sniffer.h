@@ -6,17 +6,34 @@
 #ifndef MODEM_SNIFFER_H
 #define MODEM_SNIFFER_H
 
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <stdio.h>
 
 #include "fnFS.h"
+#include "modem-capture.h"
 
 
 // using namespace std;
 
 #define SNIFFER_OUTPUT_FILE "/rs232dump"
+#define SNIFFER_CAPTURE_FILE "/rs232dump.pcapng"
+
+// Bytes waiting for the writer thread, more are dropped rather than slowing the modem down
+#ifndef SNIFFER_BUFFER_SIZE
+#define SNIFFER_BUFFER_SIZE 8192
+#endif
+
+// Stack of the writer thread, enough for stdio and the file system drivers
+#ifndef SNIFFER_WRITER_STACK_SIZE
+#define SNIFFER_WRITER_STACK_SIZE 4096
+#endif
 
 class ModemSniffer
 {
@@ -45,15 +62,20 @@ public:
     void closeOutput();
 
     /**
-     * Dump output to file
+     * Dump output to file, written in the background
      */
     void dumpOutput(uint8_t *buf, unsigned short len);
 
     /**
-     * Dump input to file
+     * Dump input to file, written in the background
      */
     void dumpInput(uint8_t *buf, unsigned short len);
 
+    /**
+     * Record a modem event, only written to captures
+     */
+    void dumpEvent(capture_event event, uint16_t value = 0);
+
     /**
      * Close output, and return a R/O file handle for web interface.
      */
@@ -69,6 +91,17 @@ public:
      */
     bool getEnable() { return enable; }
 
+    /**
+     * Write a timestamped binary capture (SNIFFER_CAPTURE_FILE, see modem-capture.h)
+     * instead of the text dump. Closes the current output.
+     */
+    void setCapture(bool _capture);
+
+    /**
+     * Get capture flag
+     */
+    bool getCapture() { return capture; }
+
     /**
      * @brief set active filesystem, for deferred use.
      */
@@ -91,6 +124,78 @@ private:
         OUTPUT
     } direction;
 
+    /**
+     * Write a binary capture instead of text?
+     */
+    std::atomic<bool> capture{false};
+
+    /**
+     * Queue a record for the writer thread
+     */
+    void dump(capture_record_type type, capture_event event, uint16_t value, const uint8_t *buf, unsigned short len);
+
+    /**
+     * Writer thread, formats queued records and writes them to the file
+     */
+    void writer();
+
+    /**
+     * Wait until the writer has written everything queued
+     */
+    void drain();
+
+    /**
+     * Append the text for a direction change and the data to out
+     */
+    void format(_direction dir, const uint8_t *buf, size_t len, std::string &out);
+
+    /**
+     * Record header in the ring, followed by len bytes of data
+     */
+    struct record
+    {
+        int64_t time; // steady clock microseconds
+        uint16_t len;
+        uint16_t value;
+        uint8_t type;
+        uint8_t event;
+    };
+
+    /**
+     * Append an enhanced packet block for a record to out
+     */
+    void formatCapture(const record &r, const uint8_t *data, std::string &out);
+
+    /**
+     * Path of the output for the current mode
+     */
+    const char *outputFile() { return capture ? SNIFFER_CAPTURE_FILE : SNIFFER_OUTPUT_FILE; }
+
+    /**
+     * Queued records, a single producer (the modem) and single consumer (the writer) ring.
+     * head and tail count bytes written and read, the ring offset is modulo the size.
+     * The producer never waits, records that don't fit are counted in dropped.
+     */
+    std::vector<uint8_t> ring;
+    std::atomic<size_t> ringHead{0};
+    std::atomic<size_t> ringTail{0};
+    std::atomic<uint32_t> dropped{0};
+    std::atomic<bool> writing{false};
+    std::atomic<bool> stopWriter{false};
+    std::thread writerThread;
+    std::mutex ringLock; // only to sleep on ringCond
+    std::condition_variable ringCond;
+
+    /**
+     * Held while the writer or the web interface use _file
+     */
+    std::mutex fileLock;
+
+    /**
+     * Wall clock microseconds at steady clock time 0, for capture timestamps
+     */
+    int64_t captureEpoch = 0;
+
 protected:
     /**
      * Pointer to ESP32 filesystem
@@ -108,7 +213,7 @@ protected:
     std::string outputBuffer;
 
     /**
-     * Recreate SNIFFER_OUTPUT_FILE
+     * Recreate SNIFFER_OUTPUT_FILE or SNIFFER_CAPTURE_FILE
      */
     void restartOutput();
 
@@ -186,44 +186,44 @@ bool NetworkProtocol::status(NetworkStatus *status)
 
 /**
  * Perform end of line translation on receive buffer. based on translation_mode.
- * @param rx_buf The receive buffer to transform
- * @param len The length of the receive buffer
- * @return length after transformation.
+ * @param pos translate from this offset on, the data before it was translated already.
   */
-void NetworkProtocol::translate_receive_buffer()
+void NetworkProtocol::translate_receive_buffer(size_t pos)
 {
     // Debug_printf("#### Translating receive buffer, mode: %u\r\n", translation_mode);
-    if (translation_mode == 0)
+    if (translation_mode == 0 || pos >= receiveBuffer->length())
         return;
 
+    auto begin = receiveBuffer->begin() + pos;
+
     #ifdef BUILD_ATARI
-    replace(receiveBuffer->begin(), receiveBuffer->end(), ASCII_BELL, ATASCII_BUZZER);
-    replace(receiveBuffer->begin(), receiveBuffer->end(), ASCII_BACKSPACE, ATASCII_DEL);
-    replace(receiveBuffer->begin(), receiveBuffer->end(), ASCII_TAB, ATASCII_TAB);
+    replace(begin, receiveBuffer->end(), ASCII_BELL, ATASCII_BUZZER);
+    replace(begin, receiveBuffer->end(), ASCII_BACKSPACE, ATASCII_DEL);
+    replace(begin, receiveBuffer->end(), ASCII_TAB, ATASCII_TAB);
     #endif   
 
     switch (translation_mode)
     {
     case TRANSLATION_MODE_CR:
-        replace(receiveBuffer->begin(), receiveBuffer->end(), ASCII_CR, EOL);
+        replace(begin, receiveBuffer->end(), ASCII_CR, EOL);
         break;
     case TRANSLATION_MODE_LF:
-        replace(receiveBuffer->begin(), receiveBuffer->end(), ASCII_LF, EOL);
+        replace(begin, receiveBuffer->end(), ASCII_LF, EOL);
         break;
     case TRANSLATION_MODE_CRLF:
     #ifndef BUILD_APPLE
         // With Apple2, we would be translating CR to CR; a waste of CPU
-        replace(receiveBuffer->begin(), receiveBuffer->end(), ASCII_CR, EOL);
+        replace(begin, receiveBuffer->end(), ASCII_CR, EOL);
     #endif
         break;
     case TRANSLATION_MODE_PETSCII:
         Debug_printf("!!! PETSCII !!!\r\n");
-        *receiveBuffer = mstr::toUTF8(*receiveBuffer);
+        receiveBuffer->replace(pos, std::string::npos, mstr::toUTF8(receiveBuffer->substr(pos)));
         break;
     }
 
     if (translation_mode == TRANSLATION_MODE_CRLF)
-        receiveBuffer->erase(std::remove(receiveBuffer->begin(), receiveBuffer->end(), '\n'), receiveBuffer->end());
+        receiveBuffer->erase(std::remove(receiveBuffer->begin() + pos, receiveBuffer->end(), '\n'), receiveBuffer->end());
 }
 
 /**
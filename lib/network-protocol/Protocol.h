@@ -205,8 +205,9 @@ protected:
 
     /**
      * Perform end of line translation on receive buffer.
+     * @param pos translate from this offset on, the data before it was translated already.
      */
-    void translate_receive_buffer();
+    void translate_receive_buffer(size_t pos = 0);
 
     /**
      * Perform end of line translation on transmit buffer.
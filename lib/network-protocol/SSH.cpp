@@ -8,10 +8,17 @@
 
 #include "status_error_codes.h"
 
+#include <algorithm>
 #include <vector>
 
 #define RXBUF_SIZE 65535
 
+// receiveBuffer is not filled beyond what status can report
+#define RX_WAITING_MAX 65535
+
+// Compression, if libssh was built with zlib and the URL asks for it, e.g. SSH://host/?compress
+#define SSH_COMPRESSION "zlib@openssh.com,zlib,none"
+
 NetworkProtocolSSH::NetworkProtocolSSH(std::string *rx_buf, std::string *tx_buf, std::string *sp_buf)
     : NetworkProtocol(rx_buf, tx_buf, sp_buf)
 {
@@ -84,6 +91,10 @@ bool NetworkProtocolSSH::open(PeoplesUrlParser *urlParser, cmdFrame_t *cmdFrame)
     session->opts.config_processed = true;
 #endif
 
+    if (urlParser->query.find("compress") != std::string::npos &&
+        ssh_options_set(session, SSH_OPTIONS_COMPRESSION, SSH_COMPRESSION) < 0)
+        Debug_printf("NetworkProtocolSSH::open() - Compression not available: %s\r\n", ssh_get_error(session));
+
     ret = ssh_connect(session);
     if (ret != SSH_OK)
     {
@@ -206,6 +217,7 @@ bool NetworkProtocolSSH::open(PeoplesUrlParser *urlParser, cmdFrame_t *cmdFrame)
     }
 
     ssh_channel_set_blocking(channel, 0);
+    pendingTx.clear();
 
     // At this point, we should be able to talk to the shell.
     Debug_printf("Shell opened.\r\n");
@@ -231,11 +243,14 @@ bool NetworkProtocolSSH::write(unsigned short len)
     bool err = false;
 
     len = translate_transmit_buffer();
-    ssh_channel_write(channel, transmitBuffer->data(), len);
+    pendingTx.append(*transmitBuffer, 0, len);
+    transmitBuffer->erase(0, len);
+
+    // What the window doesn't take now is sent by the next status poll
+    err = flush_transmit();
 
     // Return success - WTF?
     error = 1;
-    transmitBuffer->erase(0, len);
 
     return err;
 }
@@ -270,20 +285,53 @@ bool NetworkProtocolSSH::special_80(uint8_t *sp_buf, unsigned short len, cmdFram
     return false;
 }
 
-unsigned short NetworkProtocolSSH::available()
+bool NetworkProtocolSSH::flush_transmit()
 {
-    if (receiveBuffer->length() == 0)
+    while (!pendingTx.empty())
     {
-        if (ssh_channel_is_eof(channel) == 0)
+        uint32_t window = ssh_channel_window_size(channel);
+        if (window == 0)
+            break;
+
+        int len = ssh_channel_write(channel, pendingTx.data(), std::min((size_t)window, pendingTx.size()));
+        if (len == SSH_ERROR)
         {
-            int len = ssh_channel_read(channel, rxbuf, RXBUF_SIZE, 0);
-            if (len != SSH_AGAIN)
-            {
-                receiveBuffer->append(rxbuf, len);
-                translate_receive_buffer();
-            }
+            Debug_printf("NetworkProtocolSSH::flush_transmit() - %s\r\n", ssh_get_error(session));
+            pendingTx.clear();
+            return true;
         }
+        if (len <= 0)
+            break;
+        pendingTx.erase(0, len);
+    }
+    return false;
+}
+
+void NetworkProtocolSSH::fill_receive()
+{
+    size_t translated = receiveBuffer->length();
+
+    while (receiveBuffer->length() < RX_WAITING_MAX)
+    {
+        // Handles the packets waiting on the socket, without blocking
+        int waiting = ssh_channel_poll(channel, 0);
+        if (waiting <= 0)
+            break;
+
+        size_t room = std::min((size_t)RXBUF_SIZE, RX_WAITING_MAX - receiveBuffer->length());
+        int len = ssh_channel_read(channel, rxbuf, std::min((size_t)waiting, room), 0);
+        if (len <= 0)
+            break;
+        receiveBuffer->append(rxbuf, len);
     }
 
-    return receiveBuffer->length();
+    translate_receive_buffer(translated);
+}
+
+unsigned short NetworkProtocolSSH::available()
+{
+    flush_transmit();
+    fill_receive();
+
+    return std::min(receiveBuffer->length(), (size_t)RX_WAITING_MAX);
 }
@@ -129,6 +129,23 @@ private:
      */
     char *rxbuf = nullptr;
 
+    /**
+     * Translated data from transmitBuffer the channel window did not take yet
+     */
+    std::string pendingTx;
+
+    /**
+     * Send pendingTx, as much as the remote channel window allows.
+     * @return error flag. TRUE on error, FALSE on success.
+     */
+    bool flush_transmit();
+
+    /**
+     * Append what the channel has received to the receive buffer, until nothing more is
+     * waiting on the socket or the buffer holds 65535 bytes.
+     */
+    void fill_receive();
+
     /**
      * Return if bytes available by injecting into RX buffer.
      * @return number of bytes available
@@ -43,7 +43,7 @@ static void _event_handler(telnet_t *telnet, telnet_event_t *ev, void *user_data
     switch (ev->type)
     {
     case TELNET_EV_DATA: // Received Data
-        *receiveBuffer += std::string(ev->data.buffer, ev->data.size);
+        receiveBuffer->append(ev->data.buffer, ev->data.size);
         protocol->newRxLen = receiveBuffer->size();
         break;
     case TELNET_EV_SEND:
@@ -104,6 +104,7 @@ NetworkProtocolTELNET::~NetworkProtocolTELNET()
  */
 bool NetworkProtocolTELNET::read(unsigned short len)
 {
+    int actual_len = 0;
     std::vector<uint8_t> newData = std::vector<uint8_t>(len);
 
     Debug_printf("NetworkProtocolTELNET::read(%u)\r\n", len);
@@ -118,9 +119,14 @@ bool NetworkProtocolTELNET::read(unsigned short len)
         }
 
         // Do the read from client socket.
-        client.read(newData.data(), len);
+        actual_len = client.read(newData.data(), len);
 
-        telnet_recv(telnet, (char *)newData.data(), len);
+        // Data between telnet commands is appended to receiveBuffer in spans
+        if (actual_len > 0)
+        {
+            receiveBuffer->reserve(receiveBuffer->size() + actual_len);
+            telnet_recv(telnet, (char *)newData.data(), actual_len);
+        }
 
         // bail if the connection is reset.
         if (errno == ECONNRESET)
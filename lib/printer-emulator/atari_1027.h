@@ -16,6 +16,7 @@ protected:
     
     virtual void pdf_clear_modes() override {};
     void pdf_handle_char(uint16_t c, uint8_t aux1, uint8_t aux2) override;
+    bool pdf_plain_text(uint8_t aux1) override { return !escMode && !uscoreFlag; }
     virtual void post_new_file() override;
 public:
     const char *modelname()  override 
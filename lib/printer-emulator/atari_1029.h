@@ -39,6 +39,7 @@ protected:
 
     virtual void pdf_clear_modes() override;
     void pdf_handle_char(uint16_t c, uint8_t aux1, uint8_t aux2) override;
+    bool pdf_plain_text(uint8_t aux1) override { return !escMode && fontNumber == epson_font_lookup(epson_font_mask); }
     virtual void post_new_file() override;
 
 public:
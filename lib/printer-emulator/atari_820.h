@@ -16,6 +16,7 @@ protected:
     virtual void pdf_clear_modes() override {};
     virtual void post_new_file() override;
     void pdf_handle_char(uint16_t c, uint8_t aux1, uint8_t aux2) override; // need a custom one to handle sideways printing
+    bool pdf_plain_text(uint8_t aux1) override { return !sideFlag && aux1 != 'S'; }
 
 public:
     //atari820(sioPrinter *P) { my_sioP = P; }
@@ -38,6 +38,7 @@ protected:
     virtual void pdf_clear_modes() override;
     void at_reset();
     virtual void pdf_handle_char(uint16_t c, uint8_t aux1, uint8_t aux2) override;
+    virtual bool pdf_plain_text(uint8_t aux1) override { return !escMode && fontNumber == epson_font_lookup(epson_font_mask); }
     virtual void post_new_file() override;
 
     // had to use "int" here because "uint16_t" gave a compile error
@@ -1,5 +1,7 @@
 #include "file_printer.h"
 
+#include <string.h>
+
 #include "../../include/debug.h"
 #include "../../include/atascii.h"
 
@@ -13,22 +15,22 @@ bool filePrinter::process_buffer(uint8_t n, uint8_t aux1, uint8_t aux2)
     {
     // Entire record contents are written, even data after the ATASCII_EOL
     case RAW:
-        for (i = 0; i < n; i++)
-            fputc(buffer[i], _file);
+        fwrite(buffer, 1, n, _file);
         break;
     // Everything up to and including the ATASCII_EOL is written without modification
     case TRIM:
-        for (i = 0; i < n; i++)
-        {
-            fputc(buffer[i], _file);
-            if (buffer[i] == ATASCII_EOL)
-                break;
-        }
+    {
+        const uint8_t *eol = (const uint8_t *)memchr(buffer, ATASCII_EOL, n);
+        fwrite(buffer, 1, eol != nullptr ? eol - buffer + 1 : n, _file);
         break;
+    }
     case ASCII:
     default:
+    {
         // Only ASCII-valid characters (including inverse charaters stripped of inverse bit)
         // are written up to the ATASCII_EOL which is converted to ASCII_CRLF
+        char line[sizeof(buffer) + 2];
+        int len = 0;
         for (i = 0; i < n; i++)
         {
 #ifdef BUILD_APPLE
@@ -39,23 +41,25 @@ bool filePrinter::process_buffer(uint8_t n, uint8_t aux1, uint8_t aux2)
             // Handle CR
             if (buffer[i] == 13)
             {
-                fputs(ASCII_CRLF, _file);
+                memcpy(line + len, ASCII_CRLF, 2);
+                len += 2;
                 break;
             }
 #endif /* BUILD_APPLE */
             if (buffer[i] == ATASCII_EOL)
             {
-                fputs(ASCII_CRLF, _file);
+                memcpy(line + len, ASCII_CRLF, 2);
+                len += 2;
                 break;
             }
             // If it's an inverse character, convert to normal
             char c = ATASCII_REMOVE_INVERSE(buffer[i]);
             // If it's a printable character, just copy it
             if (c >= 32 && c <= 122 && c != 96)
-            {
-                fputc(c, _file);
-            }
+                line[len++] = c;
         }
+        fwrite(line, 1, len, _file);
+    }
     }
     return true;
 }
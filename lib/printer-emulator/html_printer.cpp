@@ -114,6 +114,13 @@ void htmlPrinter::pre_close_file()
     inverse = false;
 }
 
+bool htmlPrinter::live_snapshot(std::string &tail)
+{
+    printer_emu::live_snapshot(tail);
+    tail = "</html>";
+    return true;
+}
+
 void htmlPrinter::post_new_file()
 {
     const char *htm1 = "<html><head><meta charset=\"utf-8\"/>\r\n<style>";
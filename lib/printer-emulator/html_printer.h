@@ -13,6 +13,7 @@ private:
 protected:
     virtual void post_new_file() override;
     virtual void pre_close_file() override;
+    virtual bool live_snapshot(std::string &tail) override;
     virtual bool process_buffer(uint8_t linelen, uint8_t aux1, uint8_t aux2) override;
 
 public:
@@ -59,6 +59,7 @@ protected:
     
     virtual void pdf_clear_modes() override;
     virtual void pdf_handle_char(uint16_t c, uint8_t aux1, uint8_t aux2) override;
+    virtual bool pdf_plain_text(uint8_t aux1) override { return false; } // typeface and color change per character
     virtual void post_new_file() override;
 
 public:
@@ -1,10 +1,132 @@
 #include "pdf_printer.h"
 
+#ifdef ESP_PLATFORM
+#include "esp_heap_caps.h"
+#endif
+
+#include <stdarg.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+
 #include "../../include/debug.h"
 
 #include "fsFlash.h"
 
-#include "utils.h"
+// Number of "%d" placeholders for object numbers in a font file (/f/<shortname>/F<n>)
+#define PDF_FONT_PLACEHOLDERS 7
+#define PDF_FONT_COPY_BUFLEN 2048
+
+/* Font objects of a printer model (/f/<shortname>/), loaded from flash once on first use.
+   Each font file is a font dictionary, descriptor, widths and font file object with
+   "%d" placeholders for their object numbers, the LUT file has the offsets of the
+   placeholders (after the first one at 0) and the file length.
+*/
+struct pdf_font_t
+{
+    size_t pos[PDF_FONT_PLACEHOLDERS]; // from LUT
+    uint8_t *data = nullptr;           // whole font file, nullptr if not loaded (or no memory for it)
+};
+
+struct pdf_font_set_t
+{
+    int count = 0;
+    pdf_font_t fonts[MAXFONTS];
+};
+
+// Object number written in place of each placeholder, relative to the object counter
+// before the font, and whether the placeholder starts that object (or just refers to it)
+static const struct
+{
+    uint8_t obj;
+    bool start;
+} pdf_font_placeholders[PDF_FONT_PLACEHOLDERS] = {
+    {1, true}, {2, false}, {4, false}, {2, true}, {3, false}, {3, true}, {4, true}};
+
+static std::map<std::string, pdf_font_set_t> pdf_font_cache;
+
+static pdf_font_set_t &pdf_get_font_set(const std::string &shortname)
+{
+    auto it = pdf_font_cache.find(shortname);
+    if (it != pdf_font_cache.end())
+        return it->second;
+
+    char fname[30];
+    snprintf(fname, sizeof(fname), "/f/%s/LUT", shortname.c_str());
+    FILE *lut = fsFlash.file_open(fname);
+    if (lut == nullptr)
+    {
+        // not cached, the next page tries again
+        Debug_printf("Failed to open font table \"%s\"\r\n", fname);
+        static pdf_font_set_t no_fonts;
+        return no_fonts;
+    }
+
+    pdf_font_set_t &set = pdf_font_cache[shortname];
+    char buf[MAXFONTS * PDF_FONT_PLACEHOLDERS * 8];
+    size_t len = fread(buf, 1, sizeof(buf) - 1, lut);
+    fclose(lut);
+    buf[len] = '\0';
+
+    // font count, then a line of placeholder offsets for each font
+    char *p = buf;
+    set.count = strtol(p, &p, 10);
+    if (set.count > MAXFONTS)
+        set.count = MAXFONTS;
+    for (int i = 0; i < set.count; i++)
+        for (int j = 0; j < PDF_FONT_PLACEHOLDERS; j++)
+            set.fonts[i].pos[j] = strtoul(p, &p, 10);
+
+    return set;
+}
+
+// Load font file into memory, returns false if there is no memory for it
+static bool pdf_load_font(pdf_font_t &font, FILE *fff)
+{
+    size_t size = font.pos[PDF_FONT_PLACEHOLDERS - 1];
+#ifdef ESP_PLATFORM
+    font.data = (uint8_t *)heap_caps_malloc(size, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
+#else
+    font.data = (uint8_t *)malloc(size);
+#endif
+    if (font.data == nullptr)
+        return false;
+    if (fread(font.data, 1, size, fff) != size)
+    {
+        free(font.data);
+        font.data = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void pdf_writer::write(const void *data, size_t len)
+{
+    if (file != nullptr)
+        fwrite(data, 1, len, file);
+    else
+        str->append((const char *)data, len);
+    location += len;
+}
+
+void pdf_writer::printf(const char *fmt, ...)
+{
+    char buf[128];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    if (len > 0)
+        write(buf, std::min((size_t)len, sizeof(buf) - 1));
+}
+
+void pdfPrinter::pdf_set_location(int obj, size_t location)
+{
+    if (obj >= (int)objLocations.size())
+        objLocations.resize(obj + 1);
+    objLocations[obj] = location;
+}
 
 void pdfPrinter::pdf_header()
 {
@@ -12,33 +134,41 @@ void pdfPrinter::pdf_header()
     pdf_Y = 0;
     pdf_X = 0;
     pdf_pageCounter = 0;
+    pageObjects.clear();
+    objLocations.clear();
     fprintf(_file, "%%PDF-1.4\n");
     // first object: catalog of pages
     pdf_objCtr = 1;
-    objLocations[pdf_objCtr] = ftell(_file);
+    pdf_set_location(pdf_objCtr, ftell(_file));
     fprintf(_file, "1 0 obj\n<</Type /Catalog /Pages 2 0 R>>\nendobj\n");
     // object 2 0 R is printed by pdf_page_resource() before xref
     // object 3 0 R is printed at pdf_font_resource() before xref
     pdf_objCtr = 3; // set up counter for pdf_add_font()
+    pdf_committed_objCtr = pdf_objCtr;
 }
 
-void pdfPrinter::pdf_page_resource()
+void pdfPrinter::pdf_page_resource(pdf_writer &out)
 {
-    objLocations[2] = ftell(_file); // hard code page catalog as object #2
-    fprintf(_file, "2 0 obj\n<</Type /Pages /Kids [ ");
+    pdf_set_location(2, out.location); // hard code page catalog as object #2
+    std::string res = "2 0 obj\n<</Type /Pages /Kids [ ";
+    char num[16];
     for (int i = 0; i < pdf_pageCounter; i++)
     {
-        fprintf(_file, "%d 0 R ", pageObjects[i]);
+        snprintf(num, sizeof(num), "%d 0 R ", pageObjects[i]);
+        res += num;
     }
-    fprintf(_file, "] /Count %d>>\nendobj\n", pdf_pageCounter);
+    snprintf(num, sizeof(num), "] /Count %d", pdf_pageCounter);
+    res += num;
+    res += ">>\nendobj\n";
+    out.write(res.data(), res.size());
 }
 
-void pdfPrinter::pdf_font_resource()
+void pdfPrinter::pdf_font_resource(pdf_writer &out)
 {
     int fntCtr = 0;
-    objLocations[3] = ftell(_file);
+    pdf_set_location(3, out.location);
     // font catalog
-    fprintf(_file, "3 0 obj\n<</Font <<");
+    out.printf("3 0 obj\n<</Font <<");
     for (int i = 0; i < MAXFONTS; i++)
     {
         if (fontUsed[i])
@@ -48,127 +178,98 @@ void pdfPrinter::pdf_font_resource()
             //  font descriptor
             //  font widths
             //  font file
-            fprintf(_file, "/F%d %d 0 R ", i + 1, pdf_objCtr + 1 + fntCtr * 4); /// F1 4 0 R /F2 8 0 R>>>>\nendobj\n
+            out.printf("/F%d %d 0 R ", i + 1, pdf_objCtr + 1 + fntCtr * 4); /// F1 4 0 R /F2 8 0 R>>>>\nendobj\n
             fntCtr++;
         }
     }
-    fprintf(_file, ">>>>\nendobj\n");
+    out.printf(">>>>\nendobj\n");
 }
 
-void pdfPrinter::pdf_add_fonts() // pdfFont_t *fonts[],
+void pdfPrinter::pdf_add_fonts(pdf_writer &out)
 {
     Debug_print("pdf add fonts: ");
 
-    // OPEN LUT FILE
-    char fname[30]; // filename: /f/shortname/Fi
-    sprintf(fname, "/f/%s/LUT", shortname.c_str());
-    FILE *lut = fsFlash.file_open(fname);
-    int maxFonts = util_parseInt(lut);
+    pdf_font_set_t &set = pdf_get_font_set(shortname);
+    uint8_t *copybuf = nullptr;
 
     // font dictionary
-    for (int i = 0; i < maxFonts; i++)
+    for (int i = 0; i < set.count; i++)
     {
+        if (!fontUsed[i])
+        {
+            Debug_print("unused; ");
+            continue;
+        }
         Debug_printf("font %d - ", i + 1);
-        // READ LINE IN LUT FILE
-        size_t fontObjPos[7];
-        for (int j = 0; j < 7; j++)
-            fontObjPos[j] = util_parseInt(lut);
 
-        // assign fontObjPos[] matrix
-        if (fontUsed[i])
+        pdf_font_t &font = set.fonts[i];
+        FILE *fff = nullptr; // Font File File - fff
+        if (font.data == nullptr)
         {
-            size_t fp = 0;
-            char fname[30];                                        // filename: /f/shortname/Fi
-            sprintf(fname, "/f/%s/F%d", shortname.c_str(), i + 1); // e.g. /f/a820/F2
-            FILE *fff = fsFlash.file_open(fname);                 // Font File File - fff
-
-            fgetc(fff); // '%'
-            fp++;
-            fgetc(fff); // 'd'
-            fp++;
-            pdf_objCtr++; // = 6;
-            objLocations[pdf_objCtr] = ftell(_file);
-            fprintf(_file, "%d", pdf_objCtr); // 6
-            while (fp < fontObjPos[0])
-            {
-                fputc(fgetc(fff), _file);
-                fp++;
-            }
-            fgetc(fff); // '%'
-            fp++;
-            fgetc(fff); // 'd'
-            fp++;
-            fprintf(_file, "%d", pdf_objCtr + 1); // 7
-            while (fp < fontObjPos[1])
-            {
-                fputc(fgetc(fff), _file);
-                fp++;
-            }
-            fgetc(fff); // '%'
-            fp++;
-            fgetc(fff); // 'd'
-            fp++;
-            fprintf(_file, "%d", pdf_objCtr + 3); // 9
-            while (fp < fontObjPos[2])
+            char fname[30];                                                  // filename: /f/shortname/Fi
+            snprintf(fname, sizeof(fname), "/f/%s/F%d", shortname.c_str(), i + 1); // e.g. /f/a820/F2
+            fff = fsFlash.file_open(fname);
+            if (fff == nullptr)
             {
-                fputc(fgetc(fff), _file);
-                fp++;
+                Debug_printf("Failed to open font \"%s\"\r\n", fname);
+                continue;
             }
-            fgetc(fff); // '%'
-            fp++;
-            fgetc(fff); // 'd'
-            fp++;
-            pdf_objCtr++; // = 7;
-            objLocations[pdf_objCtr] = ftell(_file);
-            fprintf(_file, "%d", pdf_objCtr); // 7
-            while (fp < fontObjPos[3])
+            if (pdf_load_font(font, fff))
             {
-                fputc(fgetc(fff), _file);
-                fp++;
+                fclose(fff);
+                fff = nullptr;
             }
-            fgetc(fff); // '%'
-            fp++;
-            fgetc(fff); // 'd'
-            fp++;
-            fprintf(_file, "%d", pdf_objCtr + 1); // 8
-            while (fp < fontObjPos[4])
+            else
             {
-                fputc(fgetc(fff), _file);
-                fp++;
+                // no memory to keep it, copy from flash in chunks
+                if (copybuf == nullptr)
+                    copybuf = (uint8_t *)malloc(PDF_FONT_COPY_BUFLEN);
+                if (copybuf == nullptr)
+                {
+                    fclose(fff);
+                    continue;
+                }
             }
-            fgetc(fff); // '%'
-            fp++;
-            fgetc(fff); // 'd'
-            fp++;
-            pdf_objCtr++; // = 8;
-            objLocations[pdf_objCtr] = ftell(_file);
-            fprintf(_file, "%d", pdf_objCtr); // 8
-            while (fp < fontObjPos[5])
+        }
+
+        // replace each "%d" placeholder with the object number, copy what follows up to the next one
+        size_t fp = 0;
+        for (int j = 0; j < PDF_FONT_PLACEHOLDERS; j++)
+        {
+            int obj = pdf_objCtr + pdf_font_placeholders[j].obj;
+            if (pdf_font_placeholders[j].start)
+                pdf_set_location(obj, out.location);
+            out.printf("%d", obj);
+            fp += 2;
+
+            size_t end = font.pos[j];
+            if (end < fp)
+                break;
+            if (fff == nullptr)
             {
-                fputc(fgetc(fff), _file);
-                fp++;
+                out.write(font.data + fp, end - fp);
             }
-            fgetc(fff); // '%'
-            fp++;
-            fgetc(fff); // 'd'
-            fp++;
-            pdf_objCtr++; // = 9;
-            objLocations[pdf_objCtr] = ftell(_file);
-            fprintf(_file, "%d", pdf_objCtr); // 9
-            // insert rest of file
-            while (fp < fontObjPos[6]) //(fff.available())
+            else
             {
-                fputc(fgetc(fff), _file);
-                fp++;
+                fseek(fff, fp, SEEK_SET);
+                for (size_t n = fp; n < end;)
+                {
+                    size_t count = fread(copybuf, 1, std::min((size_t)PDF_FONT_COPY_BUFLEN, end - n), fff);
+                    if (count == 0)
+                        break;
+                    out.write(copybuf, count);
+                    n += count;
+                }
             }
-            fclose(fff);
-            fputc('\n', _file); // make sure there's a seperator
+            fp = end;
         }
-        else
-            Debug_print("unused; ");
+        pdf_objCtr += 4;
+        if (fff != nullptr)
+            fclose(fff);
+        out.write("\n", 1); // make sure there's a seperator
     }
 
-    fclose(lut);
+    free(copybuf);
     Debug_println("done.");
 }
 
@@ -176,18 +277,19 @@ void pdfPrinter::pdf_new_page()
 { // open a new page
     Debug_println("pdf new page");
     pdf_objCtr++;
-    pageObjects[pdf_pageCounter] = pdf_objCtr;
-    objLocations[pdf_objCtr] = ftell(_file);
-    fprintf(_file, "%d 0 obj\n<</Type /Page /Parent 2 0 R /Resources 3 0 R /MediaBox [0 0 %g %g] /Contents [ ", pdf_objCtr, pageWidth, pageHeight);
-    pdf_objCtr++; // increment for the contents stream object
-    fprintf(_file, "%d 0 R ", pdf_objCtr);
-    fprintf(_file, "]>>\nendobj\n");
+    pageObjects.push_back(pdf_objCtr);
+    pdf_set_location(pdf_objCtr, ftell(_file));
+    // contents stream object, its length is an indirect object written at the end of the page
+    // (no need to go back and patch the stream header)
+    int contents = pdf_objCtr + 1;
+    fprintf(_file, "%d 0 obj\n<</Type /Page /Parent 2 0 R /Resources 3 0 R /MediaBox [0 0 %g %g] /Contents [ %d 0 R ]>>\nendobj\n",
+            pdf_objCtr, pageWidth, pageHeight, contents);
+    pdf_objCtr++;
 
     // open content stream
-    objLocations[pdf_objCtr] = ftell(_file);
-    fprintf(_file, "%d 0 obj\n<</Length ", pdf_objCtr);
-    idx_stream_length = ftell(_file);
-    fprintf(_file, "0000000000 >>\nstream\n");
+    pdf_set_location(pdf_objCtr, ftell(_file));
+    fprintf(_file, "%d 0 obj\n<</Length %d 0 R>>\nstream\n", pdf_objCtr, pdf_objCtr + 1);
+    pdf_objCtr++; // stream length object
     idx_stream_start = ftell(_file);
 
     // open new text object
@@ -249,33 +351,46 @@ void pdfPrinter::pdf_end_page()
     fprintf(_file, "ET\n");
     idx_stream_stop = ftell(_file);
     fprintf(_file, "endstream\nendobj\n");
-    size_t idx_temp = ftell(_file);
-    fflush(_file);
-    fseek(_file, idx_stream_length, SEEK_SET);
-    fprintf(_file, "%10u", (unsigned)(idx_stream_stop - idx_stream_start));
-    fflush(_file);
-    fseek(_file, idx_temp, SEEK_SET);
+    // stream length object
+    pdf_set_location(pdf_objCtr, ftell(_file));
+    fprintf(_file, "%d 0 obj\n%u\nendobj\n", pdf_objCtr, (unsigned)(idx_stream_stop - idx_stream_start));
     // set counters
     pdf_pageCounter++;
     TOPflag = true;
+    pdf_committed_objCtr = pdf_objCtr;
+    page_completed();
 }
 
-void pdfPrinter::pdf_xref()
+void pdfPrinter::pdf_xref(pdf_writer &out)
 {
     Debug_println("pdf xref");
-    size_t xref = ftell(_file);
+    size_t xref = out.location;
     pdf_objCtr++;
-    fprintf(_file, "xref\n");
-    fprintf(_file, "0 %d\n", pdf_objCtr);
-    fprintf(_file, "0000000000 65535 f\n");
+    out.printf("xref\n0 %d\n", pdf_objCtr);
+
+    // fixed size 20 byte entries (with 2 character EOL), written in one go
+    std::string table(pdf_objCtr * 20, ' ');
+    memcpy(&table[0], "0000000000 65535 f \n", 20);
     for (int i = 1; i < pdf_objCtr; i++)
     {
-        fprintf(_file, "%010u 00000 n\n", (unsigned)objLocations[i]);
+        char *entry = &table[i * 20];
+        unsigned v = i < (int)objLocations.size() ? (unsigned)objLocations[i] : 0;
+        for (int d = 9; d >= 0; d--, v /= 10)
+            entry[d] = '0' + v % 10;
+        memcpy(entry + 10, " 00000 n \n", 10);
     }
-    fprintf(_file, "trailer <</Size %d/Root 1 0 R>>\n", pdf_objCtr);
-    fprintf(_file, "startxref\n");
-    fprintf(_file, "%u\n", (unsigned)xref);
-    fprintf(_file, "%%%%EOF\n");
+    out.write(table.data(), table.size());
+
+    out.printf("trailer <</Size %d/Root 1 0 R>>\nstartxref\n%u\n%%%%EOF\n", pdf_objCtr, (unsigned)xref);
+}
+
+// Font and page catalogs, fonts and xref which follow the pages
+void pdfPrinter::pdf_trailer(pdf_writer &out)
+{
+    pdf_font_resource(out);
+    pdf_add_fonts(out);
+    pdf_page_resource(out);
+    pdf_xref(out);
 }
 
 bool pdfPrinter::process_buffer(uint8_t n, uint8_t aux1, uint8_t aux2)
@@ -349,6 +464,15 @@ bool pdfPrinter::process_buffer(uint8_t n, uint8_t aux1, uint8_t aux2)
         pdf_new_page();
 #endif // BUILD_APPLE
 
+        // plain text doesn't need per character handling
+        if (textMode && colorMode == colorMode_t::off && !_eol_bypass && !BOLflag && !TOPflag &&
+            pdf_Y >= bottomMargin && pdf_plain_text(aux1))
+        {
+            i = pdf_text_run(i, n);
+            if (i >= n)
+                break;
+        }
+
         c = buffer[i++];
 #ifdef BUILD_APPLE
         if (textMode == true)
@@ -405,6 +529,33 @@ bool pdfPrinter::process_buffer(uint8_t n, uint8_t aux1, uint8_t aux2)
     return true;
 }
 
+// Write plain characters from buffer[i] on in one go, up to the first one which needs
+// pdf_handle_char() or the end of the line. Returns index of the next character to process.
+int pdfPrinter::pdf_text_run(int i, int n)
+{
+    char run[2 * sizeof(buffer)];
+    size_t len = 0;
+
+    // same test for automatic CR as in process_buffer()
+    while (i < n && !(pdf_X > (printWidth - charWidth + .072)))
+    {
+        uint8_t c = buffer[i];
+#ifdef BUILD_APPLE
+        c &= 0x7F;
+#endif // BUILD_APPLE
+        if (c < 32 || c > 122 || c == 96 || c == _eol)
+            break;
+        if (c == '\\' || c == '(' || c == ')')
+            run[len++] = '\\';
+        run[len++] = c;
+        pdf_X += charWidth; // update x position
+        i++;
+    }
+
+    fwrite(run, 1, len, _file);
+    return i;
+}
+
 void pdfPrinter::pre_close_file()
 {
     if (TOPflag && pdf_pageCounter == 0)
@@ -414,10 +565,31 @@ void pdfPrinter::pre_close_file()
     if (!TOPflag || pdf_pageCounter == 0)
         pdf_end_page();
 
-    pdf_font_resource();
-    pdf_add_fonts();
-    pdf_page_resource();
-    pdf_xref();
+    pdf_writer out;
+    out.file = _file;
+    out.location = ftell(_file);
+    pdf_trailer(out);
 
     // printer_emu::pageEject();
 }
+
+// Complete pages followed by trailer generated for them, the page in progress is left out
+bool pdfPrinter::live_snapshot(std::string &tail)
+{
+    if (pdf_pageCounter == 0)
+        return false;
+
+    // trailer objects are numbered after the last complete page, keep state of the job
+    int objCtr = pdf_objCtr;
+    std::vector<size_t> locations = objLocations;
+    pdf_objCtr = pdf_committed_objCtr;
+
+    pdf_writer out;
+    out.str = &tail;
+    out.location = _committed;
+    pdf_trailer(out);
+
+    pdf_objCtr = objCtr;
+    objLocations.swap(locations);
+    return true;
+}
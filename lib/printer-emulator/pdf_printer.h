@@ -5,6 +5,7 @@
  inherited from by other, full-fledged printer classes (e.g. Atari 820/822)
 */
 #include <string>
+#include <vector>
 
 #include "../../include/atascii.h"
 
@@ -22,6 +23,17 @@ enum class colorMode_t
     process
 };
 
+// Destination of the document trailer: the output file, or a string for a live view of a job in progress
+struct pdf_writer
+{
+    FILE *file = nullptr;
+    std::string *str = nullptr;
+    size_t location = 0; // offset in the document
+
+    void write(const void *data, size_t len);
+    void printf(const char *fmt, ...);
+};
+
 class pdfPrinter : public printer_emu
 {
 protected:
@@ -47,32 +59,40 @@ protected:
     bool textMode = true;
     colorMode_t colorMode = colorMode_t::off;
 
-    int pageObjects[256];
+    std::vector<int> pageObjects;
     int pdf_pageCounter = 0.;
-    size_t objLocations[256]; // reference table storage
+    std::vector<size_t> objLocations; // reference table storage
     int pdf_objCtr = 0;       // count the objects
+    int pdf_committed_objCtr = 0; // object counter at end of last complete page
+
+    void pdf_set_location(int obj, size_t location);
 
     void pdf_header();
-    void pdf_add_fonts(); // pdfFont_t *fonts[],
     void pdf_new_page();
     void pdf_begin_text(double Y);
     void pdf_new_line();
     void pdf_end_line();
     void pdf_set_rise();
     void pdf_end_page();
-    void pdf_page_resource();
-    void pdf_font_resource();
-    void pdf_xref();
+    void pdf_page_resource(pdf_writer &out);
+    void pdf_font_resource(pdf_writer &out);
+    void pdf_add_fonts(pdf_writer &out);
+    void pdf_xref(pdf_writer &out);
+    void pdf_trailer(pdf_writer &out);
 
-    size_t idx_stream_length = 0; // file location of stream length indictor
     size_t idx_stream_start = 0;  // file location of start of stream
     size_t idx_stream_stop = 0;   // file location of end of stream
 
     virtual void pdf_clear_modes() = 0;
     virtual void pdf_handle_char(uint16_t c, uint8_t aux1, uint8_t aux2) = 0;
+    // True if characters 32..122 (except 96) are currently printed as themselves, one charWidth
+    // each, so runs of them can be written at once by pdf_text_run() instead of pdf_handle_char()
+    virtual bool pdf_plain_text(uint8_t aux1) { return false; }
+    int pdf_text_run(int i, int n);
     virtual bool process_buffer(uint8_t linelen, uint8_t aux1, uint8_t aux2) override;
 
     virtual void pre_close_file() override;
+    virtual bool live_snapshot(std::string &tail) override;
 
 public:
 
@@ -1,82 +1,173 @@
 #include "png_printer.h"
 
+#ifdef ESP_PLATFORM
+#include "esp_heap_caps.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
 #include "../../include/debug.h"
 
 
 // rewrite of TinyPngOut https://www.nayuki.io/page/tiny-png-output
 
-#define DEFLATE_MAX_BLOCK_SIZE 0xFFFF
+#define PNG_MIN_MATCH 3
+#define PNG_MAX_MATCH 258
+#define ADLER_MOD 65521
+#define ADLER_NMAX 5552 // most bytes which can be summed before s2 could overflow 32 bits
 
-void pngPrinter::uint32_to_array(uint32_t src, uint8_t dest[4])
+// Lookup tables, built once on first use (C++11 guarantees thread safe initialization)
+struct png_tables
 {
-    dest[0] = (uint8_t)((src >> 24) & 0xff);
-    dest[1] = (uint8_t)((src >> 16) & 0xff);
-    dest[2] = (uint8_t)((src >> 8) & 0xff);
-    dest[3] = (uint8_t)(src & 0xff);
+    uint32_t crc[8][256];       // slicing-by-8 CRC-32 tables
+    uint16_t lit_code[288];     // fixed Huffman literal/length codes, bit reversed
+    uint8_t lit_bits[288];
+    uint8_t dist_rev[30];       // fixed Huffman distance codes (5 bits), bit reversed
+    uint8_t len_code[PNG_MAX_MATCH + 1]; // match length -> length code index
+    uint8_t dist_code[512];     // distance - 1 -> distance code, see dist_index()
+
+    png_tables();
+};
+
+// RFC 1951 3.2.5 length and distance codes
+static const uint16_t len_base[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                      35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t len_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                      3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t dist_base[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                       257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t dist_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                       7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+static uint16_t bit_reverse(uint16_t code, uint8_t bits)
+{
+    uint16_t r = 0;
+    for (uint8_t i = 0; i < bits; i++)
+    {
+        r = (r << 1) | (code & 1);
+        code >>= 1;
+    }
+    return r;
 }
 
-uint32_t pngPrinter::update_adler32(uint32_t adler, uint8_t data)
+png_tables::png_tables()
 {
-    // https://gist.github.com/kornelski/710db9d30a64db0807c5bfbdbdecf85e
-    unsigned s1 = adler & 0xffff;
-    unsigned s2 = (adler >> 16) & 0xffff;
+    // https://rosettacode.org/wiki/CRC-32#Implementation_2
+    for (int i = 0; i < 256; i++)
+    {
+        uint32_t rem = i;
+        for (int j = 0; j < 8; j++)
+            rem = (rem & 1) ? (rem >> 1) ^ 0xedb88320 : rem >> 1;
+        crc[0][i] = rem;
+    }
+    for (int i = 0; i < 256; i++)
+        for (int t = 1; t < 8; t++)
+            crc[t][i] = (crc[t - 1][i] >> 8) ^ crc[0][crc[t - 1][i] & 0xff];
 
-    s1 += data;
-    s1 %= 65521;
+    // RFC 1951 3.2.6 fixed Huffman codes
+    for (int i = 0; i < 288; i++)
+    {
+        if (i < 144)
+            lit_code[i] = bit_reverse(0x30 + i, lit_bits[i] = 8);
+        else if (i < 256)
+            lit_code[i] = bit_reverse(0x190 + i - 144, lit_bits[i] = 9);
+        else if (i < 280)
+            lit_code[i] = bit_reverse(i - 256, lit_bits[i] = 7);
+        else
+            lit_code[i] = bit_reverse(0xc0 + i - 280, lit_bits[i] = 8);
+    }
+    for (int i = 0; i < 30; i++)
+        dist_rev[i] = bit_reverse(i, 5);
 
-    s2 += s1;
-    s2 %= 65521;
+    for (int c = 0; c < 29; c++)
+        for (int len = len_base[c]; len < len_base[c] + (1 << len_extra[c]) && len <= PNG_MAX_MATCH; len++)
+            len_code[len] = c;
+    len_code[PNG_MAX_MATCH] = 28; // 258 has its own code
 
-    return (s2 << 16) | s1;
+    for (int c = 0; c < 30; c++)
+        for (int d = dist_base[c]; d < dist_base[c] + (1 << dist_extra[c]); d++)
+        {
+            if (d <= 256)
+                dist_code[d - 1] = c;
+            else
+                dist_code[256 + ((d - 1) >> 7)] = c;
+        }
 }
 
-uint32_t pngPrinter::rc_crc32(uint32_t crc, const uint8_t *buf, size_t len)
-// https://rosettacode.org/wiki/CRC-32#Implementation_2
+static const png_tables &png_get_tables()
 {
-    static uint32_t table[256];
-    static int have_table = 0;
-    uint32_t rem;
-    uint8_t octet;
-    int i, j;
-    const uint8_t *p, *q;
-
-    /* This check is not thread safe; there is no mutex. */
-    if (have_table == 0)
-    {
-        /* Calculate CRC table. */
-        for (i = 0; i < 256; i++)
-        {
-            rem = i; /* remainder from polynomial division */
-            for (j = 0; j < 8; j++)
-            {
-                if (rem & 1)
-                {
-                    rem >>= 1;
-                    rem ^= 0xedb88320;
-                }
-                else
-                    rem >>= 1;
-            }
-            table[i] = rem;
-        }
-        have_table = 1;
-    }
+    static const png_tables tables;
+    return tables;
+}
+
+static inline uint8_t dist_index(const png_tables &t, uint16_t dist)
+{
+    return dist <= 256 ? t.dist_code[dist - 1] : t.dist_code[256 + ((dist - 1) >> 7)];
+}
+
+static uint32_t png_crc32(uint32_t crc, const uint8_t *buf, size_t len)
+{
+    const png_tables &t = png_get_tables();
 
     crc = ~crc;
-    q = buf + len;
-    for (p = buf; p < q; p++)
+    // slicing-by-8: fold 8 bytes per step with independent table lookups
+    while (len >= 8)
     {
-        octet = *p; /* Cast to unsigned octet. */
-        crc = (crc >> 8) ^ table[(crc & 0xff) ^ octet];
+        uint32_t lo = crc ^ (buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t)buf[3] << 24));
+        uint32_t hi = buf[4] | (buf[5] << 8) | (buf[6] << 16) | ((uint32_t)buf[7] << 24);
+        crc = t.crc[7][lo & 0xff] ^ t.crc[6][(lo >> 8) & 0xff] ^ t.crc[5][(lo >> 16) & 0xff] ^ t.crc[4][lo >> 24] ^
+              t.crc[3][hi & 0xff] ^ t.crc[2][(hi >> 8) & 0xff] ^ t.crc[1][(hi >> 16) & 0xff] ^ t.crc[0][hi >> 24];
+        buf += 8;
+        len -= 8;
     }
+    while (len--)
+        crc = (crc >> 8) ^ t.crc[0][(crc ^ *buf++) & 0xff];
     return ~crc;
 }
 
-// uint32_t pngPrinter::rc_crc32(uint32_t crc, uint8_t c)
-// // pass a single character
-// {
-//     rc_crc32(crc, &c, 1);
-// }
+static uint32_t png_adler32(uint32_t adler, const uint8_t *buf, size_t len)
+{
+    // https://gist.github.com/kornelski/710db9d30a64db0807c5bfbdbdecf85e
+    // sums are reduced once per ADLER_NMAX bytes instead of once per byte
+    uint32_t s1 = adler & 0xffff;
+    uint32_t s2 = (adler >> 16) & 0xffff;
+
+    while (len > 0)
+    {
+        size_t n = len < ADLER_NMAX ? len : ADLER_NMAX;
+        len -= n;
+        while (n >= 8)
+        {
+            s1 += buf[0]; s2 += s1;
+            s1 += buf[1]; s2 += s1;
+            s1 += buf[2]; s2 += s1;
+            s1 += buf[3]; s2 += s1;
+            s1 += buf[4]; s2 += s1;
+            s1 += buf[5]; s2 += s1;
+            s1 += buf[6]; s2 += s1;
+            s1 += buf[7]; s2 += s1;
+            buf += 8;
+            n -= 8;
+        }
+        while (n--)
+        {
+            s1 += *buf++;
+            s2 += s1;
+        }
+        s1 %= ADLER_MOD;
+        s2 %= ADLER_MOD;
+    }
+    return (s2 << 16) | s1;
+}
+
+void pngPrinter::uint32_to_array(uint32_t src, uint8_t dest[4])
+{
+    dest[0] = (uint8_t)((src >> 24) & 0xff);
+    dest[1] = (uint8_t)((src >> 16) & 0xff);
+    dest[2] = (uint8_t)((src >> 8) & 0xff);
+    dest[3] = (uint8_t)(src & 0xff);
+}
 
 void pngPrinter::png_signature()
 {
@@ -111,7 +202,7 @@ void pngPrinter::png_header()
         0x08,                   // 16       1 byte depth
         0x03,                   // 17       0x03 color with palette
         0x00,                   // 18       compression method always 0
-        0x00,                   // 19       no filter
+        0x00,                   // 19       filter method 0 (adaptive, type byte per line)
         0x00,                   // 20       no interlace
         0, 0, 0, 0,             // 21-24    IHDR CRC-32 placeholder
     };
@@ -126,7 +217,7 @@ void pngPrinter::png_header()
         chunk type code and chunk data fields, but 
         not including the length field.
     */
-    crc_value = rc_crc32(0, &header[4], 17);
+    crc_value = png_crc32(0, &header[4], 17);
     uint32_to_array(crc_value, &header[21]);
     fwrite(header, 1, 25, _file);
 }
@@ -189,7 +280,7 @@ void pngPrinter::png_palette()
     uint8_t ccc[] = {0, 0, 0, 0}; // crc placeholder
 
     uint32_to_array(768, &len[0]);
-    crc_value = rc_crc32(0, &data[0], 4 + 768);
+    crc_value = png_crc32(0, &data[0], 4 + 768);
     uint32_to_array(crc_value, &ccc[0]);
 
     fwrite(len, 1, 4, _file);
@@ -219,140 +310,178 @@ void pngPrinter::png_data()
     significance and can occur at any point in the compressed datastream
 */
     Debug_println("Starting PNG Image Data...");
-    uint8_t data[] = {
-        // IDAT chunk
-        0x00, 0x00, 0x00, 0x00, // 0-3      size placeholder
-        'I', 'D', 'A', 'T',     // 4-7      IDAT
-    };
-    crc_value = rc_crc32(0, &data[4], 4); // begin CRC calculation
-
-    // Compute data size
-    // imgSize = (width + 1) * height; // +1 per line for filter 0's
-    uint32_t numBlocks = imgSize / DEFLATE_MAX_BLOCK_SIZE;
-    if (imgSize % DEFLATE_MAX_BLOCK_SIZE != 0)
-        numBlocks++; // Round up
-
-    dataSize += numBlocks * 5; // 5 bytes per DEFLATE uncompressed block header
-    dataSize += 2;             // 2 bytes for zlib header
-    dataSize += 4;             // 4 bytes for zlib Adler-32 checksum
-    dataSize += imgSize;       // plus the image data
-
-    uint32_to_array(dataSize, &data[0]); // store the computed size
+    // Deflate-compressed datastreams within PNG are stored in the “zlib” format
+    // https://tools.ietf.org/html/rfc1950#page-4
+    // CMF 0x78: deflate with 32K window, FLG 0x01: CMF*256 + FLG is a multiple of 31
+    bufs->idat_buf[idat_len++] = 0x78;
+    bufs->idat_buf[idat_len++] = 0x01;
 
-    fwrite(data, 1, 8, _file); // write out the IDAT header
+    // whole image is one final block with fixed Huffman codes (BFINAL = 1, BTYPE = 01)
+    deflate_bits(1, 1);
+    deflate_bits(1, 2);
 }
 
-void pngPrinter::png_add_data(uint8_t *buf, uint32_t n)
+void pngPrinter::deflate_bits(uint32_t bits, uint8_t count)
 {
-    uint8_t c = 0;
-    // Deflate-compressed datastreams within PNG are stored in the “zlib” format
-    // https://tools.ietf.org/html/rfc1950#page-4
-
-    if (img_pos == 0)
+    // DEFLATE packs bits starting with the least significant bit of each byte
+    bit_buf |= bits << bit_count;
+    bit_count += count;
+    while (bit_count >= 8)
     {
-        Debug_println("Writing ZLIB header.");
-        // write out a ZLIB header
-        // Compression method/flags code: 1 byte (For PNG compression method 0, the zlib compression method/flags code must specify method code 8 (“deflate” compression))
-        c = 0x08; // ZLIB "Deflate" compression scheme
-        crc_value = rc_crc32(crc_value, c);
-        fputc(c, _file);
-        //  Additional flags/check bits: 1 byte (must be such that method + flags, when viewed as a 16-bit unsigned integer stored in MSB order (CMF*256 + FLG), is a multiple of 31.)
-        c = 0x1D; // precompute so that 0x081D is divisible by 31 [ (0x800 / 31 + 1) * 31 - 0x800 ]
-        crc_value = rc_crc32(crc_value, c);
-        fputc(c, _file);
-
-        //printf("new image\r\n");
+        bufs->idat_buf[idat_len++] = bit_buf & 0xff;
+        bit_buf >>= 8;
+        bit_count -= 8;
     }
+}
+
+// Compress one filtered line, matches are searched in the last PNG_WINDOW_SIZE bytes
+void pngPrinter::deflate_line(const uint8_t *line, uint16_t len)
+{
+    const png_tables &t = png_get_tables();
+    const uint32_t mask = PNG_WINDOW_SIZE - 1;
+    const uint32_t stride = width + 1;
+
+    // worst case is every byte as 9 bit literal
+    if (idat_len + len + len / 8 + 16 > PNG_IDAT_BUFLEN)
+        write_idat();
 
-    uint32_t idx = 0;
-    while (idx < n)
+    adler_value = png_adler32(adler_value, line, len);
+
+    uint32_t pos = win_end;
+    const uint32_t end = win_end + len;
+    for (uint16_t i = 0; i < len; i++)
+        bufs->window[(pos + i) & mask] = line[i];
+    win_end = end;
+
+    while (pos < end)
     {
-        // at beginning of block?
-        if (blk_pos == 0)
+        uint32_t best_len = 0;
+        uint32_t best_dist = 0;
+        uint32_t max_len = end - pos < PNG_MAX_MATCH ? end - pos : PNG_MAX_MATCH;
+
+        if (max_len >= PNG_MIN_MATCH)
         {
-            blkSize = DEFLATE_MAX_BLOCK_SIZE;
-            uint8_t c = 0;
-            if (imgSize - img_pos <= (uint32_t)blkSize)
+            uint32_t v = (bufs->window[pos & mask] << 16) | (bufs->window[(pos + 1) & mask] << 8) | bufs->window[(pos + 2) & mask];
+            uint32_t h = ((v * 2654435761u) >> 16) & (PNG_HASH_SIZE - 1);
+            // last position with same hash, and same column of the line above
+            uint32_t candidates[2] = {bufs->hash_head[h], pos >= stride ? pos - stride + 1 : 0};
+            bufs->hash_head[h] = pos + 1;
+
+            for (uint32_t cand : candidates)
             {
-                c = 1; // final block
-                blkSize = (uint16_t)(imgSize - img_pos);
+                if (cand == 0 || end - (cand - 1) > PNG_WINDOW_SIZE)
+                    continue;
+                cand--;
+                uint32_t n = 0;
+                while (n < max_len && bufs->window[(cand + n) & mask] == bufs->window[(pos + n) & mask])
+                    n++;
+                if (n > best_len)
+                {
+                    best_len = n;
+                    best_dist = pos - cand;
+                }
             }
-
-            Debug_println("Writing ZLIB block header.");
-            // write out block header
-            crc_value = rc_crc32(crc_value, c);
-            fputc(c, _file);
-
-            // write out block size
-            c = (uint8_t)(blkSize >> 0);
-            crc_value = rc_crc32(crc_value, c);
-            fputc(c, _file);
-            c = (uint8_t)(blkSize >> 8);
-            crc_value = rc_crc32(crc_value, c);
-            fputc(c, _file);
-            c = (uint8_t)((blkSize >> 0) ^ 0xFF);
-            crc_value = rc_crc32(crc_value, c);
-            fputc(c, _file);
-            c = (uint8_t)((blkSize >> 8) ^ 0xFF);
-            crc_value = rc_crc32(crc_value, c);
-            fputc(c, _file);
-
-            //printf("new block\r\n");
         }
 
-        //at beginning of a line?
-        if (Xpos == 0)
+        if (best_len >= PNG_MIN_MATCH)
         {
-            Debug_printf("Starting PNG line %d ... ",Ypos);
-            c = 0;
-            crc_value = rc_crc32(crc_value, c);
-            adler_value = update_adler32(adler_value, c);
-            fputc(c, _file);
-            //printf("\nnew line %d ", c);
-
-            img_pos++;
-            blk_pos++;
-        }
-
-        // put byte from buffer
-        c = buf[idx];
-        crc_value = rc_crc32(crc_value, c);
-        adler_value = update_adler32(adler_value, c);
-        fputc(c, _file);
-        //printf("%d ", c);
-
-        Xpos++;
-        idx++;
-        img_pos++;
-        blk_pos++;
-
-        // check for end of's
-        if (Xpos == width)
-        {
-            Debug_println("Finished PNG line.");
-            Xpos = 0;
-            Ypos++;
+            uint8_t lc = t.len_code[best_len];
+            deflate_bits(t.lit_code[257 + lc], t.lit_bits[257 + lc]);
+            if (len_extra[lc])
+                deflate_bits(best_len - len_base[lc], len_extra[lc]);
+            uint8_t dc = dist_index(t, best_dist);
+            deflate_bits(t.dist_rev[dc], 5);
+            if (dist_extra[dc])
+                deflate_bits(best_dist - dist_base[dc], dist_extra[dc]);
+
+            // remember positions inside the match for later lines
+            for (uint32_t p = pos + 1; p < pos + best_len && p + PNG_MIN_MATCH <= end; p++)
+            {
+                uint32_t v = (bufs->window[p & mask] << 16) | (bufs->window[(p + 1) & mask] << 8) | bufs->window[(p + 2) & mask];
+                bufs->hash_head[((v * 2654435761u) >> 16) & (PNG_HASH_SIZE - 1)] = p + 1;
+            }
+            pos += best_len;
         }
-        if (blk_pos == blkSize)
+        else
         {
-            Debug_println("End of ZLIB block.");
-            blk_pos = 0;
+            uint8_t c = bufs->window[pos & mask];
+            deflate_bits(t.lit_code[c], t.lit_bits[c]);
+            pos++;
         }
+    }
+}
+
+// Write collected compressed data as IDAT chunk
+void pngPrinter::write_idat()
+{
+    if (idat_len == 0)
+        return;
+
+    uint8_t header[] = {
+        0, 0, 0, 0,         // 0-3      size
+        'I', 'D', 'A', 'T', // 4-7      IDAT
     };
+    uint8_t ccc[] = {0, 0, 0, 0};
 
-    if (img_pos == imgSize)
+    uint32_to_array(idat_len, &header[0]);
+    crc_value = png_crc32(0, &header[4], 4);
+    crc_value = png_crc32(crc_value, bufs->idat_buf, idat_len);
+    uint32_to_array(crc_value, &ccc[0]);
+
+    fwrite(header, 1, 8, _file);
+    fwrite(bufs->idat_buf, 1, idat_len, _file);
+    fwrite(ccc, 1, 4, _file);
+    idat_len = 0;
+}
+
+void pngPrinter::deflate_finish()
+{
+    Debug_println("Writing ZLIB Adler checksum and PNG data CRC.");
+    const png_tables &t = png_get_tables();
+
+    if (idat_len + 8 > PNG_IDAT_BUFLEN)
+        write_idat();
+    deflate_bits(t.lit_code[256], t.lit_bits[256]); // end of block
+    if (bit_count > 0)
+        deflate_bits(0, 8 - bit_count);
+    uint32_to_array(adler_value, &bufs->idat_buf[idat_len]);
+    idat_len += 4;
+    write_idat();
+}
+
+// Filter and compress one image line of n bytes
+void pngPrinter::png_add_data(uint8_t *buf, uint32_t n)
+{
+    if (img_done)
+        return;
+
+    // PNG filter types None, Sub and Up, pick the one with smallest sum of absolute
+    // differences (https://www.w3.org/TR/PNG-Encoders.html#E.Filter-selection)
+    uint32_t sums[3] = {0, 0, 0};
+    for (int f = 0; f < 3; f++)
+        bufs->filtered[f][0] = f;
+    for (uint32_t x = 0; x < n; x++)
+    {
+        uint8_t left = x > 0 ? buf[x - 1] : 0;
+        bufs->filtered[0][x + 1] = buf[x];
+        bufs->filtered[1][x + 1] = buf[x] - left;
+        bufs->filtered[2][x + 1] = buf[x] - prev_line[x];
+        for (int f = 0; f < 3; f++)
+            sums[f] += abs((int8_t)bufs->filtered[f][x + 1]);
+    }
+    int best = 0;
+    for (int f = 1; f < 3; f++)
+        if (sums[f] < sums[best])
+            best = f;
+
+    deflate_line(bufs->filtered[best], n + 1);
+    memcpy(prev_line, buf, n);
+
+    if (++Ypos == height)
     {
-        Debug_println("Writing ZLIB Adler checksum and PNG data CRC.");
-        uint8_t data[] = {
-            0, 0, 0, 0, // Adler32 Check value: 4 bytes
-            0, 0, 0, 0  // CRC32: 4 bytes
-        };
-        uint32_to_array(adler_value, &data[0]);
-        for (int i = 0; i < 4; i++)
-            crc_value = rc_crc32(crc_value, data[i]); // crc_value = rc_crc32(crc_value, data[0],4); ?????????
-        uint32_to_array(crc_value, &data[4]);
-        fwrite(data, 1, 8, _file);
+        deflate_finish();
         png_end();
+        img_done = true;
     }
 }
 
@@ -366,19 +495,59 @@ void pngPrinter::png_end()
     fwrite(end, 1, 12, _file);
 }
 
-// TODO: Anything here?
-void pngPrinter::pre_close_file()
+pngPrinter::~pngPrinter()
 {
+    free(bufs);
+}
 
+void pngPrinter::pre_close_file()
+{
+    // finish incomplete image with blank lines, so the file is still a valid PNG
+    if (!img_done)
+    {
+        Debug_printf("Padding PNG with %d blank lines.\r\n", height - Ypos);
+        memset(line_buffer, 0, sizeof(line_buffer));
+        while (!img_done)
+            png_add_data(line_buffer, width);
+    }
+    free(bufs);
+    bufs = nullptr;
 }
 
 void pngPrinter::post_new_file()
 {
+    if (bufs == nullptr)
+    {
+#ifdef ESP_PLATFORM
+        bufs = (png_buffers *)heap_caps_malloc(sizeof(png_buffers), MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
+#else
+        bufs = (png_buffers *)malloc(sizeof(png_buffers));
+#endif
+    }
+    if (bufs == nullptr)
+    {
+        Debug_println("No memory for PNG encoder, page is not printed");
+        img_done = true;
+        return;
+    }
+
+    Ypos = 0;
+    adler_value = 1;
+    img_done = false;
+    BOLflag = true;
+    line_index = 0;
+    memset(prev_line, 0, sizeof(prev_line));
+    win_end = 0;
+    memset(bufs->hash_head, 0, sizeof(bufs->hash_head));
+    bit_buf = 0;
+    bit_count = 0;
+    idat_len = 0;
+
     // call PNG header routines
     png_signature();
     png_header();
     png_palette();
-    // start IDAT chunk and now ready for data
+    // start zlib stream, IDAT chunks are written as compressed data is collected
     png_data();
 }
 
@@ -387,7 +556,7 @@ bool pngPrinter::process_buffer(uint8_t n, uint8_t aux1, uint8_t aux2)
 // copy buffer[] into linebuffer[]
     Debug_printf("%d bytes rx'd by PNG printer\r\n", n);
     uint16_t i = 0;
-    while (i < n && img_pos < imgSize)
+    while (i < n && !img_done)
     {
         //Debug_println("processing buffer.");
         if (BOLflag)
@@ -403,10 +572,7 @@ bool pngPrinter::process_buffer(uint8_t n, uint8_t aux1, uint8_t aux2)
         if (line_index == 320)
         {
             while (rep_code-- > 0)
-            {
-                Debug_printf("Adding line %d\r\n", rep_code);
                 png_add_data(&line_buffer[0], 320);
-            }
             BOLflag = true;
             line_index = 0;
         }
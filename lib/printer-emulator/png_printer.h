@@ -5,35 +5,47 @@
 
 #include "printer_emulator.h"
 
-#define DEFLATE_MAX_BLOCK_SIZE 0xFFFF
+#define PNG_WINDOW_SIZE 8192    // LZ77 window kept for matches, power of 2
+#define PNG_HASH_SIZE 2048      // LZ77 hash heads, power of 2
+#define PNG_IDAT_BUFLEN 4096    // compressed data collected before it is written as IDAT chunk
 
 class pngPrinter : public printer_emu
 {
     // complete rewrite of TinyPngOut https://www.nayuki.io/page/tiny-png-output
+    // image data is filtered per line and compressed with fixed Huffman code DEFLATE
 protected:
     const uint32_t width = 320;
     const uint32_t height = 192;
 
-    const uint32_t imgSize = (width + 1) * height; // size of image including BOL filter p's for IDAT chunk
-    uint32_t img_pos = 0;                    // serial position within image data including BOL filter p's
-    uint16_t Xpos = 0;                       // current position within image line
     uint16_t Ypos = 0;                       // current image line number
-    uint32_t dataSize = 0;                   // size of data for IDAT chunk
-    uint16_t blkSize = 0;                    // size of zlib block
-    uint16_t blk_pos = 0;                    // serial position within zlib block
     uint32_t crc_value = 0;                  // running crc32 value
     uint32_t adler_value = 1;                // running checksum (initilize to 1 https://en.wikipedia.org/wiki/Adler-32)
+    bool img_done = false;                   // zlib stream and IEND were written
 
     uint8_t line_buffer[320];
+    uint8_t prev_line[320];                  // previous unfiltered line, for Up filter
 
     bool BOLflag = true;
     uint16_t line_index = 0;
     uint8_t rep_code = 0;
 
+    // Encoder buffers, about 21 KB, allocated (in PSRAM on ESP32) only while a page is open
+    struct png_buffers
+    {
+        uint8_t filtered[3][321];            // candidate lines with filter type byte (None, Sub, Up)
+        uint8_t window[PNG_WINDOW_SIZE];     // last filtered image data
+        uint32_t hash_head[PNG_HASH_SIZE];   // last window position (+1) of each 3 byte hash, 0 = none
+        uint8_t idat_buf[PNG_IDAT_BUFLEN];
+    };
+    png_buffers *bufs = nullptr;
+
+    // DEFLATE encoder state
+    uint32_t win_end = 0;                    // number of filtered bytes so far
+    uint32_t bit_buf = 0;
+    uint8_t bit_count = 0;
+    uint16_t idat_len = 0;
+
     void uint32_to_array(uint32_t src, uint8_t dest[4]);
-    uint32_t update_adler32(uint32_t adler, uint8_t data);
-    uint32_t rc_crc32(uint32_t crc, const uint8_t *buf, size_t len);
-    uint32_t rc_crc32(uint32_t crc, uint8_t c) { return rc_crc32(crc, &c, 1); }
 
     void png_signature();
     void png_header();
@@ -42,11 +54,19 @@ protected:
     void png_add_data(uint8_t *buf, uint32_t n);
     void png_end();
 
+    void deflate_bits(uint32_t bits, uint8_t count);
+    void deflate_line(const uint8_t *line, uint16_t len);
+    void deflate_finish();
+    void write_idat();
+
     virtual void post_new_file() override;
     virtual void pre_close_file() override;
+    // compressed image data is only complete at the end of the image
+    virtual bool live_snapshot(std::string & /*tail*/) override { return false; }
     virtual bool process_buffer(uint8_t linelen, uint8_t aux1, uint8_t aux2) override;
 public:
     pngPrinter() { _paper_type = PNG;};
+    ~pngPrinter();
     const char *modelname()  override 
     { 
         #ifdef BUILD_ATARI
@@ -1,5 +1,9 @@
 #include "printer_emulator.h"
 
+#ifdef ESP_PLATFORM
+#include "esp_heap_caps.h"
+#endif
+
 #include "../../include/debug.h"
 
 #include "fsFlash.h"
@@ -22,6 +26,7 @@ printer_emu::~printer_emu()
         fclose(_file);
         _file = nullptr;
     }
+    free(_page_buf);
 }
 
 // virtual void flushOutput(); // do this in pageEject
@@ -58,6 +63,8 @@ size_t printer_emu::copy_file_to_output(const char *filename)
 
 size_t printer_emu::getOutputSize()
 {
+    std::lock_guard<std::mutex> lock(_output_mutex);
+
     if(_file != nullptr)
         return FileSystem::filesize(_file);
 
@@ -66,9 +73,11 @@ size_t printer_emu::getOutputSize()
     return result == -1 ? 0 : result;
 }
 
-// All the work is done here in the derived classes. Open and close the output file before proceeding
+// All the work is done here in the derived classes. Output file stays open until the job is closed
 bool printer_emu::process(uint8_t linelen, uint8_t aux1, uint8_t aux2)
 {
+    std::lock_guard<std::mutex> lock(_output_mutex);
+
     is_printing=true;
     // Make sure the file has been initialized
     if(_output_started == false)
@@ -76,23 +85,31 @@ bool printer_emu::process(uint8_t linelen, uint8_t aux1, uint8_t aux2)
         restart_output();
         // Make sure that worked...
         if(_output_started == false)
+        {
+            is_printing=false;
             return false;
+        }
     }
 
-    // Open output file for appending
-    _file = _FS->file_open(PRINTER_OUTFILE, "rb+"); // This is supposed to open the file for writing at the end, but reading at the beginnig
-    fseek(_file, 0, SEEK_END); // Make sure we're at the end of the file for reading in case the emaulator code expects that
-
     bool result = process_buffer(linelen, aux1, aux2);
 
-    fflush(_file);
-    fclose(_file);
-    _file = nullptr;
-
     is_printing=false;
     return result;
 }
 
+void printer_emu::page_completed()
+{
+    fflush(_file);
+    _committed = ftell(_file);
+}
+
+bool printer_emu::live_snapshot(std::string &tail)
+{
+    fflush(_file);
+    _committed = ftell(_file);
+    return true;
+}
+
 // Closes the output file and provides an open read handle to it afterwards
 FILE * printer_emu::closeOutputAndProvideReadHandle()
 {
@@ -100,24 +117,34 @@ FILE * printer_emu::closeOutputAndProvideReadHandle()
     return _FS->file_open(PRINTER_OUTFILE);
 }
 
+FILE * printer_emu::provideLiveReadHandle(size_t &length, std::string &tail)
+{
+    std::lock_guard<std::mutex> lock(_output_mutex);
+
+    if (_output_started == false || _file == nullptr)
+        return nullptr;
+
+    tail.clear();
+    if (!live_snapshot(tail))
+        return nullptr;
+    length = _committed;
+
+    // committed part of the file was flushed, bus can keep appending to it while it's read
+    return _FS->file_open(PRINTER_OUTFILE);
+}
+
 // Closes the output file, giving the printer emulators a chance to provide closing output
 void printer_emu::closeOutput()
 {
+    std::lock_guard<std::mutex> lock(_output_mutex);
+
     // Assume there's nothing to do if output hasn't been started
-    if (_output_started == false)
+    if (_output_started == false || _file == nullptr)
         return;
 
-    // Give printer emulator chance to finish output
-    if(_file == nullptr)
-    {
-        _file = _FS->file_open(PRINTER_OUTFILE, "rb+"); // Seeks don't work right if we use "append" mode - use "rb+"
-        fseek(_file, 0, SEEK_END);
-    }
-
     pre_close_file();
 
     // Close the file    
-    fflush(_file);
     fclose(_file);
     _file = nullptr;
     _output_started = false;
@@ -126,21 +153,29 @@ void printer_emu::closeOutput()
 void printer_emu::restart_output()
 {
     _output_started = false;
+    _committed = 0;
     if(_file != nullptr)
         fclose(_file);
-    _file = _FS->file_open(PRINTER_OUTFILE, "wb"); // This should create/truncate the file
-#ifdef DEBUG
-    if (_file != nullptr)
-    {
-        Debug_println("Printer output file initialized");
-        post_new_file();
-        fclose(_file);
-        _file = nullptr;
-        _output_started = true;
-    }
-    else
+    _file = _FS->file_open(PRINTER_OUTFILE, "wb+"); // This should create/truncate the file
+    if (_file == nullptr)
     {
         Debug_println("Error opening printer file");
+        return;
     }
+    Debug_println("Printer output file initialized");
+
+    // collect page in memory instead of default small stdio buffer
+    if (_page_buf == nullptr)
+    {
+#ifdef ESP_PLATFORM
+        _page_buf = (uint8_t *)heap_caps_malloc(PRINTER_PAGE_BUFLEN, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
+#else
+        _page_buf = (uint8_t *)malloc(PRINTER_PAGE_BUFLEN);
 #endif
+    }
+    if (_page_buf != nullptr)
+        setvbuf(_file, (char *)_page_buf, _IOFBF, PRINTER_PAGE_BUFLEN);
+
+    post_new_file();
+    _output_started = true;
 }
@@ -3,8 +3,15 @@
 
 //#include "../../include/atascii.h"
 
+#include <mutex>
+#include <string>
+
 #include "fnFsSD.h"
 
+// Output written by the emulator is kept in memory up to this size, it is written to the
+// output file when a page is completed (or the buffer is full)
+#define PRINTER_PAGE_BUFLEN 16384
+
 // TODO: Combine html_printer.cpp/h and file_printer.cpp/h
 
 // I think the way we're using this value is as a switch to tell the printer
@@ -27,6 +34,8 @@ class printer_emu
 {
 private:
     bool _output_started = false;
+    std::mutex _output_mutex;   // output file is written by the bus and read by the web server
+    uint8_t *_page_buf = nullptr;
 
 protected:
     FileSystem *_FS = nullptr;
@@ -49,6 +58,17 @@ protected:
     // Called to actually process the printer output from the Atari as uint8_ts
     virtual bool process_buffer(uint8_t linelen, uint8_t aux1, uint8_t aux2)=0;
 
+    // Size of the output which forms complete pages, set by page_completed()
+    size_t _committed = 0;
+
+    // Called by emulators when a page is complete, writes it out to the output file
+    void page_completed();
+
+    // Called to provide a view of a job in progress, with output locked. Sets _committed to the
+    // part of the output file to show and provides data to append to it to make it a valid document
+    // (e.g. PDF trailer). Default commits everything written so far. Returns false if not possible.
+    virtual bool live_snapshot(std::string &tail);
+
     size_t copy_file_to_output(const char *filename);
     void restart_output();
     
@@ -63,6 +83,9 @@ public:
 
     void closeOutput();
     FILE * closeOutputAndProvideReadHandle();
+    // Read handle to the output of a job in progress, without closing it. Only first length bytes
+    // of the file are to be used, followed by tail. Returns nullptr if there is nothing to show.
+    FILE * provideLiveReadHandle(size_t &length, std::string &tail);
 
     bool process(uint8_t linelen, uint8_t aux1, uint8_t aux2);
 
@@ -1,5 +1,9 @@
 #include "svg_plotter.h"
 
+#include <string.h>
+
+#include <algorithm>
+
 #include "../../include/debug.h"
 #include "../../include/atascii.h"
 
@@ -235,13 +239,13 @@ RELATIVE MOVE	RX,Y			        GRAPHICS
 CHAR. SCALE		S(0-63)			      GRAPHICS
 */
 
-void svgPlotter::svg_put_text(std::string S)
+void svgPlotter::svg_put_text(const char *S, size_t len)
 {
     int fontWeight = svg_compute_weight(fontSize);
     fprintf(_file, "<text x=\"%g\" y=\"%g\" ", svg_X, svg_Y);
     fprintf(_file, "font-size=\"%g\" font-family=\"FifteenTwenty\" font-weight=\"%d\" fill=\"%s\" ", fontSize, fontWeight, svg_colors[svg_color_idx].c_str());
     fprintf(_file, "transform=\"rotate(%d %g,%g)\">", svg_rotate, svg_X, svg_Y);
-    for (int i = 0; i < S.length(); i++)
+    for (size_t i = 0; i < len; i++)
     {
         svg_handle_char((unsigned char)S[i]);
     }
@@ -252,27 +256,42 @@ void svgPlotter::svg_plot_axis()
 {
 }
 
-void svgPlotter::svg_get_arg(std::string S, int n)
+void svgPlotter::svg_get_arg(const char *S, size_t len, int n)
 {
-    svg_arg[n] = atoi(S.c_str());
+    char num[16];
+    len = std::min(len, sizeof(num) - 1);
+    memcpy(num, S, len);
+    num[len] = '\0';
+    svg_arg[n] = atoi(num);
     Debug_printf(" (arg %d : %d)\r\n", n, svg_arg[n]);
 }
 
-void svgPlotter::svg_get_2_args(std::string S)
+// Position of first ',' at or after pos, len if there is none
+static size_t svg_find_comma(const char *S, size_t len, size_t pos)
+{
+    const char *comma = pos < len ? (const char *)memchr(S + pos, ',', len - pos) : nullptr;
+    return comma != nullptr ? comma - S : len;
+}
+
+void svgPlotter::svg_get_2_args(const char *S, size_t len)
 {
-    size_t n = S.find_first_of(',');
-    svg_get_arg(S.substr(0, n), 0);
-    svg_get_arg(S.substr(n + 1), 1);
+    size_t n = svg_find_comma(S, len, 0);
+    svg_get_arg(S, n, 0);
+    if (n < len)
+        svg_get_arg(S + n + 1, len - n - 1, 1);
+    else
+        svg_get_arg(S, len, 1); // no comma, both args are the same
     svg_arg[1] *= -1; // y-axis if flipped
 }
 
-void svgPlotter::svg_get_3_args(std::string S)
+void svgPlotter::svg_get_3_args(const char *S, size_t len)
 {
-    size_t n1 = S.find_first_of(',');
-    size_t n2 = S.find_first_of(',', n1 + 1);
-    svg_get_arg(S.substr(0, n1 - 1), 0);
-    svg_get_arg(S.substr(n1 + 1, n2 - n1), 1);
-    svg_get_arg(S.substr(n2 + 1), 2);
+    size_t n1 = svg_find_comma(S, len, 0);
+    size_t n2 = n1 < len ? svg_find_comma(S, len, n1 + 1) : svg_find_comma(S, len, 0);
+    size_t start1 = n1 < len ? n1 + 1 : 0;
+    svg_get_arg(S, n1 > 0 && n1 < len ? n1 - 1 : len, 0);
+    svg_get_arg(S + start1, n1 < len ? std::min(n2 - n1, len - start1) : 0, 1);
+    svg_get_arg(S + (n2 < len ? n2 + 1 : 0), n2 < len ? len - n2 - 1 : len, 2);
 }
 
 void svgPlotter::svg_header()
@@ -335,8 +354,9 @@ void svgPlotter::graphics_command(int n)
     //
     // could maybe use regex but going to brute force with a bunch of cases
 
-    std::string S;
-    S.assign((char *)buffer, n);
+    // working copy, buffer is left as received
+    char S[sizeof(buffer)];
+    memcpy(S, buffer, n);
 
     size_t cmd_pos = 0;
     do
@@ -350,12 +370,12 @@ void svgPlotter::graphics_command(int n)
             return;     // get outta here!
         case 'C':       // SELECT COLOR
             // get arg out of S and assign to...
-            svg_get_arg(S.substr(cmd_pos + 1), 0);
+            svg_get_arg(S + cmd_pos + 1, n - cmd_pos - 1, 0);
             svg_color_idx = svg_arg[0];
             break;
         case 'D': // DRAW LINE ABS COORDS
             // get 2 args out of S and draw a line
-            svg_get_2_args(S.substr(cmd_pos + 1));
+            svg_get_2_args(S + cmd_pos + 1, n - cmd_pos - 1);
             svg_abs_plot_line();
             break;
         case 'H': // GO HOME
@@ -369,19 +389,19 @@ void svgPlotter::graphics_command(int n)
             svg_home_flag = true;
             break;
         case 'J': // DRAW LINE RELATIVE COORDS
-            svg_get_2_args(S.substr(cmd_pos + 1));
+            svg_get_2_args(S + cmd_pos + 1, n - cmd_pos - 1);
             svg_rel_plot_line();
             break;
         case 'L': // SET DASHED LINE TYPE
             // get arg out of S and assign to...
-            svg_get_arg(S.substr(cmd_pos + 1), 0);
+            svg_get_arg(S + cmd_pos + 1, n - cmd_pos - 1, 0);
             svg_line_type = svg_arg[0] & 15;
             break;
         case 'M': // MOVE ABS COORDS
             // get 2 args out of S and ...
             // this behavior when out of bounds is a guess
             // i bet it's don't change it
-            svg_get_2_args(S.substr(cmd_pos + 1));
+            svg_get_2_args(S + cmd_pos + 1, n - cmd_pos - 1);
             if (svg_arg[0] > -1000 && svg_arg[0] < 1000) // probably >-1000 && <1000
                 svg_X = svg_X_home + (double)svg_arg[0];
             if (svg_arg[1] > -1000 && svg_arg[1] < 1000)
@@ -389,24 +409,24 @@ void svgPlotter::graphics_command(int n)
             svg_update_bounds();
             break;
         case 'P': // PUT TEXT HERE
-            svg_put_text(S.substr(cmd_pos + 1));
+            svg_put_text(S + cmd_pos + 1, n - cmd_pos - 1);
             break;
         case 'Q': // SET TEXT ROTATION
-            svg_get_arg(S.substr(cmd_pos + 1), 0);
+            svg_get_arg(S + cmd_pos + 1, n - cmd_pos - 1, 0);
             svg_rotate = svg_arg[0] * 90;
             break;
         case 'R': // MOVE RELATIVE COORDS
-            svg_get_2_args(S.substr(cmd_pos + 1));
+            svg_get_2_args(S + cmd_pos + 1, n - cmd_pos - 1);
             svg_X = svg_X + (double)svg_arg[0];
             svg_Y = svg_Y + (double)svg_arg[1];
             svg_update_bounds();
             break;
         case 'S': // SET TEXT SIZE
-            svg_get_arg(S.substr(cmd_pos + 1), 0);
+            svg_get_arg(S + cmd_pos + 1, n - cmd_pos - 1, 0);
             svg_set_text_size(svg_arg[0]);
             break;
         case 'X': // DRAW GRAPH AXIS
-            svg_get_3_args(S.substr(cmd_pos + 1));
+            svg_get_3_args(S + cmd_pos + 1, n - cmd_pos - 1);
             svg_plot_axis();
             break;
         default:
@@ -414,8 +434,10 @@ void svgPlotter::graphics_command(int n)
         }
         // find either ':' to repeat the command
         // or '*' to start a new command
-        size_t new_pos = S.find_first_of(":*", cmd_pos + 1);
-        if (new_pos == std::string::npos)
+        size_t new_pos = cmd_pos + 1;
+        while (new_pos < (size_t)n && S[new_pos] != ':' && S[new_pos] != '*')
+            new_pos++;
+        if (new_pos >= (size_t)n)
             return;
         if (S[new_pos] == ':')
             S[new_pos] = S[cmd_pos]; // repeat command - just copy command over
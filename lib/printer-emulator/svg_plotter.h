@@ -52,11 +52,12 @@ protected:
     void svg_abs_plot_line();
     void svg_rel_plot_line();
     void svg_set_text_size(int s);
-    void svg_put_text(std::string S);
+    // command arguments are parsed in place, S is not terminated so only len characters are used
+    void svg_put_text(const char *S, size_t len);
     void svg_plot_axis();
-    void svg_get_arg(std::string S, int n);
-    void svg_get_2_args(std::string S);
-    void svg_get_3_args(std::string S);
+    void svg_get_arg(const char *S, size_t len, int n);
+    void svg_get_2_args(const char *S, size_t len);
+    void svg_get_3_args(const char *S, size_t len);
     void svg_header();
     void svg_footer();
 
@@ -66,6 +67,8 @@ protected:
     virtual bool process_buffer(uint8_t linelen, uint8_t aux1, uint8_t aux2) override; //void svg_add(int n);
     virtual void pre_close_file() override;
     virtual void post_new_file() override;
+    // header is completed at close, nothing to show before that
+    virtual bool live_snapshot(std::string & /*tail*/) override { return false; }
 
 public:
     virtual const char *modelname(void) override
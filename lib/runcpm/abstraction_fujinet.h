@@ -68,6 +68,8 @@ char *full_path(char *fn)
 	return full_filename;
 }
 
+#include "abstraction_fujinet_files.h"
+
 
 //
 // Hardware functions, new in 5.x
@@ -84,6 +86,8 @@ uint32 _HardwareIn(const uint32 Port) {
 /*===============================================================================*/
 bool _RamLoad(char *fn, uint16_t address)
 {
+	_sys_closefile((uint8_t *)fn);
+
 	FILE *f = fnSDFAT.file_open(full_path(fn), "r");
 	bool result = false;
 	uint8_t b;
@@ -138,6 +142,10 @@ int _sys_select(uint8_t *disk)
 long _sys_filesize(uint8_t *fn)
 {
 	unsigned long fs = -1;
+	CPM_FILE *h = _sys_findfile(full_path((char *)fn));
+	if (h)
+		return h->size;
+
 	FILE *fp = fnSDFAT.file_open(full_path((char *)fn), "r");
 
 	if (fp)
@@ -164,6 +172,8 @@ int _sys_openfile(uint8_t *fn)
 
 int _sys_makefile(uint8_t *fn)
 {
+	_sys_closefile(fn);
+
 	FILE *fp = fnSDFAT.file_open(full_path((char *)fn), "w");
 	if (fp)
 	{
@@ -176,6 +186,7 @@ int _sys_makefile(uint8_t *fn)
 
 int _sys_deletefile(uint8_t *fn)
 {
+	_sys_closefile(fn);
 	return fnSDFAT.remove(full_path((char *)fn));
 }
 
@@ -183,6 +194,8 @@ int _sys_renamefile(uint8_t *fn, uint8_t *newname)
 {
 	std::string from, to;
 
+	_sys_closefile(fn);
+	_sys_closefile(newname);
 	from = std::string(full_path((char *)fn));
 	to = std::string(full_path((char *)newname));
 
@@ -194,178 +207,40 @@ void _sys_logbuffer(uint8_t *buffer)
 	// not implemented at present.
 }
 
-bool _sys_extendfile(char *fn, unsigned long fpos)
-{
-	FILE *fp = fnSDFAT.file_open(full_path((char *)fn), "a");
-
-	if (!fp)
-		return false;
-
-	long origSize = fnSDFAT.filesize(full_path(fn));
-
-	// This was patterned after the arduino abstraction, and I do not like how this works.
-
-	if (fpos > origSize)
-	{
-		for (long i = 0; i < (origSize - fpos); ++i)
-		{
-			if (fwrite("\0", sizeof(uint8_t), 1, fp) != 1)
-			{
-				fclose(fp);
-				return false;
-			}
-		}
-	}
-	fclose(fp);
-	return true;
-}
-
 uint8_t _sys_readseq(uint8_t *fn, long fpos)
 {
-	uint8_t result = 0xff;
-	FILE *f;
-	uint8_t bytesread;
-	uint8_t dmabuf[BlkSZ];
-	int seekErr;
+	CPM_FILE *h = _sys_openhandle(fn, false);
 
-	f = fnSDFAT.file_open(full_path((char *)fn), "r");
-	if (!f)
-	{
-		result = 0x10;
-		return result;
-	}
-	seekErr = fseek(f, fpos, SEEK_SET);
-	if (f)
-	{
-		if (fpos > 0 && seekErr != 0)
-		{
-			// EOF
-			result = 0x01;
-		}
-		else
-		{
-			// set DMA buffer to EOF
-			memset(dmabuf, 0x1a, BlkSZ);
-			bytesread = fread(&dmabuf[0], BlkSZ, sizeof(uint8_t), f);
-			if (bytesread)
-				memcpy((uint8_t *)&RAM[dmaAddr], dmabuf, BlkSZ);
-			result = bytesread ? 0x00 : 0x01;
-		}
-	}
-	else
-	{
-		result = 0x10;
-	}
-	fclose(f);
-	return (result);
+	if (!h)
+		return 0x10;
+	return _sys_readrecord(h, fpos);
 }
 
 uint8_t _sys_writeseq(uint8_t *fn, long fpos)
 {
-	uint8_t result = 0xff;
-	FILE *f;
+	CPM_FILE *h = _sys_openhandle(fn, true);
 
-	if (_sys_extendfile((char *)fn, fpos))
-		f = fnSDFAT.file_open(full_path((char *)fn), "r+");
-	else
-		return result;
-
-	if (f)
-	{
-		if (fseek(f, fpos, SEEK_SET) == 0)
-		{
-			if (fwrite(_RamSysAddr(dmaAddr), BlkSZ, sizeof(uint8_t), f))
-				result = 0x00;
-		}
-		else
-		{
-			result = 0x01;
-		}
-	}
-	else
-	{
-		result = 0x10;
-	}
-	fclose(f);
-	return (result);
+	if (!h)
+		return 0xff;
+	return _sys_writerecord(h, fpos) ? 0x00 : 0x01;
 }
 
 uint8_t _sys_readrand(uint8_t *fn, long fpos)
 {
-	uint8 result = 0xff;
-	FILE *f;
-	uint8 bytesread;
-	uint8 dmabuf[BlkSZ];
-	long extSize;
+	CPM_FILE *h = _sys_openhandle(fn, false);
 
-	f = fnSDFAT.file_open(full_path((char *)fn), "r+");
-	if (f)
-	{
-		if (fseek(f, fpos, SEEK_SET) == 0)
-		{
-			memset(dmabuf, 0x1A, BlkSZ);
-			bytesread = fread(&dmabuf[0], BlkSZ, sizeof(uint8_t), f);
-			if (bytesread)
-				memcpy((uint8_t *)&RAM[dmaAddr], dmabuf, BlkSZ);
-			result = bytesread ? 0x00 : 0x01;
-		}
-		else
-		{
-			if (fpos >= 65536L * BlkSZ)
-			{
-				result = 0x06; // seek past 8MB (largest file size in CP/M)
-			}
-			else
-			{
-				extSize = _sys_filesize((uint8_t *)full_path((char *)fn));
-
-				// round file size up to next full logical extent
-				extSize = ExtSZ * ((extSize / ExtSZ) + ((extSize % ExtSZ) ? 1 : 0));
-				if (fpos < extSize)
-					result = 0x01; // reading unwritten data
-				else
-					result = 0x04; // seek to unwritten extent
-			}
-		}
-	}
-	else
-	{
-		result = 0x10;
-	}
-	fclose(f);
-	return (result);
+	if (!h)
+		return 0x10;
+	return _sys_readrecord(h, fpos);
 }
 
 uint8_t _sys_writerand(uint8_t *fn, long fpos)
 {
-	uint8 result = 0xff;
-	FILE *f;
+	CPM_FILE *h = _sys_openhandle(fn, true);
 
-	if (_sys_extendfile((char *)fn, fpos))
-	{
-		f = fnSDFAT.file_open(full_path((char *)fn), "r+");
-	}
-	else
-		return result;
-
-	if (f)
-	{
-		if (fseek(f, fpos, SEEK_SET) == 0)
-		{
-			if (fwrite(_RamSysAddr(dmaAddr), BlkSZ, sizeof(uint8_t), f))
-				result = 0x00;
-		}
-		else
-		{
-			result = 0x06;
-		}
-	}
-	else
-	{
-		result = 0x10;
-	}
-	fclose(f);
-	return (result);
+	if (!h)
+		return 0xff;
+	return _sys_writerecord(h, fpos) ? 0x00 : 0x06;
 }
 
 uint8_t findNextDirName[17];
@@ -434,6 +309,7 @@ uint8_t _findfirst(uint8_t isdir)
 	uint8 path[4] = {'?', FOLDERCHAR, '?', 0};
 	path[0] = filename[0];
 	path[2] = filename[2];
+	_sys_flushall();
 	fnSDFAT.dir_close();
 	fnSDFAT.dir_open(full_path((char *)path), "*", 0);
 	_HostnameToFCBname(filename, pattern);
@@ -0,0 +1,242 @@
+/*
+ * Buffered CP/M record I/O for the #FujiNet abstractions
+ *
+ * The BDOS reads and writes one 128 byte record per call. Files are kept open between calls
+ * and read and written a block of records at a time, instead of opening, seeking and closing
+ * the file on the SD card for every record. Handles are closed by BDOS close file, disk reset
+ * and when a program returns to the CCP.
+ *
+ * Included by the abstraction after full_path() is defined.
+ */
+#ifndef ABSTRACTION_FUJINET_FILES_H
+#define ABSTRACTION_FUJINET_FILES_H
+
+#include <unistd.h>
+
+// Number of files kept open
+#ifndef CPM_FILE_HANDLES
+#define CPM_FILE_HANDLES 4
+#endif
+
+// Bytes read ahead and written behind per file, a multiple of BlkSZ
+#ifndef CPM_FILE_BLOCK
+#define CPM_FILE_BLOCK 4096
+#endif
+
+typedef struct
+{
+	char path[sizeof(full_filename)];
+	FILE *f;
+	bool writable;
+	uint32_t used;			// last access, for least recently used replacement
+	long size;				// includes records not written yet
+	uint8_t *buf;
+	long bufPos;			// file position of buf, -1 if nothing is buffered
+	long bufLen;			// bytes of buf that are part of the file
+	long dirtyLo, dirtyHi;	// part of buf still to be written, none if dirtyLo >= dirtyHi
+	bool error;				// a buffered write failed, reported when the file is closed
+} CPM_FILE;
+
+CPM_FILE cpmFiles[CPM_FILE_HANDLES];
+uint32_t cpmFileClock = 0;
+
+CPM_FILE *_sys_findfile(const char *path)
+{
+	for (int i = 0; i < CPM_FILE_HANDLES; ++i)
+	{
+		if (cpmFiles[i].f && strcmp(cpmFiles[i].path, path) == 0)
+			return &cpmFiles[i];
+	}
+	return NULL;
+}
+
+// Writes the buffered records to the file
+bool _sys_writeblock(CPM_FILE *h)
+{
+	bool ok = true;
+
+	if (h->dirtyLo < h->dirtyHi)
+	{
+		size_t len = h->dirtyHi - h->dirtyLo;
+		ok = fseek(h->f, h->bufPos + h->dirtyLo, SEEK_SET) == 0 &&
+			 fwrite(h->buf + h->dirtyLo, sizeof(uint8_t), len, h->f) == len;
+		if (!ok)
+		{
+			Debug_printf("CP/M write failed: %s\r\n", h->path);
+			h->error = true;
+		}
+		h->dirtyLo = h->dirtyHi = 0;
+	}
+	return ok;
+}
+
+// Makes buf hold the block of the file containing fpos
+bool _sys_readblock(CPM_FILE *h, long fpos)
+{
+	long blockPos = fpos - (fpos % CPM_FILE_BLOCK);
+
+	if (h->bufPos == blockPos)
+		return true;
+
+	_sys_writeblock(h);
+	h->bufPos = -1;
+	h->bufLen = 0;
+	if (blockPos < h->size)
+	{
+		if (fseek(h->f, blockPos, SEEK_SET) != 0)
+			return false;
+		h->bufLen = fread(h->buf, sizeof(uint8_t), CPM_FILE_BLOCK, h->f);
+	}
+	h->bufPos = blockPos;
+	return true;
+}
+
+// Closes a handle, false if any of its buffered records couldn't be written
+bool _sys_closehandle(CPM_FILE *h)
+{
+	_sys_writeblock(h);
+	bool ok = !h->error;
+
+	fclose(h->f);
+	h->f = NULL;
+	h->bufPos = -1;
+	return ok;
+}
+
+// Returns the open handle of a file, opening it if needed
+CPM_FILE *_sys_openhandle(uint8_t *fn, bool writable)
+{
+	char *path = full_path((char *)fn);
+	CPM_FILE *h = _sys_findfile(path);
+
+	if (h && writable && !h->writable)
+		_sys_closehandle(h);	// reopened for writing below
+	else if (h)
+	{
+		h->used = ++cpmFileClock;
+		return h;
+	}
+	else
+	{
+		h = &cpmFiles[0];
+		for (int i = 1; i < CPM_FILE_HANDLES; ++i)
+		{
+			if (h->f && (!cpmFiles[i].f || cpmFiles[i].used < h->used))
+				h = &cpmFiles[i];
+		}
+		if (h->f)
+			_sys_closehandle(h);
+	}
+
+	if (writable)
+	{
+		// Creates the file if it doesn't exist
+		FILE *f = fnSDFAT.file_open(path, "a");
+		if (!f)
+			return NULL;
+		fclose(f);
+	}
+	if (!h->buf)
+		h->buf = (uint8_t *)malloc(CPM_FILE_BLOCK);
+	if (!h->buf)
+		return NULL;
+	h->f = fnSDFAT.file_open(path, writable ? "r+" : "r");
+	if (!h->f)
+		return NULL;
+	setvbuf(h->f, NULL, _IONBF, 0); // blocks are buffered here
+	fseek(h->f, 0L, SEEK_END);
+	h->size = ftell(h->f);
+
+	strlcpy(h->path, path, sizeof(h->path));
+	h->writable = writable;
+	h->used = ++cpmFileClock;
+	h->bufPos = -1;
+	h->bufLen = 0;
+	h->dirtyLo = h->dirtyHi = 0;
+	h->error = false;
+	return h;
+}
+
+// Copies the record at fpos to the DMA buffer, a partial record at the end is not read
+uint8_t _sys_readrecord(CPM_FILE *h, long fpos)
+{
+	if (fpos + BlkSZ > h->size)
+		return 0x01; // EOF
+	if (!_sys_readblock(h, fpos))
+		return 0x01;
+
+	long offset = fpos - h->bufPos;
+	if (offset + BlkSZ > h->bufLen)
+		return 0x01;
+	memcpy((uint8_t *)&RAM[dmaAddr], h->buf + offset, BlkSZ);
+	return 0x00;
+}
+
+// Puts the record from the DMA buffer at fpos, it is written when the block is left or the file closed
+bool _sys_writerecord(CPM_FILE *h, long fpos)
+{
+	if (!_sys_readblock(h, fpos))
+		return false;
+
+	long offset = fpos - h->bufPos;
+	long lo = offset;
+	if (offset > h->bufLen)
+	{
+		// fill the hole before a record written past the end
+		memset(h->buf + h->bufLen, 0, offset - h->bufLen);
+		lo = h->bufLen;
+	}
+	memcpy(h->buf + offset, _RamSysAddr(dmaAddr), BlkSZ);
+
+	if (h->dirtyLo >= h->dirtyHi)
+	{
+		h->dirtyLo = lo;
+		h->dirtyHi = offset + BlkSZ;
+	}
+	else
+	{
+		h->dirtyLo = lo < h->dirtyLo ? lo : h->dirtyLo;
+		h->dirtyHi = offset + BlkSZ > h->dirtyHi ? offset + BlkSZ : h->dirtyHi;
+	}
+	if (offset + BlkSZ > h->bufLen)
+		h->bufLen = offset + BlkSZ;
+	if (fpos + BlkSZ > h->size)
+		h->size = fpos + BlkSZ;
+	return true;
+}
+
+// Closes a file if it is open, false if buffered records couldn't be written
+bool _sys_closefile(uint8_t *fn)
+{
+	CPM_FILE *h = _sys_findfile(full_path((char *)fn));
+
+	return h ? _sys_closehandle(h) : true;
+}
+
+// Writes buffered records of all files, so the directory shows their current size
+void _sys_flushall()
+{
+	for (int i = 0; i < CPM_FILE_HANDLES; ++i)
+	{
+		CPM_FILE *h = &cpmFiles[i];
+		if (h->f && h->writable)
+		{
+			_sys_writeblock(h);
+			fsync(fileno(h->f));
+		}
+	}
+}
+
+// Closes all files and frees their buffers
+void _sys_closeall()
+{
+	for (int i = 0; i < CPM_FILE_HANDLES; ++i)
+	{
+		if (cpmFiles[i].f)
+			_sys_closehandle(&cpmFiles[i]);
+		free(cpmFiles[i].buf);
+		cpmFiles[i].buf = NULL;
+	}
+}
+
+#endif // ABSTRACTION_FUJINET_FILES_H
@@ -623,6 +623,7 @@ uint8 _ccp_ext(void) {
         SP = BDOSjmppage;								// Sets the stack to the top of the TPA
         
         Z80run();										// Starts Z80 simulation
+        _sys_closeall();								// Writes what the program left open
         
         error = FALSE;
     }
@@ -977,6 +977,7 @@ void _Bdos(void) {
 		   C = 13 (0Dh) : Reset disk system
 		 */
 		case DRV_ALLRESET: {
+			_sys_closeall();
 			roVector = 0;       // Make all drives R/W
 			loginVector = 0;
 			dmaAddr = 0x0080;
@@ -1191,6 +1192,7 @@ void _Bdos(void) {
 		   C = 37 (25h) : Reset drive
 		 */
 		case DRV_RESET: {
+			_sys_closeall();
 			roVector = roVector & ~DE;
 			break;
 		}
@@ -9,6 +9,11 @@
 /* Definition for enabling incrementing the R register for each M1 cycle */
 #define DO_INCR
 
+/* Definition for the Z80 instruction dispatch */
+#ifndef CPU_SWITCH
+#define CPU_FAST	// If this is defined, instructions jump to the next one through a table (GCC computed goto)
+#endif				// instead of returning to the switch, ignored with DEBUG or iDEBUG
+
 /* Definitions for enabling PUN: and LST: devices */
 //#define USE_PUN	// The pun.txt and lst.txt files will appear on drive A: user 0
 //#define USE_LST
@@ -3,6 +3,7 @@
 #include <string.h>
 #include <stdlib.h>
 
+#include "sam.h"
 #include "render.h"
 #include "RenderTabs.h"
 
@@ -50,6 +51,11 @@ unsigned char trans(unsigned char mem39212, unsigned char mem39213);
 extern int bufferpos;
 extern char *buffer;
 
+// streaming output
+extern SamOutputCallback outputCallback;
+extern int outputChunk;
+void StreamOutput(int final);
+
 //timetable for more accurate c64 simulation
 int timetable[5][5] =
     {
@@ -72,6 +78,8 @@ void Output8BitAry(int index, unsigned char ary[5])
         // printf("%d %d\r\n", bufferpos,k);
         buffer[bufferpos / 50 + k] = ary[k];
     }
+    if (outputCallback != NULL && bufferpos >= outputChunk * 50)
+        StreamOutput(0);
 }
 void Output8Bit(int index, unsigned char A)
 {
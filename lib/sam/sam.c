@@ -1,7 +1,9 @@
 
 #include "sam.h"
 
+#ifdef ESP_PLATFORM
 #include <esp_heap_caps.h>
+#endif
 
 #include <stdio.h>
 #include <string.h>
@@ -47,6 +49,14 @@ unsigned char phonemeLengthOutput[60]; //tab47416
 int bufferpos = 0;
 char *buffer = NULL;
 
+// streaming output, buffer only holds the chunk being rendered
+// Render() writes up to 9 samples past a full chunk before it is sent
+#define STREAM_SLACK 16
+SamOutputCallback outputCallback = NULL;
+void *outputUser = NULL;
+int outputChunk = 0;
+int streamedpos = 0; // bufferpos of the start of buffer
+
 void SetInput(char *_input)
 {
     int i, l;
@@ -64,8 +74,33 @@ void SetMouth(unsigned char _mouth) { mouth = _mouth; }
 void SetThroat(unsigned char _throat) { throat = _throat; }
 void EnableSingmode() { singmode = 1; }
 char *GetBuffer() { return buffer; }
-int GetBufferLength() { return bufferpos; }
-void FreeBuffer() { free(buffer); }
+int GetBufferLength() { return streamedpos + bufferpos; }
+void FreeBuffer()
+{
+    free(buffer);
+    buffer = NULL;
+}
+
+void SetOutputCallback(SamOutputCallback callback, void *user, int chunkSize)
+{
+    outputCallback = callback;
+    outputUser = user;
+    outputChunk = chunkSize < STREAM_SLACK ? STREAM_SLACK : chunkSize;
+}
+
+// Sends a full chunk, or everything rendered at the end, and moves the
+// samples written ahead to the start of the buffer
+void StreamOutput(int final)
+{
+    int n = final ? bufferpos / 50 : outputChunk;
+
+    if (n > 0)
+        outputCallback((unsigned char *)buffer, n, outputUser);
+    memmove(buffer, buffer + n, STREAM_SLACK);
+    memset(buffer + STREAM_SLACK, 0x80, outputChunk);
+    bufferpos -= n * 50;
+    streamedpos += n * 50;
+}
 
 void Init();
 int Parser1();
@@ -97,10 +132,25 @@ void Init()
     SetMouthThroat(mouth, throat);
 
     bufferpos = 0;
-    // TODO, check for free the memory, 10 seconds of output should be more than enough
-    //buffer = (char*)ps_malloc(22050 * 5);
-    // switch to ESP-IDF equivalent
-    buffer = (char *)heap_caps_malloc(22050 * 10, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    streamedpos = 0;
+    if (outputCallback != NULL)
+    {
+        buffer = (char *)malloc(outputChunk + STREAM_SLACK);
+    }
+    else
+    {
+        // TODO, check for free the memory, 10 seconds of output should be more than enough
+        //buffer = (char*)ps_malloc(22050 * 5);
+        // switch to ESP-IDF equivalent
+#ifdef ESP_PLATFORM
+        buffer = (char *)heap_caps_malloc(22050 * 10, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#else
+        buffer = (char *)malloc(22050 * 10);
+#endif
+    }
+    // the first samples are skipped over by Render(), they are left silent
+    if (buffer != NULL)
+        memset(buffer, 0x80, outputCallback != NULL ? outputChunk + STREAM_SLACK : 22050 * 10);
     /*
     Due to a technical limitation, the maximum statically allocated DRAM usage is 160KB. 
     The remaining 160KB (for a total of 320KB of DRAM) can only be allocated at runtime as heap.
@@ -151,6 +201,8 @@ void Init()
 int SAMMain()
 {
     Init();
+    if (buffer == NULL)
+        return 0;
     phonemeindex[255] = 32; //to prevent buffer overflow
 
     if (!Parser1())
@@ -184,6 +236,12 @@ int SAMMain()
 
     PrepareOutput();
 
+    if (outputCallback != NULL)
+    {
+        StreamOutput(1);
+        FreeBuffer();
+    }
+
     return 1;
 }
 
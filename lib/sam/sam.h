@@ -19,6 +19,12 @@ extern "C"
     char *GetBuffer();
     int GetBufferLength();
     void FreeBuffer();
+
+    // Streaming output: SAMMain() passes the 8 bit 22050 Hz samples to the
+    // callback chunkSize at a time while it renders, instead of rendering the
+    // whole utterance into the buffer first. NULL callback renders to the buffer.
+    typedef void (*SamOutputCallback)(const unsigned char *samples, int length, void *user);
+    void SetOutputCallback(SamOutputCallback callback, void *user, int chunkSize);
     
     //char input[]={"/HAALAOAO MAYN NAAMAEAE IHSTT SAEBAASTTIHAAN \x9b\x9b\0"};
     //unsigned char input[]={"/HAALAOAO \x9b\0"};
@@ -155,6 +155,18 @@ void OutputSound()
 
 #else
 
+#if defined(ESP_PLATFORM) && !defined(CONFIG_IDF_TARGET_ESP32S3)
+// Plays each chunk as soon as SAMMain() has rendered it
+void PlayChunk(const unsigned char *samples, int length, void *user)
+{
+    for (int i = 0; i < length; i++)
+    {
+        dac_output_voltage(DAC_CHANNEL_1, samples[i]);
+        fnSystem.delay_microseconds(40);
+    }
+}
+#endif
+
 void OutputSound()
 {
 #ifdef ESP_PLATFORM
@@ -308,6 +320,19 @@ int sam(int argc, char **argv)
 
     // printf("right before SAMMain");
 
+#if defined(ESP_PLATFORM) && !defined(CONFIG_IDF_TARGET_ESP32S3)
+    // Speak while rendering, in constant memory
+    SetOutputCallback(PlayChunk, NULL, SAM_CHUNK_SIZE);
+    dac_output_enable(DAC_CHANNEL_1);
+    int ok = SAMMain();
+    dac_output_disable(DAC_CHANNEL_1);
+    FreeBuffer();
+    if (!ok)
+    {
+        PrintUsage();
+        return 1;
+    }
+#else
     if (!SAMMain())
     {
         PrintUsage();
@@ -321,6 +346,7 @@ int sam(int argc, char **argv)
     else
 #endif // ESP_PLATFORM
         OutputSound();
+#endif
 
     return 0;
 }
@@ -20,6 +20,11 @@
 extern char input[256];
 #endif
 
+// Samples rendered ahead of playback, 23 ms at 22050 Hz
+#ifndef SAM_CHUNK_SIZE
+#define SAM_CHUNK_SIZE 512
+#endif
+
 #ifndef ESP_PLATFORM
 void WriteWav(char *filename, char *buffer, int bufferlength);
 #endif // ESP_PLATFORM
@@ -1,5 +1,3 @@
-#ifndef ESP_PLATFORM
-
 #include "fnTask.h"
 #include "debug.h"
 
@@ -75,5 +73,3 @@ int fnTestTask::step()
         return 0;   // continue
     return 1;       // done
 }
-
-#endif // !ESP_PLATFORM
\ No newline at end of file
@@ -1,5 +1,3 @@
-#ifndef ESP_PLATFORM
-
 #include <list>
 
 #include "fnTaskManager.h"
@@ -24,6 +22,7 @@ fnTaskManager::~fnTaskManager()
 
 void fnTaskManager::shutdown()
 {
+    std::lock_guard<std::recursive_mutex> lock(_task_lock);
     // abort tasks, if any
     for (auto it = _task_map.begin(); it != _task_map.end(); ++it)
     {
@@ -37,6 +36,7 @@ void fnTaskManager::shutdown()
 
 int fnTaskManager::submit_task(fnTask * t)
 {
+    std::lock_guard<std::recursive_mutex> lock(_task_lock);
     Debug_println("submit_task");
 
     for (auto it = _task_map.begin(); it != _task_map.end(); ++it)
@@ -94,6 +94,7 @@ fnTask * fnTaskManager::get_task(uint8_t tid)
 
 int fnTaskManager::pause_task(uint8_t tid)
 {
+    std::lock_guard<std::recursive_mutex> lock(_task_lock);
     Debug_printf("pause_task %d\n", tid);
     fnTask *task = get_task(tid);
     if (task == nullptr)
@@ -108,6 +109,7 @@ int fnTaskManager::pause_task(uint8_t tid)
 
 int fnTaskManager::resume_task(uint8_t tid)
 {
+    std::lock_guard<std::recursive_mutex> lock(_task_lock);
     Debug_printf("resume_task %d\n", tid);
     fnTask *task = get_task(tid);
     if (task == nullptr)
@@ -122,6 +124,7 @@ int fnTaskManager::resume_task(uint8_t tid)
 
 int fnTaskManager::abort_task(uint8_t tid)
 {
+    std::lock_guard<std::recursive_mutex> lock(_task_lock);
     Debug_printf("abort_task %d\n", tid);
     fnTask *task = get_task(tid);
     if (task == nullptr)
@@ -158,6 +161,7 @@ bool fnTaskManager::service()
     if (_task_count == 0)
         return true; // idle
 
+    std::lock_guard<std::recursive_mutex> lock(_task_lock);
     bool idle = true; // was service() idle?
     int result;
     fnTask *task;
@@ -209,5 +213,3 @@ bool fnTaskManager::service()
 
     return idle;
 }
-
-#endif // !ESP_PLATFORM
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <map>
+#include <mutex>
 
 #include "fnTask.h"
 
@@ -25,6 +26,8 @@ private:
     uint8_t get_free_tid();
     void shutdown();
 
+    // Tasks may be aborted from another thread (web server) while service() steps them
+    std::recursive_mutex _task_lock;
     std::map<uint8_t, fnTask *> _task_map;
     uint8_t _next_tid;
     uint8_t _task_count;
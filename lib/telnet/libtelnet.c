@@ -964,11 +964,39 @@ static telnet_error_t _buffer_byte(telnet_t *telnet,
 	return TELNET_EOK;
 }
 
+#if !defined(TELNET_BYTEWISE)
+/* find the next byte in regular data the state tracker has to look at: an
+ * IAC, or a '\r' when NVT EOL translation is on.  the data before it is
+ * passed through as a whole, so it is skipped with memchr instead of going
+ * through the state machine byte by byte.  returns size if there is none.
+ */
+static size_t _scan_data(telnet_t *telnet, const char *buffer, size_t i,
+		size_t size) {
+	const char *p = (const char *)memchr(buffer + i, TELNET_IAC, size - i);
+	size_t end = p != 0 ? (size_t)(p - buffer) : size;
+
+	if ((telnet->flags & TELNET_FLAG_NVT_EOL) &&
+			!(telnet->flags & TELNET_FLAG_RECEIVE_BINARY)) {
+		p = (const char *)memchr(buffer + i, '\r', end - i);
+		if (p != 0)
+			end = (size_t)(p - buffer);
+	}
+	return end;
+}
+#endif /* !defined(TELNET_BYTEWISE) */
+
 static void _process(telnet_t *telnet, const char *buffer, size_t size) {
 	telnet_event_t ev;
 	unsigned char byte;
 	size_t i, start;
 	for (i = start = 0; i != size; ++i) {
+#if !defined(TELNET_BYTEWISE)
+		if (telnet->state == TELNET_STATE_DATA) {
+			i = _scan_data(telnet, buffer, i, size);
+			if (i == size)
+				break;
+		}
+#endif /* !defined(TELNET_BYTEWISE) */
 		byte = buffer[i];
 		switch (telnet->state) {
 		/* regular data */
@@ -1325,25 +1353,26 @@ void telnet_negotiate(telnet_t *telnet, unsigned char cmd,
 /* send non-command data (escapes IAC bytes) */
 void telnet_send(telnet_t *telnet, const char *buffer,
 		size_t size) {
-	size_t i, l;
+	size_t l = 0;
+	const char *iac;
 
-	for (l = i = 0; i != size; ++i) {
-		/* dump prior portion of text, send escaped bytes */
-		if (buffer[i] == (char)TELNET_IAC) {
-			/* dump prior text if any */
-			if (i != l) {
-				_send(telnet, buffer + l, i - l);
-			}
-			l = i + 1;
+	/* dump prior portion of text, send escaped bytes */
+	while ((iac = (const char *)memchr(buffer + l, TELNET_IAC, size - l)) != 0) {
+		size_t i = (size_t)(iac - buffer);
 
-			/* send escape */
-			telnet_iac(telnet, TELNET_IAC);
+		/* dump prior text if any */
+		if (i != l) {
+			_send(telnet, buffer + l, i - l);
 		}
+		l = i + 1;
+
+		/* send escape */
+		telnet_iac(telnet, TELNET_IAC);
 	}
 
 	/* send whatever portion of buffer is left */
-	if (i != l) {
-		_send(telnet, buffer + l, i - l);
+	if (size != l) {
+		_send(telnet, buffer + l, size - l);
 	}
 }
 
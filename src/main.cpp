@@ -27,9 +27,9 @@
 #include "fnFsSD.h"
 
 #include "httpService.h"
+#include "fnTaskManager.h"
 
 #ifndef ESP_PLATFORM
-#include "fnTaskManager.h"
 #include "version.h"
 #include "build_version.h"
 #endif
@@ -71,6 +71,10 @@ void print_version()
 
 volatile int exit_for_restart = 0;
 
+#ifdef SIO_TRACE_REPLAY
+const char *sio_replay_trace = nullptr;
+#endif
+
 void sighandler(int signum)
 {
 #if !defined(_WIN32)
@@ -91,6 +95,9 @@ void main_shutdown_handler()
     // Give devices an opportunity to clean up before rebooting
 
     SYSTEM_BUS.shutdown();
+
+    // Write config changes that are still waiting to be saved
+    Config.flush();
 }
 
 // Initial setup
@@ -104,7 +111,17 @@ void main_setup(int argc, char *argv[])
     // program arguments
 #ifndef ESP_PLATFORM
     int opt;
-    while ((opt = getopt(argc, argv, "Vu:c:s:")) != -1) {
+#if defined(SIO_TRACE_REPLAY)
+    const char *optstring = "Vu:c:s:t:r:";
+    const char *usage = "Usage: %s [-V] [-u URL] [-c config_file] [-s SD_directory] [-t record_trace_file] -r replay_trace_file\n";
+#elif defined(BUILD_ATARI)
+    const char *optstring = "Vu:c:s:t:";
+    const char *usage = "Usage: %s [-V] [-u URL] [-c config_file] [-s SD_directory] [-t record_trace_file]\n";
+#else
+    const char *optstring = "Vu:c:s:";
+    const char *usage = "Usage: %s [-V] [-u URL] [-c config_file] [-s SD_directory]\n";
+#endif
+    while ((opt = getopt(argc, argv, optstring)) != -1) {
         switch (opt) {
             case 'V':
                 print_version();
@@ -118,8 +135,20 @@ void main_setup(int argc, char *argv[])
             case 's':
                 Config.store_general_SD_path(optarg);
                 break;
+#ifdef BUILD_ATARI
+            case 't':
+                // record SIO commands into trace file
+                if (!fnSioTrace.start(optarg))
+                    exit(EXIT_FAILURE);
+                break;
+#endif
+#ifdef SIO_TRACE_REPLAY
+            case 'r':
+                sio_replay_trace = optarg;
+                break;
+#endif
             default: /* '?' */
-                fprintf(stderr, "Usage: %s [-V] [-u URL] [-c config_file] [-s SD_directory]\n", argv[0]);
+                fprintf(stderr, usage, argv[0]);
                 exit(EXIT_FAILURE);
         }
     }
@@ -501,14 +530,16 @@ void fn_service_loop(void *param)
 #endif
         SYSTEM_BUS.service();
 
+        taskMgr.service();
+
+        Config.service();
+
 #ifdef ESP_PLATFORM
         taskYIELD(); // Allow other tasks to run
 #else
 // !ESP_PLATFORM
         fnHTTPD.service();
 
-        taskMgr.service();
-
         if (fnSystem.check_deferred_reboot())
         {
             // stop the web server first
@@ -556,10 +587,52 @@ extern "C"
 #else
 // !ESP_PLATFORM
 
+#ifdef SIO_TRACE_REPLAY
+/*
+ * Replay recorded SIO trace against configured devices (disks, network, fuji)
+ * and report per-command latency percentiles
+ */
+int sio_trace_replay()
+{
+    if (sio_replay_trace == nullptr)
+    {
+        fprintf(stderr, "No trace file to replay, use -r replay_trace_file\n");
+        return EXIT_FAILURE;
+    }
+    if (!fnSioCom.set_trace_file(sio_replay_trace))
+    {
+        fprintf(stderr, "Failed to load trace file \"%s\"\n", sio_replay_trace);
+        return EXIT_FAILURE;
+    }
+
+    TraceSioPort *port = fnSioCom.get_trace_port();
+    fnSioCom.reset_sio_port(SioCom::sio_mode::TRACE);
+    fnSioTrace.set_collect(true);
+
+    uint64_t startus = fnSystem.micros();
+    while (!port->finished() && fnSystem.check_for_shutdown() == 0)
+    {
+        SYSTEM_BUS.service();
+        taskMgr.service();
+    }
+    uint64_t elapsedus = fnSystem.micros() - startus;
+
+    size_t replayed = fnSioTrace.samples().size();
+    printf("Replayed %zu of %zu commands in %.3f s (%.1f commands/s), %zu bytes sent to computer\n",
+           replayed, port->commands_total(), elapsedus / 1000000.0,
+           elapsedus ? replayed * 1000000.0 / elapsedus : 0.0, port->bytes_written());
+    fnSioTrace.print_report(stdout);
+    return EXIT_SUCCESS;
+}
+#endif // SIO_TRACE_REPLAY
+
 int main(int argc, char *argv[])
 {
     // Call our setup routine
     main_setup(argc, argv);
+#ifdef SIO_TRACE_REPLAY
+    return sio_trace_replay();
+#endif
     // Enter service loop
     fn_service_loop(nullptr);
 